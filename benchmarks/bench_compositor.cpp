@@ -0,0 +1,112 @@
+// CPU compositing at 1080p: one benchmark per blend mode and transition,
+// plus layer-count scaling for the common Normal case.
+
+#include "synthetic_media.h"
+
+#include "core/frame_pool.h"
+#include "core/thread_pool.h"
+#include "render/cpu_compositor.h"
+
+#include <benchmark/benchmark.h>
+
+#include <initializer_list>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace scp::bench {
+namespace {
+
+constexpr int kWidth = 1920;
+constexpr int kHeight = 1080;
+
+void run(benchmark::State &state, FramePool &pool, std::vector<CompositeLayer> &layers,
+         PixelFormat outputFormat)
+{
+    CpuCompositor compositor(ThreadPool::shared());
+    FrameRef output = pool.acquire({kWidth, kHeight, outputFormat});
+    for (auto _ : state) {
+        if (!compositor.composite(layers, *output)) {
+            state.SkipWithError("composite failed");
+            break;
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * std::int64_t(layers.size()) * kWidth * kHeight);
+}
+
+// A full-frame background plus one half-transparent layer on top.
+void blend(benchmark::State &state, BlendMode mode, PixelFormat format)
+{
+    FramePool pool;
+    std::vector<CompositeLayer> layers(2);
+    layers[0].frame = makeSyntheticFrame(pool, {kWidth, kHeight, format}, 1);
+    layers[1].frame = makeSyntheticFrame(pool, {kWidth, kHeight, format}, 2);
+    layers[1].opacity = 0.5f;
+    layers[1].blend = mode;
+    run(state, pool, layers, format);
+}
+
+void transition(benchmark::State &state, TransitionKind kind)
+{
+    FramePool pool;
+    std::vector<CompositeLayer> layers(1);
+    layers[0].frame = makeSyntheticFrame(pool, {kWidth, kHeight, PixelFormat::RGBA8}, 1);
+    layers[0].transition.kind = kind;
+    layers[0].transition.target = makeSyntheticFrame(pool, {kWidth, kHeight, PixelFormat::RGBA8}, 2);
+    layers[0].transition.progress = 0.5f;
+    layers[0].transition.softness = 0.05f;
+    run(state, pool, layers, PixelFormat::RGBA8);
+}
+
+// Picture-in-picture stack: background plus n-1 quarter-size overlays.
+void layerCount(benchmark::State &state)
+{
+    FramePool pool;
+    std::vector<CompositeLayer> layers(state.range(0));
+    layers[0].frame = makeSyntheticFrame(pool, {kWidth, kHeight, PixelFormat::RGBA8}, 0);
+    for (std::size_t i = 1; i < layers.size(); ++i) {
+        layers[i].frame = makeSyntheticFrame(pool, {kWidth / 2, kHeight / 2, PixelFormat::RGBA8},
+                                             std::uint32_t(i));
+        layers[i].x = int(i * 97) % (kWidth / 2);
+        layers[i].y = int(i * 53) % (kHeight / 2);
+        layers[i].opacity = 0.8f;
+    }
+    run(state, pool, layers, PixelFormat::RGBA8);
+}
+BENCHMARK(layerCount)
+    ->Name("Composite/Layers")
+    ->RangeMultiplier(2)
+    ->Range(2, 16)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+const bool kRegistered = [] {
+    const BlendMode modes[] = {BlendMode::Normal,  BlendMode::Add,     BlendMode::Multiply,
+                               BlendMode::Screen,  BlendMode::Overlay, BlendMode::Darken,
+                               BlendMode::Lighten, BlendMode::Difference};
+    for (PixelFormat format : {PixelFormat::RGBA8, PixelFormat::RGBA16F}) {
+        for (BlendMode mode : modes) {
+            const std::string name = std::string("Composite/Blend/") + blendModeName(mode) + "/"
+                                     + pixelFormatName(format);
+            benchmark::RegisterBenchmark(name.c_str(), blend, mode, format)
+                ->Unit(benchmark::kMicrosecond)
+                ->UseRealTime();
+        }
+    }
+    const std::pair<TransitionKind, const char *> transitions[] = {
+        {TransitionKind::Dissolve, "Dissolve"},
+        {TransitionKind::WipeRight, "WipeRight"},
+        {TransitionKind::WipeDown, "WipeDown"},
+    };
+    for (const auto &[kind, label] : transitions) {
+        benchmark::RegisterBenchmark((std::string("Composite/Transition/") + label).c_str(),
+                                     transition, kind)
+            ->Unit(benchmark::kMicrosecond)
+            ->UseRealTime();
+    }
+    return true;
+}();
+
+} // namespace
+} // namespace scp::bench
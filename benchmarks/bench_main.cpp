@@ -0,0 +1,26 @@
+// Entry point for the engine microbenchmarks.
+//
+// Run with --benchmark_out=results.json --benchmark_out_format=json to keep
+// a machine-readable record; see README.md for comparing two runs.
+
+#include "core/cpu_features.h"
+#include "core/thread_pool.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+int main(int argc, char **argv)
+{
+    // Recorded in the JSON context block so results from different kernel
+    // levels or core counts are not compared by accident.
+    benchmark::AddCustomContext("scp_simd_level", scp::simdLevelName(scp::activeSimdLevel()));
+    benchmark::AddCustomContext("scp_pool_threads", std::to_string(scp::ThreadPool::shared().size()));
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,327 @@
+// Media I/O on a synthetic MPEG-4 clip: container open, demux, decode,
+// keyframe indexing, adopting decoded frames and export segment muxing.
+
+#include "synthetic_media.h"
+
+#include "jobs/export_segments.h"
+#include "media/av_frame.h"
+#include "media/cpu_decode_backend.h"
+#include "media/decoder_pool.h"
+#include "media/demuxer.h"
+#include "media/keyframe_index.h"
+#include "media/media_error.h"
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace scp::bench {
+namespace {
+
+const SyntheticClipSpec kClip{1280, 720, 120, 12, 25};
+
+// Runs body, turning a MediaError into a skipped benchmark.
+template<typename Body>
+void guarded(benchmark::State &state, Body body)
+{
+    try {
+        body();
+    } catch (const MediaError &e) {
+        state.SkipWithError(e.what());
+    }
+}
+
+AVCodecContextPtr openDecoder(const AVStream *stream, int threads)
+{
+    const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    if (!codec)
+        throw MediaError("no decoder for synthetic clip");
+    AVCodecContextPtr decoder(avcodec_alloc_context3(codec));
+    int error = avcodec_parameters_to_context(decoder.get(), stream->codecpar);
+    if (error < 0)
+        throw MediaError("cannot configure decoder", error);
+    decoder->thread_count = threads;
+    decoder->pkt_timebase = stream->time_base;
+    error = avcodec_open2(decoder.get(), codec, nullptr);
+    if (error < 0)
+        throw MediaError("cannot open decoder", error);
+    return decoder;
+}
+
+// Returns the number of frames received.
+std::int64_t drain(AVCodecContext *decoder, AVFrame *frame, bool adopt)
+{
+    std::int64_t frames = 0;
+    int error;
+    while ((error = avcodec_receive_frame(decoder, frame)) >= 0) {
+        if (adopt)
+            benchmark::DoNotOptimize(adoptAVFrame(frame));
+        av_frame_unref(frame);
+        ++frames;
+    }
+    if (error != AVERROR(EAGAIN) && error != AVERROR_EOF)
+        throw MediaError("cannot decode synthetic clip", error);
+    return frames;
+}
+
+void BM_Open(benchmark::State &state)
+{
+    guarded(state, [&] {
+        const std::string path = syntheticClip(kClip);
+        for (auto _ : state) {
+            Demuxer demuxer(path);
+            benchmark::DoNotOptimize(demuxer.context());
+        }
+    });
+}
+BENCHMARK(BM_Open)->Name("Media/Open")->Unit(benchmark::kMicrosecond);
+
+void BM_Demux(benchmark::State &state)
+{
+    guarded(state, [&] {
+        Demuxer demuxer(syntheticClip(kClip));
+        const int stream = demuxer.bestVideoStream();
+        demuxer.selectStream(stream);
+        AVPacketPtr packet(av_packet_alloc());
+        std::int64_t packets = 0;
+        std::int64_t bytes = 0;
+        for (auto _ : state) {
+            demuxer.seek(stream, 0);
+            while (demuxer.readPacket(packet.get())) {
+                bytes += packet->size;
+                ++packets;
+                av_packet_unref(packet.get());
+            }
+        }
+        state.SetItemsProcessed(packets);
+        state.SetBytesProcessed(bytes);
+    });
+}
+BENCHMARK(BM_Demux)->Name("Media/Demux")->Unit(benchmark::kMicrosecond);
+
+// Arguments: decoder threads (0 = FFmpeg's choice), adopt frames into
+// FrameRefs (1) or just unref them (0).
+void BM_Decode(benchmark::State &state)
+{
+    guarded(state, [&] {
+        Demuxer demuxer(syntheticClip(kClip));
+        const int stream = demuxer.bestVideoStream();
+        demuxer.selectStream(stream);
+        AVCodecContextPtr decoder = openDecoder(demuxer.stream(stream), int(state.range(0)));
+        const bool adopt = state.range(1) != 0;
+        AVPacketPtr packet(av_packet_alloc());
+        AVFramePtr frame(av_frame_alloc());
+        std::int64_t frames = 0;
+        for (auto _ : state) {
+            demuxer.seek(stream, 0);
+            avcodec_flush_buffers(decoder.get());
+            while (demuxer.readPacket(packet.get())) {
+                const int error = avcodec_send_packet(decoder.get(), packet.get());
+                av_packet_unref(packet.get());
+                if (error < 0)
+                    throw MediaError("cannot decode synthetic clip", error);
+                frames += drain(decoder.get(), frame.get(), adopt);
+            }
+            avcodec_send_packet(decoder.get(), nullptr);
+            frames += drain(decoder.get(), frame.get(), adopt);
+        }
+        state.SetItemsProcessed(frames);
+    });
+}
+BENCHMARK(BM_Decode)
+    ->Name("Media/Decode")
+    ->ArgNames({"threads", "adopt"})
+    ->Args({1, 0})
+    ->Args({0, 0})
+    ->Args({1, 1})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+void BM_KeyframeIndex(benchmark::State &state)
+{
+    guarded(state, [&] {
+        const std::string path = syntheticClip(kClip);
+        for (auto _ : state)
+            benchmark::DoNotOptimize(KeyframeIndex::build(path));
+        state.SetItemsProcessed(state.iterations() * kClip.frames);
+    });
+}
+BENCHMARK(BM_KeyframeIndex)->Name("Media/KeyframeIndexBuild")->Unit(benchmark::kMicrosecond);
+
+// Stream-copy join of state.range(0) segments, as at the end of a parallel
+// export.
+void BM_ConcatSegments(benchmark::State &state)
+{
+    guarded(state, [&] {
+        const std::string part = syntheticClip(kClip);
+        const std::vector<std::string> parts(state.range(0), part);
+        const std::string output = scratchPath("concat.mp4");
+        for (auto _ : state)
+            concatSegments(parts, output);
+        std::error_code error;
+        state.SetBytesProcessed(state.iterations() * std::int64_t(parts.size())
+                                * std::int64_t(std::filesystem::file_size(part, error)));
+        std::filesystem::remove(output, error);
+    });
+}
+BENCHMARK(BM_ConcatSegments)
+    ->Name("Media/ConcatSegments")
+    ->Arg(2)
+    ->Arg(8)
+    ->Unit(benchmark::kMillisecond);
+
+// Alternating cuts between two points of one source, as on a multicam edit:
+// each cut decodes one frame, either from a freshly opened decoder
+// (pooled:0) or from a session leased from a DecoderPool (pooled:1).
+void BM_CutSwitch(benchmark::State &state)
+{
+    guarded(state, [&] {
+        const std::string path = syntheticClip(kClip);
+        const bool pooled = state.range(0) != 0;
+        DecoderOptions options;
+        options.budget = nullptr;
+        options.threads = 1;
+        const AVRational timeBase = VideoDecoder(path, -1, options).stream()->time_base;
+        DecoderPool pool(4, options);
+        std::int64_t cut = 0;
+        for (auto _ : state) {
+            // Frames 0.. and 60.., advancing one frame per visit.
+            const std::int64_t frame = (cut % 2) * 60 + (cut / 2) % 30;
+            ++cut;
+            const std::int64_t pts = av_rescale_q(frame, AVRational{1, kClip.frameRate}, timeBase);
+            if (pooled) {
+                DecoderLease lease = pool.acquire(path, -1, pts);
+                benchmark::DoNotOptimize(lease->decodeAt(pts));
+            } else {
+                VideoDecoder decoder(path, -1, options);
+                benchmark::DoNotOptimize(decoder.decodeAt(pts));
+            }
+        }
+    });
+}
+BENCHMARK(BM_CutSwitch)
+    ->Name("Media/CutSwitch")
+    ->ArgName("pooled")
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMicrosecond);
+
+// state.range(0) streams decoding at once, as in multicam playback. Each
+// decoder either lets FFmpeg pick its thread count (budget:0), which
+// oversubscribes the machine, or takes a share of one DecodeThreadBudget.
+void BM_ConcurrentDecode(benchmark::State &state)
+{
+    guarded(state, [&] {
+        const std::string path = syntheticClip(kClip);
+        const int streams = int(state.range(0));
+        DecodeThreadBudget budget;
+        budget.setExpectedStreams(streams);
+        DecoderOptions options;
+        options.budget = state.range(1) ? &budget : nullptr;
+
+        std::vector<std::unique_ptr<VideoDecoder>> decoders;
+        for (int i = 0; i < streams; ++i)
+            decoders.push_back(std::make_unique<VideoDecoder>(path, -1, options));
+        std::int64_t frames = 0;
+        for (auto _ : state) {
+            std::vector<std::thread> threads;
+            std::vector<std::int64_t> counts(streams, 0);
+            std::vector<std::string> errors(streams);
+            for (int i = 0; i < streams; ++i) {
+                threads.emplace_back([&, i] {
+                    try {
+                        VideoDecoder &decoder = *decoders[i];
+                        decoder.seek(0);
+                        while (decoder.decodeNext())
+                            ++counts[i];
+                    } catch (const MediaError &e) {
+                        errors[i] = e.what();
+                    }
+                });
+            }
+            for (std::thread &thread : threads)
+                thread.join();
+            for (const std::string &error : errors) {
+                if (!error.empty())
+                    throw MediaError(error);
+            }
+            for (std::int64_t count : counts)
+                frames += count;
+        }
+        state.SetItemsProcessed(frames);
+        state.counters["threads"] = options.budget ? budget.granted() : 0;
+    });
+}
+BENCHMARK(BM_ConcurrentDecode)
+    ->Name("Media/ConcurrentDecode")
+    ->ArgNames({"streams", "budget"})
+    ->ArgsProduct({{1, 4, 8}, {0, 1}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// The asynchronous decode pipeline on the CPU backend. The consumer keeps
+// the last `held` frames alive, as a render graph and frame cache would;
+// with fewer surfaces than that plus the decoder's needs, decoding stalls.
+void BM_DecodeBackend(benchmark::State &state)
+{
+    guarded(state, [&] {
+        Demuxer demuxer(syntheticClip(kClip));
+        const int stream = demuxer.bestVideoStream();
+        demuxer.selectStream(stream);
+        DecodeBackendConfig config;
+        config.queueDepth = int(state.range(0));
+        config.surfaces = int(state.range(1));
+        const std::size_t held = std::size_t(state.range(2));
+        CpuDecodeBackend backend(demuxer.stream(stream), config);
+        AVPacketPtr packet(av_packet_alloc());
+        std::int64_t frames = 0;
+
+        for (auto _ : state) {
+            demuxer.seek(stream, 0);
+            backend.flush();
+            std::deque<FrameRef> holding;
+            auto consume = [&](std::chrono::milliseconds wait) {
+                if (FrameRef frame = backend.poll(wait)) {
+                    holding.push_back(std::move(frame));
+                    if (holding.size() > held)
+                        holding.pop_front();
+                    ++frames;
+                }
+            };
+            bool more = true;
+            while (more) {
+                more = demuxer.readPacket(packet.get());
+                while (!backend.submit(more ? packet.get() : nullptr))
+                    consume(std::chrono::milliseconds(1));
+                av_packet_unref(packet.get());
+            }
+            while (!backend.finished())
+                consume(std::chrono::milliseconds(1));
+        }
+        const DecodeBackendStats stats = backend.stats();
+        state.SetItemsProcessed(frames);
+        state.counters["stalls"] = benchmark::Counter(double(stats.surfaceStalls),
+                                                      benchmark::Counter::kAvgIterations);
+        state.counters["rejected"] = benchmark::Counter(double(stats.submitsRejected),
+                                                        benchmark::Counter::kAvgIterations);
+    });
+}
+BENCHMARK(BM_DecodeBackend)
+    ->Name("Media/DecodeBackend/cpu")
+    ->ArgNames({"depth", "surfaces", "held"})
+    ->Args({1, 4, 2})
+    ->Args({4, 8, 2})
+    ->Args({4, 4, 3})
+    ->Args({8, 16, 8})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+} // namespace
+} // namespace scp::bench
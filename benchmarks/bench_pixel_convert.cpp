@@ -0,0 +1,61 @@
+// Pixel format conversion at 1080p, for every supported format pair and
+// every kernel level the CPU can run.
+
+#include "synthetic_media.h"
+
+#include "core/frame_pool.h"
+#include "core/pixel_convert.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <utility>
+
+namespace scp::bench {
+namespace {
+
+constexpr int kWidth = 1920;
+constexpr int kHeight = 1080;
+
+void convert(benchmark::State &state, PixelFormat from, PixelFormat to, SimdLevel level)
+{
+    FramePool pool;
+    FrameRef source = makeSyntheticFrame(pool, {kWidth, kHeight, from}, 1);
+    FrameRef destination = pool.acquire({kWidth, kHeight, to});
+    const ColorSpec spec{ColorMatrix::BT709, ColorRange::Limited};
+
+    for (auto _ : state) {
+        convertFrame(*source, *destination, spec, level);
+        benchmark::DoNotOptimize(destination->data(0));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * kWidth * kHeight);
+    state.SetBytesProcessed(state.iterations()
+                            * std::int64_t(FramePool::bufferBytes(source->format())));
+}
+
+const bool kRegistered = [] {
+    const std::pair<PixelFormat, PixelFormat> pairs[] = {
+        {PixelFormat::YUV420P, PixelFormat::RGBA8},   {PixelFormat::YUV420P, PixelFormat::RGBA16F},
+        {PixelFormat::NV12, PixelFormat::RGBA8},      {PixelFormat::NV12, PixelFormat::RGBA16F},
+        {PixelFormat::P010, PixelFormat::RGBA8},      {PixelFormat::P010, PixelFormat::RGBA16F},
+        {PixelFormat::RGBA8, PixelFormat::YUV420P},   {PixelFormat::RGBA8, PixelFormat::NV12},
+        {PixelFormat::RGBA16F, PixelFormat::P010},
+    };
+    const SimdLevel levels[] = {SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2,
+                                SimdLevel::AVX512, SimdLevel::NEON};
+    for (const auto &[from, to] : pairs) {
+        for (SimdLevel level : levels) {
+            if (!isSimdLevelSupported(level))
+                continue;
+            const std::string name = std::string("PixelConvert/") + pixelFormatName(from) + "->"
+                                     + pixelFormatName(to) + "/" + simdLevelName(level);
+            benchmark::RegisterBenchmark(name.c_str(), convert, from, to, level)
+                ->Unit(benchmark::kMicrosecond);
+        }
+    }
+    return true;
+}();
+
+} // namespace
+} // namespace scp::bench
@@ -0,0 +1,199 @@
+// Playback-path overheads: frame allocation, frame cache lookups in each
+// tier, render graph evaluation with a cold and a warm node cache, and
+// reverse playback of long-GOP media.
+
+#include "synthetic_media.h"
+
+#include "core/frame_pool.h"
+#include "core/thread_pool.h"
+#include "media/media_error.h"
+#include "playback/frame_cache.h"
+#include "playback/reverse_player.h"
+#include "render/cpu_compositor.h"
+#include "render/node_cache.h"
+#include "render/render_graph.h"
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace scp::bench {
+namespace {
+
+constexpr FrameFormat kFrame{1920, 1080, PixelFormat::RGBA8};
+
+// Threads share one pool to measure contention on the free lists.
+void BM_FramePoolAcquire(benchmark::State &state)
+{
+    static FramePool pool;
+    pool.acquire(kFrame); // warm the size class
+    for (auto _ : state)
+        benchmark::DoNotOptimize(pool.acquire(kFrame));
+}
+BENCHMARK(BM_FramePoolAcquire)->Name("Playback/FramePoolAcquire")->ThreadRange(1, 8);
+
+void BM_FrameCacheRamHit(benchmark::State &state)
+{
+    FramePool pool;
+    FrameCache cache(pool);
+    constexpr int kFrames = 64;
+    for (int i = 0; i < kFrames; ++i)
+        cache.insert({i, 0}, makeSyntheticFrame(pool, {64, 64, PixelFormat::RGBA8}, i));
+    std::int64_t frame = 0;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(cache.find({frame++ % kFrames, 0}));
+    cache.clear();
+}
+BENCHMARK(BM_FrameCacheRamHit)->Name("Playback/FrameCacheRamHit");
+
+// RAM holds a single frame, so every lookup decompresses from disk and the
+// promoted frame pushes the previous one out again.
+void BM_FrameCacheDiskHit(benchmark::State &state)
+{
+    FramePool pool;
+    FrameCacheConfig config;
+    config.ramBudget = FramePool::bufferBytes(kFrame);
+    config.diskDirectory = scratchPath("frame-cache");
+    config.diskBudget = std::size_t(1) << 30;
+    constexpr int kFrames = 8;
+    {
+        FrameCache cache(pool, config);
+        for (int i = 0; i < kFrames; ++i)
+            cache.insert({i, 0}, makeSyntheticFrame(pool, kFrame, i));
+        // The spill writer runs in the background.
+        while (cache.stats().diskEntries < kFrames - 1)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        std::int64_t frame = 0;
+        for (auto _ : state)
+            benchmark::DoNotOptimize(cache.find({frame++ % (kFrames - 1), 0}));
+        state.SetBytesProcessed(state.iterations() * std::int64_t(config.ramBudget));
+        state.counters["compression"] = double(kFrames - 1) * double(config.ramBudget)
+                                        / double(cache.stats().diskBytes);
+        cache.clear();
+    }
+    std::error_code error;
+    std::filesystem::remove_all(config.diskDirectory, error);
+}
+BENCHMARK(BM_FrameCacheDiskHit)->Name("Playback/FrameCacheDiskHit")->Unit(benchmark::kMicrosecond);
+
+// Stands in for a decoder: returns a prepared frame for every timeline frame.
+class StillSource final : public RenderNode
+{
+public:
+    StillSource(FrameRef frame, std::uint64_t id)
+        : m_frame(std::move(frame))
+        , m_id(id)
+    {}
+
+    Kind kind() const override { return Kind::Source; }
+    std::string name() const override { return "still"; }
+    std::uint64_t parameterHash(const RenderContext &) const override { return m_id; }
+    FrameRef render(const RenderContext &, std::span<const FrameRef>) override { return m_frame; }
+
+private:
+    FrameRef m_frame;
+    std::uint64_t m_id;
+};
+
+// Four sources composited with mixed blend modes. Warm (range 1) measures
+// the hash walk that finds the output in the node cache; cold (range 0)
+// clears the cache every iteration.
+void BM_RenderGraph(benchmark::State &state)
+{
+    FramePool pool;
+    NodeCache nodeCache;
+    {
+        CpuCompositor compositor(ThreadPool::shared());
+        RenderGraph graph(ThreadPool::shared(), nodeCache);
+        std::vector<CompositeLayer> layers(4);
+        const BlendMode modes[] = {BlendMode::Normal, BlendMode::Screen, BlendMode::Multiply,
+                                   BlendMode::Overlay};
+        for (int i = 0; i < 4; ++i) {
+            layers[i].blend = modes[i];
+            layers[i].opacity = i == 0 ? 1.f : 0.5f;
+        }
+        const NodeId output = graph.addNode(std::make_unique<CompositeNode>(compositor, layers));
+        for (int i = 0; i < 4; ++i) {
+            const NodeId source = graph.addNode(
+                std::make_unique<StillSource>(makeSyntheticFrame(pool, kFrame, i), i));
+            graph.connect(source, output);
+        }
+
+        const RenderContext context{0, kFrame, &pool};
+        const bool warm = state.range(0) != 0;
+        if (warm)
+            graph.evaluate(output, context);
+        for (auto _ : state) {
+            if (!warm)
+                nodeCache.clear();
+            benchmark::DoNotOptimize(graph.evaluate(output, context));
+        }
+    }
+    nodeCache.clear();
+}
+BENCHMARK(BM_RenderGraph)
+    ->Name("Playback/RenderGraph")
+    ->ArgName("warm")
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+const SyntheticClipSpec kLongGopClip{1280, 720, 96, 48, 25};
+
+// The whole clip backwards: with ReversePlayer (range 1, chunks of 24 so
+// GOPs are split) or by seeking for every frame (range 0), as a player
+// without a reverse path does.
+void BM_ReversePlayback(benchmark::State &state)
+{
+    try {
+        const std::string path = syntheticClip(kLongGopClip);
+        std::int64_t frames = 0;
+        if (state.range(0)) {
+            ReversePlayerConfig config;
+            config.chunkFrames = 24;
+            ReversePlayer player(path, -1, config);
+            for (auto _ : state) {
+                player.start(std::numeric_limits<std::int64_t>::max() - 1);
+                while (!player.finished()) {
+                    if (player.next(std::chrono::milliseconds(10)))
+                        ++frames;
+                }
+            }
+        } else {
+            DecoderOptions options;
+            options.lowLatency = true;
+            VideoDecoder decoder(path, -1, options);
+            std::vector<std::int64_t> pts;
+            while (decoder.decodeNext())
+                pts.push_back(decoder.position());
+            for (auto _ : state) {
+                for (auto it = pts.rbegin(); it != pts.rend(); ++it) {
+                    decoder.seek(*it);
+                    benchmark::DoNotOptimize(decoder.decodeAt(*it));
+                    ++frames;
+                }
+            }
+        }
+        state.SetItemsProcessed(frames);
+    } catch (const MediaError &e) {
+        state.SkipWithError(e.what());
+    }
+}
+BENCHMARK(BM_ReversePlayback)
+    ->Name("Playback/Reverse")
+    ->ArgName("chunked")
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+} // namespace
+} // namespace scp::bench
@@ -0,0 +1,130 @@
+// Binary project files: opening a large project, and materializing one
+// track of it. MLT import: converting a Shotcut project.
+
+#include "synthetic_media.h"
+
+#include "project/mlt_importer.h"
+#include "project/project_file.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+namespace scp::bench {
+namespace {
+
+constexpr int kTracks = 10;
+
+// range(0) items spread over kTracks tracks, with as many distinct media
+// paths as a typical feature has source files.
+const std::string &projectPath(std::int64_t items)
+{
+    static std::string path;
+    static std::int64_t written = -1;
+    if (written != items) {
+        Timeline timeline;
+        for (int i = 0; i < kTracks; ++i)
+            timeline.addTrack(i < kTracks / 2 ? TrackKind::Video : TrackKind::Audio);
+        const std::int64_t perTrack = items / kTracks;
+        for (std::int64_t i = 0; i < items; ++i) {
+            const std::int64_t slot = i % perTrack;
+            timeline.addItem(int(i / perTrack) % kTracks,
+                             {ItemKind::Clip, "media/clip" + std::to_string(i % 2000) + ".mov", 0},
+                             {slot * 100, slot * 100 + 100});
+        }
+        path = scratchPath("project.scpp");
+        ProjectFile::write(path, timeline);
+        written = items;
+    }
+    return path;
+}
+
+void BM_ProjectOpen(benchmark::State &state)
+{
+    const std::string &path = projectPath(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(ProjectFile::open(path));
+}
+BENCHMARK(BM_ProjectOpen)
+    ->Name("Project/Open")
+    ->ArgName("items")
+    ->Arg(50000)
+    ->Unit(benchmark::kMicrosecond);
+
+void BM_ProjectLoad(benchmark::State &state)
+{
+    const std::string &path = projectPath(state.range(0));
+    const auto project = ProjectFile::open(path);
+    if (!project) {
+        state.SkipWithError("cannot open project");
+        return;
+    }
+    for (auto _ : state) {
+        if (state.range(1))
+            benchmark::DoNotOptimize(project->load());
+        else
+            benchmark::DoNotOptimize(project->loadTrack(0));
+    }
+}
+BENCHMARK(BM_ProjectLoad)
+    ->Name("Project/Load")
+    ->ArgNames({"items", "all"})
+    ->Args({50000, 0})
+    ->Args({50000, 1})
+    ->Unit(benchmark::kMillisecond);
+
+// A Shotcut-style document: range(0) chains with a filter each, used once
+// each by entries spread over kTracks playlists with blanks between them.
+std::string mltDocument(std::int64_t entries)
+{
+    std::ostringstream out;
+    out << "<?xml version=\"1.0\" standalone=\"no\"?>\n<mlt version=\"7.0.0\">\n"
+        << "<profile frame_rate_num=\"25\" frame_rate_den=\"1\"/>\n";
+    for (std::int64_t i = 0; i < entries; ++i) {
+        out << "<chain id=\"chain" << i << "\" out=\"00:00:10.000\">"
+            << "<property name=\"resource\">media/clip" << i % 2000 << ".mov</property>"
+            << "<property name=\"mlt_service\">avformat-novalidate</property>"
+            << "<filter><property name=\"mlt_service\">brightness</property></filter>"
+            << "</chain>\n";
+    }
+    for (int track = 0; track < kTracks; ++track) {
+        out << "<playlist id=\"playlist" << track << "\">\n";
+        for (std::int64_t i = track; i < entries; i += kTracks)
+            out << "<entry producer=\"chain" << i << "\" in=\"0\" out=\"99\"/>"
+                << "<blank length=\"25\"/>\n";
+        out << "</playlist>\n";
+    }
+    out << "<tractor id=\"tractor0\">\n";
+    for (int track = 0; track < kTracks; ++track)
+        out << "<track producer=\"playlist" << track << "\"/>\n";
+    out << "</tractor>\n</mlt>\n";
+    return out.str();
+}
+
+void BM_MltImport(benchmark::State &state)
+{
+    const std::string document = mltDocument(state.range(0));
+    std::uint64_t objects = 0;
+    for (auto _ : state) {
+        std::istringstream in(document);
+        const MltImportResult result = importMlt(in);
+        if (!result.timeline) {
+            state.SkipWithError(result.error.c_str());
+            return;
+        }
+        objects += result.stats.objects;
+    }
+    state.SetBytesProcessed(std::int64_t(document.size()) * state.iterations());
+    state.counters["objects"] = benchmark::Counter(double(objects),
+                                                   benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_MltImport)
+    ->Name("Project/MltImport")
+    ->ArgName("entries")
+    ->Arg(50000)
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace
+} // namespace scp::bench
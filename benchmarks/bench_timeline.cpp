@@ -0,0 +1,121 @@
+// Timeline model: what plays at the playhead, ripple edits and undo
+// snapshots, on tracks the size of a feature-length edit.
+
+#include "timeline/edit_history.h"
+#include "timeline/timeline.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace scp::bench {
+namespace {
+
+constexpr std::int64_t kClipFrames = 120;
+
+// range(0) clips back to back on one track, with a dissolve at every cut.
+Track makeTrack(std::int64_t clips)
+{
+    Track track(TrackKind::Video);
+    for (std::int64_t i = 0; i < clips; ++i) {
+        track.add({ItemKind::Clip, "clip.mov", 0}, {i * kClipFrames, (i + 1) * kClipFrames});
+        if (i > 0)
+            track.add({ItemKind::Transition, "luma", 0},
+                      {i * kClipFrames - 12, i * kClipFrames + 12});
+    }
+    return track;
+}
+
+void BM_TimelineItemsAt(benchmark::State &state)
+{
+    const Track track = makeTrack(state.range(0));
+    std::mt19937 random(1);
+    std::uniform_int_distribution<std::int64_t> frames(0, track.end() - 1);
+    std::vector<ItemId> items;
+    for (auto _ : state) {
+        items.clear();
+        track.itemsAt(frames(random), items);
+        benchmark::DoNotOptimize(items.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TimelineItemsAt)
+    ->Name("Timeline/ItemsAt")
+    ->ArgName("clips")
+    ->Arg(1000)
+    ->Arg(8000)
+    ->Arg(64000);
+
+// Ripple-inserts a frame near the start, shifting almost every item, then
+// takes it out again.
+void BM_TimelineRipple(benchmark::State &state)
+{
+    Track track = makeTrack(state.range(0));
+    for (auto _ : state) {
+        track.ripple(kClipFrames, 1);
+        track.ripple(kClipFrames + 1, -1);
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_TimelineRipple)
+    ->Name("Timeline/Ripple")
+    ->ArgName("clips")
+    ->Arg(1000)
+    ->Arg(8000)
+    ->Arg(64000);
+
+// An edit recorded in the undo history: lengthens or shortens the first
+// clip by a frame and ripples everything after it. Every version is kept.
+void BM_TimelineSnapshot(benchmark::State &state)
+{
+    Timeline timeline;
+    timeline.addTrack(TrackKind::Video);
+    timeline.track(0) = makeTrack(state.range(0));
+    EditHistory history(std::move(timeline), std::size_t(state.max_iterations) + 1);
+    std::int64_t delta = 1;
+    for (auto _ : state) {
+        history.edit([&](Timeline &edit) {
+            TimelineChange change = edit.ripple(kClipFrames, delta);
+            change.merge(edit.trimItem({0, 0}, {0, kClipFrames + (delta > 0 ? 1 : 0)}));
+            return change;
+        });
+        delta = -delta;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["versions"] = double(history.size());
+}
+BENCHMARK(BM_TimelineSnapshot)
+    ->Name("Timeline/Snapshot")
+    ->ArgName("clips")
+    ->Arg(8000)
+    ->Arg(64000);
+
+// Recorded edits that each drop a clip at the same playhead frame, after
+// the ones dropped before. Every insert lands in the gap the previous one
+// split, the worst case for the index's order labels.
+void BM_TimelineSnapshotInsert(benchmark::State &state)
+{
+    Timeline timeline;
+    timeline.addTrack(TrackKind::Video);
+    timeline.track(0) = makeTrack(state.range(0));
+    EditHistory history(std::move(timeline), std::size_t(state.max_iterations) + 1);
+    const std::int64_t playhead = state.range(0) / 2 * kClipFrames + kClipFrames / 3;
+    for (auto _ : state) {
+        history.edit([&](Timeline &edit) {
+            return edit.addItem(0, {ItemKind::Clip, "insert.mov", 0},
+                                {playhead, playhead + kClipFrames});
+        });
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["versions"] = double(history.size());
+}
+BENCHMARK(BM_TimelineSnapshotInsert)
+    ->Name("Timeline/Snapshot/InsertAtPlayhead")
+    ->ArgName("clips")
+    ->Arg(8000)
+    ->Arg(64000);
+
+} // namespace
+} // namespace scp::bench
@@ -0,0 +1,232 @@
+#include "synthetic_media.h"
+
+#include "core/frame_pool.h"
+#include "core/half_float.h"
+#include "media/ffmpeg_ptr.h"
+#include "media/media_error.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <unistd.h>
+
+namespace scp::bench {
+
+namespace {
+
+// Numerical Recipes LCG; only the top bits are used.
+struct Noise
+{
+    std::uint32_t state;
+    std::uint32_t next()
+    {
+        state = state * 1664525u + 1013904223u;
+        return state >> 24;
+    }
+};
+
+std::uint8_t sample8(int x, int y, std::uint32_t seed, Noise &noise)
+{
+    return static_cast<std::uint8_t>((x + y + int(seed) * 7) ^ (noise.next() & 0x0f));
+}
+
+void fillPlane8(std::uint8_t *data, int stride, int samples, int rows, std::uint32_t seed)
+{
+    Noise noise{seed * 2654435761u + 1};
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < samples; ++x)
+            data[std::ptrdiff_t(y) * stride + x] = sample8(x, y, seed, noise);
+    }
+}
+
+struct TempDirectory
+{
+    std::filesystem::path path;
+    ~TempDirectory()
+    {
+        std::error_code error;
+        std::filesystem::remove_all(path, error);
+    }
+};
+
+const std::filesystem::path &tempDirectory()
+{
+    static TempDirectory directory = [] {
+        TempDirectory created;
+        created.path = std::filesystem::temp_directory_path()
+                       / ("scp-bench-" + std::to_string(::getpid()));
+        std::filesystem::create_directories(created.path);
+        return created;
+    }();
+    return directory.path;
+}
+
+void writePackets(AVCodecContext *encoder, AVFormatContext *output, AVStream *stream,
+                  AVPacket *packet)
+{
+    int error;
+    while ((error = avcodec_receive_packet(encoder, packet)) >= 0) {
+        av_packet_rescale_ts(packet, encoder->time_base, stream->time_base);
+        packet->stream_index = stream->index;
+        error = av_interleaved_write_frame(output, packet);
+        if (error < 0)
+            throw MediaError("cannot write synthetic clip", error);
+    }
+    if (error != AVERROR(EAGAIN) && error != AVERROR_EOF)
+        throw MediaError("cannot encode synthetic clip", error);
+}
+
+void encodeClip(const SyntheticClipSpec &spec, const std::string &path)
+{
+    const AVCodec *codec = avcodec_find_encoder(AV_CODEC_ID_MPEG4);
+    if (!codec)
+        throw MediaError("MPEG-4 encoder not available");
+
+    AVFormatContext *context = nullptr;
+    int error = avformat_alloc_output_context2(&context, nullptr, "mp4", path.c_str());
+    if (error < 0)
+        throw MediaError("cannot create " + path, error);
+    // avformat_close_input() would treat it as an input; free it by hand.
+    std::unique_ptr<AVFormatContext, void (*)(AVFormatContext *)> output(
+        context, [](AVFormatContext *c) {
+            if (c->pb)
+                avio_closep(&c->pb);
+            avformat_free_context(c);
+        });
+
+    AVCodecContextPtr encoder(avcodec_alloc_context3(codec));
+    encoder->width = spec.width;
+    encoder->height = spec.height;
+    encoder->pix_fmt = AV_PIX_FMT_YUV420P;
+    encoder->time_base = AVRational{1, spec.frameRate};
+    encoder->framerate = AVRational{spec.frameRate, 1};
+    encoder->gop_size = spec.gopLength;
+    encoder->max_b_frames = 2;
+    encoder->flags |= AV_CODEC_FLAG_QSCALE;
+    encoder->global_quality = 4 * FF_QP2LAMBDA;
+    // Single-threaded so the bitstream does not depend on the core count.
+    encoder->thread_count = 1;
+    if (output->oformat->flags & AVFMT_GLOBALHEADER)
+        encoder->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    error = avcodec_open2(encoder.get(), codec, nullptr);
+    if (error < 0)
+        throw MediaError("cannot open MPEG-4 encoder", error);
+
+    AVStream *stream = avformat_new_stream(output.get(), nullptr);
+    if (!stream)
+        throw MediaError("cannot add stream to " + path);
+    stream->time_base = encoder->time_base;
+    error = avcodec_parameters_from_context(stream->codecpar, encoder.get());
+    if (error < 0)
+        throw MediaError("cannot copy encoder parameters", error);
+
+    error = avio_open(&output->pb, path.c_str(), AVIO_FLAG_WRITE);
+    if (error < 0)
+        throw MediaError("cannot open " + path + " for writing", error);
+    error = avformat_write_header(output.get(), nullptr);
+    if (error < 0)
+        throw MediaError("cannot write header of " + path, error);
+
+    AVFramePtr frame(av_frame_alloc());
+    frame->width = spec.width;
+    frame->height = spec.height;
+    frame->format = AV_PIX_FMT_YUV420P;
+    error = av_frame_get_buffer(frame.get(), 0);
+    if (error < 0)
+        throw MediaError("cannot allocate frame", error);
+    AVPacketPtr packet(av_packet_alloc());
+
+    for (int i = 0; i < spec.frames; ++i) {
+        error = av_frame_make_writable(frame.get());
+        if (error < 0)
+            throw MediaError("cannot allocate frame", error);
+        fillPlane8(frame->data[0], frame->linesize[0], spec.width, spec.height, i);
+        fillPlane8(frame->data[1], frame->linesize[1], spec.width / 2, spec.height / 2, i + 1000);
+        fillPlane8(frame->data[2], frame->linesize[2], spec.width / 2, spec.height / 2, i + 2000);
+        frame->pts = i;
+        error = avcodec_send_frame(encoder.get(), frame.get());
+        if (error < 0)
+            throw MediaError("cannot encode synthetic clip", error);
+        writePackets(encoder.get(), output.get(), stream, packet.get());
+    }
+    avcodec_send_frame(encoder.get(), nullptr);
+    writePackets(encoder.get(), output.get(), stream, packet.get());
+
+    error = av_write_trailer(output.get());
+    if (error < 0)
+        throw MediaError("cannot finish " + path, error);
+}
+
+} // namespace
+
+void fillSyntheticFrame(FrameBuffer &frame, std::uint32_t seed)
+{
+    for (int i = 0; i < frame.planeCount(); ++i) {
+        const PlaneGeometry plane = planeGeometry(frame.pixelFormat(), frame.width(),
+                                                  frame.height(), i);
+        switch (frame.pixelFormat()) {
+        case PixelFormat::P010: {
+            // 10-bit samples in the high bits of 16-bit words.
+            Noise noise{seed * 2654435761u + i};
+            for (int y = 0; y < plane.rows; ++y) {
+                auto *row = reinterpret_cast<std::uint16_t *>(frame.data(i)
+                                                              + std::ptrdiff_t(y) * frame.stride(i));
+                for (int x = 0; x < plane.rowBytes / 2; ++x)
+                    row[x] = static_cast<std::uint16_t>(sample8(x, y, seed, noise) << 8);
+            }
+            break;
+        }
+        case PixelFormat::RGBA16F: {
+            Noise noise{seed * 2654435761u + i};
+            for (int y = 0; y < plane.rows; ++y) {
+                auto *row = reinterpret_cast<std::uint16_t *>(frame.data(i)
+                                                              + std::ptrdiff_t(y) * frame.stride(i));
+                for (int x = 0; x < plane.rowBytes / 2; ++x)
+                    row[x] = floatToHalf(sample8(x, y, seed, noise) / 255.f);
+            }
+            break;
+        }
+        default:
+            fillPlane8(frame.data(i), frame.stride(i), plane.rowBytes, plane.rows, seed + i);
+            break;
+        }
+    }
+}
+
+FrameRef makeSyntheticFrame(FramePool &pool, const FrameFormat &format, std::uint32_t seed)
+{
+    FrameRef frame = pool.acquire(format);
+    if (frame)
+        fillSyntheticFrame(*frame, seed);
+    return frame;
+}
+
+std::string syntheticClip(const SyntheticClipSpec &spec)
+{
+    static std::mutex mutex;
+    static std::map<std::tuple<int, int, int, int, int>, std::string> clips;
+
+    std::lock_guard lock(mutex);
+    const auto key = std::make_tuple(spec.width, spec.height, spec.frames, spec.gopLength,
+                                     spec.frameRate);
+    if (auto it = clips.find(key); it != clips.end())
+        return it->second;
+
+    char name[96];
+    std::snprintf(name, sizeof(name), "clip_%dx%d_%d_g%d_%d.mp4", spec.width, spec.height,
+                  spec.frames, spec.gopLength, spec.frameRate);
+    const std::string path = (tempDirectory() / name).string();
+    encodeClip(spec, path);
+    clips.emplace(key, path);
+    return path;
+}
+
+std::string scratchPath(const std::string &name)
+{
+    return (tempDirectory() / name).string();
+}
+
+} // namespace scp::bench
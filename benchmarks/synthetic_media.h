@@ -0,0 +1,41 @@
+#pragma once
+
+// Deterministic inputs for the benchmarks. Frames and clips are generated
+// from fixed seeds, so every machine processes the same pixels and the same
+// bitstream (for a given FFmpeg build).
+
+#include "core/frame_buffer.h"
+
+#include <cstdint>
+#include <string>
+
+namespace scp {
+class FramePool;
+}
+
+namespace scp::bench {
+
+// Fills every plane with a diagonal gradient plus seeded noise: varied
+// enough that blend and compression kernels see realistic data, cheap enough
+// to regenerate outside the timed region.
+void fillSyntheticFrame(FrameBuffer &frame, std::uint32_t seed);
+FrameRef makeSyntheticFrame(FramePool &pool, const FrameFormat &format, std::uint32_t seed);
+
+struct SyntheticClipSpec
+{
+    int width = 1280;
+    int height = 720;
+    int frames = 120;
+    int gopLength = 12;
+    int frameRate = 25;
+};
+
+// Path of an MPEG-4 Part 2 / MP4 clip matching spec, encoded on first use
+// with a fixed quantiser into a temporary directory that is removed at exit.
+// The encoder is built into every FFmpeg configuration. Throws MediaError.
+std::string syntheticClip(const SyntheticClipSpec &spec);
+
+// Fresh path in the same temporary directory, for benchmark outputs.
+std::string scratchPath(const std::string &name);
+
+} // namespace scp::bench
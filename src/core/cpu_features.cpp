@@ -0,0 +1,79 @@
+#include "core/cpu_features.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+
+namespace scp {
+
+const char *simdLevelName(SimdLevel level)
+{
+    switch (level) {
+    case SimdLevel::Scalar:
+        return "scalar";
+    case SimdLevel::SSE41:
+        return "sse4.1";
+    case SimdLevel::AVX2:
+        return "avx2";
+    case SimdLevel::AVX512:
+        return "avx512";
+    case SimdLevel::NEON:
+        return "neon";
+    }
+    return "unknown";
+}
+
+bool isSimdLevelSupported(SimdLevel level)
+{
+    switch (level) {
+    case SimdLevel::Scalar:
+        return true;
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    case SimdLevel::SSE41:
+        return __builtin_cpu_supports("sse4.1");
+    case SimdLevel::AVX2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+    case SimdLevel::AVX512:
+        return __builtin_cpu_supports("avx512f") && isSimdLevelSupported(SimdLevel::AVX2);
+#endif
+#if defined(__aarch64__)
+    case SimdLevel::NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+SimdLevel detectSimdLevel()
+{
+    static const SimdLevel level = [] {
+        for (SimdLevel candidate : {SimdLevel::AVX512, SimdLevel::AVX2, SimdLevel::SSE41,
+                                    SimdLevel::NEON}) {
+            if (isSimdLevelSupported(candidate))
+                return candidate;
+        }
+        return SimdLevel::Scalar;
+    }();
+    return level;
+}
+
+SimdLevel activeSimdLevel()
+{
+    static const SimdLevel level = [] {
+        const SimdLevel detected = detectSimdLevel();
+        const char *requested = std::getenv("SCP_SIMD");
+        if (!requested)
+            return detected;
+        for (SimdLevel candidate : {SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2,
+                                    SimdLevel::AVX512, SimdLevel::NEON}) {
+            if (!std::strcmp(requested, simdLevelName(candidate))
+                && isSimdLevelSupported(candidate))
+                return candidate;
+        }
+        return detected;
+    }();
+    return level;
+}
+
+} // namespace scp
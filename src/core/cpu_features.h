@@ -0,0 +1,27 @@
+#pragma once
+
+// Runtime detection of the vector instruction sets the engine has kernels
+// for. Detection runs once; results are cached for the process lifetime.
+
+namespace scp {
+
+enum class SimdLevel {
+    Scalar,
+    SSE41,
+    AVX2,   // AVX2 + F16C
+    AVX512, // AVX-512F + AVX2 + F16C
+    NEON,   // AArch64 Advanced SIMD
+};
+
+const char *simdLevelName(SimdLevel level);
+
+// Best level supported by both the CPU and the build.
+SimdLevel detectSimdLevel();
+
+// detectSimdLevel(), lowered by the SCP_SIMD environment variable
+// ("scalar", "sse4.1", "avx2", "avx512", "neon") for debugging and profiling.
+SimdLevel activeSimdLevel();
+
+bool isSimdLevelSupported(SimdLevel level);
+
+} // namespace scp
@@ -0,0 +1,184 @@
+#pragma once
+
+// Refcounted planar frame storage shared by decoders, effects and encoders.
+//
+// A FrameBuffer never frees itself: when the last reference goes away it is
+// handed back to its FrameOwner, which may recycle it (FramePool) or release
+// memory that belongs to somebody else (e.g. a decoder's AVFrame).
+
+#include "core/pixel_format.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace scp {
+
+// Row strides and plane starts of pool allocated buffers are multiples of
+// this, which keeps every row safe for 512-bit vector loads.
+inline constexpr std::size_t kFrameAlignment = 64;
+
+// How YUV samples map to RGB. Meaningless for RGBA frames.
+enum class ColorMatrix {
+    BT601,
+    BT709,
+    BT2020,
+};
+
+enum class ColorRange {
+    Limited, // "TV" / MPEG range
+    Full,    // "PC" / JPEG range
+};
+
+struct ColorSpec
+{
+    ColorMatrix matrix = ColorMatrix::BT709;
+    ColorRange range = ColorRange::Limited;
+
+    bool operator==(const ColorSpec &) const = default;
+};
+
+struct FrameFormat
+{
+    int width = 0;
+    int height = 0;
+    PixelFormat pixelFormat = PixelFormat::None;
+
+    bool isValid() const
+    {
+        return width > 0 && height > 0 && pixelFormat != PixelFormat::None;
+    }
+    bool operator==(const FrameFormat &) const = default;
+};
+
+class FrameBuffer;
+
+class FrameOwner
+{
+public:
+    virtual ~FrameOwner() = default;
+    // Called exactly once per buffer, when its refcount drops to zero.
+    virtual void recycle(FrameBuffer *buffer) noexcept = 0;
+};
+
+class FrameBuffer
+{
+public:
+    FrameBuffer(FrameOwner *owner, const FrameFormat &format)
+        : m_owner(owner)
+        , m_format(format)
+    {}
+
+    FrameBuffer(const FrameBuffer &) = delete;
+    FrameBuffer &operator=(const FrameBuffer &) = delete;
+
+    const FrameFormat &format() const { return m_format; }
+    int width() const { return m_format.width; }
+    int height() const { return m_format.height; }
+    PixelFormat pixelFormat() const { return m_format.pixelFormat; }
+    int planeCount() const { return scp::planeCount(m_format.pixelFormat); }
+
+    std::uint8_t *data(int plane) const { return m_data[plane]; }
+    int stride(int plane) const { return m_stride[plane]; }
+    void setPlane(int plane, std::uint8_t *data, int stride)
+    {
+        m_data[plane] = data;
+        m_stride[plane] = stride;
+    }
+
+    // True when every plane start and stride is a multiple of alignment.
+    bool isAligned(std::size_t alignment = kFrameAlignment) const
+    {
+        for (int i = 0; i < planeCount(); ++i) {
+            if (reinterpret_cast<std::uintptr_t>(m_data[i]) % alignment
+                || static_cast<std::size_t>(m_stride[i]) % alignment)
+                return false;
+        }
+        return true;
+    }
+
+    // Presentation timestamp in the stream's time base; owners reset it.
+    std::int64_t pts() const { return m_pts; }
+    void setPts(std::int64_t pts) { m_pts = pts; }
+
+    // Matrix and range of YUV samples; owners reset it.
+    const ColorSpec &colorSpec() const { return m_colorSpec; }
+    void setColorSpec(const ColorSpec &spec) { m_colorSpec = spec; }
+
+    void ref() noexcept { m_refs.fetch_add(1, std::memory_order_relaxed); }
+    void unref() noexcept
+    {
+        if (m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            m_owner->recycle(this);
+    }
+    std::uint32_t refCount() const { return m_refs.load(std::memory_order_acquire); }
+    // A buffer may only be written in place while nobody else can see it.
+    bool isWritable() const { return refCount() == 1; }
+
+    FrameOwner *owner() const { return m_owner; }
+    // Slot for owner bookkeeping (size class, wrapped AVFrame, ...).
+    void *ownerData() const { return m_ownerData; }
+    void setOwnerData(void *data) { m_ownerData = data; }
+
+    // Owners call this before handing a recycled buffer out again.
+    void resetForReuse()
+    {
+        m_refs.store(0, std::memory_order_relaxed);
+        m_pts = 0;
+        m_colorSpec = {};
+    }
+
+private:
+    std::atomic<std::uint32_t> m_refs{0};
+    FrameOwner *m_owner;
+    void *m_ownerData = nullptr;
+    FrameFormat m_format;
+    std::uint8_t *m_data[kMaxPlanes] = {};
+    int m_stride[kMaxPlanes] = {};
+    std::int64_t m_pts = 0;
+    ColorSpec m_colorSpec;
+};
+
+// Intrusive smart pointer over FrameBuffer.
+class FrameRef
+{
+public:
+    FrameRef() = default;
+    explicit FrameRef(FrameBuffer *buffer)
+        : m_buffer(buffer)
+    {
+        if (m_buffer)
+            m_buffer->ref();
+    }
+    FrameRef(const FrameRef &other)
+        : FrameRef(other.m_buffer)
+    {}
+    FrameRef(FrameRef &&other) noexcept
+        : m_buffer(std::exchange(other.m_buffer, nullptr))
+    {}
+    ~FrameRef() { reset(); }
+
+    FrameRef &operator=(FrameRef other) noexcept
+    {
+        std::swap(m_buffer, other.m_buffer);
+        return *this;
+    }
+
+    void reset()
+    {
+        if (m_buffer)
+            std::exchange(m_buffer, nullptr)->unref();
+    }
+
+    FrameBuffer *get() const { return m_buffer; }
+    FrameBuffer *operator->() const { return m_buffer; }
+    FrameBuffer &operator*() const { return *m_buffer; }
+    explicit operator bool() const { return m_buffer != nullptr; }
+    bool operator==(const FrameRef &other) const = default;
+
+private:
+    FrameBuffer *m_buffer = nullptr;
+};
+
+} // namespace scp
@@ -0,0 +1,56 @@
+#include "core/frame_copy.h"
+
+#include "core/frame_pool.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace scp {
+
+void copyFrame(const FrameBuffer &source, FrameBuffer &destination)
+{
+    assert(source.format() == destination.format());
+    for (int i = 0; i < source.planeCount(); ++i) {
+        const PlaneGeometry plane = planeGeometry(source.pixelFormat(), source.width(),
+                                                  source.height(), i);
+        const std::uint8_t *src = source.data(i);
+        std::uint8_t *dst = destination.data(i);
+        if (source.stride(i) == destination.stride(i) && source.stride(i) == plane.rowBytes) {
+            std::memcpy(dst, src, std::size_t(plane.rowBytes) * plane.rows);
+            continue;
+        }
+        for (int row = 0; row < plane.rows; ++row) {
+            std::memcpy(dst, src, plane.rowBytes);
+            src += source.stride(i);
+            dst += destination.stride(i);
+        }
+    }
+    destination.setPts(source.pts());
+    destination.setColorSpec(source.colorSpec());
+}
+
+static FrameRef copyFromPool(const FrameRef &frame, FramePool &pool)
+{
+    FrameRef copy = pool.acquire(frame->format());
+    if (copy)
+        copyFrame(*frame, *copy);
+    return copy;
+}
+
+FrameRef conformToAlignment(const FrameRef &frame, FramePool &pool, std::size_t alignment)
+{
+    assert(alignment <= kFrameAlignment);
+    if (!frame || frame->isAligned(alignment))
+        return frame;
+    return copyFromPool(frame, pool);
+}
+
+FrameRef makeWritable(const FrameRef &frame, FramePool &pool)
+{
+    // The caller's own reference is the one we expect to see.
+    if (!frame || frame->isWritable())
+        return frame;
+    return copyFromPool(frame, pool);
+}
+
+} // namespace scp
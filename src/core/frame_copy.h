@@ -0,0 +1,28 @@
+#pragma once
+
+// Copies between frame buffers. Used only at the boundaries where a stage
+// cannot consume a frame in its current memory layout.
+
+#include "core/frame_buffer.h"
+
+#include <cstddef>
+
+namespace scp {
+
+class FramePool;
+
+// Copies the visible pixels of every plane, the pts and the color spec;
+// formats must match.
+void copyFrame(const FrameBuffer &source, FrameBuffer &destination);
+
+// Returns frame unchanged when its planes and strides already satisfy
+// alignment, otherwise a pool-backed copy that does. A null ref is returned
+// only when the pool cannot allocate.
+FrameRef conformToAlignment(const FrameRef &frame, FramePool &pool,
+                            std::size_t alignment = kFrameAlignment);
+
+// Returns frame unchanged when nobody else references it, otherwise a
+// private pool-backed copy that can be modified in place.
+FrameRef makeWritable(const FrameRef &frame, FramePool &pool);
+
+} // namespace scp
@@ -0,0 +1,212 @@
+#include "core/frame_pool.h"
+
+#include "core/mpmc_queue.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <functional>
+#include <new>
+
+namespace scp {
+
+namespace {
+
+constexpr std::size_t roundUp(std::size_t value, std::size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// The FrameBuffer header lives in front of the pixels in the same block.
+constexpr std::size_t kHeaderBytes = roundUp(sizeof(FrameBuffer), kFrameAlignment);
+
+struct Layout
+{
+    int stride[kMaxPlanes] = {};
+    std::size_t offset[kMaxPlanes] = {};
+    std::size_t bytes = 0;
+};
+
+Layout layoutFor(const FrameFormat &format)
+{
+    Layout layout;
+    for (int i = 0; i < planeCount(format.pixelFormat); ++i) {
+        const PlaneGeometry plane = planeGeometry(format.pixelFormat, format.width,
+                                                  format.height, i);
+        layout.stride[i] = static_cast<int>(roundUp(plane.rowBytes, kFrameAlignment));
+        layout.offset[i] = layout.bytes;
+        layout.bytes += std::size_t(layout.stride[i]) * plane.rows;
+    }
+    return layout;
+}
+
+std::size_t hashFormat(const FrameFormat &format)
+{
+    std::size_t h = std::hash<int>{}(format.width);
+    h = h * 31 + std::hash<int>{}(format.height);
+    h = h * 31 + static_cast<std::size_t>(format.pixelFormat);
+    return h;
+}
+
+} // namespace
+
+struct FramePool::SizeClass
+{
+    explicit SizeClass(const FrameFormat &f)
+        : format(f)
+        , layout(layoutFor(f))
+        , freeList(kBuffersPerClass)
+    {}
+
+    const FrameFormat format;
+    const Layout layout;
+    MpmcQueue<FrameBuffer *> freeList;
+};
+
+FramePool::FramePool(std::size_t maxPooledBytes)
+    : m_maxPooledBytes(maxPooledBytes)
+{}
+
+FramePool::~FramePool()
+{
+    assert(m_buffersInUse.load() == 0 && "FramePool destroyed with live buffers");
+    trim();
+    for (auto &slot : m_classes)
+        delete slot.load(std::memory_order_acquire);
+}
+
+std::size_t FramePool::bufferBytes(const FrameFormat &format)
+{
+    return format.isValid() ? layoutFor(format).bytes : 0;
+}
+
+void FramePool::setMaxPooledBytes(std::size_t bytes)
+{
+    m_maxPooledBytes.store(bytes, std::memory_order_relaxed);
+    if (m_bytesPooled.load(std::memory_order_relaxed) > bytes)
+        trim();
+}
+
+FramePool::SizeClass *FramePool::sizeClassFor(const FrameFormat &format)
+{
+    // Open addressing with insert-only slots: lookups never lock and a
+    // losing inserter simply adopts the winner's class.
+    const std::size_t start = hashFormat(format);
+    for (std::size_t probe = 0; probe < kMaxSizeClasses; ++probe) {
+        auto &slot = m_classes[(start + probe) % kMaxSizeClasses];
+        SizeClass *existing = slot.load(std::memory_order_acquire);
+        if (!existing) {
+            auto *created = new SizeClass(format);
+            if (slot.compare_exchange_strong(existing, created, std::memory_order_acq_rel))
+                return created;
+            delete created;
+        }
+        if (existing->format == format)
+            return existing;
+    }
+    // Table full: serve the request unpooled.
+    return nullptr;
+}
+
+FrameBuffer *FramePool::allocate(SizeClass *sizeClass, const FrameFormat &format)
+{
+    const Layout layout = sizeClass ? sizeClass->layout : layoutFor(format);
+    void *block = std::aligned_alloc(kFrameAlignment, kHeaderBytes + layout.bytes);
+    if (!block)
+        return nullptr;
+    auto *buffer = new (block) FrameBuffer(this, format);
+    auto *pixels = static_cast<std::uint8_t *>(block) + kHeaderBytes;
+    for (int i = 0; i < planeCount(format.pixelFormat); ++i)
+        buffer->setPlane(i, pixels + layout.offset[i], layout.stride[i]);
+    buffer->setOwnerData(sizeClass);
+    return buffer;
+}
+
+void FramePool::trackAllocated(std::size_t bytes)
+{
+    const std::uint64_t total = m_bytesInUse.fetch_add(bytes, std::memory_order_relaxed) + bytes
+                                + m_bytesPooled.load(std::memory_order_relaxed);
+    std::uint64_t peak = m_highWaterBytes.load(std::memory_order_relaxed);
+    while (total > peak
+           && !m_highWaterBytes.compare_exchange_weak(peak, total, std::memory_order_relaxed)) {
+    }
+}
+
+FrameRef FramePool::acquire(const FrameFormat &format)
+{
+    if (!format.isValid())
+        return {};
+    SizeClass *sizeClass = sizeClassFor(format);
+    FrameBuffer *buffer = nullptr;
+    if (sizeClass) {
+        if (auto recycled = sizeClass->freeList.tryPop()) {
+            buffer = *recycled;
+            buffer->resetForReuse();
+            m_bytesPooled.fetch_sub(sizeClass->layout.bytes, std::memory_order_relaxed);
+            m_bytesInUse.fetch_add(sizeClass->layout.bytes, std::memory_order_relaxed);
+            m_hits.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (!buffer) {
+        buffer = allocate(sizeClass, format);
+        if (!buffer)
+            return {};
+        trackAllocated(sizeClass ? sizeClass->layout.bytes : layoutFor(format).bytes);
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_buffersInUse.fetch_add(1, std::memory_order_relaxed);
+    return FrameRef(buffer);
+}
+
+void FramePool::recycle(FrameBuffer *buffer) noexcept
+{
+    auto *sizeClass = static_cast<SizeClass *>(buffer->ownerData());
+    const std::size_t bytes = sizeClass ? sizeClass->layout.bytes
+                                        : layoutFor(buffer->format()).bytes;
+    m_buffersInUse.fetch_sub(1, std::memory_order_relaxed);
+    m_bytesInUse.fetch_sub(bytes, std::memory_order_relaxed);
+
+    const bool withinBudget = m_bytesPooled.load(std::memory_order_relaxed) + bytes
+                              <= m_maxPooledBytes.load(std::memory_order_relaxed);
+    if (sizeClass && withinBudget) {
+        m_bytesPooled.fetch_add(bytes, std::memory_order_relaxed);
+        if (sizeClass->freeList.tryPush(buffer))
+            return;
+        m_bytesPooled.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+    release(buffer);
+}
+
+void FramePool::release(FrameBuffer *buffer)
+{
+    buffer->~FrameBuffer();
+    std::free(buffer);
+}
+
+void FramePool::trim()
+{
+    for (auto &slot : m_classes) {
+        SizeClass *sizeClass = slot.load(std::memory_order_acquire);
+        if (!sizeClass)
+            continue;
+        while (auto buffer = sizeClass->freeList.tryPop()) {
+            m_bytesPooled.fetch_sub(sizeClass->layout.bytes, std::memory_order_relaxed);
+            release(*buffer);
+        }
+    }
+}
+
+FramePoolStats FramePool::stats() const
+{
+    FramePoolStats stats;
+    stats.hits = m_hits.load(std::memory_order_relaxed);
+    stats.misses = m_misses.load(std::memory_order_relaxed);
+    stats.buffersInUse = m_buffersInUse.load(std::memory_order_relaxed);
+    stats.bytesInUse = m_bytesInUse.load(std::memory_order_relaxed);
+    stats.bytesPooled = m_bytesPooled.load(std::memory_order_relaxed);
+    stats.highWaterBytes = m_highWaterBytes.load(std::memory_order_relaxed);
+    for (const auto &slot : m_classes)
+        stats.sizeClasses += slot.load(std::memory_order_relaxed) != nullptr;
+    return stats;
+}
+
+} // namespace scp
@@ -0,0 +1,80 @@
+#pragma once
+
+// Size-class arena for planar frame buffers.
+//
+// Buffers are keyed by FrameFormat (width, height, pixel format). Each size
+// class keeps a bounded lock-free free list, so decoder, effect and encoder
+// threads can acquire and release buffers without taking a lock or calling
+// malloc once the pool is warm. Idle memory is capped by a byte budget;
+// buffers released while the pool is over budget are freed instead.
+//
+// The pool must outlive every buffer it handed out.
+
+#include "core/frame_buffer.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace scp {
+
+struct FramePoolStats
+{
+    std::uint64_t hits = 0;            // acquires served from a free list
+    std::uint64_t misses = 0;          // acquires that had to allocate
+    std::uint64_t buffersInUse = 0;
+    std::uint64_t bytesInUse = 0;      // bytes referenced by live buffers
+    std::uint64_t bytesPooled = 0;     // bytes idle in free lists
+    std::uint64_t highWaterBytes = 0;  // peak of bytesInUse + bytesPooled
+    std::uint32_t sizeClasses = 0;
+};
+
+class FramePool final : public FrameOwner
+{
+public:
+    static constexpr std::size_t kDefaultMaxPooledBytes = std::size_t(512) << 20;
+    static constexpr std::size_t kMaxSizeClasses = 64;
+    static constexpr std::size_t kBuffersPerClass = 64;
+
+    explicit FramePool(std::size_t maxPooledBytes = kDefaultMaxPooledBytes);
+    ~FramePool() override;
+
+    FramePool(const FramePool &) = delete;
+    FramePool &operator=(const FramePool &) = delete;
+
+    // Returns an uninitialized, writable buffer, or a null ref for an
+    // invalid format or when allocation fails.
+    FrameRef acquire(const FrameFormat &format);
+
+    FramePoolStats stats() const;
+
+    // Frees every idle buffer; live buffers are unaffected.
+    void trim();
+
+    std::size_t maxPooledBytes() const { return m_maxPooledBytes.load(std::memory_order_relaxed); }
+    void setMaxPooledBytes(std::size_t bytes);
+
+    // Bytes of pixel storage a pool buffer of this format occupies.
+    static std::size_t bufferBytes(const FrameFormat &format);
+
+private:
+    struct SizeClass;
+
+    void recycle(FrameBuffer *buffer) noexcept override;
+    SizeClass *sizeClassFor(const FrameFormat &format);
+    FrameBuffer *allocate(SizeClass *sizeClass, const FrameFormat &format);
+    static void release(FrameBuffer *buffer);
+    void trackAllocated(std::size_t bytes);
+
+    std::atomic<std::size_t> m_maxPooledBytes;
+    std::array<std::atomic<SizeClass *>, kMaxSizeClasses> m_classes{};
+    std::atomic<std::uint64_t> m_hits{0};
+    std::atomic<std::uint64_t> m_misses{0};
+    std::atomic<std::uint64_t> m_buffersInUse{0};
+    std::atomic<std::uint64_t> m_bytesInUse{0};
+    std::atomic<std::uint64_t> m_bytesPooled{0};
+    std::atomic<std::uint64_t> m_highWaterBytes{0};
+};
+
+} // namespace scp
@@ -0,0 +1,61 @@
+#pragma once
+
+// IEEE 754 binary16 conversions for RGBA16F frames. Rounding is
+// round-to-nearest-even, matching F16C and NEON conversions, so scalar and
+// vector paths produce identical bits.
+
+#include <bit>
+#include <cstdint>
+
+namespace scp {
+
+constexpr std::uint16_t floatToHalf(float value)
+{
+    const std::uint32_t bits = std::bit_cast<std::uint32_t>(value);
+    const std::uint32_t sign = (bits >> 16) & 0x8000;
+    const std::uint32_t absolute = bits & 0x7fffffff;
+
+    if (absolute >= 0x7f800000) // inf or nan; keep nans quiet
+        return static_cast<std::uint16_t>(sign | 0x7c00 | (absolute > 0x7f800000 ? 0x200 : 0));
+    if (absolute >= 0x477ff000) // rounds to >= 65520: overflow to inf
+        return static_cast<std::uint16_t>(sign | 0x7c00);
+    if (absolute < 0x38800000) { // half subnormal or zero
+        if (absolute < 0x33000000)
+            return static_cast<std::uint16_t>(sign);
+        const std::uint32_t mantissa = (absolute & 0x7fffff) | 0x800000;
+        const int shift = 126 - static_cast<int>(absolute >> 23);
+        const std::uint32_t halfway = 1u << (shift - 1);
+        const std::uint32_t rest = mantissa & ((1u << shift) - 1);
+        std::uint32_t result = mantissa >> shift;
+        if (rest > halfway || (rest == halfway && (result & 1)))
+            ++result;
+        return static_cast<std::uint16_t>(sign | result);
+    }
+    // Normal: rebias the exponent and round the 13 dropped mantissa bits.
+    std::uint32_t result = absolute - 0x38000000;
+    result += 0xfff + ((result >> 13) & 1);
+    return static_cast<std::uint16_t>(sign | (result >> 13));
+}
+
+constexpr float halfToFloat(std::uint16_t half)
+{
+    const std::uint32_t sign = std::uint32_t(half & 0x8000) << 16;
+    const std::uint32_t exponent = (half >> 10) & 0x1f;
+    std::uint32_t mantissa = half & 0x3ff;
+
+    if (exponent == 0x1f)
+        return std::bit_cast<float>(sign | 0x7f800000 | (mantissa << 13));
+    if (exponent != 0)
+        return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+    if (mantissa == 0)
+        return std::bit_cast<float>(sign);
+    // Subnormal half: normalize into a float.
+    std::uint32_t e = 113;
+    while (!(mantissa & 0x400)) {
+        mantissa <<= 1;
+        --e;
+    }
+    return std::bit_cast<float>(sign | (e << 23) | ((mantissa & 0x3ff) << 13));
+}
+
+} // namespace scp
@@ -0,0 +1,55 @@
+#pragma once
+
+// Small non-cryptographic hashing helpers for content keys (render graph
+// nodes, cache entries). Stable within a process; not persisted.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+namespace scp {
+
+// splitmix64 finalizer.
+constexpr std::uint64_t mixHash(std::uint64_t value)
+{
+    value += 0x9e3779b97f4a7c15ull;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+
+constexpr std::uint64_t hashCombine(std::uint64_t seed, std::uint64_t value)
+{
+    return mixHash(seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2)));
+}
+
+// FNV-1a over raw bytes.
+inline std::uint64_t hashBytes(const void *data, std::size_t size,
+                               std::uint64_t seed = 0xcbf29ce484222325ull)
+{
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    std::uint64_t h = seed;
+    for (std::size_t i = 0; i < size; ++i)
+        h = (h ^ bytes[i]) * 0x100000001b3ull;
+    return h;
+}
+
+inline std::uint64_t hashString(std::string_view text)
+{
+    return hashBytes(text.data(), text.size());
+}
+
+// Hashes the object representation of a value whose bytes are all
+// significant: integers, enums, and structs without padding. Floats hash
+// by bit pattern. Hash the members of anything else one by one, since
+// padding bytes are indeterminate.
+template<typename T>
+std::uint64_t hashValue(std::uint64_t seed, const T &value)
+{
+    static_assert(std::has_unique_object_representations_v<T> || std::is_floating_point_v<T>);
+    return hashCombine(seed, hashBytes(&value, sizeof(value)));
+}
+
+} // namespace scp
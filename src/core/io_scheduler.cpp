@@ -0,0 +1,543 @@
+#include "core/io_scheduler.h"
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <future>
+
+namespace scp {
+
+class IoScheduler::File
+{
+public:
+    File(int descriptor, dev_t fileDevice, std::uint64_t fileId)
+        : fd(descriptor)
+        , device(fileDevice)
+        , id(fileId)
+    {}
+    ~File() { ::close(fd); }
+
+    const int fd;
+    const dev_t device;
+    const std::uint64_t id;
+};
+
+// A submission and a completion ring over the raw io_uring system calls,
+// driven by one thread.
+class IoScheduler::Ring
+{
+public:
+    // Null when the kernel has no io_uring or refuses it.
+    static std::unique_ptr<Ring> create(unsigned entries);
+    ~Ring();
+
+    Ring(const Ring &) = delete;
+    Ring &operator=(const Ring &) = delete;
+
+    unsigned entries() const { return m_sqEntries; }
+
+    // Queues sqe for the next submitAndWait(). False when the ring is full.
+    bool prepare(const io_uring_sqe &sqe);
+    // Submits what was prepared and waits for at least one completion.
+    // Returns 0 or a negative errno.
+    int submitAndWait();
+    // The next completion, false when none is ready.
+    bool reap(io_uring_cqe &cqe);
+
+private:
+    Ring() = default;
+
+    int m_fd = -1;
+    void *m_sqRing = MAP_FAILED;
+    void *m_cqRing = MAP_FAILED;
+    std::size_t m_sqRingBytes = 0;
+    std::size_t m_cqRingBytes = 0;
+    io_uring_sqe *m_sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+    std::size_t m_sqesBytes = 0;
+    unsigned m_sqEntries = 0;
+
+    unsigned *m_sqHead = nullptr;
+    unsigned *m_sqTail = nullptr;
+    unsigned m_sqMask = 0;
+    unsigned *m_sqArray = nullptr;
+    unsigned *m_cqHead = nullptr;
+    unsigned *m_cqTail = nullptr;
+    unsigned m_cqMask = 0;
+    io_uring_cqe *m_cqes = nullptr;
+    unsigned m_pending = 0; // prepared, not yet submitted
+};
+
+std::unique_ptr<IoScheduler::Ring> IoScheduler::Ring::create(unsigned entries)
+{
+    io_uring_params params{};
+    const int fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0)
+        return nullptr;
+    std::unique_ptr<Ring> ring(new Ring);
+    ring->m_fd = fd;
+    ring->m_sqEntries = params.sq_entries;
+
+    ring->m_sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->m_cqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single)
+        ring->m_sqRingBytes = ring->m_cqRingBytes = std::max(ring->m_sqRingBytes,
+                                                             ring->m_cqRingBytes);
+    ring->m_sqRing = ::mmap(nullptr, ring->m_sqRingBytes, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->m_sqRing == MAP_FAILED)
+        return nullptr;
+    ring->m_cqRing = single ? ring->m_sqRing
+                            : ::mmap(nullptr, ring->m_cqRingBytes, PROT_READ | PROT_WRITE,
+                                     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (ring->m_cqRing == MAP_FAILED)
+        return nullptr;
+    ring->m_sqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+    ring->m_sqes = static_cast<io_uring_sqe *>(::mmap(nullptr, ring->m_sqesBytes,
+                                                      PROT_READ | PROT_WRITE,
+                                                      MAP_SHARED | MAP_POPULATE, fd,
+                                                      IORING_OFF_SQES));
+    if (ring->m_sqes == MAP_FAILED)
+        return nullptr;
+
+    auto *sq = static_cast<std::uint8_t *>(ring->m_sqRing);
+    auto *cq = static_cast<std::uint8_t *>(ring->m_cqRing);
+    ring->m_sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    ring->m_sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    ring->m_sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    ring->m_sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    ring->m_cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    ring->m_cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    ring->m_cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    ring->m_cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    return ring;
+}
+
+IoScheduler::Ring::~Ring()
+{
+    if (m_sqes != MAP_FAILED)
+        ::munmap(m_sqes, m_sqesBytes);
+    if (m_cqRing != MAP_FAILED && m_cqRing != m_sqRing)
+        ::munmap(m_cqRing, m_cqRingBytes);
+    if (m_sqRing != MAP_FAILED)
+        ::munmap(m_sqRing, m_sqRingBytes);
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+bool IoScheduler::Ring::prepare(const io_uring_sqe &sqe)
+{
+    // The kernel moves the head, this thread the tail.
+    const unsigned tail = *m_sqTail;
+    if (tail - std::atomic_ref(*m_sqHead).load(std::memory_order_acquire) >= m_sqEntries)
+        return false;
+    const unsigned index = tail & m_sqMask;
+    m_sqes[index] = sqe;
+    m_sqArray[index] = index;
+    std::atomic_ref(*m_sqTail).store(tail + 1, std::memory_order_release);
+    ++m_pending;
+    return true;
+}
+
+int IoScheduler::Ring::submitAndWait()
+{
+    for (;;) {
+        const long submitted = ::syscall(__NR_io_uring_enter, m_fd, m_pending, 1,
+                                         IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (submitted >= 0) {
+            m_pending -= static_cast<unsigned>(submitted);
+            return 0;
+        }
+        if (errno != EINTR)
+            return -errno;
+    }
+}
+
+bool IoScheduler::Ring::reap(io_uring_cqe &cqe)
+{
+    const unsigned head = *m_cqHead;
+    if (head == std::atomic_ref(*m_cqTail).load(std::memory_order_acquire))
+        return false;
+    cqe = m_cqes[head & m_cqMask];
+    std::atomic_ref(*m_cqHead).store(head + 1, std::memory_order_release);
+    return true;
+}
+
+// A batch being read through the ring, resubmitted after short reads.
+struct IoScheduler::RingRead
+{
+    Batch batch;
+    std::vector<std::uint8_t> merged;
+    std::uint8_t *target = nullptr;
+    std::size_t done = 0;
+    iovec vector{};
+};
+
+namespace {
+
+// Ring size; one entry stays free for the wake-up poll.
+constexpr unsigned kRingEntries = 64;
+// Completion tag of the wake-up poll; reads are tagged with their RingRead.
+constexpr std::uint64_t kWakeTag = 0;
+
+// Returns the bytes read, short only at end of file, or a negative errno.
+std::int64_t readFully(int fd, std::uint8_t *buffer, std::size_t length, std::uint64_t offset)
+{
+    std::size_t done = 0;
+    while (done < length) {
+        const ssize_t n = ::pread(fd, buffer + done, length - done, off_t(offset + done));
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -errno;
+        }
+        if (n == 0)
+            break;
+        done += std::size_t(n);
+    }
+    return std::int64_t(done);
+}
+
+} // namespace
+
+IoScheduler::IoScheduler(IoSchedulerConfig config)
+    : m_config(config)
+{
+    if (m_config.ioUring && (m_ring = Ring::create(kRingEntries))) {
+        m_wakeFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (m_wakeFd >= 0) {
+            m_workers.emplace_back([this](std::stop_token stop) { runRing(stop); });
+            return;
+        }
+        m_ring.reset();
+    }
+    const unsigned workers = std::max(1u, m_config.workers);
+    for (unsigned i = 0; i < workers; ++i)
+        m_workers.emplace_back([this](std::stop_token stop) { run(stop); });
+}
+
+IoScheduler::~IoScheduler()
+{
+    for (std::jthread &worker : m_workers)
+        worker.request_stop();
+    m_workers.clear();
+    m_ring.reset();
+    if (m_wakeFd >= 0)
+        ::close(m_wakeFd);
+
+    // Nobody will read these any more; fail them so waiters return.
+    std::vector<Request> orphaned;
+    for (auto &[device, state] : m_devices)
+        for (auto &queue : state.queues)
+            for (auto &[key, request] : queue)
+                orphaned.push_back(std::move(request));
+    for (Request &request : orphaned)
+        request.completion(-ECANCELED);
+}
+
+IoScheduler &IoScheduler::shared()
+{
+    static IoScheduler scheduler;
+    return scheduler;
+}
+
+IoScheduler::FileHandle IoScheduler::open(const std::string &path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return nullptr;
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    std::lock_guard lock(m_mutex);
+    return std::make_shared<const File>(fd, info.st_dev, m_nextFileId++);
+}
+
+IoScheduler::RequestId IoScheduler::submit(const FileHandle &file, std::uint64_t offset,
+                                           std::size_t length, void *buffer, IoPriority priority,
+                                           Completion completion)
+{
+    RequestId id;
+    {
+        std::lock_guard lock(m_mutex);
+        id = m_nextId++;
+        Device &device = m_devices[file->device];
+        const int p = static_cast<int>(priority);
+        const Key key{file->id, offset, id};
+        device.queues[p].emplace(key, Request{file, offset, length, buffer, std::move(completion)});
+        m_queued.emplace(id, Location{&device, p, key});
+        ++m_stats.requests;
+    }
+    if (m_wakeFd >= 0)
+        ::eventfd_write(m_wakeFd, 1);
+    else
+        m_wake.notify_one();
+    return id;
+}
+
+bool IoScheduler::cancel(RequestId id)
+{
+    std::lock_guard lock(m_mutex);
+    auto it = m_queued.find(id);
+    if (it == m_queued.end())
+        return false;
+    it->second.device->queues[it->second.priority].erase(it->second.key);
+    m_queued.erase(it);
+    ++m_stats.cancelled;
+    return true;
+}
+
+std::int64_t IoScheduler::read(const FileHandle &file, std::uint64_t offset, std::size_t length,
+                               void *buffer, IoPriority priority)
+{
+    std::promise<std::int64_t> result;
+    submit(file, offset, length, buffer, priority,
+           [&result](std::int64_t bytes) { result.set_value(bytes); });
+    return result.get_future().get();
+}
+
+IoSchedulerStats IoScheduler::stats() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_stats;
+}
+
+unsigned IoScheduler::slotsFor(int priority) const
+{
+    const unsigned depth = std::max(1u, m_config.deviceDepth);
+    switch (static_cast<IoPriority>(priority)) {
+    case IoPriority::Playhead:
+        return depth;
+    case IoPriority::Prefetch:
+        return std::max(1u, depth - 1);
+    case IoPriority::Background:
+        return std::max(1u, depth / 2);
+    }
+    return 1;
+}
+
+bool IoScheduler::takeBatchLocked(Batch &batch)
+{
+    // Highest class first; between devices, the least busy one.
+    Device *device = nullptr;
+    int priority = 0;
+    for (; priority < kPriorities && !device; ++priority) {
+        for (auto &[id, candidate] : m_devices) {
+            if (candidate.queues[priority].empty() || candidate.inFlight >= slotsFor(priority))
+                continue;
+            if (!device || candidate.inFlight < device->inFlight)
+                device = &candidate;
+        }
+    }
+    if (!device)
+        return false;
+    --priority;
+
+    // Elevator: the next read at or after the head, wrapping to the start.
+    auto &queue = device->queues[priority];
+    auto lead = queue.lower_bound(Key{device->headFile, device->headOffset, 0});
+    if (lead == queue.end())
+        lead = queue.begin();
+    const std::uint64_t fileId = std::get<0>(lead->first);
+    batch.device = device;
+    batch.file = lead->second.file;
+    batch.offset = lead->second.offset;
+    std::uint64_t end = batch.offset + lead->second.length;
+    m_queued.erase(std::get<2>(lead->first));
+    batch.requests.push_back(std::move(lead->second));
+    queue.erase(lead);
+
+    // Merge reads of the same file that start inside or just past the
+    // range. Lower classes only ride along when they barely extend it, so
+    // they cannot add much latency to the lead read.
+    for (bool grew = true; grew;) {
+        grew = false;
+        for (int q = 0; q < kPriorities; ++q) {
+            auto &other = device->queues[q];
+            for (auto it = other.lower_bound(Key{fileId, batch.offset, 0});
+                 it != other.end() && std::get<0>(it->first) == fileId;) {
+                const Request &request = it->second;
+                if (request.offset > end + m_config.mergeGap)
+                    break;
+                const std::uint64_t requestEnd = std::max(end, request.offset + request.length);
+                if (requestEnd - batch.offset > m_config.maxMergedRead
+                    || (q > priority && requestEnd > end + m_config.mergeGap)) {
+                    ++it;
+                    continue;
+                }
+                end = requestEnd;
+                m_queued.erase(std::get<2>(it->first));
+                batch.requests.push_back(std::move(it->second));
+                it = other.erase(it);
+                grew = true;
+            }
+        }
+    }
+    batch.length = static_cast<std::size_t>(end - batch.offset);
+    m_stats.merged += batch.requests.size() - 1;
+
+    ++device->inFlight;
+    device->headFile = fileId;
+    device->headOffset = end;
+    return true;
+}
+
+void IoScheduler::dispatch(Batch &batch)
+{
+    const int fd = batch.file->fd;
+    if (batch.requests.size() == 1) {
+        Request &request = batch.requests.front();
+        complete(batch,
+                 readFully(fd, static_cast<std::uint8_t *>(request.buffer), request.length,
+                           request.offset),
+                 nullptr);
+        return;
+    }
+    std::vector<std::uint8_t> merged(batch.length);
+    complete(batch, readFully(fd, merged.data(), batch.length, batch.offset), merged.data());
+}
+
+void IoScheduler::complete(Batch &batch, std::int64_t got, const std::uint8_t *merged)
+{
+    if (merged && got >= 0) {
+        for (Request &request : batch.requests) {
+            const std::int64_t skip = std::int64_t(request.offset - batch.offset);
+            const std::size_t bytes = static_cast<std::size_t>(
+                std::clamp<std::int64_t>(got - skip, 0, std::int64_t(request.length)));
+            if (bytes)
+                std::memcpy(request.buffer, merged + skip, bytes);
+        }
+    }
+    {
+        std::lock_guard lock(m_mutex);
+        ++m_stats.reads;
+        m_stats.bytesRead += std::uint64_t(std::max<std::int64_t>(got, 0));
+    }
+
+    for (Request &request : batch.requests) {
+        std::int64_t result = got;
+        if (got >= 0) {
+            const std::int64_t skip = std::int64_t(request.offset - batch.offset);
+            result = std::clamp<std::int64_t>(got - skip, 0, std::int64_t(request.length));
+        }
+        request.completion(result);
+    }
+}
+
+void IoScheduler::run(std::stop_token stop)
+{
+    for (;;) {
+        Batch batch;
+        {
+            std::unique_lock lock(m_mutex);
+            if (!m_wake.wait(lock, stop, [&] { return takeBatchLocked(batch); }))
+                return;
+        }
+        dispatch(batch);
+        {
+            std::lock_guard lock(m_mutex);
+            --batch.device->inFlight;
+        }
+        // A device slot opened up.
+        m_wake.notify_all();
+    }
+}
+
+void IoScheduler::submitRead(RingRead &read)
+{
+    read.vector.iov_base = read.target + read.done;
+    read.vector.iov_len = read.batch.length - read.done;
+    io_uring_sqe sqe{};
+    sqe.opcode = IORING_OP_READV; // READ needs 5.6; READV is as old as the ring
+    sqe.fd = read.batch.file->fd;
+    sqe.addr = reinterpret_cast<std::uint64_t>(&read.vector);
+    sqe.len = 1;
+    sqe.off = read.batch.offset + read.done;
+    sqe.user_data = reinterpret_cast<std::uint64_t>(&read);
+    // runRing() never has more reads out than the ring has entries.
+    m_ring->prepare(sqe);
+}
+
+void IoScheduler::runRing(std::stop_token stop)
+{
+    std::stop_callback wake(stop, [this] { ::eventfd_write(m_wakeFd, 1); });
+    io_uring_sqe poll{};
+    poll.opcode = IORING_OP_POLL_ADD;
+    poll.fd = m_wakeFd;
+    poll.poll32_events = POLLIN;
+    poll.user_data = kWakeTag;
+
+    bool polling = false;
+    std::size_t inFlight = 0;
+    for (;;) {
+        if (stop.stop_requested()) {
+            // Reads in flight write into callers' buffers; see them out.
+            if (inFlight == 0)
+                return;
+        } else {
+            std::vector<std::unique_ptr<RingRead>> started;
+            {
+                std::lock_guard lock(m_mutex);
+                auto read = std::make_unique<RingRead>();
+                while (inFlight + started.size() < m_ring->entries() - 1
+                       && takeBatchLocked(read->batch)) {
+                    started.push_back(std::move(read));
+                    read = std::make_unique<RingRead>();
+                }
+            }
+            for (std::unique_ptr<RingRead> &read : started) {
+                if (read->batch.requests.size() == 1) {
+                    read->target = static_cast<std::uint8_t *>(
+                        read->batch.requests.front().buffer);
+                } else {
+                    read->merged.resize(read->batch.length);
+                    read->target = read->merged.data();
+                }
+                submitRead(*read.release());
+                ++inFlight;
+            }
+            if (!polling)
+                polling = m_ring->prepare(poll);
+        }
+
+        // Besides EINTR, which it retries, entering only fails with a full
+        // completion ring (EBUSY), which reaping below clears.
+        m_ring->submitAndWait();
+        io_uring_cqe cqe;
+        while (m_ring->reap(cqe)) {
+            if (cqe.user_data == kWakeTag) {
+                eventfd_t count;
+                ::eventfd_read(m_wakeFd, &count);
+                polling = false;
+                continue;
+            }
+            auto *read = reinterpret_cast<RingRead *>(cqe.user_data);
+            if (cqe.res == -EINTR || cqe.res == -EAGAIN
+                || (cqe.res > 0 && (read->done += std::size_t(cqe.res)) < read->batch.length)) {
+                submitRead(*read);
+                continue;
+            }
+            const std::unique_ptr<RingRead> finished(read);
+            --inFlight;
+            complete(read->batch, cqe.res < 0 ? cqe.res : std::int64_t(read->done),
+                     read->merged.empty() ? nullptr : read->merged.data());
+            std::lock_guard lock(m_mutex);
+            --read->batch.device->inFlight;
+        }
+    }
+}
+
+} // namespace scp
@@ -0,0 +1,180 @@
+#pragma once
+
+// Shared read scheduler for media on local disks and arrays.
+//
+// Sixteen decoders each issuing blocking reads from their own thread send a
+// spinning array's heads back and forth between files and collapse its
+// throughput. Instead, reads are queued here per device and dispatched by a
+// small set of workers with a bounded number in flight per device:
+//
+//   - the highest priority class with pending reads goes first (playhead,
+//     then prefetch, then background work such as thumbnails, waveforms and
+//     indexing), and lower classes may not fill every slot, so a playhead
+//     read never waits behind a queue of background ones;
+//   - within a class, reads are taken in elevator order (file, offset) from
+//     where the device's last read ended;
+//   - reads of the same file that are adjacent or nearly so, of any class,
+//     are merged into one larger read and split again on completion.
+//
+// Reads go through io_uring where the kernel offers it (Linux 5.1+, and not
+// disabled by sysctl or seccomp): one thread keeps every device's slots
+// submitted on a ring and completes requests as their reads come back, so
+// the number of reads in flight no longer costs a thread each. Elsewhere a
+// pool of workers issues blocking pread()s. Callers cannot tell the two
+// apart.
+
+#include <sys/types.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace scp {
+
+// In dispatch order.
+enum class IoPriority {
+    Playhead,
+    Prefetch,
+    Background,
+};
+
+struct IoSchedulerConfig
+{
+    // Reads in flight per device. Prefetch may use all but one slot and
+    // background work half of them.
+    unsigned deviceDepth = 4;
+    // Worker threads shared by all devices.
+    unsigned workers = 8;
+    // Reads of one file at most this far apart are merged.
+    std::size_t mergeGap = 256 * 1024;
+    std::size_t maxMergedRead = 8u << 20;
+    // Use io_uring when available. With it, workers is ignored.
+    bool ioUring = true;
+};
+
+struct IoSchedulerStats
+{
+    std::uint64_t requests = 0;
+    std::uint64_t cancelled = 0;
+    // Requests served by a read that was issued for another request.
+    std::uint64_t merged = 0;
+    std::uint64_t reads = 0;
+    std::uint64_t bytesRead = 0;
+};
+
+class IoScheduler
+{
+public:
+    // An open file. Keep the handle for as long as reads are submitted.
+    class File;
+    using FileHandle = std::shared_ptr<const File>;
+    using RequestId = std::uint64_t;
+    // Bytes read (short only at end of file), or a negative errno.
+    using Completion = std::function<void(std::int64_t result)>;
+
+    explicit IoScheduler(IoSchedulerConfig config = {});
+    ~IoScheduler();
+
+    IoScheduler(const IoScheduler &) = delete;
+    IoScheduler &operator=(const IoScheduler &) = delete;
+
+    // Null if the file cannot be opened.
+    FileHandle open(const std::string &path);
+
+    // Queues a read of length bytes at offset into buffer, which must stay
+    // valid until completion runs. Completions run on a worker thread and
+    // must not block.
+    RequestId submit(const FileHandle &file, std::uint64_t offset, std::size_t length,
+                     void *buffer, IoPriority priority, Completion completion);
+
+    // Removes a request that has not been dispatched yet; its completion
+    // will not run. False if it is already being read or has completed.
+    bool cancel(RequestId id);
+
+    // Submits and waits. Returns like Completion.
+    std::int64_t read(const FileHandle &file, std::uint64_t offset, std::size_t length,
+                      void *buffer, IoPriority priority);
+
+    IoSchedulerStats stats() const;
+    // Whether reads go through io_uring rather than pread() workers.
+    bool usesIoUring() const { return m_ring != nullptr; }
+
+    // Process-wide scheduler.
+    static IoScheduler &shared();
+
+private:
+    // Elevator order: file, then offset, then submission.
+    using Key = std::tuple<std::uint64_t, std::uint64_t, RequestId>;
+    static constexpr int kPriorities = 3;
+
+    struct Request
+    {
+        FileHandle file;
+        std::uint64_t offset;
+        std::size_t length;
+        void *buffer;
+        Completion completion;
+    };
+
+    struct Device
+    {
+        std::map<Key, Request> queues[kPriorities];
+        // Where the last dispatched read ended.
+        std::uint64_t headFile = 0;
+        std::uint64_t headOffset = 0;
+        unsigned inFlight = 0;
+    };
+
+    // One read, serving one or more requests.
+    struct Batch
+    {
+        Device *device;
+        FileHandle file;
+        std::uint64_t offset = 0;
+        std::size_t length = 0;
+        std::vector<Request> requests;
+    };
+
+    class Ring;
+    struct RingRead;
+
+    bool takeBatchLocked(Batch &batch);
+    unsigned slotsFor(int priority) const;
+    void dispatch(Batch &batch);
+    // Hands merged data out to the requests of batch and completes them.
+    void complete(Batch &batch, std::int64_t result, const std::uint8_t *merged);
+    void run(std::stop_token stop);
+    void runRing(std::stop_token stop);
+    void submitRead(RingRead &read);
+
+    const IoSchedulerConfig m_config;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable_any m_wake;
+    std::map<dev_t, Device> m_devices;
+    struct Location
+    {
+        Device *device;
+        int priority;
+        Key key;
+    };
+    std::unordered_map<RequestId, Location> m_queued;
+    RequestId m_nextId = 1;
+    std::uint64_t m_nextFileId = 1;
+    IoSchedulerStats m_stats;
+    std::unique_ptr<Ring> m_ring;
+    // Signalled by submit() to wake runRing() from waiting on the ring.
+    int m_wakeFd = -1;
+    std::vector<std::jthread> m_workers;
+};
+
+} // namespace scp
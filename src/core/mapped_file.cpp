@@ -0,0 +1,104 @@
+#include "core/mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace scp {
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+    : m_data(std::exchange(other.m_data, nullptr))
+    , m_size(std::exchange(other.m_size, 0))
+    , m_open(std::exchange(other.m_open, false))
+{}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other) {
+        close();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+        m_open = std::exchange(other.m_open, false);
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string &path)
+{
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    m_size = static_cast<std::size_t>(info.st_size);
+    if (m_size > 0) {
+        void *mapped = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            m_size = 0;
+            return false;
+        }
+        m_data = static_cast<const std::uint8_t *>(mapped);
+    }
+    // The mapping keeps the file referenced.
+    ::close(fd);
+    m_open = true;
+    return true;
+}
+
+void MappedFile::advise(std::size_t offset, std::size_t length, Advice advice) const
+{
+    if (!m_data || offset >= m_size || length == 0)
+        return;
+    static const std::size_t pageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    const std::size_t begin = offset / pageSize * pageSize;
+    const std::size_t end = std::min(m_size, offset + std::min(length, m_size - offset));
+
+    int flag = MADV_NORMAL;
+    switch (advice) {
+    case Advice::Normal:
+        flag = MADV_NORMAL;
+        break;
+    case Advice::Sequential:
+        flag = MADV_SEQUENTIAL;
+        break;
+    case Advice::Random:
+        flag = MADV_RANDOM;
+        break;
+    case Advice::WillNeed:
+        flag = MADV_WILLNEED;
+        break;
+    case Advice::Cold:
+#ifdef MADV_COLD
+        flag = MADV_COLD;
+        break;
+#else
+        return;
+#endif
+    }
+    ::madvise(const_cast<std::uint8_t *>(m_data) + begin, end - begin, flag);
+}
+
+void MappedFile::close()
+{
+    if (m_data)
+        ::munmap(const_cast<std::uint8_t *>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+    m_open = false;
+}
+
+} // namespace scp
@@ -0,0 +1,50 @@
+#pragma once
+
+// Read-only memory mapping of a whole file (POSIX).
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace scp {
+
+class MappedFile
+{
+public:
+    // Paging hints, see advise().
+    enum class Advice {
+        Normal,
+        Sequential, // aggressive kernel readahead, pages dropped soon after use
+        Random,     // no kernel readahead
+        WillNeed,   // start reading the range in now
+        Cold,       // range was consumed; reclaim it before other pages
+    };
+
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Returns false if the file cannot be opened or mapped. Empty files map
+    // successfully with a null data pointer.
+    bool open(const std::string &path);
+    void close();
+
+    // Passes a paging hint for [offset, offset + length) to the kernel.
+    // The range is widened to page boundaries and clipped to the file.
+    // Hints are best effort; unsupported ones are ignored.
+    void advise(std::size_t offset, std::size_t length, Advice advice) const;
+
+    bool isOpen() const { return m_open; }
+    const std::uint8_t *data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+
+private:
+    const std::uint8_t *m_data = nullptr;
+    std::size_t m_size = 0;
+    bool m_open = false;
+};
+
+} // namespace scp
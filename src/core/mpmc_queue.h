@@ -0,0 +1,96 @@
+#pragma once
+
+// Bounded lock-free multi-producer/multi-consumer queue (Vyukov's design).
+// Each cell carries a sequence number, so there is no ABA hazard and no
+// allocation after construction. Used wherever engine threads hand objects to
+// each other on hot paths.
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+
+namespace scp {
+
+template<typename T>
+class MpmcQueue
+{
+public:
+    // Capacity is rounded up to a power of two.
+    explicit MpmcQueue(std::size_t capacity)
+    {
+        std::size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        m_mask = size - 1;
+        m_cells = std::make_unique<Cell[]>(size);
+        for (std::size_t i = 0; i < size; ++i)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpmcQueue(const MpmcQueue &) = delete;
+    MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+    std::size_t capacity() const { return m_mask + 1; }
+
+    // Returns false when the queue is full.
+    bool tryPush(T value)
+    {
+        std::size_t pos = m_tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = m_cells[pos & m_mask];
+            const std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::optional<T> tryPop()
+    {
+        std::size_t pos = m_head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = m_cells[pos & m_mask];
+            const std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::ptrdiff_t>(seq)
+                              - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    T value = std::move(cell.value);
+                    cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+                    return value;
+                }
+            } else if (diff < 0) {
+                return std::nullopt;
+            } else {
+                pos = m_head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence{0};
+        T value{};
+    };
+
+    static constexpr std::size_t kCacheLine = 64;
+
+    std::unique_ptr<Cell[]> m_cells;
+    std::size_t m_mask = 0;
+    alignas(kCacheLine) std::atomic<std::size_t> m_head{0};
+    alignas(kCacheLine) std::atomic<std::size_t> m_tail{0};
+};
+
+} // namespace scp
@@ -0,0 +1,397 @@
+#include "core/pixel_convert.h"
+
+#include "core/half_float.h"
+#include "core/pixel_convert_internal.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace scp {
+
+namespace convert {
+
+Coefficients makeCoefficients(const ColorSpec &spec, int yuvBits)
+{
+    double kr = 0.2126, kb = 0.0722;
+    switch (spec.matrix) {
+    case ColorMatrix::BT601:
+        kr = 0.299;
+        kb = 0.114;
+        break;
+    case ColorMatrix::BT709:
+        break;
+    case ColorMatrix::BT2020:
+        kr = 0.2627;
+        kb = 0.0593;
+        break;
+    }
+    const double kg = 1.0 - kr - kb;
+    const int shift = yuvBits - 8;
+    const bool limited = spec.range == ColorRange::Limited;
+    const double lumaRange = limited ? 219 << shift : (1 << yuvBits) - 1;
+    const double chromaRange = limited ? 224 << shift : (1 << yuvBits) - 1;
+
+    // Normalized YUV -> RGB factors.
+    const double crR = 2.0 * (1.0 - kr);
+    const double cbG = 2.0 * kb * (1.0 - kb) / kg;
+    const double crG = 2.0 * kr * (1.0 - kr) / kg;
+    const double cbB = 2.0 * (1.0 - kb);
+    auto q16 = [](double value) { return static_cast<std::int32_t>(std::lround(value * 65536.0)); };
+
+    Coefficients c;
+    c.yOffset = limited ? 16 << shift : 0;
+    c.chromaOffset = 128 << shift;
+    c.maxCode = (1 << yuvBits) - 1;
+
+    c.yScale = q16(255.0 / lumaRange);
+    c.crR = q16(255.0 * crR / chromaRange);
+    c.cbG = q16(255.0 * cbG / chromaRange);
+    c.crG = q16(255.0 * crG / chromaRange);
+    c.cbB = q16(255.0 * cbB / chromaRange);
+
+    c.fyScale = static_cast<float>(1.0 / lumaRange);
+    c.fcrR = static_cast<float>(crR / chromaRange);
+    c.fcbG = static_cast<float>(cbG / chromaRange);
+    c.fcrG = static_cast<float>(crG / chromaRange);
+    c.fcbB = static_cast<float>(cbB / chromaRange);
+
+    // RGB -> YUV: integer factors take 8-bit RGB, float factors [0, 1] RGB.
+    const double uScale = 0.5 / (1.0 - kb);
+    const double vScale = 0.5 / (1.0 - kr);
+    const double y[3] = {kr, kg, kb};
+    const double u[3] = {-kr * uScale, -kg * uScale, 0.5};
+    const double v[3] = {0.5, -kg * vScale, -kb * vScale};
+    c.yR = q16(y[0] * lumaRange / 255.0);
+    c.yG = q16(y[1] * lumaRange / 255.0);
+    c.yB = q16(y[2] * lumaRange / 255.0);
+    c.uR = q16(u[0] * chromaRange / 255.0);
+    c.uG = q16(u[1] * chromaRange / 255.0);
+    c.uB = q16(u[2] * chromaRange / 255.0);
+    c.vR = q16(v[0] * chromaRange / 255.0);
+    c.vG = q16(v[1] * chromaRange / 255.0);
+    c.vB = q16(v[2] * chromaRange / 255.0);
+    c.fyR = static_cast<float>(y[0] * lumaRange);
+    c.fyG = static_cast<float>(y[1] * lumaRange);
+    c.fyB = static_cast<float>(y[2] * lumaRange);
+    c.fuR = static_cast<float>(u[0] * chromaRange);
+    c.fuG = static_cast<float>(u[1] * chromaRange);
+    c.fuB = static_cast<float>(u[2] * chromaRange);
+    c.fvR = static_cast<float>(v[0] * chromaRange);
+    c.fvG = static_cast<float>(v[1] * chromaRange);
+    c.fvB = static_cast<float>(v[2] * chromaRange);
+    return c;
+}
+
+#if !defined(__x86_64__) && !defined(__i386__)
+const KernelTable *sse41Kernels()
+{
+    return nullptr;
+}
+const KernelTable *avx2Kernels()
+{
+    return nullptr;
+}
+const KernelTable *avx512Kernels()
+{
+    return nullptr;
+}
+#endif
+#if !defined(__aarch64__)
+const KernelTable *neonKernels()
+{
+    return nullptr;
+}
+#endif
+
+} // namespace convert
+
+using namespace convert;
+
+namespace {
+
+std::int32_t clampCode(std::int32_t value, std::int32_t maxCode)
+{
+    return std::clamp(value, 0, maxCode);
+}
+
+// Scalar reference kernels. They start at pixel x0 so they can also finish
+// rows after a vector kernel.
+
+template<bool Interleaved, bool Wide>
+void loadYuv(const ToRgbaRow &row, int x, std::int32_t &y, std::int32_t &u, std::int32_t &v)
+{
+    if constexpr (Wide) {
+        const auto *y16 = reinterpret_cast<const std::uint16_t *>(row.y);
+        const auto *uv16 = reinterpret_cast<const std::uint16_t *>(row.u);
+        y = y16[x] >> 6;
+        u = uv16[x / 2 * 2] >> 6;
+        v = uv16[x / 2 * 2 + 1] >> 6;
+    } else if constexpr (Interleaved) {
+        y = row.y[x];
+        u = row.u[x / 2 * 2];
+        v = row.u[x / 2 * 2 + 1];
+    } else {
+        y = row.y[x];
+        u = row.u[x / 2];
+        v = row.v[x / 2];
+    }
+}
+
+template<bool Interleaved, bool Wide>
+void toRgba8(const ToRgbaRow &row, const Coefficients &c, int x0)
+{
+    auto *out = reinterpret_cast<std::uint32_t *>(row.out);
+    for (int x = x0; x < row.width; ++x) {
+        std::int32_t y, u, v;
+        loadYuv<Interleaved, Wide>(row, x, y, u, v);
+        y = (y - c.yOffset) * c.yScale + (1 << 15);
+        u -= c.chromaOffset;
+        v -= c.chromaOffset;
+        const std::uint32_t r = clampCode((y + v * c.crR) >> 16, 255);
+        const std::uint32_t g = clampCode((y - u * c.cbG - v * c.crG) >> 16, 255);
+        const std::uint32_t b = clampCode((y + u * c.cbB) >> 16, 255);
+        out[x] = r | g << 8 | b << 16 | 0xff000000u;
+    }
+}
+
+template<bool Interleaved, bool Wide>
+void toRgba16f(const ToRgbaRow &row, const Coefficients &c, int x0)
+{
+    auto *out = reinterpret_cast<std::uint16_t *>(row.out);
+    for (int x = x0; x < row.width; ++x) {
+        std::int32_t yi, ui, vi;
+        loadYuv<Interleaved, Wide>(row, x, yi, ui, vi);
+        const float y = static_cast<float>(yi - c.yOffset) * c.fyScale;
+        const float u = static_cast<float>(ui - c.chromaOffset);
+        const float v = static_cast<float>(vi - c.chromaOffset);
+        const float r = y + v * c.fcrR;
+        const float g = (y - u * c.fcbG) - v * c.fcrG;
+        const float b = y + u * c.fcbB;
+        std::uint16_t *pixel = out + 4 * x;
+        pixel[0] = floatToHalf(r);
+        pixel[1] = floatToHalf(g);
+        pixel[2] = floatToHalf(b);
+        pixel[3] = 0x3c00;
+    }
+}
+
+template<bool Interleaved>
+void fromRgba8(const FromRgbaRows &rows, const Coefficients &c, int x0)
+{
+    const std::int32_t yBias = (c.yOffset << 16) + (1 << 15);
+    const std::int32_t chromaBias = (c.chromaOffset << 18) + (1 << 17);
+    for (int x = x0; x < rows.width; x += 2) {
+        std::int32_t sr = 0, sg = 0, sb = 0;
+        for (int line = 0; line < 2; ++line) {
+            // Odd widths repeat the last column into the chroma sum.
+            for (int dx = 0; dx < 2; ++dx) {
+                const int column = std::min(x + dx, rows.width - 1);
+                const std::uint8_t *p = rows.rgba[line] + 4 * column;
+                if (column == x + dx)
+                    rows.y[line][column] = static_cast<std::uint8_t>(
+                        clampCode((p[0] * c.yR + p[1] * c.yG + p[2] * c.yB + yBias) >> 16, 255));
+                sr += p[0];
+                sg += p[1];
+                sb += p[2];
+            }
+        }
+        const auto u = static_cast<std::uint8_t>(
+            clampCode((sr * c.uR + sg * c.uG + sb * c.uB + chromaBias) >> 18, 255));
+        const auto v = static_cast<std::uint8_t>(
+            clampCode((sr * c.vR + sg * c.vG + sb * c.vB + chromaBias) >> 18, 255));
+        if constexpr (Interleaved) {
+            rows.u[x] = u;
+            rows.u[x + 1] = v;
+        } else {
+            rows.u[x / 2] = u;
+            rows.v[x / 2] = v;
+        }
+    }
+}
+
+void rgba16fToP010(const FromRgbaRows &rows, const Coefficients &c, int x0)
+{
+    const float yOffset = static_cast<float>(c.yOffset);
+    const float chromaOffset = static_cast<float>(c.chromaOffset);
+    auto code = [&](float value) {
+        const auto clamped = clampCode(static_cast<std::int32_t>(std::lround(value)), c.maxCode);
+        return static_cast<std::uint16_t>(clamped << 6);
+    };
+    auto *uv = reinterpret_cast<std::uint16_t *>(rows.u);
+    for (int x = x0; x < rows.width; x += 2) {
+        float sr = 0, sg = 0, sb = 0;
+        for (int line = 0; line < 2; ++line) {
+            const auto *in = reinterpret_cast<const std::uint16_t *>(rows.rgba[line]);
+            auto *luma = reinterpret_cast<std::uint16_t *>(rows.y[line]);
+            for (int dx = 0; dx < 2; ++dx) {
+                const int column = std::min(x + dx, rows.width - 1);
+                const float r = halfToFloat(in[4 * column]);
+                const float g = halfToFloat(in[4 * column + 1]);
+                const float b = halfToFloat(in[4 * column + 2]);
+                if (column == x + dx)
+                    luma[column] = code(yOffset + r * c.fyR + g * c.fyG + b * c.fyB);
+                sr += r;
+                sg += g;
+                sb += b;
+            }
+        }
+        uv[x] = code(chromaOffset + (sr * c.fuR + sg * c.fuG + sb * c.fuB) * 0.25f);
+        uv[x + 1] = code(chromaOffset + (sr * c.fvR + sg * c.fvG + sb * c.fvB) * 0.25f);
+    }
+}
+
+const KernelTable *kernelsFor(SimdLevel level)
+{
+    static const KernelTable none;
+    const KernelTable *table = nullptr;
+    if (isSimdLevelSupported(level)) {
+        switch (level) {
+        case SimdLevel::SSE41:
+            table = sse41Kernels();
+            break;
+        case SimdLevel::AVX2:
+            table = avx2Kernels();
+            break;
+        case SimdLevel::AVX512:
+            table = avx512Kernels();
+            break;
+        case SimdLevel::NEON:
+            table = neonKernels();
+            break;
+        case SimdLevel::Scalar:
+            break;
+        }
+    }
+    return table ? table : &none;
+}
+
+using ScalarToRgba = void (*)(const ToRgbaRow &, const Coefficients &, int);
+using ScalarFromRgba = void (*)(const FromRgbaRows &, const Coefficients &, int);
+
+void convertToRgba(const FrameBuffer &source, FrameBuffer &destination, const Coefficients &c,
+                   ToRgbaKernel vector, ScalarToRgba scalar)
+{
+    const bool planar = source.planeCount() == 3;
+    for (int line = 0; line < source.height(); ++line) {
+        const int chromaLine = line / 2;
+        const ToRgbaRow row{
+            source.data(0) + std::ptrdiff_t(line) * source.stride(0),
+            source.data(1) + std::ptrdiff_t(chromaLine) * source.stride(1),
+            planar ? source.data(2) + std::ptrdiff_t(chromaLine) * source.stride(2) : nullptr,
+            destination.data(0) + std::ptrdiff_t(line) * destination.stride(0),
+            source.width(),
+        };
+        scalar(row, c, vector ? vector(row, c) : 0);
+    }
+}
+
+void convertFromRgba(const FrameBuffer &source, FrameBuffer &destination, const Coefficients &c,
+                     FromRgbaKernel vector, ScalarFromRgba scalar)
+{
+    const bool planar = destination.planeCount() == 3;
+    for (int line = 0; line < source.height(); line += 2) {
+        // An odd last row pairs with itself.
+        const int next = std::min(line + 1, source.height() - 1);
+        const int chromaLine = line / 2;
+        const FromRgbaRows rows{
+            {source.data(0) + std::ptrdiff_t(line) * source.stride(0),
+             source.data(0) + std::ptrdiff_t(next) * source.stride(0)},
+            {destination.data(0) + std::ptrdiff_t(line) * destination.stride(0),
+             destination.data(0) + std::ptrdiff_t(next) * destination.stride(0)},
+            destination.data(1) + std::ptrdiff_t(chromaLine) * destination.stride(1),
+            planar ? destination.data(2) + std::ptrdiff_t(chromaLine) * destination.stride(2)
+                   : nullptr,
+            source.width(),
+        };
+        scalar(rows, c, vector ? vector(rows, c) : 0);
+    }
+}
+
+int yuvBits(PixelFormat format)
+{
+    return format == PixelFormat::P010 ? 10 : 8;
+}
+
+} // namespace
+
+bool isConversionSupported(PixelFormat from, PixelFormat to)
+{
+    switch (from) {
+    case PixelFormat::YUV420P:
+    case PixelFormat::NV12:
+    case PixelFormat::P010:
+        return to == PixelFormat::RGBA8 || to == PixelFormat::RGBA16F;
+    case PixelFormat::RGBA8:
+        return to == PixelFormat::YUV420P || to == PixelFormat::NV12;
+    case PixelFormat::RGBA16F:
+        return to == PixelFormat::P010;
+    case PixelFormat::None:
+        break;
+    }
+    return false;
+}
+
+bool convertFrame(const FrameBuffer &source, FrameBuffer &destination)
+{
+    const PixelFormat to = destination.pixelFormat();
+    const bool toRgba = to == PixelFormat::RGBA8 || to == PixelFormat::RGBA16F;
+    return convertFrame(source, destination,
+                        toRgba ? source.colorSpec() : destination.colorSpec());
+}
+
+bool convertFrame(const FrameBuffer &source, FrameBuffer &destination, const ColorSpec &spec)
+{
+    return convertFrame(source, destination, spec, activeSimdLevel());
+}
+
+bool convertFrame(const FrameBuffer &source, FrameBuffer &destination, const ColorSpec &spec,
+                  SimdLevel level)
+{
+    const PixelFormat from = source.pixelFormat();
+    const PixelFormat to = destination.pixelFormat();
+    if (!isConversionSupported(from, to) || source.width() != destination.width()
+        || source.height() != destination.height())
+        return false;
+
+    const KernelTable &k = *kernelsFor(level);
+    const bool toRgba = to == PixelFormat::RGBA8 || to == PixelFormat::RGBA16F;
+    const Coefficients c = makeCoefficients(spec, yuvBits(toRgba ? from : to));
+
+    if (to == PixelFormat::RGBA8) {
+        switch (from) {
+        case PixelFormat::YUV420P:
+            convertToRgba(source, destination, c, k.yuv420pToRgba8, toRgba8<false, false>);
+            break;
+        case PixelFormat::NV12:
+            convertToRgba(source, destination, c, k.nv12ToRgba8, toRgba8<true, false>);
+            break;
+        default:
+            convertToRgba(source, destination, c, k.p010ToRgba8, toRgba8<true, true>);
+            break;
+        }
+    } else if (to == PixelFormat::RGBA16F) {
+        switch (from) {
+        case PixelFormat::YUV420P:
+            convertToRgba(source, destination, c, k.yuv420pToRgba16f, toRgba16f<false, false>);
+            break;
+        case PixelFormat::NV12:
+            convertToRgba(source, destination, c, k.nv12ToRgba16f, toRgba16f<true, false>);
+            break;
+        default:
+            convertToRgba(source, destination, c, k.p010ToRgba16f, toRgba16f<true, true>);
+            break;
+        }
+    } else if (to == PixelFormat::YUV420P) {
+        convertFromRgba(source, destination, c, k.rgba8ToYuv420p, fromRgba8<false>);
+    } else if (to == PixelFormat::NV12) {
+        convertFromRgba(source, destination, c, k.rgba8ToNv12, fromRgba8<true>);
+    } else {
+        convertFromRgba(source, destination, c, nullptr, rgba16fToP010);
+    }
+    destination.setPts(source.pts());
+    destination.setColorSpec(spec);
+    return true;
+}
+
+} // namespace scp
@@ -0,0 +1,39 @@
+#pragma once
+
+// Pixel format conversion between decoder YUV formats and the RGBA formats
+// the compositor works in.
+//
+// Supported conversions:
+//   YUV420P, NV12, P010 -> RGBA8, RGBA16F
+//   RGBA8 -> YUV420P, NV12
+//   RGBA16F -> P010
+//
+// Each conversion has a scalar reference implementation and, where it pays
+// off, SSE4.1 / AVX2 / AVX-512 / NEON kernels. The kernel set is chosen once
+// from the CPU's capabilities (see core/cpu_features.h). Vector kernels use
+// the same fixed-point and float operations as the scalar code, in the same
+// order and without fused multiply-adds, so every level produces identical
+// bits.
+
+#include "core/cpu_features.h"
+#include "core/frame_buffer.h"
+
+namespace scp {
+
+bool isConversionSupported(PixelFormat from, PixelFormat to);
+
+// Converts source into destination, which must have the same dimensions,
+// with the color spec of the YUV side: the source's when converting to RGBA,
+// the destination's when converting from it. Returns false when the format
+// pair is unsupported.
+bool convertFrame(const FrameBuffer &source, FrameBuffer &destination);
+
+// As above with an explicit color spec, which the destination records.
+bool convertFrame(const FrameBuffer &source, FrameBuffer &destination, const ColorSpec &spec);
+
+// As above with an explicit kernel level; unsupported levels fall back to
+// scalar. Used by tests and benchmarks.
+bool convertFrame(const FrameBuffer &source, FrameBuffer &destination,
+                  const ColorSpec &spec, SimdLevel level);
+
+} // namespace scp
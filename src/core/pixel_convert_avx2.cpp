@@ -0,0 +1,135 @@
+// AVX2 + F16C conversion kernels, 8 pixels per iteration.
+
+#include "core/pixel_convert_internal.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#include <cstring>
+
+#if defined(__GNUC__)
+#define SCP_KERNEL_TARGET __attribute__((target("avx2,f16c")))
+#else
+#define SCP_KERNEL_TARGET
+#endif
+#define SCP_KERNEL_HAS_F16 1
+
+namespace scp::convert {
+
+namespace {
+
+struct V
+{
+    using vi = __m256i;
+    using vf = __m256;
+    static constexpr int N = 8;
+
+    SCP_KERNEL_TARGET static vi splat(std::int32_t value) { return _mm256_set1_epi32(value); }
+    SCP_KERNEL_TARGET static vf splatf(float value) { return _mm256_set1_ps(value); }
+
+    SCP_KERNEL_TARGET static vi loadU8(const std::uint8_t *p)
+    {
+        return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+    }
+    SCP_KERNEL_TARGET static vi loadU8Half(const std::uint8_t *p)
+    {
+        std::int32_t bytes;
+        std::memcpy(&bytes, p, sizeof(bytes));
+        return _mm256_cvtepu8_epi32(_mm_cvtsi32_si128(bytes));
+    }
+    SCP_KERNEL_TARGET static vi loadU16(const std::uint16_t *p)
+    {
+        return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+    }
+    SCP_KERNEL_TARGET static vi loadU32(const std::uint32_t *p)
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    }
+
+    SCP_KERNEL_TARGET static vi dupLow(vi v)
+    {
+        return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3));
+    }
+    SCP_KERNEL_TARGET static vi dupEven(vi v)
+    {
+        return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 0, 2, 2, 4, 4, 6, 6));
+    }
+    SCP_KERNEL_TARGET static vi dupOdd(vi v)
+    {
+        return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(1, 1, 3, 3, 5, 5, 7, 7));
+    }
+    SCP_KERNEL_TARGET static vi pairSum(vi v)
+    {
+        // hadd works within 128-bit lanes; gather the four sums to the bottom.
+        return _mm256_permutevar8x32_epi32(_mm256_hadd_epi32(v, v),
+                                           _mm256_setr_epi32(0, 1, 4, 5, 0, 1, 4, 5));
+    }
+    SCP_KERNEL_TARGET static vi interleaveLow(vi a, vi b)
+    {
+        return _mm256_permute2x128_si256(_mm256_unpacklo_epi32(a, b),
+                                         _mm256_unpackhi_epi32(a, b), 0x20);
+    }
+
+    SCP_KERNEL_TARGET static void storeU32(std::uint32_t *p, vi v)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+    }
+    SCP_KERNEL_TARGET static void storeU32Interleaved(std::uint32_t *p, vi a, vi b)
+    {
+        const __m256i lo = _mm256_unpacklo_epi32(a, b);
+        const __m256i hi = _mm256_unpackhi_epi32(a, b);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p + 8),
+                            _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    SCP_KERNEL_TARGET static void storeU8(std::uint8_t *p, vi v)
+    {
+        const __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(v),
+                                               _mm256_extracti128_si256(v, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(p), _mm_packus_epi16(words, words));
+    }
+    SCP_KERNEL_TARGET static void storeU8Half(std::uint8_t *p, vi v)
+    {
+        const __m128i low = _mm256_castsi256_si128(v);
+        const __m128i words = _mm_packus_epi32(low, low);
+        const std::int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+        std::memcpy(p, &bytes, sizeof(bytes));
+    }
+
+    SCP_KERNEL_TARGET static vi add(vi a, vi b) { return _mm256_add_epi32(a, b); }
+    SCP_KERNEL_TARGET static vi sub(vi a, vi b) { return _mm256_sub_epi32(a, b); }
+    SCP_KERNEL_TARGET static vi mul(vi a, vi b) { return _mm256_mullo_epi32(a, b); }
+    SCP_KERNEL_TARGET static vi min(vi a, vi b) { return _mm256_min_epi32(a, b); }
+    SCP_KERNEL_TARGET static vi max(vi a, vi b) { return _mm256_max_epi32(a, b); }
+    SCP_KERNEL_TARGET static vi bitAnd(vi a, vi b) { return _mm256_and_si256(a, b); }
+    SCP_KERNEL_TARGET static vi bitOr(vi a, vi b) { return _mm256_or_si256(a, b); }
+    template<int S>
+    SCP_KERNEL_TARGET static vi sra(vi v) { return _mm256_srai_epi32(v, S); }
+    template<int S>
+    SCP_KERNEL_TARGET static vi srl(vi v) { return _mm256_srli_epi32(v, S); }
+    template<int S>
+    SCP_KERNEL_TARGET static vi shl(vi v) { return _mm256_slli_epi32(v, S); }
+
+    SCP_KERNEL_TARGET static vf toFloat(vi v) { return _mm256_cvtepi32_ps(v); }
+    SCP_KERNEL_TARGET static vf fadd(vf a, vf b) { return _mm256_add_ps(a, b); }
+    SCP_KERNEL_TARGET static vf fsub(vf a, vf b) { return _mm256_sub_ps(a, b); }
+    SCP_KERNEL_TARGET static vf fmul(vf a, vf b) { return _mm256_mul_ps(a, b); }
+    SCP_KERNEL_TARGET static vi toHalf(vf v)
+    {
+        return _mm256_cvtepu16_epi32(_mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+    }
+};
+
+#include "core/pixel_convert_kernels.inc"
+
+} // namespace
+
+const KernelTable *avx2Kernels()
+{
+    return &kKernels;
+}
+
+} // namespace scp::convert
+
+#endif
@@ -0,0 +1,134 @@
+// AVX-512F conversion kernels, 16 pixels per iteration.
+
+#include "core/pixel_convert_internal.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#if defined(__GNUC__)
+#define SCP_KERNEL_TARGET __attribute__((target("avx512f,avx2,f16c")))
+#else
+#define SCP_KERNEL_TARGET
+#endif
+#define SCP_KERNEL_HAS_F16 1
+
+namespace scp::convert {
+
+namespace {
+
+struct V
+{
+    using vi = __m512i;
+    using vf = __m512;
+    static constexpr int N = 16;
+    // GCC implements the unmasked forms with _mm512_undefined_*() as the
+    // merge source, which -Wmaybe-uninitialized reports wherever they are
+    // inlined. With every lane selected the zero-masked forms compile to
+    // the same instructions.
+    static constexpr __mmask16 kAll = 0xffff;
+
+    SCP_KERNEL_TARGET static vi splat(std::int32_t value) { return _mm512_set1_epi32(value); }
+    SCP_KERNEL_TARGET static vf splatf(float value) { return _mm512_set1_ps(value); }
+
+    SCP_KERNEL_TARGET static vi loadU8(const std::uint8_t *p)
+    {
+        return _mm512_maskz_cvtepu8_epi32(
+            kAll, _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)));
+    }
+    SCP_KERNEL_TARGET static vi loadU8Half(const std::uint8_t *p)
+    {
+        return _mm512_maskz_cvtepu8_epi32(
+            kAll, _mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+    }
+    SCP_KERNEL_TARGET static vi loadU16(const std::uint16_t *p)
+    {
+        return _mm512_maskz_cvtepu16_epi32(
+            kAll, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)));
+    }
+    SCP_KERNEL_TARGET static vi loadU32(const std::uint32_t *p) { return _mm512_loadu_si512(p); }
+
+    SCP_KERNEL_TARGET static vi dupLow(vi v)
+    {
+        return _mm512_maskz_permutexvar_epi32(
+            kAll, _mm512_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7), v);
+    }
+    SCP_KERNEL_TARGET static vi dupEven(vi v)
+    {
+        return _mm512_maskz_permutexvar_epi32(
+            kAll, _mm512_setr_epi32(0, 0, 2, 2, 4, 4, 6, 6, 8, 8, 10, 10, 12, 12, 14, 14), v);
+    }
+    SCP_KERNEL_TARGET static vi dupOdd(vi v)
+    {
+        return _mm512_maskz_permutexvar_epi32(
+            kAll, _mm512_setr_epi32(1, 1, 3, 3, 5, 5, 7, 7, 9, 9, 11, 11, 13, 13, 15, 15), v);
+    }
+    SCP_KERNEL_TARGET static vi pairSum(vi v)
+    {
+        const __m512i sums = _mm512_add_epi32(v, _mm512_maskz_srli_epi64(0xff, v, 32));
+        return _mm512_maskz_permutexvar_epi32(
+            kAll, _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 0, 2, 4, 6, 8, 10, 12, 14), sums);
+    }
+    SCP_KERNEL_TARGET static vi interleaveLow(vi a, vi b)
+    {
+        return _mm512_permutex2var_epi32(
+            a, _mm512_setr_epi32(0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23), b);
+    }
+
+    SCP_KERNEL_TARGET static void storeU32(std::uint32_t *p, vi v) { _mm512_storeu_si512(p, v); }
+    SCP_KERNEL_TARGET static void storeU32Interleaved(std::uint32_t *p, vi a, vi b)
+    {
+        _mm512_storeu_si512(p, interleaveLow(a, b));
+        _mm512_storeu_si512(p + 16, _mm512_permutex2var_epi32(
+                                        a,
+                                        _mm512_setr_epi32(8, 24, 9, 25, 10, 26, 11, 27, 12, 28,
+                                                          13, 29, 14, 30, 15, 31),
+                                        b));
+    }
+    // Inputs are already clamped to 0..255, so truncation is exact.
+    SCP_KERNEL_TARGET static void storeU8(std::uint8_t *p, vi v)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm512_maskz_cvtepi32_epi8(kAll, v));
+    }
+    SCP_KERNEL_TARGET static void storeU8Half(std::uint8_t *p, vi v)
+    {
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(p), _mm512_maskz_cvtepi32_epi8(kAll, v));
+    }
+
+    SCP_KERNEL_TARGET static vi add(vi a, vi b) { return _mm512_add_epi32(a, b); }
+    SCP_KERNEL_TARGET static vi sub(vi a, vi b) { return _mm512_sub_epi32(a, b); }
+    SCP_KERNEL_TARGET static vi mul(vi a, vi b) { return _mm512_mullo_epi32(a, b); }
+    SCP_KERNEL_TARGET static vi min(vi a, vi b) { return _mm512_maskz_min_epi32(kAll, a, b); }
+    SCP_KERNEL_TARGET static vi max(vi a, vi b) { return _mm512_maskz_max_epi32(kAll, a, b); }
+    SCP_KERNEL_TARGET static vi bitAnd(vi a, vi b) { return _mm512_and_si512(a, b); }
+    SCP_KERNEL_TARGET static vi bitOr(vi a, vi b) { return _mm512_or_si512(a, b); }
+    template<int S>
+    SCP_KERNEL_TARGET static vi sra(vi v) { return _mm512_maskz_srai_epi32(kAll, v, S); }
+    template<int S>
+    SCP_KERNEL_TARGET static vi srl(vi v) { return _mm512_maskz_srli_epi32(kAll, v, S); }
+    template<int S>
+    SCP_KERNEL_TARGET static vi shl(vi v) { return _mm512_maskz_slli_epi32(kAll, v, S); }
+
+    SCP_KERNEL_TARGET static vf toFloat(vi v) { return _mm512_maskz_cvtepi32_ps(kAll, v); }
+    SCP_KERNEL_TARGET static vf fadd(vf a, vf b) { return _mm512_add_ps(a, b); }
+    SCP_KERNEL_TARGET static vf fsub(vf a, vf b) { return _mm512_sub_ps(a, b); }
+    SCP_KERNEL_TARGET static vf fmul(vf a, vf b) { return _mm512_mul_ps(a, b); }
+    SCP_KERNEL_TARGET static vi toHalf(vf v)
+    {
+        return _mm512_maskz_cvtepu16_epi32(
+            kAll, _mm512_maskz_cvtps_ph(kAll, v, _MM_FROUND_TO_NEAREST_INT));
+    }
+};
+
+#include "core/pixel_convert_kernels.inc"
+
+} // namespace
+
+const KernelTable *avx512Kernels()
+{
+    return &kKernels;
+}
+
+} // namespace scp::convert
+
+#endif
@@ -0,0 +1,102 @@
+#pragma once
+
+// Shared between the conversion driver and the per-ISA kernel files.
+
+#include "core/cpu_features.h"
+#include "core/pixel_convert.h"
+
+#include <cstdint>
+
+namespace scp::convert {
+
+struct Coefficients
+{
+    // YUV -> RGBA8, Q16 fixed point, scaled for the input bit depth.
+    std::int32_t yOffset = 0;
+    std::int32_t chromaOffset = 0;
+    std::int32_t yScale = 0;
+    std::int32_t crR = 0;
+    std::int32_t cbG = 0;
+    std::int32_t crG = 0;
+    std::int32_t cbB = 0;
+
+    // YUV -> RGBA16F, producing normalized [0, 1] for nominal black..white.
+    float fyScale = 0;
+    float fcrR = 0;
+    float fcbG = 0;
+    float fcrG = 0;
+    float fcbB = 0;
+
+    // RGB -> YUV. Luma is Q16 per pixel; chroma is applied to 2x2 sums,
+    // which makes it effectively Q18.
+    std::int32_t yR = 0;
+    std::int32_t yG = 0;
+    std::int32_t yB = 0;
+    std::int32_t uR = 0;
+    std::int32_t uG = 0;
+    std::int32_t uB = 0;
+    std::int32_t vR = 0;
+    std::int32_t vG = 0;
+    std::int32_t vB = 0;
+
+    // Float RGB -> YUV for 16-bit float sources, in output code values.
+    float fyR = 0;
+    float fyG = 0;
+    float fyB = 0;
+    float fuR = 0;
+    float fuG = 0;
+    float fuB = 0;
+    float fvR = 0;
+    float fvG = 0;
+    float fvB = 0;
+    std::int32_t maxCode = 255;
+};
+
+Coefficients makeCoefficients(const ColorSpec &spec, int yuvBits);
+
+// One output row of a YUV -> RGBA conversion. For NV12/P010 u points at the
+// interleaved UV row and v is unused.
+struct ToRgbaRow
+{
+    const std::uint8_t *y;
+    const std::uint8_t *u;
+    const std::uint8_t *v;
+    std::uint8_t *out;
+    int width;
+};
+
+// Two input rows of an RGBA -> YUV conversion and the luma rows and
+// chroma row they produce. For NV12/P010 u is the interleaved UV row.
+struct FromRgbaRows
+{
+    const std::uint8_t *rgba[2];
+    std::uint8_t *y[2];
+    std::uint8_t *u;
+    std::uint8_t *v;
+    int width;
+};
+
+// Vector kernels convert a multiple of their lane count and return how many
+// pixels they covered; the scalar kernel finishes the row from there.
+using ToRgbaKernel = int (*)(const ToRgbaRow &row, const Coefficients &c);
+using FromRgbaKernel = int (*)(const FromRgbaRows &rows, const Coefficients &c);
+
+struct KernelTable
+{
+    ToRgbaKernel yuv420pToRgba8 = nullptr;
+    ToRgbaKernel nv12ToRgba8 = nullptr;
+    ToRgbaKernel p010ToRgba8 = nullptr;
+    ToRgbaKernel yuv420pToRgba16f = nullptr;
+    ToRgbaKernel nv12ToRgba16f = nullptr;
+    ToRgbaKernel p010ToRgba16f = nullptr;
+    FromRgbaKernel rgba8ToYuv420p = nullptr;
+    FromRgbaKernel rgba8ToNv12 = nullptr;
+};
+
+// Null when the build has no kernels for that level.
+const KernelTable *sse41Kernels();
+const KernelTable *avx2Kernels();
+const KernelTable *avx512Kernels();
+const KernelTable *neonKernels();
+
+} // namespace scp::convert
@@ -0,0 +1,108 @@
+// AArch64 NEON conversion kernels, 4 pixels per iteration.
+
+#include "core/pixel_convert_internal.h"
+
+#if defined(__aarch64__)
+
+#include <arm_neon.h>
+
+#include <cstring>
+
+#define SCP_KERNEL_TARGET
+#define SCP_KERNEL_HAS_F16 1
+
+namespace scp::convert {
+
+namespace {
+
+struct V
+{
+    using vi = int32x4_t;
+    using vf = float32x4_t;
+    static constexpr int N = 4;
+
+    static vi splat(std::int32_t value) { return vdupq_n_s32(value); }
+    static vf splatf(float value) { return vdupq_n_f32(value); }
+
+    static vi widen(uint8x8_t bytes)
+    {
+        return vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(vmovl_u8(bytes))));
+    }
+    static vi loadU8(const std::uint8_t *p)
+    {
+        std::uint32_t bytes;
+        std::memcpy(&bytes, p, sizeof(bytes));
+        return widen(vcreate_u8(bytes));
+    }
+    static vi loadU8Half(const std::uint8_t *p)
+    {
+        std::uint16_t bytes;
+        std::memcpy(&bytes, p, sizeof(bytes));
+        return widen(vcreate_u8(bytes));
+    }
+    static vi loadU16(const std::uint16_t *p) { return vreinterpretq_s32_u32(vmovl_u16(vld1_u16(p))); }
+    static vi loadU32(const std::uint32_t *p) { return vreinterpretq_s32_u32(vld1q_u32(p)); }
+
+    static vi dupLow(vi v) { return vzip1q_s32(v, v); }
+    static vi dupEven(vi v) { return vtrn1q_s32(v, v); }
+    static vi dupOdd(vi v) { return vtrn2q_s32(v, v); }
+    static vi pairSum(vi v) { return vpaddq_s32(v, v); }
+    static vi interleaveLow(vi a, vi b) { return vzip1q_s32(a, b); }
+
+    static void storeU32(std::uint32_t *p, vi v) { vst1q_u32(p, vreinterpretq_u32_s32(v)); }
+    static void storeU32Interleaved(std::uint32_t *p, vi a, vi b)
+    {
+        vst2q_u32(p, uint32x4x2_t{{vreinterpretq_u32_s32(a), vreinterpretq_u32_s32(b)}});
+    }
+    static uint8x8_t narrow(vi v)
+    {
+        const uint16x4_t words = vqmovun_s32(v);
+        return vqmovn_u16(vcombine_u16(words, words));
+    }
+    static void storeU8(std::uint8_t *p, vi v)
+    {
+        const std::uint32_t bytes = vget_lane_u32(vreinterpret_u32_u8(narrow(v)), 0);
+        std::memcpy(p, &bytes, sizeof(bytes));
+    }
+    static void storeU8Half(std::uint8_t *p, vi v)
+    {
+        const std::uint16_t bytes = vget_lane_u16(vreinterpret_u16_u8(narrow(v)), 0);
+        std::memcpy(p, &bytes, sizeof(bytes));
+    }
+
+    static vi add(vi a, vi b) { return vaddq_s32(a, b); }
+    static vi sub(vi a, vi b) { return vsubq_s32(a, b); }
+    static vi mul(vi a, vi b) { return vmulq_s32(a, b); }
+    static vi min(vi a, vi b) { return vminq_s32(a, b); }
+    static vi max(vi a, vi b) { return vmaxq_s32(a, b); }
+    static vi bitAnd(vi a, vi b) { return vandq_s32(a, b); }
+    static vi bitOr(vi a, vi b) { return vorrq_s32(a, b); }
+    template<int S>
+    static vi sra(vi v) { return vshrq_n_s32(v, S); }
+    template<int S>
+    static vi srl(vi v) { return vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(v), S)); }
+    template<int S>
+    static vi shl(vi v) { return vshlq_n_s32(v, S); }
+
+    static vf toFloat(vi v) { return vcvtq_f32_s32(v); }
+    static vf fadd(vf a, vf b) { return vaddq_f32(a, b); }
+    static vf fsub(vf a, vf b) { return vsubq_f32(a, b); }
+    static vf fmul(vf a, vf b) { return vmulq_f32(a, b); }
+    static vi toHalf(vf v)
+    {
+        return vreinterpretq_s32_u32(vmovl_u16(vreinterpret_u16_f16(vcvt_f16_f32(v))));
+    }
+};
+
+#include "core/pixel_convert_kernels.inc"
+
+} // namespace
+
+const KernelTable *neonKernels()
+{
+    return &kKernels;
+}
+
+} // namespace scp::convert
+
+#endif
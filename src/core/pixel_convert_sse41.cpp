@@ -0,0 +1,103 @@
+// SSE4.1 conversion kernels, 4 pixels per iteration. SSE4.1 has no half
+// float conversion, so RGBA16F outputs stay on the scalar path.
+
+#include "core/pixel_convert_internal.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#include <cstring>
+
+#if defined(__GNUC__)
+#define SCP_KERNEL_TARGET __attribute__((target("sse4.1")))
+#else
+#define SCP_KERNEL_TARGET
+#endif
+#define SCP_KERNEL_HAS_F16 0
+
+namespace scp::convert {
+
+namespace {
+
+struct V
+{
+    using vi = __m128i;
+    using vf = __m128;
+    static constexpr int N = 4;
+
+    SCP_KERNEL_TARGET static vi splat(std::int32_t value) { return _mm_set1_epi32(value); }
+    SCP_KERNEL_TARGET static vf splatf(float value) { return _mm_set1_ps(value); }
+
+    SCP_KERNEL_TARGET static vi loadU8(const std::uint8_t *p)
+    {
+        std::int32_t bytes;
+        std::memcpy(&bytes, p, sizeof(bytes));
+        return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes));
+    }
+    SCP_KERNEL_TARGET static vi loadU8Half(const std::uint8_t *p)
+    {
+        std::uint16_t bytes;
+        std::memcpy(&bytes, p, sizeof(bytes));
+        return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes));
+    }
+    SCP_KERNEL_TARGET static vi loadU16(const std::uint16_t *p)
+    {
+        return _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+    }
+    SCP_KERNEL_TARGET static vi loadU32(const std::uint32_t *p)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    }
+
+    SCP_KERNEL_TARGET static vi dupLow(vi v) { return _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 1, 0, 0)); }
+    SCP_KERNEL_TARGET static vi dupEven(vi v) { return _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 2, 0, 0)); }
+    SCP_KERNEL_TARGET static vi dupOdd(vi v) { return _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 1, 1)); }
+    SCP_KERNEL_TARGET static vi pairSum(vi v) { return _mm_hadd_epi32(v, v); }
+    SCP_KERNEL_TARGET static vi interleaveLow(vi a, vi b) { return _mm_unpacklo_epi32(a, b); }
+
+    SCP_KERNEL_TARGET static void storeU32(std::uint32_t *p, vi v)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+    }
+    SCP_KERNEL_TARGET static void storeU8(std::uint8_t *p, vi v)
+    {
+        const __m128i words = _mm_packus_epi32(v, v);
+        const std::int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+        std::memcpy(p, &bytes, sizeof(bytes));
+    }
+    SCP_KERNEL_TARGET static void storeU8Half(std::uint8_t *p, vi v)
+    {
+        const __m128i words = _mm_packus_epi32(v, v);
+        const auto bytes = static_cast<std::uint16_t>(
+            _mm_cvtsi128_si32(_mm_packus_epi16(words, words)));
+        std::memcpy(p, &bytes, sizeof(bytes));
+    }
+
+    SCP_KERNEL_TARGET static vi add(vi a, vi b) { return _mm_add_epi32(a, b); }
+    SCP_KERNEL_TARGET static vi sub(vi a, vi b) { return _mm_sub_epi32(a, b); }
+    SCP_KERNEL_TARGET static vi mul(vi a, vi b) { return _mm_mullo_epi32(a, b); }
+    SCP_KERNEL_TARGET static vi min(vi a, vi b) { return _mm_min_epi32(a, b); }
+    SCP_KERNEL_TARGET static vi max(vi a, vi b) { return _mm_max_epi32(a, b); }
+    SCP_KERNEL_TARGET static vi bitAnd(vi a, vi b) { return _mm_and_si128(a, b); }
+    SCP_KERNEL_TARGET static vi bitOr(vi a, vi b) { return _mm_or_si128(a, b); }
+    template<int S>
+    SCP_KERNEL_TARGET static vi sra(vi v) { return _mm_srai_epi32(v, S); }
+    template<int S>
+    SCP_KERNEL_TARGET static vi srl(vi v) { return _mm_srli_epi32(v, S); }
+    template<int S>
+    SCP_KERNEL_TARGET static vi shl(vi v) { return _mm_slli_epi32(v, S); }
+};
+
+#include "core/pixel_convert_kernels.inc"
+
+} // namespace
+
+const KernelTable *sse41Kernels()
+{
+    return &kKernels;
+}
+
+} // namespace scp::convert
+
+#endif
@@ -0,0 +1,87 @@
+#pragma once
+
+// Pixel formats understood by the frame management system and the geometry
+// of their planes. Everything here is constexpr so that pool size classes and
+// conversion kernels can compute layouts without touching FFmpeg.
+
+#include <cstdint>
+
+namespace scp {
+
+enum class PixelFormat : std::uint8_t {
+    None,
+    YUV420P, // 8-bit planar Y, U, V with 2x2 chroma subsampling
+    NV12,    // 8-bit planar Y + interleaved UV, 2x2 subsampling
+    P010,    // 10-bit in the high bits of 16-bit words, NV12 layout
+    RGBA8,   // 8-bit packed RGBA
+    RGBA16F, // half-float packed RGBA
+};
+
+inline constexpr int kMaxPlanes = 4;
+
+struct PlaneGeometry
+{
+    int rowBytes = 0; // bytes of pixel data per row, excluding padding
+    int rows = 0;
+};
+
+constexpr int planeCount(PixelFormat format)
+{
+    switch (format) {
+    case PixelFormat::YUV420P:
+        return 3;
+    case PixelFormat::NV12:
+    case PixelFormat::P010:
+        return 2;
+    case PixelFormat::RGBA8:
+    case PixelFormat::RGBA16F:
+        return 1;
+    case PixelFormat::None:
+        break;
+    }
+    return 0;
+}
+
+constexpr PlaneGeometry planeGeometry(PixelFormat format, int width, int height, int plane)
+{
+    const int chromaWidth = (width + 1) / 2;
+    const int chromaHeight = (height + 1) / 2;
+    switch (format) {
+    case PixelFormat::YUV420P:
+        return plane == 0 ? PlaneGeometry{width, height} : PlaneGeometry{chromaWidth, chromaHeight};
+    case PixelFormat::NV12:
+        return plane == 0 ? PlaneGeometry{width, height}
+                          : PlaneGeometry{chromaWidth * 2, chromaHeight};
+    case PixelFormat::P010:
+        return plane == 0 ? PlaneGeometry{width * 2, height}
+                          : PlaneGeometry{chromaWidth * 4, chromaHeight};
+    case PixelFormat::RGBA8:
+        return {width * 4, height};
+    case PixelFormat::RGBA16F:
+        return {width * 8, height};
+    case PixelFormat::None:
+        break;
+    }
+    return {};
+}
+
+constexpr const char *pixelFormatName(PixelFormat format)
+{
+    switch (format) {
+    case PixelFormat::YUV420P:
+        return "yuv420p";
+    case PixelFormat::NV12:
+        return "nv12";
+    case PixelFormat::P010:
+        return "p010";
+    case PixelFormat::RGBA8:
+        return "rgba8";
+    case PixelFormat::RGBA16F:
+        return "rgba16f";
+    case PixelFormat::None:
+        break;
+    }
+    return "none";
+}
+
+} // namespace scp
@@ -0,0 +1,170 @@
+#include "core/thread_pool.h"
+
+#include <algorithm>
+#include <exception>
+
+namespace scp {
+
+namespace {
+
+// Identifies the pool and worker the current thread belongs to.
+thread_local const ThreadPool *tlsPool = nullptr;
+thread_local unsigned tlsWorker = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned threads)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < threads; ++i)
+        m_workers.push_back(std::make_unique<Worker>());
+    for (unsigned i = 0; i < threads; ++i)
+        m_threads.emplace_back([this, i] { run(i); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock(m_sleepMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto &thread : m_threads)
+        thread.join();
+}
+
+ThreadPool &ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    const unsigned target = tlsPool == this
+                                ? tlsWorker
+                                : m_nextWorker.fetch_add(1, std::memory_order_relaxed) % size();
+    {
+        std::lock_guard lock(m_workers[target]->mutex);
+        m_workers[target]->tasks.push_back(std::move(task));
+    }
+    m_queued.fetch_add(1, std::memory_order_release);
+    {
+        // Pairs with the predicate check in run() so a wakeup cannot be lost.
+        std::lock_guard lock(m_sleepMutex);
+    }
+    m_wake.notify_one();
+}
+
+bool ThreadPool::tryTake(unsigned self, std::function<void()> &task)
+{
+    if (m_queued.load(std::memory_order_acquire) == 0)
+        return false;
+    const unsigned count = size();
+    for (unsigned i = 0; i < count; ++i) {
+        const unsigned victim = (self + i) % count;
+        Worker &worker = *m_workers[victim];
+        std::lock_guard lock(worker.mutex);
+        if (worker.tasks.empty())
+            continue;
+        // Own work LIFO, stolen work FIFO.
+        if (i == 0 && tlsPool == this) {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+        } else {
+            task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+        }
+        m_queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+bool ThreadPool::runPendingTask()
+{
+    std::function<void()> task;
+    const unsigned self = tlsPool == this ? tlsWorker : 0;
+    if (!tryTake(self, task))
+        return false;
+    execute(task);
+    return true;
+}
+
+void ThreadPool::execute(std::function<void()> &task) noexcept
+{
+    try {
+        task();
+    } catch (...) {
+        // Nobody to hand it to; see submit().
+    }
+}
+
+void ThreadPool::run(unsigned index)
+{
+    tlsPool = this;
+    tlsWorker = index;
+    for (;;) {
+        std::function<void()> task;
+        if (tryTake(index, task)) {
+            execute(task);
+            continue;
+        }
+        std::unique_lock lock(m_sleepMutex);
+        m_wake.wait(lock, [this] {
+            return m_stopping || m_queued.load(std::memory_order_acquire) > 0;
+        });
+        if (m_stopping && m_queued.load(std::memory_order_acquire) == 0)
+            return;
+    }
+}
+
+void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)> &body)
+{
+    if (count == 0)
+        return;
+    // Helpers may be dequeued after we return, so they only touch shared
+    // state; by then every index is taken and body is no longer called.
+    struct State
+    {
+        std::function<void(std::size_t)> body;
+        std::atomic<std::size_t> next{0};
+        std::atomic<std::size_t> done{0};
+        std::atomic<bool> failed{false};
+        std::mutex errorMutex;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<State>();
+    state->body = body;
+    auto drain = [](State &s, std::size_t total) {
+        for (std::size_t i; (i = s.next.fetch_add(1, std::memory_order_relaxed)) < total;) {
+            // After a failure the remaining indices are only counted off, so
+            // done still reaches total.
+            if (!s.failed.load(std::memory_order_relaxed)) {
+                try {
+                    s.body(i);
+                } catch (...) {
+                    std::lock_guard lock(s.errorMutex);
+                    if (!s.error)
+                        s.error = std::current_exception();
+                    s.failed.store(true, std::memory_order_relaxed);
+                }
+            }
+            s.done.fetch_add(1, std::memory_order_acq_rel);
+        }
+    };
+
+    const std::size_t helpers = std::min<std::size_t>(count - 1, size());
+    for (std::size_t i = 0; i < helpers; ++i)
+        submit([state, count, drain] { drain(*state, count); });
+    drain(*state, count);
+    while (state->done.load(std::memory_order_acquire) < count) {
+        if (!runPendingTask())
+            std::this_thread::yield();
+    }
+    if (state->error)
+        std::rethrow_exception(state->error);
+}
+
+} // namespace scp
@@ -0,0 +1,70 @@
+#pragma once
+
+// Work-stealing thread pool shared by the engine's CPU-bound stages.
+//
+// Every worker owns a deque: it pops its own work LIFO (cache-warm) and
+// steals FIFO from the others when it runs dry. Tasks submitted from a worker
+// go to that worker's deque; tasks from other threads are spread round-robin.
+// parallelFor() lets the calling thread take part, so it is safe to call from
+// inside a task.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace scp {
+
+class ThreadPool
+{
+public:
+    // 0 means one worker per hardware thread.
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(m_workers.size()); }
+
+    // Queues task. An exception escaping it is caught and dropped, so it
+    // cannot take a worker down; tasks that can fail report it themselves.
+    void submit(std::function<void()> task);
+
+    // Runs body(i) for every i in [0, count) and returns when all are done.
+    // If body throws, the indices not yet started are skipped and the first
+    // exception is rethrown once every running body(i) has returned.
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)> &body);
+
+    // Runs one queued task on the calling thread, if there is one.
+    bool runPendingTask();
+
+    // Process-wide pool sized to the machine.
+    static ThreadPool &shared();
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void run(unsigned index);
+    static void execute(std::function<void()> &task) noexcept;
+    bool tryTake(unsigned self, std::function<void()> &task);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    std::atomic<std::size_t> m_queued{0};
+    std::atomic<unsigned> m_nextWorker{0};
+    bool m_stopping = false;
+};
+
+} // namespace scp
@@ -0,0 +1,183 @@
+#include "jobs/av_segment_encoder.h"
+
+#include "core/frame_copy.h"
+#include "media/av_frame.h"
+#include "media/ffmpeg_ptr.h"
+#include "media/media_error.h"
+
+#include <string>
+#include <utility>
+
+namespace scp {
+
+namespace {
+
+// Owns a muxer context opened for writing; avformat_close_input() is only
+// for inputs.
+struct OutputFile
+{
+    AVFormatContext *context = nullptr;
+    ~OutputFile()
+    {
+        if (!context)
+            return;
+        if (context->pb && !(context->oformat->flags & AVFMT_NOFILE))
+            avio_closep(&context->pb);
+        avformat_free_context(context);
+    }
+};
+
+AVColorSpace toAVColorSpace(ColorMatrix matrix)
+{
+    switch (matrix) {
+    case ColorMatrix::BT601:
+        return AVCOL_SPC_SMPTE170M;
+    case ColorMatrix::BT2020:
+        return AVCOL_SPC_BT2020_NCL;
+    case ColorMatrix::BT709:
+        break;
+    }
+    return AVCOL_SPC_BT709;
+}
+
+} // namespace
+
+AVSegmentEncoder::AVSegmentEncoder(VideoEncoderSettings settings, FrameSource source)
+    : m_settings(std::move(settings))
+    , m_source(std::move(source))
+{}
+
+void AVSegmentEncoder::encode(const ExportJob &job, const ExportSegment &segment,
+                              std::stop_token stop,
+                              const std::function<void(std::int64_t frames)> &progress)
+{
+    const VideoEncoderSettings &settings = m_settings;
+    const AVCodec *codec = avcodec_find_encoder_by_name(settings.codec.c_str());
+    if (!codec)
+        throw MediaError("encoder " + settings.codec + " not available");
+    const FrameFormat format{settings.width, settings.height, settings.pixelFormat};
+    const AVPixelFormat pixelFormat = toAVPixelFormat(settings.pixelFormat);
+    if (!format.isValid() || pixelFormat == AV_PIX_FMT_NONE)
+        throw MediaError("unsupported encoder frame format");
+
+    OutputFile output;
+    int error = avformat_alloc_output_context2(&output.context, nullptr, nullptr,
+                                               segment.path.c_str());
+    if (error < 0)
+        throw MediaError("cannot create " + segment.path, error);
+
+    AVCodecContextPtr encoder(avcodec_alloc_context3(codec));
+    if (!encoder)
+        throw MediaError("cannot allocate " + settings.codec + " encoder");
+    encoder->width = settings.width;
+    encoder->height = settings.height;
+    encoder->pix_fmt = pixelFormat;
+    encoder->time_base = av_inv_q(settings.frameRate);
+    encoder->framerate = settings.frameRate;
+    encoder->color_range = settings.color.range == ColorRange::Full ? AVCOL_RANGE_JPEG
+                                                                    : AVCOL_RANGE_MPEG;
+    encoder->colorspace = toAVColorSpace(settings.color.matrix);
+    encoder->thread_count = settings.threads;
+    if (settings.bitRate > 0)
+        encoder->bit_rate = settings.bitRate;
+    // Segment boundaries are GOP boundaries of the whole export. Closed GOPs
+    // keep B-frames from referencing the previous segment.
+    encoder->gop_size = job.segments.gopLength;
+    encoder->flags |= AV_CODEC_FLAG_CLOSED_GOP;
+    if (output.context->oformat->flags & AVFMT_GLOBALHEADER)
+        encoder->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+    AVDictionary *options = nullptr;
+    for (const auto &[key, value] : settings.codecOptions)
+        av_dict_set(&options, key.c_str(), value.c_str(), 0);
+    // Makes the forced keyframe below an IDR frame in the encoders that
+    // distinguish the two (x264, x265, NVENC...); others leave it unused.
+    av_dict_set(&options, "forced-idr", "1", 0);
+    error = avcodec_open2(encoder.get(), codec, &options);
+    av_dict_free(&options);
+    if (error < 0)
+        throw MediaError("cannot open " + settings.codec + " encoder", error);
+
+    AVStream *stream = avformat_new_stream(output.context, nullptr);
+    if (!stream)
+        throw MediaError("cannot add stream to " + segment.path);
+    stream->time_base = encoder->time_base;
+    error = avcodec_parameters_from_context(stream->codecpar, encoder.get());
+    if (error < 0)
+        throw MediaError("cannot copy encoder parameters", error);
+
+    if (!(output.context->oformat->flags & AVFMT_NOFILE)) {
+        error = avio_open(&output.context->pb, segment.path.c_str(), AVIO_FLAG_WRITE);
+        if (error < 0)
+            throw MediaError("cannot open " + segment.path + " for writing", error);
+    }
+    error = avformat_write_header(output.context, nullptr);
+    if (error < 0)
+        throw MediaError("cannot write header of " + segment.path, error);
+
+    AVPacketPtr packet(av_packet_alloc());
+    bool firstPacket = true;
+    auto writePackets = [&] {
+        while ((error = avcodec_receive_packet(encoder.get(), packet.get())) >= 0) {
+            if (firstPacket && !(packet->flags & AV_PKT_FLAG_KEY))
+                throw MediaError(settings.codec + " did not start " + segment.path
+                                 + " with a keyframe");
+            firstPacket = false;
+            av_packet_rescale_ts(packet.get(), encoder->time_base, stream->time_base);
+            packet->stream_index = stream->index;
+            error = av_interleaved_write_frame(output.context, packet.get());
+            if (error < 0)
+                throw MediaError("cannot write " + segment.path, error);
+        }
+        if (error != AVERROR(EAGAIN) && error != AVERROR_EOF)
+            throw MediaError("cannot encode " + segment.path, error);
+    };
+
+    for (std::int64_t n = segment.startFrame; n < segment.endFrame; ++n) {
+        if (stop.stop_requested())
+            return;
+        const FrameRef rendered = m_source(n);
+        if (!rendered)
+            throw MediaError("frame " + std::to_string(n) + " did not render");
+
+        AVFramePtr frame(av_frame_alloc());
+        if (!frame)
+            throw MediaError("cannot allocate frame");
+        frame->width = settings.width;
+        frame->height = settings.height;
+        frame->format = pixelFormat;
+        error = av_frame_get_buffer(frame.get(), 0);
+        if (error < 0)
+            throw MediaError("cannot allocate frame", error);
+        // A view of the AVFrame's planes; never referenced, so no owner.
+        FrameBuffer view(nullptr, format);
+        for (int i = 0; i < view.planeCount(); ++i)
+            view.setPlane(i, frame->data[i], frame->linesize[i]);
+        view.setColorSpec(settings.color);
+        if (rendered->format() == format)
+            copyFrame(*rendered, view);
+        else if (!convertFrame(*rendered, view))
+            throw MediaError("cannot convert frame " + std::to_string(n) + " for the encoder");
+
+        frame->pts = n - segment.startFrame;
+        frame->color_range = encoder->color_range;
+        frame->colorspace = encoder->colorspace;
+        if (n == segment.startFrame)
+            frame->pict_type = AV_PICTURE_TYPE_I;
+        error = avcodec_send_frame(encoder.get(), frame.get());
+        if (error < 0)
+            throw MediaError("cannot encode " + segment.path, error);
+        writePackets();
+        progress(1);
+    }
+    error = avcodec_send_frame(encoder.get(), nullptr);
+    if (error < 0)
+        throw MediaError("cannot flush " + settings.codec + " encoder", error);
+    writePackets();
+
+    error = av_write_trailer(output.context);
+    if (error < 0)
+        throw MediaError("cannot finish " + segment.path, error);
+}
+
+} // namespace scp
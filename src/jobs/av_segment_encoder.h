@@ -0,0 +1,60 @@
+#pragma once
+
+// libavcodec implementation of SegmentEncoder.
+//
+// Each segment gets its own encoder instance and output file. The encoder
+// runs with closed GOPs of the job's GOP length, and the first frame of every
+// segment is forced to an IDR frame, which is what lets concatSegments() join
+// the parts by stream copy. A segment whose first packet is not a keyframe
+// fails instead of producing a file that would not decode after the join.
+
+#include "core/pixel_convert.h"
+#include "jobs/render_queue.h"
+
+extern "C" {
+#include <libavutil/rational.h>
+}
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+namespace scp {
+
+struct VideoEncoderSettings
+{
+    std::string codec = "libx264"; // encoder name, as for avcodec_find_encoder_by_name()
+    int width = 1920;
+    int height = 1080;
+    AVRational frameRate{30, 1};
+    // What the encoder is fed. Rendered frames in other formats are
+    // converted with color, which is also written to the stream.
+    PixelFormat pixelFormat = PixelFormat::YUV420P;
+    ColorSpec color;
+    std::int64_t bitRate = 0; // 0 leaves rate control to the codec options
+    // Private options of the codec, e.g. {"crf", "18"}, {"preset", "slow"}.
+    std::map<std::string, std::string> codecOptions;
+    // Codec threads per segment; segments already encode in parallel.
+    int threads = 1;
+};
+
+class AVSegmentEncoder final : public SegmentEncoder
+{
+public:
+    // Renders timeline frame n. Called from several segment workers at once;
+    // throws on failure.
+    using FrameSource = std::function<FrameRef(std::int64_t frame)>;
+
+    AVSegmentEncoder(VideoEncoderSettings settings, FrameSource source);
+
+    // Throws MediaError, and whatever the frame source throws.
+    void encode(const ExportJob &job, const ExportSegment &segment, std::stop_token stop,
+                const std::function<void(std::int64_t frames)> &progress) override;
+
+private:
+    const VideoEncoderSettings m_settings;
+    const FrameSource m_source;
+};
+
+} // namespace scp
@@ -0,0 +1,155 @@
+#include "jobs/export_segments.h"
+
+#include "media/ffmpeg_ptr.h"
+#include "media/media_error.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <thread>
+
+namespace scp {
+
+std::vector<ExportSegment> planSegments(std::int64_t startFrame, std::int64_t endFrame,
+                                        const SegmentPlanOptions &options,
+                                        const std::string &outputPath)
+{
+    std::vector<ExportSegment> segments;
+    if (endFrame <= startFrame)
+        return segments;
+
+    const std::int64_t total = endFrame - startFrame;
+    const std::int64_t gop = std::max(1, options.gopLength);
+    const std::int64_t maxSegments = options.maxSegments > 0
+                                         ? options.maxSegments
+                                         : std::max(1u, std::thread::hardware_concurrency());
+    const std::int64_t bySize = std::max<std::int64_t>(1, total / std::max<std::int64_t>(
+                                                                     1, options.minSegmentFrames));
+    const std::int64_t count = std::clamp<std::int64_t>(bySize, 1, maxSegments);
+    // Round the segment length up to whole GOPs.
+    const std::int64_t length = ((total + count - 1) / count + gop - 1) / gop * gop;
+
+    const std::filesystem::path output(outputPath);
+    for (std::int64_t start = startFrame; start < endFrame; start += length) {
+        ExportSegment segment;
+        segment.index = static_cast<int>(segments.size());
+        segment.startFrame = start;
+        segment.endFrame = std::min(endFrame, start + length);
+        char suffix[32];
+        std::snprintf(suffix, sizeof(suffix), ".seg%03d", segment.index);
+        std::filesystem::path part = output;
+        part.replace_filename(output.stem().string() + suffix + output.extension().string());
+        segment.path = part.string();
+        segments.push_back(std::move(segment));
+    }
+    return segments;
+}
+
+namespace {
+
+struct OutputContext
+{
+    AVFormatContext *context = nullptr;
+    ~OutputContext()
+    {
+        if (!context)
+            return;
+        if (context->pb && !(context->oformat->flags & AVFMT_NOFILE))
+            avio_closep(&context->pb);
+        avformat_free_context(context);
+    }
+};
+
+AVFormatContextPtr openPart(const std::string &path)
+{
+    AVFormatContext *context = nullptr;
+    int error = avformat_open_input(&context, path.c_str(), nullptr, nullptr);
+    if (error < 0)
+        throw MediaError("cannot open segment " + path, error);
+    AVFormatContextPtr owned(context);
+    error = avformat_find_stream_info(context, nullptr);
+    if (error < 0)
+        throw MediaError("cannot read segment " + path, error);
+    return owned;
+}
+
+} // namespace
+
+void concatSegments(const std::vector<std::string> &parts, const std::string &outputPath)
+{
+    if (parts.empty())
+        throw MediaError("no segments to join into " + outputPath);
+
+    OutputContext output;
+    int error = avformat_alloc_output_context2(&output.context, nullptr, nullptr,
+                                               outputPath.c_str());
+    if (error < 0)
+        throw MediaError("cannot create " + outputPath, error);
+
+    AVFormatContextPtr first = openPart(parts.front());
+    const unsigned streamCount = first->nb_streams;
+    for (unsigned i = 0; i < streamCount; ++i) {
+        AVStream *stream = avformat_new_stream(output.context, nullptr);
+        if (!stream)
+            throw MediaError("cannot add stream to " + outputPath);
+        error = avcodec_parameters_copy(stream->codecpar, first->streams[i]->codecpar);
+        if (error < 0)
+            throw MediaError("cannot copy stream parameters", error);
+        stream->codecpar->codec_tag = 0;
+        stream->time_base = first->streams[i]->time_base;
+    }
+    first.reset();
+
+    if (!(output.context->oformat->flags & AVFMT_NOFILE)) {
+        error = avio_open(&output.context->pb, outputPath.c_str(), AVIO_FLAG_WRITE);
+        if (error < 0)
+            throw MediaError("cannot open " + outputPath + " for writing", error);
+    }
+    error = avformat_write_header(output.context, nullptr);
+    if (error < 0)
+        throw MediaError("cannot write header of " + outputPath, error);
+
+    // Per output stream: offset applied to the current part and the end of
+    // the data written so far, both in the output stream's time base.
+    std::vector<std::int64_t> offset(streamCount, 0);
+    std::vector<std::int64_t> end(streamCount, 0);
+    AVPacketPtr packet(av_packet_alloc());
+
+    for (const std::string &path : parts) {
+        AVFormatContextPtr input = openPart(path);
+        if (input->nb_streams != streamCount)
+            throw MediaError("segment " + path + " has a different stream layout");
+        for (unsigned i = 0; i < streamCount; ++i)
+            offset[i] = end[i];
+
+        // Parts may not start at zero; anchor each stream on its first dts.
+        std::vector<std::int64_t> base(streamCount, AV_NOPTS_VALUE);
+        while ((error = av_read_frame(input.get(), packet.get())) >= 0) {
+            const unsigned index = static_cast<unsigned>(packet->stream_index);
+            AVStream *in = input->streams[index];
+            AVStream *out = output.context->streams[index];
+            av_packet_rescale_ts(packet.get(), in->time_base, out->time_base);
+            if (base[index] == AV_NOPTS_VALUE)
+                base[index] = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+            const std::int64_t shift = offset[index] - base[index];
+            if (packet->pts != AV_NOPTS_VALUE)
+                packet->pts += shift;
+            if (packet->dts != AV_NOPTS_VALUE)
+                packet->dts += shift;
+            const std::int64_t last = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+            end[index] = std::max(end[index], last + std::max<std::int64_t>(packet->duration, 1));
+            packet->pos = -1;
+            error = av_interleaved_write_frame(output.context, packet.get());
+            if (error < 0)
+                throw MediaError("cannot write " + outputPath, error);
+        }
+        if (error != AVERROR_EOF)
+            throw MediaError("cannot read segment " + path, error);
+    }
+
+    error = av_write_trailer(output.context);
+    if (error < 0)
+        throw MediaError("cannot finish " + outputPath, error);
+}
+
+} // namespace scp
@@ -0,0 +1,42 @@
+#pragma once
+
+// Splitting an export into independently encodable segments and joining the
+// encoded segments back together.
+//
+// Segment boundaries fall on multiples of the export's GOP length, so when
+// each segment is encoded with closed GOPs starting on its first frame the
+// parts can be concatenated by stream copy, without re-encoding.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace scp {
+
+struct ExportSegment
+{
+    int index = 0;
+    std::int64_t startFrame = 0; // inclusive, timeline frames
+    std::int64_t endFrame = 0;   // exclusive
+    std::string path;            // intermediate file for this segment
+};
+
+struct SegmentPlanOptions
+{
+    int gopLength = 60;                 // frames; every segment starts a GOP
+    int maxSegments = 0;                // 0 = one per hardware thread
+    std::int64_t minSegmentFrames = 600; // below this, splitting is not worth it
+};
+
+// Plans segments covering [startFrame, endFrame). Always returns at least
+// one segment for a non-empty range.
+std::vector<ExportSegment> planSegments(std::int64_t startFrame, std::int64_t endFrame,
+                                        const SegmentPlanOptions &options,
+                                        const std::string &outputPath);
+
+// Remuxes parts, in order, into outputPath, shifting each part's timestamps
+// to follow the previous one. Every part must have the same stream layout
+// and codec parameters. Throws MediaError.
+void concatSegments(const std::vector<std::string> &parts, const std::string &outputPath);
+
+} // namespace scp
@@ -0,0 +1,237 @@
+#include "jobs/render_queue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <filesystem>
+
+namespace scp {
+
+namespace {
+
+// Where a job writes before it succeeds, so a failed or cancelled export
+// leaves an existing file at outputPath alone. Keeps the extension, which
+// picks the container.
+std::filesystem::path partialPath(const std::string &outputPath)
+{
+    std::filesystem::path partial(outputPath);
+    partial.replace_filename(partial.stem().string() + ".partial"
+                             + partial.extension().string());
+    return partial;
+}
+
+// what() of the exception being handled, for JobStatus::error.
+std::string currentErrorMessage()
+{
+    try {
+        throw;
+    } catch (const std::exception &e) {
+        return e.what();
+    } catch (...) {
+        return "unknown error";
+    }
+}
+
+} // namespace
+
+RenderQueue::RenderQueue(SegmentEncoder &encoder, unsigned segmentWorkers, StatusCallback onStatus)
+    : m_encoder(encoder)
+    , m_segmentWorkers(segmentWorkers ? segmentWorkers
+                                      : std::max(1u, std::thread::hardware_concurrency()))
+    , m_onStatus(std::move(onStatus))
+    , m_thread([this](std::stop_token stop) { run(stop); })
+{}
+
+RenderQueue::~RenderQueue()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        for (auto &[id, job] : m_jobs)
+            job->stop.request_stop();
+    }
+    m_thread.request_stop();
+}
+
+JobId RenderQueue::enqueue(ExportJob spec)
+{
+    JobId id;
+    {
+        std::lock_guard lock(m_mutex);
+        id = m_nextId++;
+        auto job = std::make_shared<Job>();
+        job->spec = std::move(spec);
+        m_jobs.emplace(id, std::move(job));
+        m_pending.push_back(id);
+    }
+    m_wake.notify_one();
+    return id;
+}
+
+void RenderQueue::cancel(JobId id)
+{
+    JobStatus cancelled;
+    {
+        std::lock_guard lock(m_mutex);
+        auto it = m_jobs.find(id);
+        if (it == m_jobs.end())
+            return;
+        it->second->stop.request_stop();
+        auto queued = std::find(m_pending.begin(), m_pending.end(), id);
+        if (queued == m_pending.end())
+            return; // the runner reports the cancellation
+        m_pending.erase(queued);
+        it->second->status.state = JobState::Cancelled;
+        cancelled = it->second->status;
+        retireLocked(id);
+    }
+    m_idle.notify_all();
+    publish(id, cancelled);
+}
+
+JobStatus RenderQueue::status(JobId id) const
+{
+    std::lock_guard lock(m_mutex);
+    auto it = m_jobs.find(id);
+    return it == m_jobs.end() ? JobStatus{JobState::Failed, 0.0, 0, "unknown job"}
+                              : it->second->status;
+}
+
+void RenderQueue::waitForIdle()
+{
+    std::unique_lock lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_pending.empty() && !m_busy; });
+}
+
+void RenderQueue::publish(JobId id, const JobStatus &status)
+{
+    if (m_onStatus)
+        m_onStatus(id, status);
+}
+
+void RenderQueue::retireLocked(JobId id)
+{
+    m_finished.push_back(id);
+    while (m_finished.size() > kKeptJobs) {
+        m_jobs.erase(m_finished.front());
+        m_finished.pop_front();
+    }
+}
+
+void RenderQueue::run(std::stop_token stop)
+{
+    for (;;) {
+        JobId id;
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock lock(m_mutex);
+            if (!m_wake.wait(lock, stop, [this] { return !m_pending.empty(); }))
+                return;
+            id = m_pending.front();
+            m_pending.pop_front();
+            job = m_jobs.at(id);
+            m_busy = true;
+        }
+        execute(id, *job);
+        {
+            std::lock_guard lock(m_mutex);
+            m_busy = false;
+            retireLocked(id);
+        }
+        m_idle.notify_all();
+    }
+}
+
+void RenderQueue::execute(JobId id, Job &job)
+{
+    const std::vector<ExportSegment> segments = planSegments(
+        job.spec.startFrame, job.spec.endFrame, job.spec.segments, job.spec.outputPath);
+    const std::int64_t totalFrames = std::max<std::int64_t>(1, job.spec.endFrame
+                                                                   - job.spec.startFrame);
+    const std::stop_token stop = job.stop.get_token();
+
+    auto update = [&](auto &&change) {
+        JobStatus snapshot;
+        {
+            std::lock_guard lock(m_mutex);
+            change(job.status);
+            snapshot = job.status;
+        }
+        publish(id, snapshot);
+    };
+    update([&](JobStatus &s) {
+        s.state = JobState::Running;
+        s.segments = static_cast<int>(segments.size());
+    });
+
+    std::atomic<std::int64_t> framesDone{0};
+    std::atomic<std::size_t> nextSegment{0};
+    std::mutex errorMutex;
+    std::string error;
+
+    // Workers pull segments in order so early segments, and with them the
+    // start of the file, finish first.
+    auto worker = [&] {
+        for (std::size_t i; (i = nextSegment.fetch_add(1)) < segments.size();) {
+            if (stop.stop_requested())
+                return;
+            try {
+                m_encoder.encode(job.spec, segments[i], stop, [&](std::int64_t frames) {
+                    const std::int64_t done = framesDone.fetch_add(frames) + frames;
+                    update([&](JobStatus &s) { s.progress = double(done) / totalFrames; });
+                });
+            } catch (...) {
+                // Anything escaping here would terminate the process.
+                std::lock_guard lock(errorMutex);
+                if (error.empty())
+                    error = "segment " + std::to_string(i) + ": " + currentErrorMessage();
+                job.stop.request_stop();
+            }
+        }
+    };
+    {
+        const unsigned threads = std::min<unsigned>(m_segmentWorkers,
+                                                    static_cast<unsigned>(segments.size()));
+        std::vector<std::jthread> workers;
+        for (unsigned i = 1; i < threads; ++i)
+            workers.emplace_back(worker);
+        worker();
+    }
+
+    // Set once the result has replaced outputPath; a cancel after that is
+    // too late to undo it.
+    bool written = false;
+    const std::filesystem::path partial = partialPath(job.spec.outputPath);
+    if (error.empty() && !stop.stop_requested()) {
+        update([](JobStatus &s) { s.state = JobState::Joining; });
+        try {
+            if (segments.size() == 1) {
+                std::filesystem::rename(segments.front().path, job.spec.outputPath);
+            } else {
+                std::vector<std::string> parts;
+                for (const ExportSegment &segment : segments)
+                    parts.push_back(segment.path);
+                concatSegments(parts, partial.string());
+                std::filesystem::rename(partial, job.spec.outputPath);
+            }
+            written = true;
+        } catch (...) {
+            error = currentErrorMessage();
+        }
+    }
+
+    std::error_code ignored;
+    for (const ExportSegment &segment : segments)
+        std::filesystem::remove(segment.path, ignored);
+    std::filesystem::remove(partial, ignored);
+    const bool failed = !error.empty();
+    const bool cancelled = !failed && !written && stop.stop_requested();
+
+    update([&](JobStatus &s) {
+        s.state = failed ? JobState::Failed : cancelled ? JobState::Cancelled : JobState::Finished;
+        s.error = error;
+        if (s.state == JobState::Finished)
+            s.progress = 1.0;
+    });
+}
+
+} // namespace scp
@@ -0,0 +1,124 @@
+#pragma once
+
+// Background export queue.
+//
+// Jobs run one at a time in submission order. Each job is split into
+// GOP-aligned segments (see export_segments.h) that are encoded concurrently
+// by a SegmentEncoder and then joined by stream copy. The queue owns its
+// worker threads so a long export never competes with the preview's shared
+// pool for queue slots.
+
+#include "jobs/export_segments.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace scp {
+
+struct ExportJob
+{
+    std::string name;
+    std::string outputPath;
+    std::int64_t startFrame = 0;
+    std::int64_t endFrame = 0;
+    SegmentPlanOptions segments;
+};
+
+// Renders and encodes one segment into segment.path. The first frame must
+// be a keyframe and GOPs must be closed. Implementations report completed
+// frames through progress, return early when stop is requested, and throw
+// on failure. AVSegmentEncoder (av_segment_encoder.h) encodes with
+// libavcodec.
+class SegmentEncoder
+{
+public:
+    virtual ~SegmentEncoder() = default;
+    virtual void encode(const ExportJob &job, const ExportSegment &segment, std::stop_token stop,
+                        const std::function<void(std::int64_t frames)> &progress) = 0;
+};
+
+using JobId = std::uint64_t;
+
+enum class JobState {
+    Queued,
+    Running,
+    Joining,
+    Finished,
+    Failed,
+    Cancelled,
+};
+
+struct JobStatus
+{
+    JobState state = JobState::Queued;
+    double progress = 0.0; // 0..1 over all segments
+    int segments = 0;
+    std::string error;
+};
+
+class RenderQueue
+{
+public:
+    static constexpr std::size_t kKeptJobs = 64;
+
+    using StatusCallback = std::function<void(JobId, const JobStatus &)>;
+
+    // 0 segment workers means one per hardware thread.
+    explicit RenderQueue(SegmentEncoder &encoder, unsigned segmentWorkers = 0,
+                         StatusCallback onStatus = {});
+    ~RenderQueue();
+
+    RenderQueue(const RenderQueue &) = delete;
+    RenderQueue &operator=(const RenderQueue &) = delete;
+
+    JobId enqueue(ExportJob job);
+    // Cancels a queued or running job; partial output is removed.
+    void cancel(JobId id);
+    // Status of a job. The queue remembers the last kKeptJobs finished
+    // jobs; older ones report Failed with "unknown job".
+    JobStatus status(JobId id) const;
+
+    // Blocks until every job submitted so far has finished.
+    void waitForIdle();
+
+private:
+    struct Job
+    {
+        ExportJob spec;
+        JobStatus status;
+        std::stop_source stop;
+    };
+
+    void run(std::stop_token stop);
+    void execute(JobId id, Job &job);
+    void publish(JobId id, const JobStatus &status);
+    // Records that id reached a final state, forgetting the oldest
+    // finished jobs beyond kKeptJobs.
+    void retireLocked(JobId id);
+
+    SegmentEncoder &m_encoder;
+    const unsigned m_segmentWorkers;
+    const StatusCallback m_onStatus;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable_any m_wake;
+    std::condition_variable m_idle;
+    std::deque<JobId> m_pending;
+    std::map<JobId, std::shared_ptr<Job>> m_jobs;
+    std::deque<JobId> m_finished; // oldest first
+    JobId m_nextId = 1;
+    bool m_busy = false;
+    std::jthread m_thread;
+};
+
+} // namespace scp
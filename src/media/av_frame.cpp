@@ -0,0 +1,136 @@
+#include "media/av_frame.h"
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+#include <atomic>
+
+namespace scp {
+
+namespace {
+
+// Unspecified matrices are taken as BT.709 and unspecified ranges as limited,
+// except for the J formats, which are full range by definition.
+ColorSpec colorSpecOf(const AVFrame *frame)
+{
+    ColorSpec spec;
+    switch (frame->colorspace) {
+    case AVCOL_SPC_BT470BG:
+    case AVCOL_SPC_SMPTE170M:
+        spec.matrix = ColorMatrix::BT601;
+        break;
+    case AVCOL_SPC_BT2020_NCL:
+    case AVCOL_SPC_BT2020_CL:
+        spec.matrix = ColorMatrix::BT2020;
+        break;
+    default:
+        break;
+    }
+    if (frame->color_range == AVCOL_RANGE_JPEG || frame->format == AV_PIX_FMT_YUVJ420P)
+        spec.range = ColorRange::Full;
+    return spec;
+}
+
+class AVFrameOwner final : public FrameOwner
+{
+public:
+    void recycle(FrameBuffer *buffer) noexcept override
+    {
+        auto *frame = static_cast<AVFrame *>(buffer->ownerData());
+        av_frame_free(&frame);
+        delete buffer;
+        m_live.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    FrameBuffer *adopt(AVFrame *frame, PixelFormat format)
+    {
+        auto *buffer = new FrameBuffer(this, {frame->width, frame->height, format});
+        for (int i = 0; i < planeCount(format); ++i)
+            buffer->setPlane(i, frame->data[i], frame->linesize[i]);
+        buffer->setOwnerData(frame);
+        buffer->setPts(frame->best_effort_timestamp != AV_NOPTS_VALUE
+                           ? frame->best_effort_timestamp
+                           : frame->pts);
+        buffer->setColorSpec(colorSpecOf(frame));
+        m_live.fetch_add(1, std::memory_order_relaxed);
+        return buffer;
+    }
+
+    std::uint64_t live() const { return m_live.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::uint64_t> m_live{0};
+};
+
+AVFrameOwner &avFrameOwner()
+{
+    static AVFrameOwner owner;
+    return owner;
+}
+
+} // namespace
+
+PixelFormat fromAVPixelFormat(AVPixelFormat format)
+{
+    switch (format) {
+    case AV_PIX_FMT_YUV420P:
+    case AV_PIX_FMT_YUVJ420P: // full range; adoptAVFrame() records it in the color spec
+        return PixelFormat::YUV420P;
+    case AV_PIX_FMT_NV12:
+        return PixelFormat::NV12;
+    case AV_PIX_FMT_P010LE:
+        return PixelFormat::P010;
+    case AV_PIX_FMT_RGBA:
+        return PixelFormat::RGBA8;
+#ifdef AV_PIX_FMT_RGBAF16
+    case AV_PIX_FMT_RGBAF16LE:
+        return PixelFormat::RGBA16F;
+#endif
+    default:
+        return PixelFormat::None;
+    }
+}
+
+AVPixelFormat toAVPixelFormat(PixelFormat format)
+{
+    switch (format) {
+    case PixelFormat::YUV420P:
+        return AV_PIX_FMT_YUV420P;
+    case PixelFormat::NV12:
+        return AV_PIX_FMT_NV12;
+    case PixelFormat::P010:
+        return AV_PIX_FMT_P010LE;
+    case PixelFormat::RGBA8:
+        return AV_PIX_FMT_RGBA;
+    case PixelFormat::RGBA16F:
+#ifdef AV_PIX_FMT_RGBAF16
+        return AV_PIX_FMT_RGBAF16LE;
+#else
+        break;
+#endif
+    case PixelFormat::None:
+        break;
+    }
+    return AV_PIX_FMT_NONE;
+}
+
+FrameRef adoptAVFrame(const AVFrame *frame)
+{
+    if (!frame || !frame->buf[0])
+        return {};
+    const PixelFormat format = fromAVPixelFormat(static_cast<AVPixelFormat>(frame->format));
+    if (format == PixelFormat::None)
+        return {};
+    AVFrame *reference = av_frame_clone(frame);
+    if (!reference)
+        return {};
+    return FrameRef(avFrameOwner().adopt(reference, format));
+}
+
+std::uint64_t adoptedAVFrameCount()
+{
+    return avFrameOwner().live();
+}
+
+} // namespace scp
@@ -0,0 +1,34 @@
+#pragma once
+
+// Zero-copy bridge from FFmpeg's decoded frames to engine FrameBuffers.
+//
+// adoptAVFrame() takes a new reference on the AVFrame's AVBufferRefs and
+// points the FrameBuffer's planes straight at the decoder's memory; the
+// buffers go back to FFmpeg when the last FrameRef is dropped. Stages that
+// need a stricter layout call conformToAlignment() (core/frame_copy.h), which
+// copies only when the decoder's strides or plane starts do not fit.
+
+#include "core/frame_buffer.h"
+
+extern "C" {
+#include <libavutil/pixfmt.h>
+}
+
+struct AVFrame;
+
+namespace scp {
+
+// PixelFormat::None / AV_PIX_FMT_NONE for formats the engine does not carry.
+PixelFormat fromAVPixelFormat(AVPixelFormat format);
+AVPixelFormat toAVPixelFormat(PixelFormat format);
+
+// Wraps a refcounted decoded frame without copying pixel data. Returns a
+// null ref when the frame is not refcounted or its pixel format has no
+// engine equivalent; the caller then has to convert. The caller keeps its
+// own reference to frame and may unref or reuse it immediately.
+FrameRef adoptAVFrame(const AVFrame *frame);
+
+// Number of AVFrames currently kept alive by adopted FrameBuffers.
+std::uint64_t adoptedAVFrameCount();
+
+} // namespace scp
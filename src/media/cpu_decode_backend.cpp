@@ -0,0 +1,228 @@
+#include "media/cpu_decode_backend.h"
+
+#include "core/frame_copy.h"
+#include "media/av_frame.h"
+#include "media/media_error.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace scp {
+
+CpuDecodeBackend::CpuDecodeBackend(const AVStream *stream, DecodeBackendConfig config,
+                                   const DecoderOptions &options)
+    : m_config(config)
+    , m_frame(av_frame_alloc())
+{
+    const AVCodecParameters *parameters = stream->codecpar;
+    const AVCodec *codec = avcodec_find_decoder(parameters->codec_id);
+    if (!codec)
+        throw MediaError("no decoder for stream");
+    m_codec.reset(avcodec_alloc_context3(codec));
+    if (!m_codec || !m_frame)
+        throw MediaError("cannot allocate decoder");
+    int error = avcodec_parameters_to_context(m_codec.get(), parameters);
+    if (error < 0)
+        throw MediaError("cannot configure decoder", error);
+    if (options.budget) {
+        const int wanted = planDecodeThreading(codec, parameters, INT32_MAX, options.lowLatency)
+                               .threads;
+        m_threadGrant = options.budget->acquire(wanted);
+        applyDecodeThreading(m_codec.get(), planDecodeThreading(codec, parameters,
+                                                                m_threadGrant.threads(),
+                                                                options.lowLatency));
+    } else {
+        m_codec->thread_count = options.threads;
+    }
+    m_codec->pkt_timebase = stream->time_base;
+    error = avcodec_open2(m_codec.get(), codec, nullptr);
+    if (error < 0)
+        throw MediaError("cannot open decoder", error);
+
+    // Like a hardware decoder, surfaces are sized from the stream
+    // parameters before the first packet.
+    const FrameFormat format{parameters->width, parameters->height,
+                             fromAVPixelFormat(static_cast<AVPixelFormat>(parameters->format))};
+    if (!format.isValid())
+        throw MediaError("no surface format for stream");
+    m_surfaces = SurfacePool::create(format, std::max(1, m_config.surfaces));
+    if (!m_surfaces)
+        throw MediaError("cannot allocate decode surfaces");
+
+    m_thread = std::jthread([this](std::stop_token stop) { run(stop); });
+}
+
+CpuDecodeBackend::~CpuDecodeBackend()
+{
+    m_thread.request_stop();
+}
+
+bool CpuDecodeBackend::submit(const AVPacket *packet)
+{
+    AVPacketPtr reference;
+    if (packet) {
+        reference.reset(av_packet_alloc());
+        if (!reference || av_packet_ref(reference.get(), packet) < 0)
+            throw MediaError("cannot reference packet");
+    }
+    {
+        std::lock_guard lock(m_mutex);
+        if (m_endOfStream)
+            throw MediaError("packet submitted after the end of the stream");
+        const int depth = static_cast<int>(m_packets.size()) + (m_decoding ? 1 : 0);
+        if (depth >= std::max(1, m_config.queueDepth)) {
+            ++m_stats.submitsRejected;
+            return false;
+        }
+        if (packet)
+            ++m_stats.packetsSubmitted;
+        else
+            m_endOfStream = true;
+        m_packets.push_back(std::move(reference));
+        m_stats.peakQueueDepth = std::max(m_stats.peakQueueDepth, depth + 1);
+    }
+    m_packetReady.notify_one();
+    return true;
+}
+
+FrameRef CpuDecodeBackend::poll(std::chrono::milliseconds timeout)
+{
+    std::unique_lock lock(m_mutex);
+    m_frameReady.wait_for(lock, timeout,
+                          [this] { return !m_frames.empty() || m_error || m_drained; });
+    if (m_error)
+        std::rethrow_exception(std::exchange(m_error, nullptr));
+    if (m_frames.empty())
+        return {};
+    FrameRef frame = std::move(m_frames.front());
+    m_frames.pop_front();
+    return frame;
+}
+
+bool CpuDecodeBackend::finished() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_drained && m_frames.empty();
+}
+
+void CpuDecodeBackend::flush()
+{
+    std::deque<FrameRef> dropped;
+    {
+        std::lock_guard lock(m_mutex);
+        m_stats.framesDropped += m_frames.size();
+        dropped.swap(m_frames);
+        m_packets.clear();
+        m_endOfStream = false;
+        m_drained = false;
+        m_error = nullptr;
+        ++m_generation;
+    }
+    // Releasing the frames frees surfaces a stalled decode may wait for.
+}
+
+DecodeBackendStats CpuDecodeBackend::stats() const
+{
+    std::lock_guard lock(m_mutex);
+    DecodeBackendStats stats = m_stats;
+    stats.surfacesInUse = m_surfaces->size() - m_surfaces->available();
+    return stats;
+}
+
+void CpuDecodeBackend::run(std::stop_token stop)
+{
+    std::uint64_t codecGeneration = 0;
+    bool codecDrained = false;
+    for (;;) {
+        AVPacketPtr packet;
+        std::uint64_t generation;
+        {
+            std::unique_lock lock(m_mutex);
+            if (!m_packetReady.wait(lock, stop, [this] { return !m_packets.empty(); }))
+                return;
+            packet = std::move(m_packets.front());
+            m_packets.pop_front();
+            m_decoding = true;
+            generation = m_generation;
+        }
+        if (generation != codecGeneration || codecDrained) {
+            avcodec_flush_buffers(m_codec.get());
+            codecGeneration = generation;
+            codecDrained = false;
+        }
+
+        bool current = true;
+        try {
+            current = decode(packet.get(), generation, stop);
+        } catch (...) {
+            // Includes bad_alloc from frame allocation; the reader rethrows
+            // it from poll() instead of the thread terminating.
+            std::lock_guard lock(m_mutex);
+            if (generation == m_generation)
+                m_error = std::current_exception();
+        }
+        if (!packet)
+            codecDrained = true;
+        {
+            std::lock_guard lock(m_mutex);
+            m_decoding = false;
+            if (!packet && current && generation == m_generation)
+                m_drained = true;
+        }
+        m_frameReady.notify_all();
+    }
+}
+
+bool CpuDecodeBackend::decode(const AVPacket *packet, std::uint64_t generation,
+                              std::stop_token stop)
+{
+    int error = avcodec_send_packet(m_codec.get(), packet);
+    if (error < 0 && error != AVERROR_EOF)
+        throw MediaError("cannot decode packet", error);
+    for (;;) {
+        error = avcodec_receive_frame(m_codec.get(), m_frame.get());
+        if (error == AVERROR(EAGAIN) || error == AVERROR_EOF)
+            return true;
+        if (error < 0)
+            throw MediaError("cannot decode packet", error);
+        const bool queued = output(m_frame.get(), generation, stop);
+        av_frame_unref(m_frame.get());
+        if (!queued)
+            return false;
+    }
+}
+
+bool CpuDecodeBackend::output(const AVFrame *frame, std::uint64_t generation,
+                              std::stop_token stop)
+{
+    const FrameRef decoded = adoptAVFrame(frame);
+    if (!decoded || decoded->format() != m_surfaces->format())
+        throw MediaError("decoded frame does not fit the decode surfaces");
+
+    FrameRef surface = m_surfaces->tryAcquire();
+    if (!surface) {
+        {
+            std::lock_guard lock(m_mutex);
+            ++m_stats.surfaceStalls;
+        }
+        surface = m_surfaces->acquire(stop);
+        if (!surface)
+            return false;
+    }
+    copyFrame(*decoded, *surface);
+    surface->setPts(decoded->pts());
+    surface->setColorSpec(decoded->colorSpec());
+    {
+        std::lock_guard lock(m_mutex);
+        if (generation != m_generation) {
+            ++m_stats.framesDropped;
+            return false;
+        }
+        m_frames.push_back(std::move(surface));
+        ++m_stats.framesDecoded;
+    }
+    m_frameReady.notify_all();
+    return true;
+}
+
+} // namespace scp
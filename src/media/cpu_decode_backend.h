@@ -0,0 +1,72 @@
+#pragma once
+
+// DecodeBackend on a CPU thread, for machines without a GPU.
+//
+// A decode thread takes packets from the bounded submit queue, decodes them
+// with FFmpeg's software decoder and writes each frame into a pool surface,
+// blocking while none is free, as a hardware decoder does. The copy into
+// the surface stands in for the hardware's own write; everything after it
+// is zero-copy.
+
+#include "media/decode_backend.h"
+#include "media/surface_pool.h"
+#include "media/video_decoder.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace scp {
+
+class CpuDecodeBackend final : public DecodeBackend
+{
+public:
+    // Opens a decoder for stream; threads come from options like a
+    // VideoDecoder's (the I/O fields are ignored). Throws MediaError, also
+    // when the stream's pixel format has no engine equivalent.
+    explicit CpuDecodeBackend(const AVStream *stream, DecodeBackendConfig config = {},
+                              const DecoderOptions &options = {});
+    ~CpuDecodeBackend() override;
+
+    std::string name() const override { return "cpu"; }
+    const DecodeBackendConfig &config() const override { return m_config; }
+    bool submit(const AVPacket *packet) override;
+    FrameRef poll(std::chrono::milliseconds timeout = {}) override;
+    bool finished() const override;
+    void flush() override;
+    DecodeBackendStats stats() const override;
+
+private:
+    void run(std::stop_token stop);
+    // Sends packet (null: drain) and queues every frame it produces.
+    // Returns false if the stream was flushed meanwhile.
+    bool decode(const AVPacket *packet, std::uint64_t generation, std::stop_token stop);
+    bool output(const AVFrame *frame, std::uint64_t generation, std::stop_token stop);
+
+    const DecodeBackendConfig m_config;
+    DecodeThreadBudget::Grant m_threadGrant;
+    AVCodecContextPtr m_codec;
+    AVFramePtr m_frame;
+    std::shared_ptr<SurfacePool> m_surfaces;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable_any m_packetReady;
+    std::condition_variable_any m_frameReady;
+    // A null packet marks the end of the stream.
+    std::deque<AVPacketPtr> m_packets;
+    std::deque<FrameRef> m_frames;
+    bool m_decoding = false;
+    bool m_endOfStream = false; // submitted
+    bool m_drained = false;     // every frame before it is queued
+    // Bumped by flush(); work started under an older value is discarded.
+    std::uint64_t m_generation = 0;
+    std::exception_ptr m_error;
+    DecodeBackendStats m_stats;
+
+    std::jthread m_thread;
+};
+
+} // namespace scp
@@ -0,0 +1,75 @@
+#pragma once
+
+// Asynchronous decode interface shared by the hardware and CPU backends.
+//
+// The contract follows hardware decoders: packets are submitted into a queue
+// of fixed depth, decoding happens elsewhere, and decoded frames are polled
+// in presentation order. Frames live in the backend's SurfacePool and go to
+// the render graph without a copy; the decoder stalls once every surface is
+// referenced, so callers that hold on to frames throttle decoding, exactly
+// as they would on a GPU. CpuDecodeBackend implements the same contract on
+// threads, so the pipeline's queueing and surface recycling behave the
+// same on machines without a GPU.
+
+#include "core/frame_buffer.h"
+#include "media/ffmpeg_ptr.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace scp {
+
+struct DecodeBackendConfig
+{
+    // Packets submitted but not yet consumed by the decoder.
+    int queueDepth = 4;
+    // Output surfaces, including those the decoder keeps as references and
+    // those held by the caller.
+    int surfaces = 8;
+};
+
+struct DecodeBackendStats
+{
+    std::uint64_t packetsSubmitted = 0;
+    // submit() calls turned away because the queue was full.
+    std::uint64_t submitsRejected = 0;
+    std::uint64_t framesDecoded = 0;
+    // Decoded frames discarded by flush().
+    std::uint64_t framesDropped = 0;
+    // Times the decoder had to wait for a surface to be released.
+    std::uint64_t surfaceStalls = 0;
+    int surfacesInUse = 0;
+    int peakQueueDepth = 0;
+};
+
+class DecodeBackend
+{
+public:
+    virtual ~DecodeBackend() = default;
+
+    virtual std::string name() const = 0;
+    virtual const DecodeBackendConfig &config() const = 0;
+
+    // Queues a reference to packet, or the end of the stream for null.
+    // Returns false without taking the packet while the queue is full; poll
+    // and submit it again. Throws MediaError.
+    virtual bool submit(const AVPacket *packet) = 0;
+
+    // The next decoded frame, waiting up to timeout for one. Null ref if
+    // none is ready. Rethrows a decode error of an earlier packet as
+    // MediaError.
+    virtual FrameRef poll(std::chrono::milliseconds timeout = {}) = 0;
+
+    // True once the end of the stream has been submitted and every frame
+    // before it has been polled.
+    virtual bool finished() const = 0;
+
+    // Drops queued packets and unpolled frames and resets the decoder, for
+    // seeking. Frames already polled stay valid.
+    virtual void flush() = 0;
+
+    virtual DecodeBackendStats stats() const = 0;
+};
+
+} // namespace scp
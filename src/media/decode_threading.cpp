@@ -0,0 +1,165 @@
+#include "media/decode_threading.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#include <algorithm>
+#include <initializer_list>
+#include <thread>
+
+namespace scp {
+
+namespace {
+
+// Roughly one thread's worth of decoding per quarter of a 1080p frame;
+// below that, thread start-up and synchronisation eat the gain.
+constexpr long kPixelsPerThread = 960L * 540;
+// Frame threading stops scaling past this in FFmpeg's decoders.
+constexpr int kMaxFrameThreads = 16;
+// Frames of latency tolerated after a seek when access is interactive.
+constexpr int kLowLatencyFrameThreads = 3;
+
+} // namespace
+
+const char *decodeThreadingName(DecodeThreading threading)
+{
+    switch (threading) {
+    case DecodeThreading::Single:
+        return "single";
+    case DecodeThreading::Slice:
+        return "slice";
+    case DecodeThreading::Frame:
+        return "frame";
+    case DecodeThreading::Internal:
+        return "internal";
+    }
+    return "unknown";
+}
+
+DecodeThreadingPlan planDecodeThreading(const AVCodec *codec, const AVCodecParameters *parameters,
+                                        int threadLimit, bool lowLatency)
+{
+    const long pixels = long(parameters->width) * parameters->height;
+    const int wanted = std::clamp(static_cast<int>((pixels + kPixelsPerThread / 2)
+                                                   / kPixelsPerThread),
+                                  1, std::min(std::max(threadLimit, 1), kMaxFrameThreads));
+    if (wanted <= 1 || !codec)
+        return {DecodeThreading::Single, 1};
+
+    const bool frame = codec->capabilities & AV_CODEC_CAP_FRAME_THREADS;
+    const bool slice = codec->capabilities & AV_CODEC_CAP_SLICE_THREADS;
+    const AVCodecDescriptor *descriptor = avcodec_descriptor_get(codec->id);
+    const bool intraOnly = descriptor && (descriptor->props & AV_CODEC_PROP_INTRA_ONLY);
+
+    // Intra-only codecs are sliced for parallel decoding by design (ProRes,
+    // DNxHR), and slice threading adds no latency. Long-GOP streams often
+    // carry one slice per frame, so they thread across frames even when
+    // latency matters, just less deep.
+    if (slice && (intraOnly || !frame))
+        return {DecodeThreading::Slice, wanted};
+    if (frame) {
+        return {DecodeThreading::Frame,
+                lowLatency ? std::min(wanted, kLowLatencyFrameThreads) : wanted};
+    }
+    if (codec->capabilities & AV_CODEC_CAP_OTHER_THREADS)
+        return {DecodeThreading::Internal, wanted};
+    return {DecodeThreading::Single, 1};
+}
+
+void applyDecodeThreading(AVCodecContext *context, const DecodeThreadingPlan &plan)
+{
+    switch (plan.mode) {
+    case DecodeThreading::Single:
+        context->thread_count = 1;
+        break;
+    case DecodeThreading::Slice:
+        context->thread_count = plan.threads;
+        context->thread_type = FF_THREAD_SLICE;
+        break;
+    case DecodeThreading::Frame:
+        context->thread_count = plan.threads;
+        context->thread_type = FF_THREAD_FRAME;
+        break;
+    case DecodeThreading::Internal:
+        context->thread_count = plan.threads;
+        break;
+    }
+}
+
+DecodeThreadBudget::Grant::Grant(Grant &&other) noexcept
+    : m_budget(other.m_budget)
+    , m_threads(other.m_threads)
+{
+    other.m_budget = nullptr;
+    other.m_threads = 0;
+}
+
+DecodeThreadBudget::Grant &DecodeThreadBudget::Grant::operator=(Grant &&other) noexcept
+{
+    if (this != &other) {
+        reset();
+        m_budget = other.m_budget;
+        m_threads = other.m_threads;
+        other.m_budget = nullptr;
+        other.m_threads = 0;
+    }
+    return *this;
+}
+
+void DecodeThreadBudget::Grant::reset()
+{
+    if (m_budget)
+        m_budget->release(m_threads);
+    m_budget = nullptr;
+    m_threads = 0;
+}
+
+DecodeThreadBudget::DecodeThreadBudget(int threads)
+    : m_threads(threads > 0 ? threads
+                            : std::max(1, static_cast<int>(std::thread::hardware_concurrency())))
+{}
+
+DecodeThreadBudget::Grant DecodeThreadBudget::acquire(int wanted)
+{
+    std::lock_guard lock(m_mutex);
+    const int fairShare = m_threads / std::max(m_streams + 1, m_expectedStreams);
+    const int left = m_threads - m_granted;
+    const int threads = std::max(0, std::min({wanted, fairShare, left}));
+    m_granted += threads;
+    ++m_streams;
+    return Grant(this, threads);
+}
+
+void DecodeThreadBudget::release(int threads)
+{
+    std::lock_guard lock(m_mutex);
+    m_granted -= threads;
+    --m_streams;
+}
+
+void DecodeThreadBudget::setExpectedStreams(int streams)
+{
+    std::lock_guard lock(m_mutex);
+    m_expectedStreams = std::max(1, streams);
+}
+
+int DecodeThreadBudget::granted() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_granted;
+}
+
+int DecodeThreadBudget::streams() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_streams;
+}
+
+DecodeThreadBudget &DecodeThreadBudget::shared()
+{
+    static DecodeThreadBudget budget;
+    return budget;
+}
+
+} // namespace scp
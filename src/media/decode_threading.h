@@ -0,0 +1,109 @@
+#pragma once
+
+// How each decoder uses threads, and how many it may use in total.
+//
+// FFmpeg decoders can thread across frames (throughput scales well, but each
+// thread adds a frame of latency after every seek), across slices (no extra
+// latency, but only as parallel as the encoder made the bitstream), or not at
+// all. planDecodeThreading() picks one per stream from the codec's
+// capabilities, the frame size and whether the stream serves interactive
+// access. DecodeThreadBudget shares a machine-wide thread count between all
+// open decoders, so eight multicam angles get a couple of threads each
+// instead of eight times the core count.
+//
+// Thread counts are fixed when the codec context opens. Pooled decoders
+// hand their threads back while idle and reopen with fewer if the budget
+// has shrunk by the time they are leased again.
+
+#include <cstddef>
+#include <mutex>
+
+struct AVCodec;
+struct AVCodecContext;
+struct AVCodecParameters;
+
+namespace scp {
+
+enum class DecodeThreading {
+    Single,
+    Slice,
+    Frame,
+    Internal, // the codec library manages its own threads (e.g. dav1d)
+};
+
+const char *decodeThreadingName(DecodeThreading threading);
+
+struct DecodeThreadingPlan
+{
+    DecodeThreading mode = DecodeThreading::Single;
+    int threads = 1;
+};
+
+// threadLimit caps the result. lowLatency keeps frame threading shallow,
+// for scrubbing and reverse playback.
+DecodeThreadingPlan planDecodeThreading(const AVCodec *codec, const AVCodecParameters *parameters,
+                                        int threadLimit, bool lowLatency);
+
+// Sets thread_count and thread_type; call before avcodec_open2().
+void applyDecodeThreading(AVCodecContext *context, const DecodeThreadingPlan &plan);
+
+class DecodeThreadBudget
+{
+public:
+    // Threads held by one decoder; returned to the budget on destruction.
+    class Grant
+    {
+    public:
+        Grant() = default;
+        Grant(Grant &&other) noexcept;
+        Grant &operator=(Grant &&other) noexcept;
+        ~Grant() { reset(); }
+
+        int threads() const { return m_threads; }
+        void reset();
+
+    private:
+        friend class DecodeThreadBudget;
+        Grant(DecodeThreadBudget *budget, int threads)
+            : m_budget(budget)
+            , m_threads(threads)
+        {}
+
+        DecodeThreadBudget *m_budget = nullptr;
+        int m_threads = 0;
+    };
+
+    // 0 means one thread per hardware thread.
+    explicit DecodeThreadBudget(int threads = 0);
+
+    DecodeThreadBudget(const DecodeThreadBudget &) = delete;
+    DecodeThreadBudget &operator=(const DecodeThreadBudget &) = delete;
+
+    // Grants up to wanted threads, never more than a fair share of the
+    // budget for the streams expected to decode together, nor more than is
+    // left. Grants none once the budget is spent; the decoder then runs
+    // single-threaded on its caller.
+    Grant acquire(int wanted);
+
+    // How many streams the player expects to decode at once, e.g. the number
+    // of video tracks under the playhead. Caps the share a single decoder
+    // opened first can take.
+    void setExpectedStreams(int streams);
+
+    int threads() const { return m_threads; }
+    int granted() const;
+    int streams() const;
+
+    static DecodeThreadBudget &shared();
+
+private:
+    void release(int threads);
+
+    const int m_threads;
+    mutable std::mutex m_mutex;
+    int m_granted = 0;
+    int m_streams = 0;
+    int m_expectedStreams = 1;
+};
+
+} // namespace scp
@@ -0,0 +1,229 @@
+#include "media/decoder_pool.h"
+
+#include <cassert>
+#include <optional>
+#include <vector>
+
+namespace scp {
+
+DecoderLease::DecoderLease(DecoderPool *pool, int requestedStream,
+                           std::unique_ptr<VideoDecoder> decoder)
+    : m_pool(pool)
+    , m_requestedStream(requestedStream)
+    , m_decoder(std::move(decoder))
+{}
+
+DecoderLease::DecoderLease(DecoderLease &&other) noexcept
+    : m_pool(other.m_pool)
+    , m_requestedStream(other.m_requestedStream)
+    , m_decoder(std::move(other.m_decoder))
+{
+    other.m_pool = nullptr;
+}
+
+DecoderLease &DecoderLease::operator=(DecoderLease &&other) noexcept
+{
+    if (this != &other) {
+        release();
+        m_pool = other.m_pool;
+        m_requestedStream = other.m_requestedStream;
+        m_decoder = std::move(other.m_decoder);
+        other.m_pool = nullptr;
+    }
+    return *this;
+}
+
+void DecoderLease::release()
+{
+    if (m_pool && m_decoder)
+        m_pool->giveBack(m_requestedStream, std::move(m_decoder));
+    m_pool = nullptr;
+}
+
+void DecoderLease::discard()
+{
+    if (m_pool && m_decoder) {
+        m_decoder.reset();
+        m_pool->dropLeased();
+    }
+    m_pool = nullptr;
+}
+
+DecoderPool::DecoderPool(std::size_t maxIdle, DecoderOptions options)
+    : m_maxIdle(maxIdle)
+    , m_options(options)
+{}
+
+DecoderPool::~DecoderPool()
+{
+    assert(m_stats.leased == 0 && "DecoderPool destroyed with sessions still leased");
+}
+
+DecoderLease DecoderPool::acquire(const std::string &path, int streamIndex, std::int64_t pts)
+{
+    const std::optional<MediaIdentity> identity = MediaIdentity::of(path);
+    std::vector<std::unique_ptr<VideoDecoder>> stale;
+    DecoderLease lease;
+    {
+        std::lock_guard lock(m_mutex);
+        auto best = m_idle.end();
+        for (auto it = m_idle.begin(); it != m_idle.end();) {
+            VideoDecoder &decoder = *it->decoder;
+            if (it->requestedStream != streamIndex || decoder.path() != path) {
+                ++it;
+                continue;
+            }
+            if (!identity || decoder.identity() != *identity) {
+                // The file changed since the session opened it.
+                stale.push_back(std::move(it->decoder));
+                it = m_idle.erase(it);
+                continue;
+            }
+            if (best == m_idle.end()) {
+                best = it;
+            } else if (pts != AV_NOPTS_VALUE) {
+                // Closest at-or-before pts wins; anything else needs a seek.
+                const std::int64_t position = decoder.position();
+                const std::int64_t bestPosition = best->decoder->position();
+                const bool usable = position != AV_NOPTS_VALUE && position <= pts;
+                const bool bestUsable = bestPosition != AV_NOPTS_VALUE && bestPosition <= pts;
+                if (usable && (!bestUsable || position > bestPosition))
+                    best = it;
+            }
+            ++it;
+        }
+        if (best != m_idle.end()) {
+            std::unique_ptr<VideoDecoder> decoder = std::move(best->decoder);
+            m_idle.erase(best);
+            ++m_stats.hits;
+            ++m_stats.leased;
+            lease = DecoderLease(this, streamIndex, std::move(decoder));
+        }
+    }
+    if (lease) {
+        // Outside the lock: a shrunken grant reopens the codec.
+        try {
+            lease->reacquireThreads();
+            return lease;
+        } catch (...) {
+            lease.discard();
+            throw;
+        }
+    }
+
+    stale.clear();
+    auto decoder = std::make_unique<VideoDecoder>(path, streamIndex, m_options);
+    std::lock_guard lock(m_mutex);
+    ++m_stats.opens;
+    ++m_stats.leased;
+    return DecoderLease(this, streamIndex, std::move(decoder));
+}
+
+AVFramePtr DecoderPool::decodeAt(const std::string &path, int streamIndex, std::int64_t pts)
+{
+    const std::optional<MediaIdentity> identity = MediaIdentity::of(path);
+    const std::pair key(path, streamIndex);
+    std::shared_ptr<IntraDecoder> intra;
+    bool known = false;
+    {
+        std::lock_guard lock(m_mutex);
+        const auto it = m_intra.find(key);
+        if (it != m_intra.end() && identity && it->second.identity == *identity) {
+            known = true;
+            intra = it->second.decoder;
+        }
+    }
+    if (intra)
+        return intra->decodeAt(pts);
+
+    DecoderLease lease = acquire(path, streamIndex, pts);
+    if (!known && identity) {
+        if (isIntraOnlyCodec(lease->stream()->codecpar->codec_id)) {
+            lease.release();
+            intra = std::make_shared<IntraDecoder>(path, streamIndex);
+        }
+        std::shared_ptr<IntraDecoder> replaced;
+        {
+            std::lock_guard lock(m_mutex);
+            Intra &entry = m_intra[key];
+            entry.identity = *identity;
+            replaced = std::exchange(entry.decoder, intra);
+        }
+        if (intra)
+            return intra->decodeAt(pts);
+    }
+    try {
+        const AVFrame *frame = lease->decodeAt(pts);
+        return AVFramePtr(frame ? av_frame_clone(frame) : nullptr);
+    } catch (...) {
+        lease.discard();
+        throw;
+    }
+}
+
+void DecoderPool::giveBack(int requestedStream, std::unique_ptr<VideoDecoder> decoder)
+{
+    // Idle codec threads only wait, so their budget is better spent on the
+    // sessions that decode.
+    decoder->releaseThreads();
+    std::vector<std::unique_ptr<VideoDecoder>> evicted;
+    {
+        std::lock_guard lock(m_mutex);
+        --m_stats.leased;
+        m_idle.push_front({requestedStream, std::move(decoder)});
+        while (m_idle.size() > m_maxIdle) {
+            evicted.push_back(std::move(m_idle.back().decoder));
+            m_idle.pop_back();
+            ++m_stats.evictions;
+        }
+    }
+    // Closing joins codec threads; do it outside the lock.
+}
+
+void DecoderPool::dropLeased()
+{
+    std::lock_guard lock(m_mutex);
+    --m_stats.leased;
+}
+
+void DecoderPool::evict(const std::string &path)
+{
+    std::vector<std::unique_ptr<VideoDecoder>> closed;
+    std::vector<std::shared_ptr<IntraDecoder>> closedIntra;
+    std::lock_guard lock(m_mutex);
+    for (auto it = m_intra.begin(); it != m_intra.end();) {
+        if (it->first.first == path) {
+            closedIntra.push_back(std::move(it->second.decoder));
+            it = m_intra.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = m_idle.begin(); it != m_idle.end();) {
+        if (it->decoder->path() == path) {
+            closed.push_back(std::move(it->decoder));
+            it = m_idle.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void DecoderPool::clear()
+{
+    std::list<Idle> closed;
+    std::map<std::pair<std::string, int>, Intra> closedIntra;
+    std::lock_guard lock(m_mutex);
+    closed.swap(m_idle);
+    closedIntra.swap(m_intra);
+}
+
+DecoderPoolStats DecoderPool::stats() const
+{
+    std::lock_guard lock(m_mutex);
+    DecoderPoolStats stats = m_stats;
+    stats.idle = m_idle.size();
+    return stats;
+}
+
+} // namespace scp
@@ -0,0 +1,127 @@
+#pragma once
+
+// Bounded pool of open decoder sessions, keyed by media file and stream.
+//
+// Timelines cut between a few long camera files hundreds of times; opening a
+// VideoDecoder per clip repeats container probing and codec start-up on
+// every cut. Clips lease a session for as long as they read from it and
+// return it afterwards, so the next clip from the same source gets a warm
+// one, ideally already positioned just before the frame it needs.
+//
+// One-off random access (scrubbing, thumbnails) goes through decodeAt(),
+// which serves intra-only streams with a shared IntraDecoder instead.
+
+#include "media/intra_decoder.h"
+#include "media/video_decoder.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace scp {
+
+class DecoderPool;
+
+// Exclusive use of a session; returns it to the pool when destroyed.
+class DecoderLease
+{
+public:
+    DecoderLease() = default;
+    DecoderLease(DecoderLease &&other) noexcept;
+    DecoderLease &operator=(DecoderLease &&other) noexcept;
+    ~DecoderLease() { release(); }
+
+    VideoDecoder *get() const { return m_decoder.get(); }
+    VideoDecoder *operator->() const { return m_decoder.get(); }
+    VideoDecoder &operator*() const { return *m_decoder; }
+    explicit operator bool() const { return m_decoder != nullptr; }
+
+    void release();
+    // Closes the session instead of returning it, e.g. after a decode error
+    // left it in an unknown state.
+    void discard();
+
+private:
+    friend class DecoderPool;
+    DecoderLease(DecoderPool *pool, int requestedStream, std::unique_ptr<VideoDecoder> decoder);
+
+    DecoderPool *m_pool = nullptr;
+    int m_requestedStream = -1;
+    std::unique_ptr<VideoDecoder> m_decoder;
+};
+
+struct DecoderPoolStats
+{
+    std::uint64_t hits = 0;      // acquires served by an idle session
+    std::uint64_t opens = 0;     // acquires that opened a new one
+    std::uint64_t evictions = 0; // idle sessions closed to stay in budget
+    std::size_t idle = 0;
+    std::size_t leased = 0;
+};
+
+class DecoderPool
+{
+public:
+    // Keeps at most maxIdle sessions open while nobody uses them. options
+    // apply to every VideoDecoder it opens.
+    explicit DecoderPool(std::size_t maxIdle = 16, DecoderOptions options = {});
+    // All leases must have been released.
+    ~DecoderPool();
+
+    DecoderPool(const DecoderPool &) = delete;
+    DecoderPool &operator=(const DecoderPool &) = delete;
+
+    // A session on streamIndex of path (-1: best video stream). Among idle
+    // sessions for it, prefers the one positioned closest before pts (stream
+    // time base), so the following decodeAt(pts) decodes forward instead of
+    // seeking. Opens a new session if none is idle. Throws MediaError.
+    DecoderLease acquire(const std::string &path, int streamIndex = -1,
+                         std::int64_t pts = AV_NOPTS_VALUE);
+
+    // The frame displayed at pts on streamIndex of path, or null past the
+    // end. Intra-only streams decode just the packet covering pts on a shared
+    // IntraDecoder, in parallel across callers; others use a leased session.
+    // Thread-safe. Throws MediaError.
+    AVFramePtr decodeAt(const std::string &path, int streamIndex, std::int64_t pts);
+
+    // Closes idle sessions of path, e.g. after the file was replaced.
+    void evict(const std::string &path);
+    void clear();
+
+    DecoderPoolStats stats() const;
+
+private:
+    friend class DecoderLease;
+
+    struct Idle
+    {
+        int requestedStream;
+        std::unique_ptr<VideoDecoder> decoder;
+    };
+
+    // What decodeAt() learnt about a stream: its IntraDecoder, or null if the
+    // stream has GOPs.
+    struct Intra
+    {
+        MediaIdentity identity;
+        std::shared_ptr<IntraDecoder> decoder;
+    };
+
+    void giveBack(int requestedStream, std::unique_ptr<VideoDecoder> decoder);
+    void dropLeased();
+
+    const std::size_t m_maxIdle;
+    const DecoderOptions m_options;
+
+    mutable std::mutex m_mutex;
+    std::list<Idle> m_idle; // most recently returned first
+    std::map<std::pair<std::string, int>, Intra> m_intra;
+    DecoderPoolStats m_stats;
+};
+
+} // namespace scp
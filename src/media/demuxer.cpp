@@ -0,0 +1,80 @@
+#include "media/demuxer.h"
+
+#include "media/media_error.h"
+
+namespace scp {
+
+Demuxer::Demuxer(const std::string &path, DemuxerIO io, IoPriority priority)
+    : m_path(path)
+{
+    AVIOContext *custom = nullptr;
+    if (io == DemuxerIO::Mapped && (m_mapped = MappedIO::open(path)))
+        custom = m_mapped->context();
+    else if (io == DemuxerIO::Scheduled
+             && (m_scheduled = ScheduledIO::open(path, IoScheduler::shared(), priority)))
+        custom = m_scheduled->context();
+    else if (io == DemuxerIO::Growing && (m_growing = GrowingIO::open(path)))
+        custom = m_growing->context();
+
+    AVFormatContext *context = nullptr;
+    if (custom) {
+        context = avformat_alloc_context();
+        if (!context)
+            throw MediaError("cannot allocate demuxer for " + path);
+        context->pb = custom;
+        context->flags |= AVFMT_FLAG_CUSTOM_IO;
+    }
+    // Frees context on failure.
+    int error = avformat_open_input(&context, path.c_str(), nullptr, nullptr);
+    if (error < 0)
+        throw MediaError("cannot open " + path, error);
+    m_context.reset(context);
+    error = avformat_find_stream_info(context, nullptr);
+    if (error < 0)
+        throw MediaError("cannot read stream info of " + path, error);
+}
+
+int Demuxer::bestVideoStream() const
+{
+    const int index = av_find_best_stream(m_context.get(), AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    return index < 0 ? -1 : index;
+}
+
+void Demuxer::selectStream(int index)
+{
+    for (int i = 0; i < streamCount(); ++i)
+        stream(i)->discard = i == index ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+}
+
+bool Demuxer::readPacket(AVPacket *packet)
+{
+    const int error = av_read_frame(m_context.get(), packet);
+    if (error == AVERROR_EOF)
+        return false;
+    if (error < 0)
+        throw MediaError("cannot read " + m_path, error);
+    return true;
+}
+
+void Demuxer::seek(int streamIndex, std::int64_t timestamp)
+{
+    const int error = av_seek_frame(m_context.get(), streamIndex, timestamp,
+                                    AVSEEK_FLAG_BACKWARD);
+    if (error < 0)
+        throw MediaError("cannot seek in " + m_path, error);
+}
+
+void Demuxer::seekToByte(std::int64_t position)
+{
+    const int error = av_seek_frame(m_context.get(), -1, position, AVSEEK_FLAG_BYTE);
+    if (error < 0)
+        throw MediaError("cannot seek in " + m_path, error);
+}
+
+bool Demuxer::hasTimestampDiscontinuities() const
+{
+    const AVInputFormat *format = m_context->iformat;
+    return format && (format->flags & AVFMT_TS_DISCONT) && !(format->flags & AVFMT_NO_BYTE_SEEK);
+}
+
+} // namespace scp
@@ -0,0 +1,73 @@
+#pragma once
+
+// Thin owner of an AVFormatContext opened for reading.
+
+#include "media/ffmpeg_ptr.h"
+#include "media/growing_io.h"
+#include "media/mapped_io.h"
+#include "media/scheduled_io.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace scp {
+
+// How a Demuxer reads its file. The custom backends fall back to File when
+// they cannot open it.
+enum class DemuxerIO {
+    File,      // FFmpeg's file protocol
+    Mapped,    // MappedIO, for SSDs and the page cache
+    Scheduled, // ScheduledIO on IoScheduler::shared(), for spinning disks
+    Growing,   // GrowingIO, for files still being written
+};
+
+class Demuxer
+{
+public:
+    // Opens the container and reads stream info. priority applies to
+    // DemuxerIO::Scheduled. Throws MediaError.
+    explicit Demuxer(const std::string &path, DemuxerIO io = DemuxerIO::File,
+                     IoPriority priority = IoPriority::Playhead);
+
+    const std::string &path() const { return m_path; }
+    AVFormatContext *context() const { return m_context.get(); }
+    // Null unless the file is read through a mapping.
+    MappedIO *mappedIO() const { return m_mapped.get(); }
+    // Null unless the file is read through the scheduler.
+    ScheduledIO *scheduledIO() const { return m_scheduled.get(); }
+    // Null unless the file is opened as still growing.
+    GrowingIO *growingIO() const { return m_growing.get(); }
+    AVStream *stream(int index) const { return m_context->streams[index]; }
+    int streamCount() const { return static_cast<int>(m_context->nb_streams); }
+
+    // Index of the default video stream, or -1.
+    int bestVideoStream() const;
+
+    // Makes the container skip every other stream's packets.
+    void selectStream(int index);
+
+    // Returns false at end of file. Throws MediaError on read errors.
+    bool readPacket(AVPacket *packet);
+
+    // Positions the demuxer at the keyframe at or before timestamp, given in
+    // the stream's time base. Throws MediaError.
+    void seek(int streamIndex, std::int64_t timestamp);
+    // Positions the demuxer at a byte offset, which must be the start of a
+    // packet. Throws MediaError.
+    void seekToByte(std::int64_t position);
+
+    // The container's timestamps may jump (MPEG-TS/PS), so timestamp seeks
+    // are a bisection over the file rather than an index lookup.
+    bool hasTimestampDiscontinuities() const;
+
+private:
+    std::string m_path;
+    // Must outlive m_context.
+    std::unique_ptr<MappedIO> m_mapped;
+    std::unique_ptr<ScheduledIO> m_scheduled;
+    std::unique_ptr<GrowingIO> m_growing;
+    AVFormatContextPtr m_context;
+};
+
+} // namespace scp
@@ -0,0 +1,38 @@
+#pragma once
+
+// unique_ptr aliases for FFmpeg objects that are freed through a
+// pointer-to-pointer API.
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/frame.h>
+}
+
+#include <memory>
+
+namespace scp {
+
+struct AVFormatContextDeleter
+{
+    void operator()(AVFormatContext *context) const { avformat_close_input(&context); }
+};
+struct AVCodecContextDeleter
+{
+    void operator()(AVCodecContext *context) const { avcodec_free_context(&context); }
+};
+struct AVPacketDeleter
+{
+    void operator()(AVPacket *packet) const { av_packet_free(&packet); }
+};
+struct AVFrameDeleter
+{
+    void operator()(AVFrame *frame) const { av_frame_free(&frame); }
+};
+
+using AVFormatContextPtr = std::unique_ptr<AVFormatContext, AVFormatContextDeleter>;
+using AVCodecContextPtr = std::unique_ptr<AVCodecContext, AVCodecContextDeleter>;
+using AVPacketPtr = std::unique_ptr<AVPacket, AVPacketDeleter>;
+using AVFramePtr = std::unique_ptr<AVFrame, AVFrameDeleter>;
+
+} // namespace scp
@@ -0,0 +1,167 @@
+#include "media/growing_io.h"
+
+extern "C" {
+#include <libavformat/avio.h>
+#include <libavutil/mem.h>
+}
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+
+namespace scp {
+
+namespace {
+
+constexpr int kBufferSize = 256 * 1024;
+// How often a following read checks whether the file grew.
+constexpr auto kPollInterval = std::chrono::milliseconds(50);
+
+} // namespace
+
+GrowingIO::GrowingIO(int fd)
+    : m_fd(fd)
+    , m_lastGrowth(std::chrono::steady_clock::now())
+{}
+
+std::unique_ptr<GrowingIO> GrowingIO::open(const std::string &path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return nullptr;
+    std::unique_ptr<GrowingIO> io(new GrowingIO(fd));
+    io->refreshSize();
+    auto *buffer = static_cast<unsigned char *>(av_malloc(kBufferSize));
+    if (!buffer)
+        return nullptr;
+    io->m_context = avio_alloc_context(buffer, kBufferSize, 0, io.get(), &GrowingIO::readPacket,
+                                       nullptr, &GrowingIO::seek);
+    if (!io->m_context) {
+        av_free(buffer);
+        return nullptr;
+    }
+    io->m_context->seekable = AVIO_SEEKABLE_NORMAL;
+    return io;
+}
+
+GrowingIO::~GrowingIO()
+{
+    if (m_context) {
+        av_freep(&m_context->buffer);
+        avio_context_free(&m_context);
+    }
+    ::close(m_fd);
+}
+
+std::uint64_t GrowingIO::size() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_size;
+}
+
+void GrowingIO::setFollow(bool follow, std::chrono::milliseconds idleTimeout)
+{
+    std::lock_guard lock(m_mutex);
+    m_follow = follow;
+    m_idleTimeout = idleTimeout;
+    m_lastGrowth = std::chrono::steady_clock::now();
+}
+
+void GrowingIO::finish()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_finished = true;
+    }
+    m_finishedChanged.notify_all();
+}
+
+bool GrowingIO::finished() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_finished;
+}
+
+bool GrowingIO::pollFinished()
+{
+    refreshSize();
+    std::lock_guard lock(m_mutex);
+    return m_finished || idleLocked();
+}
+
+bool GrowingIO::idleLocked()
+{
+    if (!m_follow || std::chrono::steady_clock::now() - m_lastGrowth < m_idleTimeout)
+        return false;
+    m_finished = true;
+    return true;
+}
+
+std::uint64_t GrowingIO::refreshSize()
+{
+    struct stat info;
+    std::lock_guard lock(m_mutex);
+    if (::fstat(m_fd, &info) == 0 && std::uint64_t(info.st_size) > m_size) {
+        m_size = std::uint64_t(info.st_size);
+        m_lastGrowth = std::chrono::steady_clock::now();
+    }
+    return m_size;
+}
+
+int GrowingIO::readPacket(void *opaque, std::uint8_t *buffer, int size)
+{
+    auto *io = static_cast<GrowingIO *>(opaque);
+    for (;;) {
+        const ssize_t n = ::pread(io->m_fd, buffer, std::size_t(size), off_t(io->m_position));
+        if (n > 0) {
+            io->m_position += std::uint64_t(n);
+            return static_cast<int>(n);
+        }
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return AVERROR(errno);
+        }
+
+        // At the end of what has been written so far.
+        io->refreshSize();
+        std::unique_lock lock(io->m_mutex);
+        if (io->m_size > io->m_position)
+            continue;
+        if (!io->m_follow || io->m_finished)
+            return AVERROR_EOF;
+        if (io->idleLocked())
+            return AVERROR_EOF;
+        io->m_finishedChanged.wait_for(lock, kPollInterval, [io] { return io->m_finished; });
+    }
+}
+
+std::int64_t GrowingIO::seek(void *opaque, std::int64_t offset, int whence)
+{
+    auto *io = static_cast<GrowingIO *>(opaque);
+    std::int64_t target;
+    switch (whence & ~AVSEEK_FORCE) {
+    case AVSEEK_SIZE:
+        return static_cast<std::int64_t>(io->refreshSize());
+    case SEEK_SET:
+        target = offset;
+        break;
+    case SEEK_CUR:
+        target = std::int64_t(io->m_position) + offset;
+        break;
+    case SEEK_END:
+        target = static_cast<std::int64_t>(io->refreshSize()) + offset;
+        break;
+    default:
+        return AVERROR(EINVAL);
+    }
+    if (target < 0)
+        return AVERROR(EINVAL);
+    io->m_position = std::uint64_t(target);
+    return target;
+}
+
+} // namespace scp
@@ -0,0 +1,75 @@
+#pragma once
+
+// AVIOContext over a file that a capture process is still writing.
+//
+// FFmpeg's file protocol, like MappedIO, fixes the file size when it opens.
+// GrowingIO reads with pread() and reports the size the file has at the
+// time of asking, so data written after the open is visible to the
+// demuxer, and seeking into it works. Reading at the end returns EOF, or,
+// in follow mode, waits for the file to grow until the writer is done.
+// Whether the writer is done is known only to the ingest system, which
+// calls finish(), or guessed when the file stops growing for a while.
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+struct AVIOContext;
+
+namespace scp {
+
+class GrowingIO
+{
+public:
+    // Null if path cannot be opened.
+    static std::unique_ptr<GrowingIO> open(const std::string &path);
+    ~GrowingIO();
+
+    GrowingIO(const GrowingIO &) = delete;
+    GrowingIO &operator=(const GrowingIO &) = delete;
+
+    AVIOContext *context() const { return m_context; }
+
+    // Size of the file when it was last checked.
+    std::uint64_t size() const;
+
+    // In follow mode, reads at the end of the file wait for more data. A
+    // file that has not grown for idleTimeout is taken as finished.
+    void setFollow(bool follow, std::chrono::milliseconds idleTimeout = std::chrono::seconds(15));
+
+    // The writer is done, or the reader gives up: waiting reads return EOF.
+    void finish();
+    bool finished() const;
+    // Checks for growth the way a waiting read does, for readers whose
+    // demuxer stopped reading: true once finished, including by the idle
+    // timeout in follow mode.
+    bool pollFinished();
+
+private:
+    explicit GrowingIO(int fd);
+
+    static int readPacket(void *opaque, std::uint8_t *buffer, int size);
+    static std::int64_t seek(void *opaque, std::int64_t offset, int whence);
+
+    // fstat()s the file; returns the new size.
+    std::uint64_t refreshSize();
+    // Marks the file finished if it has been idle too long in follow mode.
+    bool idleLocked();
+
+    const int m_fd;
+    AVIOContext *m_context = nullptr;
+    std::uint64_t m_position = 0;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_finishedChanged;
+    std::uint64_t m_size = 0;
+    bool m_follow = false;
+    bool m_finished = false;
+    std::chrono::milliseconds m_idleTimeout{0};
+    std::chrono::steady_clock::time_point m_lastGrowth;
+};
+
+} // namespace scp
@@ -0,0 +1,202 @@
+#include "media/growing_media.h"
+
+#include "media/ffmpeg_ptr.h"
+#include "media/media_error.h"
+
+#include <exception>
+#include <fstream>
+#include <string_view>
+#include <utility>
+
+namespace scp {
+
+namespace {
+
+// Retry delay when the container reports its end before the writer is done.
+constexpr auto kRetryInterval = std::chrono::milliseconds(50);
+
+int videoStream(const Demuxer &demuxer)
+{
+    const int index = demuxer.bestVideoStream();
+    if (index < 0)
+        throw MediaError("no video stream in " + demuxer.path());
+    return index;
+}
+
+// Whether an ISO BMFF file is fragmented: a moov announcing fragments
+// (mvex) or a moof among the top-level boxes written so far.
+bool isFragmented(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    auto header = [&](std::uint64_t offset, std::uint64_t &size, std::string &type,
+                      std::uint64_t &headerSize) {
+        unsigned char bytes[16];
+        in.clear();
+        in.seekg(std::streamoff(offset));
+        if (!in.read(reinterpret_cast<char *>(bytes), 8))
+            return false;
+        size = std::uint64_t(bytes[0]) << 24 | std::uint64_t(bytes[1]) << 16
+               | std::uint64_t(bytes[2]) << 8 | bytes[3];
+        type.assign(reinterpret_cast<const char *>(bytes + 4), 4);
+        headerSize = 8;
+        if (size == 1) {
+            if (!in.read(reinterpret_cast<char *>(bytes + 8), 8))
+                return false;
+            size = 0;
+            for (int i = 8; i < 16; ++i)
+                size = size << 8 | bytes[i];
+            headerSize = 16;
+        }
+        return size == 0 || size >= headerSize;
+    };
+
+    std::uint64_t size, headerSize;
+    std::string type;
+    for (std::uint64_t offset = 0; header(offset, size, type, headerSize);) {
+        if (type == "moof")
+            return true;
+        if (type == "moov") {
+            const std::uint64_t end = size ? offset + size : UINT64_MAX;
+            std::uint64_t childSize, childHeader;
+            std::string child;
+            for (std::uint64_t at = offset + headerSize;
+                 at < end && header(at, childSize, child, childHeader) && childSize;
+                 at += childSize) {
+                if (child == "mvex")
+                    return true;
+            }
+        }
+        if (size == 0)
+            break; // runs to the end of the file
+        offset += size;
+    }
+    return false;
+}
+
+std::string currentErrorMessage()
+{
+    try {
+        throw;
+    } catch (const std::exception &e) {
+        return e.what();
+    } catch (...) {
+        return "unknown error";
+    }
+}
+
+} // namespace
+
+GrowingMediaFollower::GrowingMediaFollower(const std::string &path, Callback onGrowth,
+                                           GrowingMediaOptions options)
+    : m_onGrowth(std::move(onGrowth))
+    , m_options(options)
+    , m_demuxer(path, DemuxerIO::Growing)
+    , m_io(m_demuxer.growingIO())
+    , m_streamIndex(videoStream(m_demuxer))
+    , m_builder(m_streamIndex, m_demuxer.stream(m_streamIndex)->time_base.num,
+                m_demuxer.stream(m_streamIndex)->time_base.den)
+{
+    if (!m_io)
+        throw MediaError("cannot follow " + path);
+    const AVInputFormat *format = m_demuxer.context()->iformat;
+    if (format && std::string_view(format->name).starts_with("mov") && !isFragmented(path))
+        throw MediaError("cannot follow " + path + ": MOV/MP4 recordings must be fragmented");
+    m_demuxer.selectStream(m_streamIndex);
+    m_state.streamIndex = m_streamIndex;
+    m_state.timeBaseNum = m_demuxer.stream(m_streamIndex)->time_base.num;
+    m_state.timeBaseDen = m_demuxer.stream(m_streamIndex)->time_base.den;
+    // Probing read what was there; from here on reads wait for more.
+    m_io->setFollow(true, m_options.idleTimeout);
+    m_thread = std::jthread([this](std::stop_token stop) { run(stop); });
+}
+
+GrowingMediaFollower::~GrowingMediaFollower()
+{
+    m_thread.request_stop();
+}
+
+void GrowingMediaFollower::finish()
+{
+    m_io->finish();
+}
+
+GrowingMediaState GrowingMediaFollower::snapshot() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_state;
+}
+
+KeyframeIndexData GrowingMediaFollower::index() const
+{
+    const MediaIdentity identity = MediaIdentity::of(path()).value_or(MediaIdentity{});
+    std::lock_guard lock(m_mutex);
+    return m_builder.data(identity);
+}
+
+void GrowingMediaFollower::run(std::stop_token stop)
+{
+    // Wakes a read waiting for data that will never come.
+    std::stop_callback wake(stop, [this] { m_io->finish(); });
+
+    AVPacketPtr packet(av_packet_alloc());
+    auto nextPublish = std::chrono::steady_clock::now();
+    std::string error;
+    try {
+        if (!packet)
+            throw MediaError("cannot allocate packet");
+        for (;;) {
+            if (!m_demuxer.readPacket(packet.get())) {
+                // The demuxer may report its end without reading on (e.g.
+                // at the end of an MXF partition), so the idle timeout in
+                // GrowingIO's reads never runs; check growth here too.
+                if (m_io->pollFinished())
+                    break;
+                // The demuxer saw the end of what was written; it is not
+                // the end of the file.
+                m_demuxer.context()->pb->eof_reached = 0;
+                std::this_thread::sleep_for(kRetryInterval);
+                continue;
+            }
+            {
+                std::lock_guard lock(m_mutex);
+                m_builder.add(*packet);
+            }
+            av_packet_unref(packet.get());
+            const auto now = std::chrono::steady_clock::now();
+            if (now >= nextPublish) {
+                publish(false);
+                nextPublish = now + m_options.publishInterval;
+            }
+        }
+    } catch (...) {
+        // Anything escaping the thread would terminate the process: demuxer
+        // errors, bad_alloc, or the callback failing on a periodic publish.
+        error = currentErrorMessage();
+    }
+    if (stop.stop_requested())
+        return;
+    try {
+        publish(true, std::move(error));
+    } catch (...) {
+        // The callback failed on the final state; nothing is left to tell.
+    }
+}
+
+void GrowingMediaFollower::publish(bool finished, std::string error)
+{
+    GrowingMediaState state;
+    {
+        std::lock_guard lock(m_mutex);
+        m_state.endPts = m_builder.endPts();
+        m_state.frames = m_builder.packetCount();
+        m_state.keyframes = m_builder.keyframeCount();
+        m_state.bytes = m_io->size();
+        m_state.finished = finished;
+        m_state.error = std::move(error);
+        state = m_state;
+    }
+    if (m_onGrowth)
+        m_onGrowth(state);
+}
+
+} // namespace scp
@@ -0,0 +1,104 @@
+#pragma once
+
+// Editing media while it is still being ingested.
+//
+// A capture process appends to an MXF or MOV file for as long as the
+// recording runs. GrowingMediaFollower opens it once through GrowingIO,
+// probes it once, and then keeps demuxing packets as they are written,
+// feeding them to a KeyframeIndexBuilder. Every publishInterval the owner
+// is handed a snapshot with the new extent, so the timeline can lengthen
+// the clip without reprobing or reopening anything. Decoders of the clip
+// open it with DemuxerIO::Growing and see new data as it appears.
+//
+// When the writer is done (finish(), or no growth for idleTimeout) a final
+// snapshot is published and index() is complete, ready to be written as
+// the clip's keyframe sidecar.
+//
+// Only containers that put their index next to the data can be followed:
+// MXF, and MOV/MP4 written as fragments. A plain MOV describes its samples
+// in one moov box written when recording stops, so nothing appended after
+// the open would ever be demuxed; the constructor rejects it.
+
+#include "media/demuxer.h"
+#include "media/keyframe_index.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+namespace scp {
+
+struct GrowingMediaOptions
+{
+    // How often the owner hears about growth.
+    std::chrono::milliseconds publishInterval{1000};
+    // A file that has not grown this long is taken as finished.
+    std::chrono::milliseconds idleTimeout{15000};
+};
+
+struct GrowingMediaState
+{
+    int streamIndex = -1;
+    int timeBaseNum = 0;
+    int timeBaseDen = 1;
+    // End of the last demuxed frame, stream time base.
+    std::int64_t endPts = 0;
+    std::uint64_t frames = 0;
+    std::uint64_t keyframes = 0;
+    std::uint64_t bytes = 0; // file size seen so far
+    bool finished = false;
+    // Set when following failed, including when the callback threw; the
+    // state is final.
+    std::string error;
+};
+
+class GrowingMediaFollower
+{
+public:
+    // Called on the follower thread; must be thread-safe. If it throws,
+    // following stops with the exception's message as the error.
+    using Callback = std::function<void(const GrowingMediaState &)>;
+
+    // Opens and probes path and starts following its best video stream.
+    // Throws MediaError, also for an unfragmented MOV/MP4.
+    GrowingMediaFollower(const std::string &path, Callback onGrowth,
+                         GrowingMediaOptions options = {});
+    // Stops following without a final snapshot.
+    ~GrowingMediaFollower();
+
+    GrowingMediaFollower(const GrowingMediaFollower &) = delete;
+    GrowingMediaFollower &operator=(const GrowingMediaFollower &) = delete;
+
+    const std::string &path() const { return m_demuxer.path(); }
+
+    // The writer is done: the rest of the file is demuxed, then the final
+    // snapshot is published.
+    void finish();
+
+    GrowingMediaState snapshot() const;
+
+    // The keyframe index so far; complete once snapshot().finished.
+    KeyframeIndexData index() const;
+
+private:
+    void run(std::stop_token stop);
+    void publish(bool finished, std::string error = {});
+
+    const Callback m_onGrowth;
+    const GrowingMediaOptions m_options;
+    Demuxer m_demuxer;
+    GrowingIO *m_io = nullptr;
+    int m_streamIndex = -1;
+
+    mutable std::mutex m_mutex;
+    KeyframeIndexBuilder m_builder;
+    GrowingMediaState m_state;
+
+    std::jthread m_thread;
+};
+
+} // namespace scp
@@ -0,0 +1,198 @@
+#include "media/intra_decoder.h"
+
+#include "core/thread_pool.h"
+#include "media/media_error.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace scp {
+
+struct IntraDecoder::Instance
+{
+    explicit Instance(const std::string &path)
+        : demuxer(path, DemuxerIO::Mapped)
+        , packet(av_packet_alloc())
+        , candidate(av_packet_alloc())
+    {
+        // Every request is a seek to one packet.
+        if (MappedIO *io = demuxer.mappedIO())
+            io->setAccessPattern(AccessPattern::Random);
+    }
+
+    Demuxer demuxer;
+    AVCodecContextPtr codec;
+    AVPacketPtr packet;
+    AVPacketPtr candidate;
+};
+
+bool isIntraOnlyCodec(AVCodecID codec)
+{
+    const AVCodecDescriptor *descriptor = avcodec_descriptor_get(codec);
+    return descriptor && (descriptor->props & AV_CODEC_PROP_INTRA_ONLY);
+}
+
+IntraDecoder::IntraDecoder(const std::string &path, int streamIndex, IntraDecoderOptions options,
+                           ThreadPool *pool)
+    : m_path(path)
+    , m_pool(pool ? *pool : ThreadPool::shared())
+    , m_maxInstances(options.instances > 0 ? options.instances : int(m_pool.size()) + 1)
+{
+    // The first instance also resolves the stream and the codec's limits.
+    auto first = std::make_unique<Instance>(path);
+    m_streamIndex = streamIndex >= 0 ? streamIndex : first->demuxer.bestVideoStream();
+    if (m_streamIndex < 0 || m_streamIndex >= first->demuxer.streamCount())
+        throw MediaError("no video stream in " + path);
+    const AVStream *stream = first->demuxer.stream(m_streamIndex);
+    if (!isIntraOnlyCodec(stream->codecpar->codec_id))
+        throw MediaError(path + " is not intra-only");
+    m_timeBase = stream->time_base;
+    const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    if (!codec)
+        throw MediaError("no decoder for " + path);
+    m_lowres = std::clamp(options.lowres, 0, int(codec->max_lowres));
+
+    m_idle.push_back(openInstance(std::move(first)));
+    m_open = 1;
+}
+
+IntraDecoder::~IntraDecoder() = default;
+
+std::unique_ptr<IntraDecoder::Instance>
+IntraDecoder::openInstance(std::unique_ptr<Instance> instance) const
+{
+    if (!instance)
+        instance = std::make_unique<Instance>(m_path);
+    instance->demuxer.selectStream(m_streamIndex);
+    const AVStream *stream = instance->demuxer.stream(m_streamIndex);
+    const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    instance->codec.reset(avcodec_alloc_context3(codec));
+    if (!instance->codec)
+        throw MediaError("cannot allocate decoder for " + m_path);
+    int error = avcodec_parameters_to_context(instance->codec.get(), stream->codecpar);
+    if (error < 0)
+        throw MediaError("cannot configure decoder for " + m_path, error);
+    // Parallelism comes from running instances side by side.
+    instance->codec->thread_count = 1;
+    instance->codec->lowres = m_lowres;
+    instance->codec->pkt_timebase = stream->time_base;
+    error = avcodec_open2(instance->codec.get(), codec, nullptr);
+    if (error < 0)
+        throw MediaError("cannot open decoder for " + m_path, error);
+    return instance;
+}
+
+std::unique_ptr<IntraDecoder::Instance> IntraDecoder::lease()
+{
+    {
+        std::unique_lock lock(m_mutex);
+        m_returned.wait(lock, [this] { return !m_idle.empty() || m_open < m_maxInstances; });
+        if (!m_idle.empty()) {
+            auto instance = std::move(m_idle.back());
+            m_idle.pop_back();
+            return instance;
+        }
+        ++m_open;
+    }
+    try {
+        return openInstance();
+    } catch (...) {
+        std::lock_guard lock(m_mutex);
+        --m_open;
+        m_returned.notify_one();
+        throw;
+    }
+}
+
+void IntraDecoder::giveBack(std::unique_ptr<Instance> instance)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        if (instance)
+            m_idle.push_back(std::move(instance));
+        else
+            --m_open;
+    }
+    m_returned.notify_one();
+}
+
+AVFramePtr IntraDecoder::decodeAt(std::int64_t pts)
+{
+    std::unique_ptr<Instance> instance = lease();
+    try {
+        Instance &in = *instance;
+        in.demuxer.seek(m_streamIndex, pts);
+        avcodec_flush_buffers(in.codec.get());
+
+        // Read ahead to the packet covering pts. Packets are self-contained,
+        // so the ones skipped on the way are never decoded.
+        av_packet_unref(in.candidate.get());
+        bool haveCandidate = false;
+        while (in.demuxer.readPacket(in.packet.get())) {
+            if (in.packet->stream_index != m_streamIndex) {
+                av_packet_unref(in.packet.get());
+                continue;
+            }
+            const std::int64_t start = in.packet->pts != AV_NOPTS_VALUE ? in.packet->pts
+                                                                          : in.packet->dts;
+            if (haveCandidate && start > pts) {
+                av_packet_unref(in.packet.get());
+                break;
+            }
+            av_packet_unref(in.candidate.get());
+            av_packet_move_ref(in.candidate.get(), in.packet.get());
+            haveCandidate = true;
+            if (start > pts || (in.candidate->duration > 0 && start + in.candidate->duration > pts))
+                break;
+        }
+
+        AVFramePtr frame;
+        if (haveCandidate) {
+            int error = avcodec_send_packet(in.codec.get(), in.candidate.get());
+            if (error < 0)
+                throw MediaError("cannot decode " + m_path, error);
+            frame.reset(av_frame_alloc());
+            error = avcodec_receive_frame(in.codec.get(), frame.get());
+            if (error == AVERROR(EAGAIN)) {
+                // Some wrappers hold a frame back until drained.
+                avcodec_send_packet(in.codec.get(), nullptr);
+                error = avcodec_receive_frame(in.codec.get(), frame.get());
+            }
+            if (error < 0)
+                throw MediaError("cannot decode " + m_path, error);
+        }
+        giveBack(std::move(instance));
+        return frame;
+    } catch (...) {
+        // State unknown after an error: close this instance.
+        giveBack(nullptr);
+        throw;
+    }
+}
+
+void IntraDecoder::decodeMany(std::span<const std::int64_t> pts,
+                              const std::function<void(std::size_t, AVFramePtr)> &sink)
+{
+    std::mutex errorMutex;
+    std::exception_ptr firstError;
+    std::atomic<bool> failed{false};
+    m_pool.parallelFor(pts.size(), [&](std::size_t i) {
+        if (failed.load(std::memory_order_relaxed))
+            return;
+        try {
+            sink(i, decodeAt(pts[i]));
+        } catch (...) {
+            // The sink's exceptions too: one escaping a pool task would
+            // terminate the process.
+            std::lock_guard lock(errorMutex);
+            if (!firstError)
+                firstError = std::current_exception();
+            failed.store(true, std::memory_order_relaxed);
+        }
+    });
+    if (firstError)
+        std::rethrow_exception(firstError);
+}
+
+} // namespace scp
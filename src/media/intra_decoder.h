@@ -0,0 +1,90 @@
+#pragma once
+
+// Random access for intra-only streams (ProRes, DNxHR, MJPEG, ...).
+//
+// Every packet of such a stream decodes on its own, so the GOP machinery of
+// VideoDecoder is pure overhead here: a request seeks straight to the
+// packet covering the timestamp, skips packets before it without decoding
+// them, and decodes exactly one. Scrubbing and thumbnail strips decode many
+// frames at once on separate single-threaded decoder instances, which scales
+// better than slice threading one decoder. Preview can ask for
+// reduced-resolution decoding where the codec implements it (lowres).
+
+#include "media/demuxer.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace scp {
+
+class ThreadPool;
+
+// True if every frame of the codec is a keyframe.
+bool isIntraOnlyCodec(AVCodecID codec);
+
+struct IntraDecoderOptions
+{
+    // Downscale by 2^lowres while decoding; clamped to what the codec
+    // supports (0 for codecs without lowres decoding).
+    int lowres = 0;
+    // Decoder instances kept open; 0 means one per pool worker plus one for
+    // the calling thread.
+    int instances = 0;
+};
+
+class IntraDecoder
+{
+public:
+    // Opens streamIndex of path (-1: best video stream). Throws MediaError,
+    // also when the stream's codec is not intra-only.
+    IntraDecoder(const std::string &path, int streamIndex = -1, IntraDecoderOptions options = {},
+                 ThreadPool *pool = nullptr);
+    ~IntraDecoder();
+
+    IntraDecoder(const IntraDecoder &) = delete;
+    IntraDecoder &operator=(const IntraDecoder &) = delete;
+
+    int streamIndex() const { return m_streamIndex; }
+    AVRational timeBase() const { return m_timeBase; }
+    int lowres() const { return m_lowres; }
+
+    // The frame displayed at pts (stream time base), or null past the end.
+    // Thread-safe; concurrent calls use separate decoder instances. Throws
+    // MediaError.
+    AVFramePtr decodeAt(std::int64_t pts);
+
+    // Decodes every timestamp in parallel on the pool and hands each frame
+    // to sink(index, frame) as it completes, on pool threads. Rethrows the
+    // first exception, from decoding or from sink, after all work has
+    // stopped.
+    void decodeMany(std::span<const std::int64_t> pts,
+                    const std::function<void(std::size_t, AVFramePtr)> &sink);
+
+private:
+    struct Instance;
+
+    // Configures instance, or a newly opened one if it is null.
+    std::unique_ptr<Instance> openInstance(std::unique_ptr<Instance> instance = nullptr) const;
+    std::unique_ptr<Instance> lease();
+    void giveBack(std::unique_ptr<Instance> instance);
+
+    std::string m_path;
+    int m_streamIndex = -1;
+    AVRational m_timeBase{0, 1};
+    int m_lowres = 0;
+    ThreadPool &m_pool;
+    int m_maxInstances;
+
+    std::mutex m_mutex;
+    std::condition_variable m_returned;
+    std::vector<std::unique_ptr<Instance>> m_idle;
+    int m_open = 0;
+};
+
+} // namespace scp
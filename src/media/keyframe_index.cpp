@@ -0,0 +1,457 @@
+#include "media/keyframe_index.h"
+
+#include "media/demuxer.h"
+#include "media/media_error.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <ranges>
+
+namespace scp {
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'C', 'P', 'K', 'I', 'D', 'X', '\0'};
+constexpr std::uint32_t kVersion = 2;
+// Version 1 sidecars lack frame times but are otherwise current.
+constexpr std::uint32_t kOldestVersion = 1;
+
+enum SectionType : std::uint32_t {
+    KeyframeSection = 1,
+    FrameTimeSection = 2,
+};
+
+struct Header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t sectionCount;
+    std::uint64_t sourceSize;
+    std::int64_t sourceMtimeNs;
+    std::uint64_t packetCount;
+    std::int32_t streamIndex;
+    std::int32_t timeBaseNum;
+    std::int32_t timeBaseDen;
+    std::uint32_t reserved;
+};
+
+struct Section
+{
+    std::uint32_t type;
+    std::uint32_t reserved;
+    std::uint64_t offset;
+    std::uint64_t count;
+};
+
+// Followed, unless step > 0, by the anchors (int64) and then one uint32
+// offset per frame.
+struct FrameTimeHeader
+{
+    std::uint64_t count;
+    std::int64_t first;
+    std::int64_t step; // > 0 for constant-rate streams
+    std::uint32_t interval;
+    std::uint32_t reserved;
+};
+
+struct EncodedFrameTimes
+{
+    FrameTimeHeader header{};
+    std::vector<std::int64_t> anchors;
+    std::vector<std::uint32_t> offsets;
+
+    std::uint64_t bytes() const
+    {
+        return sizeof(header) + anchors.size() * sizeof(std::int64_t)
+               + offsets.size() * sizeof(std::uint32_t);
+    }
+};
+
+EncodedFrameTimes encodeFrameTimes(const std::vector<std::int64_t> &pts)
+{
+    EncodedFrameTimes encoded;
+    encoded.header.count = pts.size();
+    encoded.header.interval = FrameTimes::kAnchorInterval;
+    if (pts.empty())
+        return encoded;
+    encoded.header.first = pts.front();
+
+    const std::int64_t step = pts.size() > 1 ? pts[1] - pts[0] : 1;
+    bool constant = step > 0;
+    for (std::size_t i = 1; constant && i < pts.size(); ++i)
+        constant = pts[i] - pts[i - 1] == step;
+    if (constant) {
+        encoded.header.step = step;
+        return encoded;
+    }
+
+    // Gaps too large for 32-bit offsets fall back to an anchor per frame.
+    for (std::uint32_t interval : {FrameTimes::kAnchorInterval, 1u}) {
+        encoded.header.interval = interval;
+        encoded.anchors.clear();
+        encoded.offsets.clear();
+        bool fits = true;
+        for (std::size_t i = 0; fits && i < pts.size(); ++i) {
+            if (i % interval == 0)
+                encoded.anchors.push_back(pts[i]);
+            const std::int64_t offset = pts[i] - encoded.anchors.back();
+            fits = offset <= std::numeric_limits<std::uint32_t>::max();
+            encoded.offsets.push_back(static_cast<std::uint32_t>(offset));
+        }
+        if (fits)
+            break;
+    }
+    return encoded;
+}
+
+} // namespace
+
+std::size_t FrameTimes::frameAt(std::int64_t timestamp) const
+{
+    if (m_step > 0) {
+        if (timestamp <= m_first)
+            return 0;
+        return std::min<std::size_t>(m_count - 1, std::size_t((timestamp - m_first) / m_step));
+    }
+    const std::int64_t first = pts(0);
+    const std::int64_t last = pts(m_count - 1);
+    if (timestamp <= first)
+        return 0;
+    if (timestamp >= last)
+        return m_count - 1;
+
+    // Variable rates stay close to their average; start from there.
+    auto frame = static_cast<std::size_t>(static_cast<long double>(timestamp - first)
+                                          * static_cast<long double>(m_count - 1)
+                                          / static_cast<long double>(last - first));
+    frame = std::min(frame, m_count - 1);
+    for (int step = 0; step < 8; ++step) {
+        if (pts(frame) > timestamp)
+            --frame;
+        else if (pts(frame + 1) <= timestamp)
+            ++frame;
+        else
+            return frame;
+    }
+    const auto frames = std::views::iota(std::size_t(0), m_count);
+    const auto it = std::ranges::upper_bound(frames, timestamp, {},
+                                             [this](std::size_t i) { return pts(i); });
+    return *std::ranges::prev(it);
+}
+
+std::optional<MediaIdentity> MediaIdentity::of(const std::string &path)
+{
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0)
+        return std::nullopt;
+    return MediaIdentity{static_cast<std::uint64_t>(info.st_size),
+                         std::int64_t(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec};
+}
+
+std::string KeyframeIndex::sidecarPath(const std::string &cacheDir, const std::string &mediaPath)
+{
+    std::error_code error;
+    auto absolute = std::filesystem::absolute(mediaPath, error);
+    const std::string key = error ? mediaPath : absolute.lexically_normal().string();
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016zx.kfi", std::hash<std::string>{}(key));
+    return (std::filesystem::path(cacheDir) / name).string();
+}
+
+std::optional<KeyframeIndex> KeyframeIndex::open(const std::string &sidecarPath,
+                                                 const std::string &mediaPath)
+{
+    KeyframeIndex index;
+    if (!index.m_file.open(sidecarPath) || index.m_file.size() < sizeof(Header))
+        return std::nullopt;
+    const std::uint8_t *base = index.m_file.data();
+    const std::size_t size = index.m_file.size();
+
+    Header header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) || header.version < kOldestVersion
+        || header.version > kVersion)
+        return std::nullopt;
+    const auto identity = MediaIdentity::of(mediaPath);
+    if (!identity || *identity != MediaIdentity{header.sourceSize, header.sourceMtimeNs})
+        return std::nullopt;
+    if (sizeof(Header) + std::uint64_t(header.sectionCount) * sizeof(Section) > size)
+        return std::nullopt;
+
+    for (std::uint32_t i = 0; i < header.sectionCount; ++i) {
+        Section section;
+        std::memcpy(&section, base + sizeof(Header) + i * sizeof(Section), sizeof(section));
+        if (section.type == FrameTimeSection) {
+            if (!index.readFrameTimes(section.offset, section.count))
+                return std::nullopt;
+            continue;
+        }
+        if (section.type != KeyframeSection)
+            continue;
+        if (section.offset % alignof(KeyframeEntry)
+            || section.count > (size - std::min<std::uint64_t>(section.offset, size))
+                                   / sizeof(KeyframeEntry))
+            return std::nullopt;
+        index.m_keyframes = {reinterpret_cast<const KeyframeEntry *>(base + section.offset),
+                             static_cast<std::size_t>(section.count)};
+    }
+    index.m_streamIndex = header.streamIndex;
+    index.m_timeBaseNum = header.timeBaseNum;
+    index.m_timeBaseDen = header.timeBaseDen;
+    index.m_packetCount = header.packetCount;
+    return index;
+}
+
+bool KeyframeIndex::write(const std::string &sidecarPath, const KeyframeIndexData &data)
+{
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.sectionCount = 2;
+    header.sourceSize = data.source.size;
+    header.sourceMtimeNs = data.source.mtimeNs;
+    header.packetCount = data.packetCount;
+    header.streamIndex = data.streamIndex;
+    header.timeBaseNum = data.timeBaseNum;
+    header.timeBaseDen = data.timeBaseDen;
+    const Section keyframes{KeyframeSection, 0, sizeof(Header) + 2 * sizeof(Section),
+                            data.keyframes.size()};
+    const EncodedFrameTimes frameTimes = encodeFrameTimes(data.framePts);
+    const Section frameTimeSection{FrameTimeSection, 0,
+                                   keyframes.offset
+                                       + data.keyframes.size() * sizeof(KeyframeEntry),
+                                   data.framePts.size()};
+
+    const std::string temporary = sidecarPath + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(&keyframes), sizeof(keyframes));
+        out.write(reinterpret_cast<const char *>(&frameTimeSection), sizeof(frameTimeSection));
+        out.write(reinterpret_cast<const char *>(data.keyframes.data()),
+                  std::streamsize(data.keyframes.size() * sizeof(KeyframeEntry)));
+        out.write(reinterpret_cast<const char *>(&frameTimes.header), sizeof(frameTimes.header));
+        out.write(reinterpret_cast<const char *>(frameTimes.anchors.data()),
+                  std::streamsize(frameTimes.anchors.size() * sizeof(std::int64_t)));
+        out.write(reinterpret_cast<const char *>(frameTimes.offsets.data()),
+                  std::streamsize(frameTimes.offsets.size() * sizeof(std::uint32_t)));
+        out.close();
+        if (out) {
+            std::error_code error;
+            std::filesystem::rename(temporary, sidecarPath, error);
+            if (!error)
+                return true;
+        }
+    }
+    // A short write (full disk) must not leave a partial sidecar behind.
+    std::error_code error;
+    std::filesystem::remove(temporary, error);
+    return false;
+}
+
+std::optional<KeyframeIndexData> KeyframeIndex::build(const std::string &mediaPath,
+                                                      std::stop_token stop)
+{
+    const auto identity = MediaIdentity::of(mediaPath);
+    if (!identity)
+        throw MediaError("cannot stat " + mediaPath);
+    // Indexing is background work; it reads the whole file.
+    Demuxer demuxer(mediaPath, DemuxerIO::Scheduled, IoPriority::Background);
+    const int streamIndex = demuxer.bestVideoStream();
+    if (streamIndex < 0)
+        throw MediaError("no video stream in " + mediaPath);
+    demuxer.selectStream(streamIndex);
+
+    const AVStream *stream = demuxer.stream(streamIndex);
+    KeyframeIndexBuilder builder(streamIndex, stream->time_base.num, stream->time_base.den);
+    AVPacketPtr packet(av_packet_alloc());
+    while (demuxer.readPacket(packet.get())) {
+        if (stop.stop_requested())
+            return std::nullopt;
+        builder.add(*packet);
+        av_packet_unref(packet.get());
+    }
+    return builder.data(*identity);
+}
+
+KeyframeIndexBuilder::KeyframeIndexBuilder(int streamIndex, int timeBaseNum, int timeBaseDen)
+{
+    m_data.streamIndex = streamIndex;
+    m_data.timeBaseNum = timeBaseNum;
+    m_data.timeBaseDen = timeBaseDen;
+}
+
+void KeyframeIndexBuilder::add(const AVPacket &packet)
+{
+    if (packet.stream_index != m_data.streamIndex)
+        return;
+    const std::int64_t pts = packet.pts != AV_NOPTS_VALUE ? packet.pts : packet.dts;
+    if (packet.flags & AV_PKT_FLAG_KEY) {
+        if (!m_data.keyframes.empty())
+            m_data.keyframes.back().gopLength = m_packetsInGop;
+        m_packetsInGop = 0;
+        KeyframeEntry entry;
+        entry.dts = packet.dts;
+        entry.pts = pts;
+        entry.pos = packet.pos;
+        m_data.keyframes.push_back(entry);
+    }
+    ++m_packetsInGop;
+    ++m_data.packetCount;
+    if (pts != AV_NOPTS_VALUE && !(packet.flags & AV_PKT_FLAG_DISCARD)) {
+        m_data.framePts.push_back(pts);
+        m_endPts = std::max(m_endPts, pts + std::max<std::int64_t>(packet.duration, 0));
+    }
+}
+
+KeyframeIndexData KeyframeIndexBuilder::data(const MediaIdentity &source) const
+{
+    KeyframeIndexData data = m_data;
+    data.source = source;
+    if (!data.keyframes.empty())
+        data.keyframes.back().gopLength = m_packetsInGop;
+
+    // Keyframes arrive in decode order; open GOPs can reorder their pts.
+    std::stable_sort(data.keyframes.begin(), data.keyframes.end(),
+                     [](const KeyframeEntry &a, const KeyframeEntry &b) { return a.pts < b.pts; });
+    // Packets arrive in decode order too.
+    std::sort(data.framePts.begin(), data.framePts.end());
+    data.framePts.erase(std::unique(data.framePts.begin(), data.framePts.end()),
+                        data.framePts.end());
+    return data;
+}
+
+bool KeyframeIndex::readFrameTimes(std::uint64_t offset, std::uint64_t count)
+{
+    const std::uint8_t *base = m_file.data();
+    const std::size_t size = m_file.size();
+    if (offset % alignof(std::int64_t) || offset > size || size - offset < sizeof(FrameTimeHeader))
+        return false;
+    FrameTimeHeader header;
+    std::memcpy(&header, base + offset, sizeof(header));
+    if (header.count != count)
+        return false;
+
+    FrameTimes &times = m_frameTimes;
+    times.m_count = static_cast<std::size_t>(count);
+    times.m_first = header.first;
+    times.m_step = header.step;
+    times.m_interval = header.interval;
+    if (header.step <= 0 && count > 0) {
+        const std::uint64_t available = size - offset - sizeof(FrameTimeHeader);
+        if (header.interval == 0 || count > available / sizeof(std::uint32_t))
+            return false;
+        const std::uint64_t anchors = (count + header.interval - 1) / header.interval;
+        if (anchors * sizeof(std::int64_t) + count * sizeof(std::uint32_t) > available)
+            return false;
+        const std::uint8_t *data = base + offset + sizeof(FrameTimeHeader);
+        times.m_anchors = {reinterpret_cast<const std::int64_t *>(data),
+                           static_cast<std::size_t>(anchors)};
+        times.m_offsets = {reinterpret_cast<const std::uint32_t *>(
+                               data + anchors * sizeof(std::int64_t)),
+                           static_cast<std::size_t>(count)};
+    }
+    m_hasFrameTimes = true;
+    return true;
+}
+
+std::size_t KeyframeIndex::sourceFrameFor(std::int64_t timelineFrame, int rateNum,
+                                          int rateDen) const
+{
+    if (m_frameTimes.size() == 0)
+        return 0;
+    const std::int64_t offset = av_rescale_q(timelineFrame, AVRational{rateDen, rateNum},
+                                             AVRational{m_timeBaseNum, m_timeBaseDen});
+    return m_frameTimes.frameAt(m_frameTimes.pts(0) + offset);
+}
+
+const KeyframeEntry *KeyframeIndex::keyframeFor(std::int64_t pts) const
+{
+    if (m_keyframes.empty())
+        return nullptr;
+    auto it = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), pts,
+                               [](std::int64_t value, const KeyframeEntry &entry) {
+                                   return value < entry.pts;
+                               });
+    return it == m_keyframes.begin() ? &m_keyframes.front() : &*std::prev(it);
+}
+
+const KeyframeEntry *KeyframeIndex::nextKeyframe(const KeyframeEntry *entry) const
+{
+    if (!entry || entry + 1 >= m_keyframes.data() + m_keyframes.size())
+        return nullptr;
+    return entry + 1;
+}
+
+KeyframeIndexer::KeyframeIndexer(std::string cacheDir, Callback onFinished)
+    : m_cacheDir(std::move(cacheDir))
+    , m_onFinished(std::move(onFinished))
+    , m_thread([this](std::stop_token stop) { run(stop); })
+{}
+
+KeyframeIndexer::~KeyframeIndexer()
+{
+    m_thread.request_stop();
+}
+
+void KeyframeIndexer::enqueue(const std::string &mediaPath)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_queue.push_back(mediaPath);
+    }
+    m_wake.notify_one();
+}
+
+std::size_t KeyframeIndexer::pending() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_queue.size();
+}
+
+std::exception_ptr KeyframeIndexer::lastError() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_lastError;
+}
+
+void KeyframeIndexer::run(std::stop_token stop)
+{
+    for (;;) {
+        std::string mediaPath;
+        {
+            std::unique_lock lock(m_mutex);
+            if (!m_wake.wait(lock, stop, [this] { return !m_queue.empty(); }))
+                return;
+            mediaPath = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        const std::string sidecar = KeyframeIndex::sidecarPath(m_cacheDir, mediaPath);
+        const auto existing = KeyframeIndex::open(sidecar, mediaPath);
+        bool ok = existing && existing->frameTimes();
+        if (!ok) {
+            try {
+                auto data = KeyframeIndex::build(mediaPath, stop);
+                if (!data)
+                    return;
+                ok = KeyframeIndex::write(sidecar, *data);
+            } catch (...) {
+                // Anything escaping here would end the thread, and with it
+                // the process.
+                ok = false;
+                std::lock_guard lock(m_mutex);
+                m_lastError = std::current_exception();
+            }
+        }
+        if (m_onFinished)
+            m_onFinished(mediaPath, ok);
+    }
+}
+
+} // namespace scp
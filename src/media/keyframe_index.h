@@ -0,0 +1,221 @@
+#pragma once
+
+// Persistent per-media index of keyframes for frame-accurate seeking.
+//
+// The index is built once by demuxing the video stream (no decoding) and
+// stored as a sidecar file: a fixed header, a section table and the raw
+// entry arrays. Besides the keyframes it records the presentation time of
+// every displayed frame (FrameTimes), so variable frame rate footage
+// resolves frame N and the frame shown at a time without scanning packets.
+// Readers map the file and binary search it in place, so opening an index
+// costs one mmap regardless of media length. The header records the source
+// size and mtime; a sidecar that no longer matches its media is treated as
+// missing.
+//
+// Sidecars use the host byte order and are a cache, not an interchange
+// format.
+
+#include "core/mapped_file.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct AVPacket;
+
+namespace scp {
+
+struct KeyframeEntry
+{
+    std::int64_t pts = 0;      // presentation time, stream time base
+    std::int64_t dts = 0;      // decode time, stream time base
+    std::int64_t pos = -1;     // byte offset of the packet, -1 if unknown
+    std::uint32_t gopLength = 0; // packets from this keyframe to the next
+    std::uint32_t reserved = 0;
+};
+static_assert(sizeof(KeyframeEntry) == 32);
+
+struct MediaIdentity
+{
+    std::uint64_t size = 0;
+    std::int64_t mtimeNs = 0;
+
+    static std::optional<MediaIdentity> of(const std::string &path);
+    bool operator==(const MediaIdentity &) const = default;
+};
+
+// Presentation timestamps of every frame of a stream, in display order.
+// Constant-rate streams are stored as a start and a step. Other streams
+// store an absolute anchor every kAnchorInterval frames and a 32-bit offset
+// from it per frame, about 4 bytes per frame.
+class FrameTimes
+{
+public:
+    static constexpr std::uint32_t kAnchorInterval = 64;
+
+    std::size_t size() const { return m_count; }
+    bool isConstantRate() const { return m_step > 0; }
+
+    // pts of frame, which must be < size(). O(1).
+    std::int64_t pts(std::size_t frame) const
+    {
+        if (m_step > 0)
+            return m_first + std::int64_t(frame) * m_step;
+        return m_anchors[frame / m_interval] + m_offsets[frame];
+    }
+
+    // The frame displayed at timestamp: the last one starting at or before
+    // it, or 0 when timestamp precedes the stream. Requires size() > 0. O(1) for
+    // constant-rate streams; for variable rates a guess from the average
+    // rate is corrected in a few steps.
+    std::size_t frameAt(std::int64_t timestamp) const;
+
+private:
+    friend class KeyframeIndex;
+
+    std::size_t m_count = 0;
+    std::int64_t m_first = 0;
+    std::int64_t m_step = 0;
+    std::uint32_t m_interval = kAnchorInterval;
+    std::span<const std::int64_t> m_anchors;
+    std::span<const std::uint32_t> m_offsets;
+};
+
+struct KeyframeIndexData
+{
+    MediaIdentity source;
+    int streamIndex = -1;
+    int timeBaseNum = 0;
+    int timeBaseDen = 1;
+    std::uint64_t packetCount = 0;
+    std::vector<KeyframeEntry> keyframes; // sorted by pts
+    std::vector<std::int64_t> framePts;   // every frame, sorted
+};
+
+// Collects KeyframeIndexData from one stream's packets in decode order.
+// KeyframeIndex::build() feeds it a whole file; followers of growing files
+// feed it as packets are written.
+class KeyframeIndexBuilder
+{
+public:
+    KeyframeIndexBuilder(int streamIndex, int timeBaseNum, int timeBaseDen);
+
+    // Packets of other streams are ignored. Packets flagged for discarding
+    // (decoded but not shown, e.g. before an edit list's start) still
+    // count for keyframes and GOPs but get no frame time.
+    void add(const AVPacket &packet);
+
+    std::uint64_t packetCount() const { return m_data.packetCount; }
+    std::size_t keyframeCount() const { return m_data.keyframes.size(); }
+    // End of the latest frame in presentation order, 0 before any frame.
+    std::int64_t endPts() const { return m_endPts; }
+
+    // The index so far, sorted.
+    KeyframeIndexData data(const MediaIdentity &source) const;
+
+private:
+    KeyframeIndexData m_data;
+    std::uint32_t m_packetsInGop = 0;
+    std::int64_t m_endPts = 0;
+};
+
+class KeyframeIndex
+{
+public:
+    // Maps a sidecar. Returns nullopt when it is missing, malformed or stale
+    // with respect to mediaPath.
+    static std::optional<KeyframeIndex> open(const std::string &sidecarPath,
+                                             const std::string &mediaPath);
+
+    // Demuxes mediaPath's best video stream and collects its keyframes.
+    // Returns nullopt if stop is requested. Throws MediaError.
+    static std::optional<KeyframeIndexData> build(const std::string &mediaPath,
+                                                  std::stop_token stop = {});
+
+    // Writes data atomically (temporary file + rename). On failure the
+    // temporary file is removed and any previous sidecar is left as it was.
+    static bool write(const std::string &sidecarPath, const KeyframeIndexData &data);
+
+    // Sidecar name for mediaPath inside cacheDir.
+    static std::string sidecarPath(const std::string &cacheDir, const std::string &mediaPath);
+
+    int streamIndex() const { return m_streamIndex; }
+    int timeBaseNum() const { return m_timeBaseNum; }
+    int timeBaseDen() const { return m_timeBaseDen; }
+    std::uint64_t packetCount() const { return m_packetCount; }
+    std::span<const KeyframeEntry> keyframes() const { return m_keyframes; }
+
+    // Last keyframe whose pts is <= pts, or the first keyframe when pts
+    // precedes all of them. Null for an empty index. Seeking the demuxer to
+    // the entry's pts and decoding forward reaches pts with the fewest
+    // decoded frames.
+    const KeyframeEntry *keyframeFor(std::int64_t pts) const;
+
+    // Keyframe that starts the GOP after entry, or null for the last GOP.
+    const KeyframeEntry *nextKeyframe(const KeyframeEntry *entry) const;
+
+    // Null for sidecars written before frame times were recorded.
+    const FrameTimes *frameTimes() const { return m_hasFrameTimes ? &m_frameTimes : nullptr; }
+
+    // The source frame a timeline running at rateNum/rateDen frames per
+    // second shows at timelineFrame, counting from the stream's first frame.
+    // Requires frame times.
+    std::size_t sourceFrameFor(std::int64_t timelineFrame, int rateNum, int rateDen) const;
+
+private:
+    KeyframeIndex() = default;
+
+    bool readFrameTimes(std::uint64_t offset, std::uint64_t count);
+
+    MappedFile m_file;
+    int m_streamIndex = -1;
+    int m_timeBaseNum = 0;
+    int m_timeBaseDen = 1;
+    std::uint64_t m_packetCount = 0;
+    std::span<const KeyframeEntry> m_keyframes;
+    FrameTimes m_frameTimes;
+    bool m_hasFrameTimes = false;
+};
+
+// Builds missing or stale sidecars on a background thread. MediaImporter
+// enqueues every video file it imports; consumers are told when an index is
+// ready, and VideoDecoders opened from then on with DecoderOptions::indexDir
+// seek through it.
+class KeyframeIndexer
+{
+public:
+    using Callback = std::function<void(const std::string &mediaPath, bool ok)>;
+
+    explicit KeyframeIndexer(std::string cacheDir, Callback onFinished = {});
+    ~KeyframeIndexer();
+
+    void enqueue(const std::string &mediaPath);
+    std::size_t pending() const;
+
+    // What made the most recent failed build fail, or null. The callback
+    // only reports ok = false.
+    std::exception_ptr lastError() const;
+
+private:
+    void run(std::stop_token stop);
+
+    const std::string m_cacheDir;
+    const Callback m_onFinished;
+    mutable std::mutex m_mutex;
+    std::condition_variable_any m_wake;
+    std::deque<std::string> m_queue;
+    std::exception_ptr m_lastError;
+    std::jthread m_thread;
+};
+
+} // namespace scp
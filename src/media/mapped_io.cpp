@@ -0,0 +1,198 @@
+#include "media/mapped_io.h"
+
+extern "C" {
+#include <libavformat/avio.h>
+#include <libavutil/mem.h>
+}
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace scp {
+
+namespace {
+
+// AVIO refill size; the copy comes straight from the mapping.
+constexpr int kBufferSize = 256 * 1024;
+// Readahead requested ahead of sequential reads, and kept resident behind
+// them for the short backward seeks demuxers make.
+constexpr std::uint64_t kSequentialWindow = 16u << 20;
+// Around a random seek target: the packet plus a few neighbours.
+constexpr std::uint64_t kRandomWindow = 1u << 20;
+// Before a backward seek: about one GOP of high-bitrate footage.
+constexpr std::uint64_t kReverseWindow = 32u << 20;
+// Contiguous reading that switches detection back to Sequential.
+constexpr std::uint64_t kSequentialThreshold = 4 * kSequentialWindow;
+// Backward seeks further than this are jumps, not reverse playback.
+constexpr std::uint64_t kReverseMaxStep = 256u << 20;
+
+} // namespace
+
+const char *accessPatternName(AccessPattern pattern)
+{
+    switch (pattern) {
+    case AccessPattern::Auto:
+        return "auto";
+    case AccessPattern::Sequential:
+        return "sequential";
+    case AccessPattern::Random:
+        return "random";
+    case AccessPattern::Reverse:
+        return "reverse";
+    }
+    return "unknown";
+}
+
+std::unique_ptr<MappedIO> MappedIO::open(const std::string &path)
+{
+    std::unique_ptr<MappedIO> io(new MappedIO);
+    if (!io->m_file.open(path))
+        return nullptr;
+    auto *buffer = static_cast<unsigned char *>(av_malloc(kBufferSize));
+    if (!buffer)
+        return nullptr;
+    io->m_context = avio_alloc_context(buffer, kBufferSize, 0, io.get(), &MappedIO::readPacket,
+                                       nullptr, &MappedIO::seek);
+    if (!io->m_context) {
+        av_free(buffer);
+        return nullptr;
+    }
+    io->m_context->seekable = AVIO_SEEKABLE_NORMAL;
+    // Demuxers open by reading the header sequentially.
+    io->m_file.advise(0, io->m_file.size(), MappedFile::Advice::Sequential);
+    return io;
+}
+
+MappedIO::~MappedIO()
+{
+    if (m_context) {
+        // The context may have swapped in a buffer of its own.
+        av_freep(&m_context->buffer);
+        avio_context_free(&m_context);
+    }
+}
+
+int MappedIO::readPacket(void *opaque, std::uint8_t *buffer, int size)
+{
+    auto *io = static_cast<MappedIO *>(opaque);
+    const std::uint64_t total = io->m_file.size();
+    if (io->m_position >= total)
+        return AVERROR_EOF;
+    const std::size_t bytes = static_cast<std::size_t>(
+        std::min<std::uint64_t>(std::uint64_t(size), total - io->m_position));
+    io->onRead(io->m_position, bytes);
+    std::memcpy(buffer, io->m_file.data() + io->m_position, bytes);
+    io->m_position += bytes;
+    return static_cast<int>(bytes);
+}
+
+std::int64_t MappedIO::seek(void *opaque, std::int64_t offset, int whence)
+{
+    auto *io = static_cast<MappedIO *>(opaque);
+    const auto total = static_cast<std::int64_t>(io->m_file.size());
+    std::int64_t target;
+    switch (whence & ~AVSEEK_FORCE) {
+    case AVSEEK_SIZE:
+        return total;
+    case SEEK_SET:
+        target = offset;
+        break;
+    case SEEK_CUR:
+        target = std::int64_t(io->m_position) + offset;
+        break;
+    case SEEK_END:
+        target = total + offset;
+        break;
+    default:
+        return AVERROR(EINVAL);
+    }
+    if (target < 0)
+        return AVERROR(EINVAL);
+    io->onSeek(std::uint64_t(target));
+    io->m_position = std::uint64_t(target);
+    return target;
+}
+
+void MappedIO::setAccessPattern(AccessPattern pattern)
+{
+    m_requested = pattern;
+    m_sequentialBytes = 0;
+    m_backwardSeeks = 0;
+    if (pattern != AccessPattern::Auto)
+        apply(pattern);
+}
+
+void MappedIO::onSeek(std::uint64_t target)
+{
+    if (target == m_position)
+        return;
+
+    if (m_requested == AccessPattern::Auto) {
+        if (target < m_position) {
+            // Reverse playback seeks back a GOP at a time, reads forward up
+            // to where it was, and seeks back again.
+            m_backwardSeeks = m_position - target <= kReverseMaxStep ? m_backwardSeeks + 1 : 0;
+            apply(m_backwardSeeks >= 2 ? AccessPattern::Reverse : AccessPattern::Random);
+        } else if (target - m_position > kSequentialWindow) {
+            // Small forward skips are a sequential demuxer stepping over
+            // another stream's data; large ones are jumps.
+            m_backwardSeeks = 0;
+            apply(AccessPattern::Random);
+        }
+        m_sequentialBytes = 0;
+    }
+
+    switch (m_applied) {
+    case AccessPattern::Random:
+        m_file.advise(target, kRandomWindow, MappedFile::Advice::WillNeed);
+        break;
+    case AccessPattern::Reverse:
+        // This GOP, and the one the player will ask for after it.
+        m_file.advise(target, kRandomWindow, MappedFile::Advice::WillNeed);
+        m_file.advise(target > kReverseWindow ? target - kReverseWindow : 0,
+                      std::min(target, kReverseWindow), MappedFile::Advice::WillNeed);
+        break;
+    default:
+        m_prefetchedEnd = m_coldEnd = target;
+        break;
+    }
+}
+
+void MappedIO::onRead(std::uint64_t offset, std::size_t bytes)
+{
+    if (m_requested == AccessPattern::Auto && m_applied != AccessPattern::Sequential) {
+        m_sequentialBytes += bytes;
+        if (m_sequentialBytes >= kSequentialThreshold) {
+            m_backwardSeeks = 0;
+            apply(AccessPattern::Sequential);
+            m_prefetchedEnd = m_coldEnd = offset;
+        }
+    }
+    if (m_applied != AccessPattern::Sequential)
+        return;
+
+    const std::uint64_t end = offset + bytes;
+    if (end + kSequentialWindow / 2 > m_prefetchedEnd) {
+        const std::uint64_t from = std::max(m_prefetchedEnd, offset);
+        m_file.advise(from, end + kSequentialWindow - from, MappedFile::Advice::WillNeed);
+        m_prefetchedEnd = end + kSequentialWindow;
+    }
+    if (offset > m_coldEnd + 2 * kSequentialWindow) {
+        const std::uint64_t coldEnd = offset - kSequentialWindow;
+        m_file.advise(m_coldEnd, coldEnd - m_coldEnd, MappedFile::Advice::Cold);
+        m_coldEnd = coldEnd;
+    }
+}
+
+void MappedIO::apply(AccessPattern pattern)
+{
+    if (pattern == m_applied)
+        return;
+    m_applied = pattern;
+    m_file.advise(0, m_file.size(), pattern == AccessPattern::Sequential
+                                        ? MappedFile::Advice::Sequential
+                                        : MappedFile::Advice::Random);
+}
+
+} // namespace scp
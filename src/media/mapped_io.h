@@ -0,0 +1,83 @@
+#pragma once
+
+// AVIOContext that reads local media through a memory mapping.
+//
+// Reads are a memcpy from the mapping instead of a read() syscall per
+// buffer refill, and paging is steered with madvise according to how the
+// demuxer moves through the file:
+//
+//   Sequential  kernel readahead on, a window ahead of the read position
+//               requested explicitly, consumed ranges marked cold so a 100 GB
+//               camera file does not push everything else out of the page
+//               cache.
+//   Random      kernel readahead off (it would read megabytes per seek),
+//               a small window requested around each seek target.
+//   Reverse     readahead off, and the window *before* each backward seek
+//               requested, since that is where the reverse player goes next.
+//
+// The pattern is detected from the seeks and reads the demuxer issues, or
+// pinned by the player, which knows better (setAccessPattern()).
+
+#include "core/mapped_file.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct AVIOContext;
+
+namespace scp {
+
+enum class AccessPattern {
+    Auto, // detect from the demuxer's behaviour
+    Sequential,
+    Random,
+    Reverse,
+};
+
+const char *accessPatternName(AccessPattern pattern);
+
+class MappedIO
+{
+public:
+    // Maps path. Returns null if it cannot be opened or mapped, in which
+    // case callers use FFmpeg's own file protocol.
+    static std::unique_ptr<MappedIO> open(const std::string &path);
+    ~MappedIO();
+
+    MappedIO(const MappedIO &) = delete;
+    MappedIO &operator=(const MappedIO &) = delete;
+
+    AVIOContext *context() const { return m_context; }
+    std::uint64_t size() const { return m_file.size(); }
+
+    // Pins the pattern, or returns to detection with Auto.
+    void setAccessPattern(AccessPattern pattern);
+    // The pattern currently applied (never Auto).
+    AccessPattern accessPattern() const { return m_applied; }
+
+private:
+    MappedIO() = default;
+
+    static int readPacket(void *opaque, std::uint8_t *buffer, int size);
+    static std::int64_t seek(void *opaque, std::int64_t offset, int whence);
+
+    void onSeek(std::uint64_t target);
+    void onRead(std::uint64_t offset, std::size_t bytes);
+    void apply(AccessPattern pattern);
+
+    MappedFile m_file;
+    AVIOContext *m_context = nullptr;
+    std::uint64_t m_position = 0;
+
+    AccessPattern m_requested = AccessPattern::Auto;
+    AccessPattern m_applied = AccessPattern::Sequential;
+    // Detection state.
+    std::uint64_t m_sequentialBytes = 0;
+    int m_backwardSeeks = 0;
+    // Readahead bookkeeping for the sequential pattern.
+    std::uint64_t m_prefetchedEnd = 0;
+    std::uint64_t m_coldEnd = 0;
+};
+
+} // namespace scp
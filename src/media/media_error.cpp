@@ -0,0 +1,17 @@
+#include "media/media_error.h"
+
+extern "C" {
+#include <libavutil/error.h>
+}
+
+namespace scp {
+
+std::string MediaError::avErrorString(int averror)
+{
+    char buffer[AV_ERROR_MAX_STRING_SIZE] = {};
+    if (av_strerror(averror, buffer, sizeof(buffer)) < 0)
+        return "error " + std::to_string(averror);
+    return buffer;
+}
+
+} // namespace scp
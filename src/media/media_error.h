@@ -0,0 +1,28 @@
+#pragma once
+
+// Error type thrown by the FFmpeg wrapper when media cannot be opened or
+// read. Conditions that are expected in normal operation (end of stream, a
+// missing or stale cache file) are reported through return values instead.
+
+#include <stdexcept>
+#include <string>
+
+namespace scp {
+
+class MediaError : public std::runtime_error
+{
+public:
+    MediaError(const std::string &what, int averror = 0)
+        : std::runtime_error(averror ? what + ": " + avErrorString(averror) : what)
+        , m_averror(averror)
+    {}
+
+    int averror() const { return m_averror; }
+
+    static std::string avErrorString(int averror);
+
+private:
+    int m_averror;
+};
+
+} // namespace scp
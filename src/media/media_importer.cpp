@@ -0,0 +1,186 @@
+#include "media/media_importer.h"
+
+#include "media/keyframe_index.h"
+#include "media/media_error.h"
+#include "media/probe_cache.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+
+namespace scp {
+
+namespace {
+
+unsigned resolveThreads(unsigned threads)
+{
+    return threads ? threads : std::clamp(2 * std::thread::hardware_concurrency(), 4u, 16u);
+}
+
+} // namespace
+
+MediaImporter::MediaImporter(ProbeCache *cache, KeyframeIndexer *indexer,
+                             ResultCallback onResult, unsigned threads, unsigned perDeviceLimit)
+    : m_cache(cache)
+    , m_indexer(indexer)
+    , m_onResult(std::move(onResult))
+    , m_perDeviceLimit(perDeviceLimit ? perDeviceLimit
+                                      : std::max(1u, resolveThreads(threads) / 2))
+{
+    const unsigned count = resolveThreads(threads);
+    m_threads.reserve(count);
+    for (unsigned i = 0; i < count; ++i)
+        m_threads.emplace_back([this](std::stop_token stop) { run(stop); });
+}
+
+MediaImporter::~MediaImporter()
+{
+    cancel();
+    for (std::jthread &thread : m_threads)
+        thread.request_stop();
+}
+
+void MediaImporter::enqueue(const std::vector<std::string> &paths)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_queue.insert(m_queue.end(), paths.begin(), paths.end());
+        m_stats.pending += paths.size();
+    }
+    m_wake.notify_all();
+}
+
+void MediaImporter::cancel()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        std::size_t dropped = m_queue.size();
+        for (const auto &[device, jobs] : m_deferred)
+            dropped += jobs.size();
+        m_queue.clear();
+        m_deferred.clear();
+        m_stats.pending -= dropped;
+    }
+    m_idle.notify_all();
+}
+
+void MediaImporter::waitForIdle()
+{
+    std::unique_lock lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_stats.pending == 0; });
+}
+
+ImportStats MediaImporter::stats() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_stats;
+}
+
+bool MediaImporter::takeDeferredLocked(Deferred &job)
+{
+    for (auto it = m_deferred.begin(); it != m_deferred.end(); ++it) {
+        const auto active = m_active.find(it->first);
+        if (active != m_active.end() && active->second >= m_perDeviceLimit)
+            continue;
+        job = std::move(it->second.front());
+        it->second.pop_front();
+        if (it->second.empty())
+            m_deferred.erase(it);
+        return true;
+    }
+    return false;
+}
+
+void MediaImporter::run(std::stop_token stop)
+{
+    for (;;) {
+        std::unique_lock lock(m_mutex);
+        Deferred deferred;
+        bool haveDeferred = false;
+        if (!m_wake.wait(lock, stop, [&] {
+                haveDeferred = takeDeferredLocked(deferred);
+                return haveDeferred || !m_queue.empty();
+            }))
+            return;
+
+        if (haveDeferred) {
+            ++m_active[deferred.device];
+            lock.unlock();
+            probe(deferred.path, deferred.identity, deferred.device);
+            continue;
+        }
+
+        std::string path = std::move(m_queue.front());
+        m_queue.pop_front();
+        lock.unlock();
+
+        struct stat info;
+        if (::stat(path.c_str(), &info) != 0) {
+            finish({path, std::nullopt, "cannot stat " + path, false});
+            continue;
+        }
+        const MediaIdentity identity{static_cast<std::uint64_t>(info.st_size),
+                                     std::int64_t(info.st_mtim.tv_sec) * 1000000000
+                                         + info.st_mtim.tv_nsec};
+        if (m_cache) {
+            if (std::optional<MediaInfo> cached = m_cache->find(path, identity)) {
+                finish({path, std::move(cached), {}, true});
+                continue;
+            }
+        }
+
+        lock.lock();
+        if (m_active[info.st_dev] >= m_perDeviceLimit) {
+            m_deferred[info.st_dev].push_back({std::move(path), identity, info.st_dev});
+            continue;
+        }
+        ++m_active[info.st_dev];
+        lock.unlock();
+        probe(path, identity, info.st_dev);
+    }
+}
+
+void MediaImporter::probe(const std::string &path, const MediaIdentity &identity, dev_t device)
+{
+    ImportResult result;
+    result.path = path;
+    try {
+        result.info = probeMedia(path);
+        // Probed from the version of the file the cache lookup saw, so a
+        // file replaced meanwhile is not cached under the old identity.
+        if (m_cache && result.info->identity == identity)
+            m_cache->store(*result.info);
+    } catch (const MediaError &e) {
+        result.error = e.what();
+    }
+    {
+        std::lock_guard lock(m_mutex);
+        if (--m_active[device] == 0)
+            m_active.erase(device);
+    }
+    // A device slot opened up for any deferred files.
+    m_wake.notify_all();
+    finish(result);
+}
+
+void MediaImporter::finish(const ImportResult &result)
+{
+    // Cached files too: their sidecar may have been evicted or gone stale.
+    if (m_indexer && result.info && result.info->bestVideoStream >= 0)
+        m_indexer->enqueue(result.path);
+    if (m_onResult)
+        m_onResult(result);
+    {
+        std::lock_guard lock(m_mutex);
+        if (!result.info)
+            ++m_stats.failed;
+        else if (result.cached)
+            ++m_stats.cached;
+        else
+            ++m_stats.probed;
+        --m_stats.pending;
+    }
+    m_idle.notify_all();
+}
+
+} // namespace scp
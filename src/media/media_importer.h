@@ -0,0 +1,107 @@
+#pragma once
+
+// Concurrent media probing for imports into the media bin.
+//
+// Probing is dominated by I/O latency (open, a few scattered reads, on
+// network mounts a round trip each), so the importer runs more probes than
+// there are cores, on its own threads rather than the shared compute pool.
+// Probes are also capped per filesystem: a slow NAS cannot tie up every
+// worker while files on a local disk wait. Files whose size and mtime match
+// a ProbeCache entry are answered without opening them. Every imported
+// file with video is handed to a KeyframeIndexer, which builds its seek
+// index in the background unless a current one exists.
+//
+// Results are delivered one by one as they finish, on importer threads; the
+// callback must be thread-safe (the bin queues them to the UI thread).
+
+#include "media/media_probe.h"
+
+#include <sys/types.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace scp {
+
+class KeyframeIndexer;
+class ProbeCache;
+
+struct ImportResult
+{
+    std::string path;
+    std::optional<MediaInfo> info; // empty when probing failed
+    std::string error;
+    bool cached = false;
+};
+
+struct ImportStats
+{
+    std::uint64_t probed = 0;
+    std::uint64_t cached = 0;
+    std::uint64_t failed = 0;
+    std::size_t pending = 0;
+};
+
+class MediaImporter
+{
+public:
+    using ResultCallback = std::function<void(const ImportResult &)>;
+
+    // cache and indexer may be null. 0 threads picks twice the core count
+    // clamped to [4, 16]; 0 perDeviceLimit allows half the threads on one
+    // filesystem.
+    MediaImporter(ProbeCache *cache, KeyframeIndexer *indexer, ResultCallback onResult,
+                  unsigned threads = 0, unsigned perDeviceLimit = 0);
+    // Drops queued files and waits for probes in progress.
+    ~MediaImporter();
+
+    MediaImporter(const MediaImporter &) = delete;
+    MediaImporter &operator=(const MediaImporter &) = delete;
+
+    void enqueue(const std::vector<std::string> &paths);
+    // Drops every file not being probed yet; they get no result.
+    void cancel();
+    // Blocks until every enqueued file has a result or was cancelled.
+    void waitForIdle();
+
+    ImportStats stats() const;
+
+private:
+    // A file that missed the cache and waits for a slot on its device.
+    struct Deferred
+    {
+        std::string path;
+        MediaIdentity identity;
+        dev_t device;
+    };
+
+    void run(std::stop_token stop);
+    bool takeDeferredLocked(Deferred &job);
+    void probe(const std::string &path, const MediaIdentity &identity, dev_t device);
+    void finish(const ImportResult &result);
+
+    ProbeCache *m_cache;
+    KeyframeIndexer *m_indexer;
+    const ResultCallback m_onResult;
+    const unsigned m_perDeviceLimit;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable_any m_wake;
+    std::condition_variable m_idle;
+    std::deque<std::string> m_queue;
+    std::map<dev_t, std::deque<Deferred>> m_deferred;
+    std::map<dev_t, unsigned> m_active;
+    ImportStats m_stats;
+    std::vector<std::jthread> m_threads;
+};
+
+} // namespace scp
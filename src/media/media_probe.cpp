@@ -0,0 +1,65 @@
+#include "media/media_probe.h"
+
+#include "media/demuxer.h"
+#include "media/media_error.h"
+
+namespace scp {
+
+MediaInfo probeMedia(const std::string &path)
+{
+    const auto identity = MediaIdentity::of(path);
+    if (!identity)
+        throw MediaError("cannot stat " + path);
+    Demuxer demuxer(path);
+    AVFormatContext *context = demuxer.context();
+
+    MediaInfo info;
+    info.path = path;
+    info.identity = *identity;
+    info.format = context->iformat ? context->iformat->name : "";
+    info.durationUs = context->duration != AV_NOPTS_VALUE ? context->duration : 0;
+    info.bitRate = context->bit_rate;
+    info.bestVideoStream = demuxer.bestVideoStream();
+    const int audio = av_find_best_stream(context, AVMEDIA_TYPE_AUDIO, -1, info.bestVideoStream,
+                                          nullptr, 0);
+    info.bestAudioStream = audio < 0 ? -1 : audio;
+
+    for (int i = 0; i < demuxer.streamCount(); ++i) {
+        const AVStream *stream = demuxer.stream(i);
+        const AVCodecParameters *codec = stream->codecpar;
+        StreamInfo out;
+        out.index = i;
+        out.type = codec->codec_type == AVMEDIA_TYPE_VIDEO   ? StreamType::Video
+                   : codec->codec_type == AVMEDIA_TYPE_AUDIO ? StreamType::Audio
+                                                             : StreamType::Other;
+        out.codec = avcodec_get_name(codec->codec_id);
+        out.timeBaseNum = stream->time_base.num;
+        out.timeBaseDen = stream->time_base.den;
+        out.startTime = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+        out.duration = stream->duration != AV_NOPTS_VALUE ? stream->duration : 0;
+        out.frameCount = stream->nb_frames;
+        out.bitRate = codec->bit_rate;
+        if (out.type == StreamType::Video) {
+            out.width = codec->width;
+            out.height = codec->height;
+            out.pixelFormat = codec->format;
+            const AVRational rate = stream->avg_frame_rate.num ? stream->avg_frame_rate
+                                                               : stream->r_frame_rate;
+            out.frameRateNum = rate.num;
+            out.frameRateDen = rate.den ? rate.den : 1;
+            out.sampleAspectNum = codec->sample_aspect_ratio.num;
+            out.sampleAspectDen = codec->sample_aspect_ratio.den ? codec->sample_aspect_ratio.den : 1;
+            out.colorRange = codec->color_range;
+            out.colorPrimaries = codec->color_primaries;
+            out.colorTransfer = codec->color_trc;
+            out.colorSpace = codec->color_space;
+        } else if (out.type == StreamType::Audio) {
+            out.sampleRate = codec->sample_rate;
+            out.channels = codec->ch_layout.nb_channels;
+        }
+        info.streams.push_back(std::move(out));
+    }
+    return info;
+}
+
+} // namespace scp
@@ -0,0 +1,68 @@
+#pragma once
+
+// What the media bin needs to know about a file before it can be used on
+// the timeline: container, duration and per-stream layout and color
+// metadata.
+
+#include "media/keyframe_index.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace scp {
+
+enum class StreamType : std::int32_t {
+    Other,
+    Video,
+    Audio,
+};
+
+struct StreamInfo
+{
+    std::int32_t index = 0;
+    StreamType type = StreamType::Other;
+    std::string codec;
+    std::int32_t timeBaseNum = 0;
+    std::int32_t timeBaseDen = 1;
+    std::int64_t startTime = 0;  // time base units; 0 when unknown
+    std::int64_t duration = 0;   // time base units; 0 when unknown
+    std::int64_t frameCount = 0; // 0 when the container does not say
+    std::int64_t bitRate = 0;
+
+    // Video
+    std::int32_t width = 0;
+    std::int32_t height = 0;
+    std::int32_t pixelFormat = -1; // AVPixelFormat
+    std::int32_t frameRateNum = 0;
+    std::int32_t frameRateDen = 1;
+    std::int32_t sampleAspectNum = 0;
+    std::int32_t sampleAspectDen = 1;
+    // AVColorRange / AVColorPrimaries / AVColorTransferCharacteristic /
+    // AVColorSpace values as reported by the container or bitstream.
+    std::int32_t colorRange = 0;
+    std::int32_t colorPrimaries = 2;
+    std::int32_t colorTransfer = 2;
+    std::int32_t colorSpace = 2;
+
+    // Audio
+    std::int32_t sampleRate = 0;
+    std::int32_t channels = 0;
+};
+
+struct MediaInfo
+{
+    std::string path;
+    MediaIdentity identity;
+    std::string format;
+    std::int64_t durationUs = 0;
+    std::int64_t bitRate = 0;
+    std::vector<StreamInfo> streams;
+    std::int32_t bestVideoStream = -1;
+    std::int32_t bestAudioStream = -1;
+};
+
+// Opens path and reads its stream parameters. Throws MediaError.
+MediaInfo probeMedia(const std::string &path);
+
+} // namespace scp
@@ -0,0 +1,234 @@
+#include "media/probe_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+namespace scp {
+
+namespace {
+
+constexpr char kMagic[8] = {'S', 'C', 'P', 'P', 'R', 'O', 'B', 'E'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::size_t kNameBytes = 32;
+
+struct Header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t streamCount;
+    std::uint64_t sourceSize;
+    std::int64_t sourceMtimeNs;
+    std::int64_t durationUs;
+    std::int64_t bitRate;
+    std::int32_t bestVideoStream;
+    std::int32_t bestAudioStream;
+    std::uint32_t pathBytes;
+    std::uint32_t reserved;
+    char format[kNameBytes];
+};
+
+struct StreamRecord
+{
+    std::int32_t index;
+    std::int32_t type;
+    std::int32_t timeBaseNum;
+    std::int32_t timeBaseDen;
+    std::int64_t startTime;
+    std::int64_t duration;
+    std::int64_t frameCount;
+    std::int64_t bitRate;
+    std::int32_t width;
+    std::int32_t height;
+    std::int32_t pixelFormat;
+    std::int32_t frameRateNum;
+    std::int32_t frameRateDen;
+    std::int32_t sampleAspectNum;
+    std::int32_t sampleAspectDen;
+    std::int32_t colorRange;
+    std::int32_t colorPrimaries;
+    std::int32_t colorTransfer;
+    std::int32_t colorSpace;
+    std::int32_t sampleRate;
+    std::int32_t channels;
+    std::int32_t reserved;
+    char codec[kNameBytes];
+};
+
+void copyName(char (&out)[kNameBytes], const std::string &name)
+{
+    std::memset(out, 0, kNameBytes);
+    std::memcpy(out, name.data(), std::min(name.size(), kNameBytes - 1));
+}
+
+std::string readName(const char (&name)[kNameBytes])
+{
+    return std::string(name, strnlen(name, kNameBytes));
+}
+
+std::string canonicalKey(const std::string &path)
+{
+    std::error_code error;
+    auto absolute = std::filesystem::absolute(path, error);
+    return error ? path : absolute.lexically_normal().string();
+}
+
+} // namespace
+
+ProbeCache::ProbeCache(std::string directory)
+    : m_directory(std::move(directory))
+{
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+}
+
+std::string ProbeCache::entryPath(const std::string &path) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016zx.probe", std::hash<std::string>{}(canonicalKey(path)));
+    return (std::filesystem::path(m_directory) / name).string();
+}
+
+std::optional<MediaInfo> ProbeCache::find(const std::string &path,
+                                          const MediaIdentity &identity) const
+{
+    std::ifstream in(entryPath(path), std::ios::binary | std::ios::ate);
+    if (!in)
+        return std::nullopt;
+    const std::uint64_t fileSize = std::uint64_t(in.tellg());
+    in.seekg(0);
+    Header header;
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(header))
+        || std::memcmp(header.magic, kMagic, sizeof(kMagic)) || header.version != kVersion
+        || MediaIdentity{header.sourceSize, header.sourceMtimeNs} != identity)
+        return std::nullopt;
+
+    // Counts from a corrupt or truncated entry must not size allocations:
+    // whatever does not fit in the file is a miss.
+    const std::string key = canonicalKey(path);
+    const std::uint64_t left = fileSize - sizeof(header);
+    if (header.pathBytes != key.size() || header.pathBytes > left
+        || header.streamCount > (left - header.pathBytes) / sizeof(StreamRecord))
+        return std::nullopt;
+
+    // Entries are named by a hash of the path; confirm it is ours.
+    std::string stored(header.pathBytes, '\0');
+    if (!in.read(stored.data(), std::streamsize(stored.size())) || stored != key)
+        return std::nullopt;
+
+    MediaInfo info;
+    info.path = path;
+    info.identity = identity;
+    info.format = readName(header.format);
+    info.durationUs = header.durationUs;
+    info.bitRate = header.bitRate;
+    info.bestVideoStream = header.bestVideoStream;
+    info.bestAudioStream = header.bestAudioStream;
+    info.streams.reserve(header.streamCount);
+    for (std::uint32_t i = 0; i < header.streamCount; ++i) {
+        StreamRecord record;
+        if (!in.read(reinterpret_cast<char *>(&record), sizeof(record)))
+            return std::nullopt;
+        StreamInfo stream;
+        stream.index = record.index;
+        stream.type = static_cast<StreamType>(record.type);
+        stream.codec = readName(record.codec);
+        stream.timeBaseNum = record.timeBaseNum;
+        stream.timeBaseDen = record.timeBaseDen;
+        stream.startTime = record.startTime;
+        stream.duration = record.duration;
+        stream.frameCount = record.frameCount;
+        stream.bitRate = record.bitRate;
+        stream.width = record.width;
+        stream.height = record.height;
+        stream.pixelFormat = record.pixelFormat;
+        stream.frameRateNum = record.frameRateNum;
+        stream.frameRateDen = record.frameRateDen;
+        stream.sampleAspectNum = record.sampleAspectNum;
+        stream.sampleAspectDen = record.sampleAspectDen;
+        stream.colorRange = record.colorRange;
+        stream.colorPrimaries = record.colorPrimaries;
+        stream.colorTransfer = record.colorTransfer;
+        stream.colorSpace = record.colorSpace;
+        stream.sampleRate = record.sampleRate;
+        stream.channels = record.channels;
+        info.streams.push_back(std::move(stream));
+    }
+    return info;
+}
+
+bool ProbeCache::store(const MediaInfo &info) const
+{
+    const std::string key = canonicalKey(info.path);
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.streamCount = static_cast<std::uint32_t>(info.streams.size());
+    header.sourceSize = info.identity.size;
+    header.sourceMtimeNs = info.identity.mtimeNs;
+    header.durationUs = info.durationUs;
+    header.bitRate = info.bitRate;
+    header.bestVideoStream = info.bestVideoStream;
+    header.bestAudioStream = info.bestAudioStream;
+    header.pathBytes = static_cast<std::uint32_t>(key.size());
+    copyName(header.format, info.format);
+
+    const std::string path = entryPath(info.path);
+    // Several importer threads may store the same entry; give each its own
+    // temporary file so the renames stay atomic.
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%zx.tmp",
+                  std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    const std::string temporary = path + suffix;
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(key.data(), std::streamsize(key.size()));
+        for (const StreamInfo &stream : info.streams) {
+            StreamRecord record{};
+            record.index = stream.index;
+            record.type = static_cast<std::int32_t>(stream.type);
+            record.timeBaseNum = stream.timeBaseNum;
+            record.timeBaseDen = stream.timeBaseDen;
+            record.startTime = stream.startTime;
+            record.duration = stream.duration;
+            record.frameCount = stream.frameCount;
+            record.bitRate = stream.bitRate;
+            record.width = stream.width;
+            record.height = stream.height;
+            record.pixelFormat = stream.pixelFormat;
+            record.frameRateNum = stream.frameRateNum;
+            record.frameRateDen = stream.frameRateDen;
+            record.sampleAspectNum = stream.sampleAspectNum;
+            record.sampleAspectDen = stream.sampleAspectDen;
+            record.colorRange = stream.colorRange;
+            record.colorPrimaries = stream.colorPrimaries;
+            record.colorTransfer = stream.colorTransfer;
+            record.colorSpace = stream.colorSpace;
+            record.sampleRate = stream.sampleRate;
+            record.channels = stream.channels;
+            copyName(record.codec, stream.codec);
+            out.write(reinterpret_cast<const char *>(&record), sizeof(record));
+        }
+        if (!out.flush())
+            return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (!error)
+        return true;
+    std::filesystem::remove(temporary, error);
+    return false;
+}
+
+void ProbeCache::remove(const std::string &path) const
+{
+    std::error_code error;
+    std::filesystem::remove(entryPath(path), error);
+}
+
+} // namespace scp
@@ -0,0 +1,35 @@
+#pragma once
+
+// Persistent cache of probeMedia() results, one small file per media path
+// in a cache directory. An entry is only returned while the media file's
+// size and mtime match the ones it was probed with, so re-importing an
+// unchanged library never opens a single container.
+
+#include "media/media_probe.h"
+
+#include <optional>
+#include <string>
+
+namespace scp {
+
+class ProbeCache
+{
+public:
+    explicit ProbeCache(std::string directory);
+
+    const std::string &directory() const { return m_directory; }
+
+    // nullopt when there is no entry, it was probed from a different
+    // version of the file, or it is damaged.
+    std::optional<MediaInfo> find(const std::string &path, const MediaIdentity &identity) const;
+    // Writes atomically (temporary file + rename). Safe to call concurrently.
+    bool store(const MediaInfo &info) const;
+    void remove(const std::string &path) const;
+
+private:
+    std::string entryPath(const std::string &path) const;
+
+    std::string m_directory;
+};
+
+} // namespace scp
@@ -0,0 +1,186 @@
+#include "media/scheduled_io.h"
+
+extern "C" {
+#include <libavformat/avio.h>
+#include <libavutil/mem.h>
+}
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace scp {
+
+namespace {
+
+// Large enough that a spinning disk spends its time transferring rather
+// than seeking between the sessions it serves.
+constexpr int kBlockSize = 1 << 20;
+
+} // namespace
+
+ScheduledIO::ScheduledIO(IoScheduler &scheduler, IoPriority priority)
+    : m_scheduler(scheduler)
+    , m_priority(priority)
+{}
+
+std::unique_ptr<ScheduledIO> ScheduledIO::open(const std::string &path, IoScheduler &scheduler,
+                                               IoPriority priority)
+{
+    std::unique_ptr<ScheduledIO> io(new ScheduledIO(scheduler, priority));
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0 || !(io->m_file = scheduler.open(path)))
+        return nullptr;
+    io->m_size = static_cast<std::uint64_t>(info.st_size);
+    auto *buffer = static_cast<unsigned char *>(av_malloc(kBlockSize));
+    if (!buffer)
+        return nullptr;
+    io->m_context = avio_alloc_context(buffer, kBlockSize, 0, io.get(), &ScheduledIO::readPacket,
+                                       nullptr, &ScheduledIO::seek);
+    if (!io->m_context) {
+        av_free(buffer);
+        return nullptr;
+    }
+    io->m_context->seekable = AVIO_SEEKABLE_NORMAL;
+    io->m_ahead.resize(kBlockSize);
+    return io;
+}
+
+ScheduledIO::~ScheduledIO()
+{
+    dropReadAhead();
+    if (m_context) {
+        av_freep(&m_context->buffer);
+        avio_context_free(&m_context);
+    }
+}
+
+void ScheduledIO::setPriority(IoPriority priority)
+{
+    std::lock_guard lock(m_mutex);
+    m_priority = priority;
+}
+
+IoPriority ScheduledIO::priority() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_priority;
+}
+
+int ScheduledIO::readPacket(void *opaque, std::uint8_t *buffer, int size)
+{
+    return static_cast<ScheduledIO *>(opaque)->read(buffer, size);
+}
+
+std::int64_t ScheduledIO::seek(void *opaque, std::int64_t offset, int whence)
+{
+    auto *io = static_cast<ScheduledIO *>(opaque);
+    const auto total = static_cast<std::int64_t>(io->m_size);
+    std::int64_t target;
+    switch (whence & ~AVSEEK_FORCE) {
+    case AVSEEK_SIZE:
+        return total;
+    case SEEK_SET:
+        target = offset;
+        break;
+    case SEEK_CUR:
+        target = std::int64_t(io->m_position) + offset;
+        break;
+    case SEEK_END:
+        target = total + offset;
+        break;
+    default:
+        return AVERROR(EINVAL);
+    }
+    if (target < 0)
+        return AVERROR(EINVAL);
+    // No I/O here: the block ahead is kept in case the demuxer comes back
+    // to it, and dropped by the next read otherwise.
+    io->m_position = std::uint64_t(target);
+    return target;
+}
+
+int ScheduledIO::read(std::uint8_t *buffer, int size)
+{
+    if (m_position >= m_size)
+        return AVERROR_EOF;
+
+    IoPriority priority;
+    {
+        std::unique_lock lock(m_mutex);
+        priority = m_priority;
+        if (m_aheadPending && m_aheadOffset == m_position) {
+            // The demuxer caught up with the read ahead. Unless it is already
+            // being read, take it out of the prefetch class and read at ours.
+            if (m_scheduler.cancel(m_aheadId)) {
+                m_aheadPending = false;
+                m_aheadId = 0;
+                m_aheadResult = -1;
+            } else {
+                m_done.wait(lock, [this] { return !m_aheadPending; });
+            }
+        }
+        if (!m_aheadPending && m_aheadResult > 0 && m_position >= m_aheadOffset
+            && m_position < m_aheadOffset + std::uint64_t(m_aheadResult)) {
+            const std::uint64_t skip = m_position - m_aheadOffset;
+            const std::size_t bytes = static_cast<std::size_t>(
+                std::min<std::uint64_t>(std::uint64_t(size), std::uint64_t(m_aheadResult) - skip));
+            std::memcpy(buffer, m_ahead.data() + skip, bytes);
+            m_position += bytes;
+            const bool consumed = m_position >= m_aheadOffset + std::uint64_t(m_aheadResult);
+            lock.unlock();
+            if (consumed)
+                readAhead(m_position);
+            return static_cast<int>(bytes);
+        }
+    }
+
+    dropReadAhead();
+    const std::int64_t result = m_scheduler.read(m_file, m_position, std::size_t(size), buffer,
+                                                 priority);
+    if (result < 0)
+        return static_cast<int>(result); // -errno, which is AVERROR(errno)
+    if (result == 0)
+        return AVERROR_EOF;
+    m_position += std::uint64_t(result);
+    readAhead(m_position);
+    return static_cast<int>(result);
+}
+
+void ScheduledIO::readAhead(std::uint64_t offset)
+{
+    if (offset >= m_size)
+        return;
+    dropReadAhead();
+    std::lock_guard lock(m_mutex);
+    // Read ahead is never more urgent than prefetching.
+    const IoPriority priority = std::max(m_priority, IoPriority::Prefetch);
+    m_aheadOffset = offset;
+    m_aheadResult = -1;
+    m_aheadPending = true;
+    m_aheadId = m_scheduler.submit(m_file, offset, m_ahead.size(), m_ahead.data(), priority,
+                                   [this](std::int64_t result) {
+                                       {
+                                           std::lock_guard lock(m_mutex);
+                                           m_aheadResult = result;
+                                           m_aheadPending = false;
+                                           m_aheadId = 0;
+                                       }
+                                       m_done.notify_all();
+                                   });
+}
+
+void ScheduledIO::dropReadAhead()
+{
+    std::unique_lock lock(m_mutex);
+    if (m_aheadPending && !m_scheduler.cancel(m_aheadId))
+        // m_ahead is being written; it cannot be reused until that is done.
+        m_done.wait(lock, [this] { return !m_aheadPending; });
+    m_aheadPending = false;
+    m_aheadId = 0;
+    m_aheadResult = -1;
+}
+
+} // namespace scp
@@ -0,0 +1,70 @@
+#pragma once
+
+// AVIOContext that reads through the shared IoScheduler.
+//
+// For media on spinning disks and arrays, where many decoders reading on
+// their own would thrash the heads. Reads are issued in large blocks with
+// the session's priority, and while the demuxer reads forward, the next
+// block is requested at prefetch priority so it is usually in memory by
+// the time the demuxer gets there. The player raises or lowers the
+// priority as the session moves between playhead, prefetch and background
+// duty (setPriority()).
+
+#include "core/io_scheduler.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct AVIOContext;
+
+namespace scp {
+
+class ScheduledIO
+{
+public:
+    // Returns null if path cannot be opened, in which case callers use
+    // FFmpeg's own file protocol.
+    static std::unique_ptr<ScheduledIO> open(const std::string &path, IoScheduler &scheduler,
+                                             IoPriority priority);
+    ~ScheduledIO();
+
+    ScheduledIO(const ScheduledIO &) = delete;
+    ScheduledIO &operator=(const ScheduledIO &) = delete;
+
+    AVIOContext *context() const { return m_context; }
+
+    void setPriority(IoPriority priority);
+    IoPriority priority() const;
+
+private:
+    ScheduledIO(IoScheduler &scheduler, IoPriority priority);
+
+    static int readPacket(void *opaque, std::uint8_t *buffer, int size);
+    static std::int64_t seek(void *opaque, std::int64_t offset, int whence);
+
+    int read(std::uint8_t *buffer, int size);
+    void readAhead(std::uint64_t offset);
+    void dropReadAhead();
+
+    IoScheduler &m_scheduler;
+    IoScheduler::FileHandle m_file;
+    std::uint64_t m_size = 0;
+    AVIOContext *m_context = nullptr;
+    std::uint64_t m_position = 0;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_done;
+    IoPriority m_priority;
+    // The block requested ahead of the read position.
+    std::vector<std::uint8_t> m_ahead;
+    std::uint64_t m_aheadOffset = 0;
+    IoScheduler::RequestId m_aheadId = 0; // 0 when nothing is in flight
+    std::int64_t m_aheadResult = -1;      // bytes in m_ahead once complete
+    bool m_aheadPending = false;
+};
+
+} // namespace scp
@@ -0,0 +1,78 @@
+#include "media/surface_pool.h"
+
+#include <cstdint>
+
+namespace scp {
+
+SurfacePool::SurfacePool(const FrameFormat &format)
+    : m_format(format)
+    , m_storage(0) // surfaces are never returned to it
+{}
+
+SurfacePool::~SurfacePool() = default;
+
+std::shared_ptr<SurfacePool> SurfacePool::create(const FrameFormat &format, int count)
+{
+    if (!format.isValid() || count <= 0)
+        return nullptr;
+    std::shared_ptr<SurfacePool> pool(new SurfacePool(format));
+    pool->m_surfaces.resize(static_cast<std::size_t>(count));
+    for (int i = 0; i < count; ++i) {
+        Surface &surface = pool->m_surfaces[std::size_t(i)];
+        surface.storage = pool->m_storage.acquire(format);
+        if (!surface.storage)
+            return nullptr;
+        // The view shares the storage's planes but belongs to this pool.
+        surface.view = std::make_unique<FrameBuffer>(pool.get(), format);
+        for (int plane = 0; plane < planeCount(format.pixelFormat); ++plane)
+            surface.view->setPlane(plane, surface.storage->data(plane),
+                                   surface.storage->stride(plane));
+        surface.view->setOwnerData(reinterpret_cast<void *>(std::intptr_t(i)));
+        pool->m_free.push_back(i);
+    }
+    return pool;
+}
+
+int SurfacePool::available() const
+{
+    std::lock_guard lock(m_mutex);
+    return static_cast<int>(m_free.size());
+}
+
+FrameRef SurfacePool::acquire(std::stop_token stop)
+{
+    std::unique_lock lock(m_mutex);
+    if (!m_returned.wait(lock, stop, [this] { return !m_free.empty(); }))
+        return {};
+    return handOutLocked();
+}
+
+FrameRef SurfacePool::tryAcquire()
+{
+    std::lock_guard lock(m_mutex);
+    return m_free.empty() ? FrameRef() : handOutLocked();
+}
+
+FrameRef SurfacePool::handOutLocked()
+{
+    Surface &surface = m_surfaces[std::size_t(m_free.back())];
+    m_free.pop_back();
+    surface.pool = shared_from_this();
+    surface.view->resetForReuse();
+    return FrameRef(surface.view.get());
+}
+
+void SurfacePool::recycle(FrameBuffer *buffer) noexcept
+{
+    const auto index = static_cast<int>(reinterpret_cast<std::intptr_t>(buffer->ownerData()));
+    std::shared_ptr<SurfacePool> self;
+    {
+        std::lock_guard lock(m_mutex);
+        self = std::move(m_surfaces[std::size_t(index)].pool);
+        m_free.push_back(index);
+    }
+    m_returned.notify_one();
+    // self may be the last reference; nothing touches the pool after this.
+}
+
+} // namespace scp
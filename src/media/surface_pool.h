@@ -0,0 +1,66 @@
+#pragma once
+
+// Fixed set of decoder output surfaces.
+//
+// Hardware decoders allocate their surfaces once, from the stream's
+// parameters, and stall when all of them are referenced: by the decoder's
+// reference frames, by frames waiting to be polled, or by frames the render
+// graph still holds. SurfacePool gives every decode backend the same
+// contract. Surfaces are handed out as FrameRefs that can go to the render
+// graph as they are, and come back to the pool when the last reference is
+// dropped. Surfaces keep their pool alive, so frames may outlive the
+// backend that decoded them.
+
+#include "core/frame_buffer.h"
+#include "core/frame_pool.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <vector>
+
+namespace scp {
+
+class SurfacePool final : public FrameOwner, public std::enable_shared_from_this<SurfacePool>
+{
+public:
+    // Allocates count surfaces up front. Null if format is invalid or
+    // memory runs out.
+    static std::shared_ptr<SurfacePool> create(const FrameFormat &format, int count);
+    ~SurfacePool() override;
+
+    const FrameFormat &format() const { return m_format; }
+    int size() const { return static_cast<int>(m_surfaces.size()); }
+    int available() const;
+
+    // Waits for a free surface. Returns a null ref if stop is requested
+    // first.
+    FrameRef acquire(std::stop_token stop);
+    // Null ref if every surface is in use.
+    FrameRef tryAcquire();
+
+private:
+    struct Surface
+    {
+        FrameRef storage;
+        std::unique_ptr<FrameBuffer> view;
+        // Set while the surface is handed out.
+        std::shared_ptr<SurfacePool> pool;
+    };
+
+    explicit SurfacePool(const FrameFormat &format);
+
+    void recycle(FrameBuffer *buffer) noexcept override;
+    FrameRef handOutLocked();
+
+    const FrameFormat m_format;
+    FramePool m_storage; // must outlive m_surfaces
+    std::vector<Surface> m_surfaces;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable_any m_returned;
+    std::vector<int> m_free;
+};
+
+} // namespace scp
@@ -0,0 +1,245 @@
+#include "media/video_decoder.h"
+
+#include "media/media_error.h"
+
+#include <algorithm>
+
+namespace scp {
+
+namespace {
+
+// Decoding forward this far is usually cheaper than seeking, which costs a
+// keyframe decode plus everything between it and the target.
+constexpr double kForwardDecodeSeconds = 2.0;
+
+std::int64_t timestampOf(const AVFrame *frame)
+{
+    return frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp
+                                                          : frame->pts;
+}
+
+} // namespace
+
+VideoDecoder::VideoDecoder(const std::string &path, int streamIndex, const DecoderOptions &options)
+    : m_demuxer(path, options.io, options.ioPriority)
+    , m_budget(options.budget)
+    , m_threads(options.threads)
+    , m_lowLatency(options.lowLatency)
+    , m_packet(av_packet_alloc())
+    , m_current(av_frame_alloc())
+    , m_next(av_frame_alloc())
+    , m_position(AV_NOPTS_VALUE)
+{
+    m_streamIndex = streamIndex >= 0 ? streamIndex : m_demuxer.bestVideoStream();
+    if (m_streamIndex < 0 || m_streamIndex >= m_demuxer.streamCount())
+        throw MediaError("no video stream in " + path);
+    m_demuxer.selectStream(m_streamIndex);
+    m_identity = MediaIdentity::of(path).value_or(MediaIdentity{});
+    if (!options.indexDir.empty()) {
+        m_index = KeyframeIndex::open(KeyframeIndex::sidecarPath(options.indexDir, path), path);
+        if (m_index && (m_index->streamIndex() != m_streamIndex || m_index->keyframes().empty()))
+            m_index.reset();
+    }
+    if (m_budget) {
+        const AVCodec *codec = avcodec_find_decoder(stream()->codecpar->codec_id);
+        m_threadGrant = m_budget->acquire(
+            planDecodeThreading(codec, stream()->codecpar, INT32_MAX, m_lowLatency).threads);
+    }
+    openCodec();
+
+    m_forwardLimit = av_rescale_q(static_cast<std::int64_t>(kForwardDecodeSeconds * 1000),
+                                  AVRational{1, 1000}, stream()->time_base);
+}
+
+void VideoDecoder::openCodec()
+{
+    const AVStream *source = stream();
+    const AVCodec *codec = avcodec_find_decoder(source->codecpar->codec_id);
+    if (!codec)
+        throw MediaError("no decoder for " + path());
+    m_codec.reset(avcodec_alloc_context3(codec));
+    if (!m_codec)
+        throw MediaError("cannot allocate decoder for " + path());
+    int error = avcodec_parameters_to_context(m_codec.get(), source->codecpar);
+    if (error < 0)
+        throw MediaError("cannot configure decoder for " + path(), error);
+    if (m_budget) {
+        m_threading = planDecodeThreading(codec, source->codecpar, m_threadGrant.threads(),
+                                          m_lowLatency);
+        applyDecodeThreading(m_codec.get(), m_threading);
+    } else {
+        m_codec->thread_count = m_threads;
+        m_threading = {DecodeThreading::Internal, m_threads};
+    }
+    m_codec->pkt_timebase = source->time_base;
+    error = avcodec_open2(m_codec.get(), codec, nullptr);
+    if (error < 0)
+        throw MediaError("cannot open decoder for " + path(), error);
+}
+
+bool VideoDecoder::receive(AVFrame *frame)
+{
+    for (;;) {
+        int error = avcodec_receive_frame(m_codec.get(), frame);
+        if (error >= 0)
+            return true;
+        if (error == AVERROR_EOF)
+            return false;
+        if (error != AVERROR(EAGAIN))
+            throw MediaError("cannot decode " + path(), error);
+
+        if (!m_demuxer.readPacket(m_packet.get())) {
+            if (m_draining)
+                return false;
+            m_draining = true;
+            avcodec_send_packet(m_codec.get(), nullptr);
+            continue;
+        }
+        if (m_packet->stream_index != m_streamIndex) {
+            av_packet_unref(m_packet.get());
+            continue;
+        }
+        error = avcodec_send_packet(m_codec.get(), m_packet.get());
+        av_packet_unref(m_packet.get());
+        if (error < 0 && error != AVERROR_INVALIDDATA)
+            throw MediaError("cannot decode " + path(), error);
+    }
+}
+
+std::int64_t VideoDecoder::startPts() const
+{
+    if (m_index)
+        return m_index->keyframes().front().pts;
+    const std::int64_t start = stream()->start_time;
+    return start != AV_NOPTS_VALUE ? start : 0;
+}
+
+const AVFrame *VideoDecoder::decodeNext()
+{
+    if (m_hasNext) {
+        av_frame_unref(m_current.get());
+        av_frame_move_ref(m_current.get(), m_next.get());
+        m_hasNext = false;
+    } else {
+        av_frame_unref(m_current.get());
+        if (!receive(m_current.get())) {
+            m_position = AV_NOPTS_VALUE;
+            return nullptr;
+        }
+    }
+    m_position = timestampOf(m_current.get());
+    return m_current.get();
+}
+
+const AVFrame *VideoDecoder::decodeAt(std::int64_t pts)
+{
+    if (m_position == AV_NOPTS_VALUE || pts < m_position || pts - m_position > m_forwardLimit)
+        seek(pts);
+
+    bool haveCurrent = m_position != AV_NOPTS_VALUE;
+    for (;;) {
+        if (!m_hasNext) {
+            av_frame_unref(m_next.get());
+            if (!receive(m_next.get()))
+                return haveCurrent ? m_current.get() : nullptr;
+            m_hasNext = true;
+        }
+        const std::int64_t next = timestampOf(m_next.get());
+        if (next > pts && haveCurrent)
+            return m_current.get();
+        // Either the target is still ahead, or it precedes the first frame
+        // after the seek and that frame is the best answer.
+        decodeNext();
+        haveCurrent = true;
+        if (next > pts)
+            return m_current.get();
+    }
+}
+
+const AVFrame *VideoDecoder::decodeFrame(std::size_t frame)
+{
+    const FrameTimes *times = m_index ? m_index->frameTimes() : nullptr;
+    if (times && times->size() > 0)
+        return decodeAt(times->pts(std::min(frame, times->size() - 1)));
+    AVRational rate = stream()->avg_frame_rate;
+    if (rate.num <= 0 || rate.den <= 0)
+        rate = stream()->r_frame_rate;
+    if (rate.num <= 0 || rate.den <= 0)
+        throw MediaError("unknown frame rate of " + path());
+    return decodeAt(startPts()
+                    + av_rescale_q(std::int64_t(frame), AVRational{rate.den, rate.num},
+                                   stream()->time_base));
+}
+
+const AVFrame *VideoDecoder::decodeForTimeline(std::int64_t timelineFrame,
+                                               AVRational timelineRate)
+{
+    const FrameTimes *times = m_index ? m_index->frameTimes() : nullptr;
+    if (times && times->size() > 0)
+        return decodeFrame(m_index->sourceFrameFor(timelineFrame, timelineRate.num,
+                                                   timelineRate.den));
+    // decodeAt() already shows the frame displayed at a time; only the
+    // stream's first timestamp has to be found.
+    return decodeAt(startPts()
+                    + av_rescale_q(timelineFrame,
+                                   AVRational{timelineRate.den, timelineRate.num},
+                                   stream()->time_base));
+}
+
+void VideoDecoder::seek(std::int64_t pts)
+{
+    if (const KeyframeEntry *keyframe = m_index ? m_index->keyframeFor(pts) : nullptr) {
+        // Byte offsets are exact where timestamp seeks have to search;
+        // elsewhere the container's own index finds the keyframe by its
+        // dts, which is never after its pts.
+        if (keyframe->pos >= 0 && m_demuxer.hasTimestampDiscontinuities())
+            m_demuxer.seekToByte(keyframe->pos);
+        else
+            m_demuxer.seek(m_streamIndex, keyframe->dts);
+    } else {
+        m_demuxer.seek(m_streamIndex, pts);
+    }
+    avcodec_flush_buffers(m_codec.get());
+    av_frame_unref(m_current.get());
+    av_frame_unref(m_next.get());
+    m_hasNext = false;
+    m_draining = false;
+    m_position = AV_NOPTS_VALUE;
+}
+
+void VideoDecoder::releaseThreads()
+{
+    m_threadGrant.reset();
+}
+
+void VideoDecoder::reacquireThreads()
+{
+    if (!m_budget)
+        return;
+    m_threadGrant = m_budget->acquire(m_threading.threads);
+    if (m_threading.mode == DecodeThreading::Single
+        || m_threadGrant.threads() >= m_threading.threads)
+        return;
+    // Others took the budget while this session was idle; running on the
+    // old thread count would overcommit the machine.
+    openCodec();
+    av_frame_unref(m_current.get());
+    av_frame_unref(m_next.get());
+    m_hasNext = false;
+    m_draining = false;
+    m_position = AV_NOPTS_VALUE;
+}
+
+void VideoDecoder::setIoPriority(IoPriority priority)
+{
+    if (ScheduledIO *io = m_demuxer.scheduledIO())
+        io->setPriority(priority);
+}
+
+void VideoDecoder::setAccessPattern(AccessPattern pattern)
+{
+    if (MappedIO *io = m_demuxer.mappedIO())
+        io->setAccessPattern(pattern);
+}
+
+} // namespace scp
@@ -0,0 +1,131 @@
+#pragma once
+
+// One open video stream: its demuxer and decoder context.
+//
+// decodeAt() serves random access with as little work as it can: a request
+// at or shortly after the current position decodes forward from there, and
+// only requests behind it or far ahead of it seek. Opening is the expensive
+// part (probing, codec init, thread start-up), which is why sessions are
+// pooled by DecoderPool rather than opened per clip.
+
+#include "media/decode_threading.h"
+#include "media/demuxer.h"
+#include "media/keyframe_index.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace scp {
+
+struct DecoderOptions
+{
+    // Threads are granted from budget and laid out by planDecodeThreading().
+    // Without a budget, threads is passed to the codec as is (0 lets FFmpeg
+    // choose).
+    DecodeThreadBudget *budget = &DecodeThreadBudget::shared();
+    int threads = 0;
+    // The session serves scrubbing or reverse playback rather than
+    // sequential playback or export.
+    bool lowLatency = false;
+    DemuxerIO io = DemuxerIO::Mapped;
+    // Where KeyframeIndexer keeps its sidecars. When the file has a current
+    // one, seeks go straight to the indexed keyframe. Empty: no index.
+    std::string indexDir;
+    // Initial priority of DemuxerIO::Scheduled reads, see setIoPriority().
+    IoPriority ioPriority = IoPriority::Playhead;
+};
+
+class VideoDecoder
+{
+public:
+    // Opens streamIndex of path, or its best video stream for -1. Throws
+    // MediaError.
+    explicit VideoDecoder(const std::string &path, int streamIndex = -1,
+                          const DecoderOptions &options = {});
+
+    VideoDecoder(const VideoDecoder &) = delete;
+    VideoDecoder &operator=(const VideoDecoder &) = delete;
+
+    const std::string &path() const { return m_demuxer.path(); }
+    int streamIndex() const { return m_streamIndex; }
+    AVStream *stream() const { return m_demuxer.stream(m_streamIndex); }
+    AVCodecContext *codecContext() const { return m_codec.get(); }
+    // Size and mtime of the file when it was opened.
+    const MediaIdentity &identity() const { return m_identity; }
+    const DecodeThreadingPlan &threading() const { return m_threading; }
+
+    // Timestamp of the frame last returned, AV_NOPTS_VALUE after a seek.
+    std::int64_t position() const { return m_position; }
+    // Where the stream starts: its first indexed keyframe, else its
+    // start_time, or 0 when the container does not say. Nothing before it
+    // can be decoded.
+    std::int64_t startPts() const;
+
+    // Next frame in decode order, nullptr at end of stream. The frame stays
+    // valid until the next call. Throws MediaError.
+    const AVFrame *decodeNext();
+
+    // The frame displayed at pts (stream time base): the last one starting
+    // at or before it, or the first frame if pts precedes the stream.
+    // nullptr past the end. Same lifetime as decodeNext(). Throws MediaError.
+    const AVFrame *decodeAt(std::int64_t pts);
+
+    // Source frame number frame, counting from the first displayed one.
+    // Exact for variable frame rates when the keyframe index has frame
+    // times; estimated from the average frame rate otherwise. Same
+    // lifetime as decodeNext(). Throws MediaError.
+    const AVFrame *decodeFrame(std::size_t frame);
+
+    // The frame a timeline running at timelineRate frames per second shows
+    // timelineFrame frames into the clip, the clip starting at the first
+    // displayed frame. Throws MediaError.
+    const AVFrame *decodeForTimeline(std::int64_t timelineFrame, AVRational timelineRate);
+
+    // Positions at the keyframe at or before pts. Throws MediaError.
+    void seek(std::int64_t pts);
+
+    // The file's keyframe index, null without a current sidecar.
+    const KeyframeIndex *keyframeIndex() const { return m_index ? &*m_index : nullptr; }
+
+    // Priority of this session's reads while it serves the playhead,
+    // prefetch or background work. No effect unless reads are scheduled.
+    void setIoPriority(IoPriority priority);
+    // Pins the paging pattern of mapped reads, see MappedIO.
+    void setAccessPattern(AccessPattern pattern);
+
+    // Returns the session's threads to the budget while it sits idle, and
+    // takes them back before it decodes again. If the budget no longer has
+    // as many, the codec reopens with what it gets and the next decodeAt()
+    // seeks. Throws MediaError.
+    void releaseThreads();
+    void reacquireThreads();
+
+private:
+    void openCodec();
+    bool receive(AVFrame *frame);
+
+    Demuxer m_demuxer;
+    int m_streamIndex = -1;
+    MediaIdentity m_identity;
+    std::optional<KeyframeIndex> m_index;
+    DecodeThreadBudget *m_budget = nullptr;
+    int m_threads = 0;
+    bool m_lowLatency = false;
+    DecodeThreadBudget::Grant m_threadGrant;
+    DecodeThreadingPlan m_threading;
+    AVCodecContextPtr m_codec;
+    AVPacketPtr m_packet;
+    // m_current is the frame last returned; m_next was decoded past a
+    // decodeAt() target and is handed out before decoding more.
+    AVFramePtr m_current;
+    AVFramePtr m_next;
+    bool m_hasNext = false;
+    bool m_draining = false;
+    std::int64_t m_position;
+    // decodeAt() seeks instead of decoding forward beyond this distance.
+    std::int64_t m_forwardLimit = 0;
+};
+
+} // namespace scp
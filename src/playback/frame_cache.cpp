@@ -0,0 +1,445 @@
+#include "playback/frame_cache.h"
+
+#include "core/frame_pool.h"
+
+#include <signal.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <vector>
+
+namespace scp {
+
+namespace {
+
+constexpr char kMagic[4] = {'S', 'C', 'F', 'C'};
+constexpr std::uint32_t kVersion = 2;
+constexpr std::size_t kMaxPendingSpills = 32;
+constexpr const char *kExtension = ".scf";
+// Each cache keeps its files in "<prefix><pid>-<n>" below diskDirectory.
+constexpr std::string_view kDirectoryPrefix = "scp-frame-cache-";
+// Deflate never compresses better than about 1032:1.
+constexpr std::uint64_t kMaxCompressionRatio = 1032;
+
+std::atomic<unsigned> g_nextInstance{0};
+
+struct DiskHeader
+{
+    char magic[4];
+    std::uint32_t version;
+    std::int32_t width;
+    std::int32_t height;
+    std::uint32_t pixelFormat;
+    std::uint8_t colorMatrix;
+    std::uint8_t colorRange;
+    std::uint8_t reserved[2];
+    std::int64_t pts;
+    std::uint64_t rawBytes;
+    std::uint64_t compressedBytes;
+};
+
+// Byte distance between the same channel of neighbouring pixels; the delta
+// filter subtracts across it so flat and gradient areas become runs of zeros.
+int filterDistance(PixelFormat format)
+{
+    switch (format) {
+    case PixelFormat::RGBA8:
+        return 4;
+    case PixelFormat::RGBA16F:
+        return 8;
+    case PixelFormat::NV12:
+    case PixelFormat::P010:
+        return 2;
+    default:
+        return 1;
+    }
+}
+
+std::size_t packedBytes(const FrameFormat &format)
+{
+    std::size_t bytes = 0;
+    for (int i = 0; i < planeCount(format.pixelFormat); ++i) {
+        const PlaneGeometry plane = planeGeometry(format.pixelFormat, format.width,
+                                                  format.height, i);
+        bytes += std::size_t(plane.rowBytes) * plane.rows;
+    }
+    return bytes;
+}
+
+void packFiltered(const FrameBuffer &frame, std::uint8_t *out)
+{
+    const int distance = filterDistance(frame.pixelFormat());
+    for (int i = 0; i < frame.planeCount(); ++i) {
+        const PlaneGeometry plane = planeGeometry(frame.pixelFormat(), frame.width(),
+                                                  frame.height(), i);
+        for (int row = 0; row < plane.rows; ++row) {
+            const std::uint8_t *in = frame.data(i) + std::ptrdiff_t(row) * frame.stride(i);
+            for (int x = 0; x < plane.rowBytes; ++x)
+                out[x] = static_cast<std::uint8_t>(in[x] - (x >= distance ? in[x - distance] : 0));
+            out += plane.rowBytes;
+        }
+    }
+}
+
+void unpackFiltered(const std::uint8_t *in, FrameBuffer &frame)
+{
+    const int distance = filterDistance(frame.pixelFormat());
+    for (int i = 0; i < frame.planeCount(); ++i) {
+        const PlaneGeometry plane = planeGeometry(frame.pixelFormat(), frame.width(),
+                                                  frame.height(), i);
+        for (int row = 0; row < plane.rows; ++row) {
+            std::uint8_t *out = frame.data(i) + std::ptrdiff_t(row) * frame.stride(i);
+            for (int x = 0; x < plane.rowBytes; ++x)
+                out[x] = static_cast<std::uint8_t>(in[x] + (x >= distance ? out[x - distance] : 0));
+            in += plane.rowBytes;
+        }
+    }
+}
+
+// The disk index lives in memory, so files of a process that is gone,
+// including half-written ones, are unreachable. Other directories and those
+// of running processes are left alone.
+void removeAbandonedDirectories(const std::filesystem::path &parent)
+{
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(parent, error)) {
+        const std::string name = entry.path().filename().string();
+        if (!entry.is_directory(error) || !name.starts_with(kDirectoryPrefix))
+            continue;
+        const pid_t pid = static_cast<pid_t>(
+            std::strtol(name.c_str() + kDirectoryPrefix.size(), nullptr, 10));
+        if (pid > 0 && ::kill(pid, 0) == -1 && errno == ESRCH)
+            std::filesystem::remove_all(entry.path(), error);
+    }
+}
+
+} // namespace
+
+FrameCache::FrameCache(FramePool &pool, FrameCacheConfig config)
+    : m_pool(pool)
+    , m_config(std::move(config))
+{
+    if (m_config.diskDirectory.empty() || m_config.diskBudget == 0)
+        return;
+    std::error_code error;
+    std::filesystem::create_directories(m_config.diskDirectory, error);
+    removeAbandonedDirectories(m_config.diskDirectory);
+    const std::filesystem::path directory = std::filesystem::path(m_config.diskDirectory)
+                                            / (std::string(kDirectoryPrefix)
+                                               + std::to_string(::getpid()) + "-"
+                                               + std::to_string(g_nextInstance++));
+    // Without a directory of its own the cache runs RAM only.
+    if (!std::filesystem::create_directory(directory, error))
+        return;
+    m_diskDirectory = directory.string();
+    m_writer = std::jthread([this](std::stop_token stop) { runWriter(stop); });
+}
+
+FrameCache::~FrameCache()
+{
+    if (m_writer.joinable()) {
+        m_writer.request_stop();
+        m_writer.join();
+    }
+    if (diskEnabled()) {
+        std::error_code error;
+        std::filesystem::remove_all(m_diskDirectory, error);
+    }
+}
+
+bool FrameCache::diskEnabled() const
+{
+    return !m_diskDirectory.empty();
+}
+
+std::string FrameCache::diskPath(const FrameCacheKey &key) const
+{
+    char name[64];
+    std::snprintf(name, sizeof(name), "%016llx_%lld%s",
+                  static_cast<unsigned long long>(key.variant),
+                  static_cast<long long>(key.frame), kExtension);
+    return (std::filesystem::path(m_diskDirectory) / name).string();
+}
+
+FrameRef FrameCache::find(const FrameCacheKey &key)
+{
+    std::string path;
+    {
+        std::lock_guard lock(m_mutex);
+        if (auto it = m_ram.find(key); it != m_ram.end()) {
+            RamList::iterator entry = it->second;
+            if (entry->segment == Segment::Probation) {
+                entry->segment = Segment::Protected;
+                m_probationBytes -= entry->bytes;
+                m_protectedBytes += entry->bytes;
+                m_protected.splice(m_protected.begin(), m_probation, entry);
+            } else {
+                m_protected.splice(m_protected.begin(), m_protected, entry);
+            }
+            balanceLocked();
+            ++m_stats.ramHits;
+            return entry->frame;
+        }
+        auto it = m_disk.find(key);
+        if (it == m_disk.end()) {
+            ++m_stats.misses;
+            return {};
+        }
+        m_diskLru.splice(m_diskLru.begin(), m_diskLru, it->second.lru);
+        path = it->second.path;
+    }
+
+    FrameRef frame = readDisk(path);
+    std::lock_guard lock(m_mutex);
+    if (!frame || !m_disk.count(key)) {
+        // Unreadable, or invalidated while we were reading.
+        ++m_stats.misses;
+        return {};
+    }
+    ++m_stats.diskHits;
+    insertLocked(key, frame);
+    return frame;
+}
+
+bool FrameCache::contains(const FrameCacheKey &key) const
+{
+    std::lock_guard lock(m_mutex);
+    return m_ram.count(key) || m_disk.count(key);
+}
+
+void FrameCache::insert(const FrameCacheKey &key, const FrameRef &frame)
+{
+    if (!frame)
+        return;
+    std::lock_guard lock(m_mutex);
+    // The new frame supersedes whatever the disk tier holds, or is about to
+    // write, for key; find() would otherwise serve the old one once the new
+    // one leaves RAM.
+    if (auto it = m_disk.find(key); it != m_disk.end())
+        eraseDiskLocked(it);
+    std::erase_if(m_spillQueue, [&](const auto &item) { return item.first == key; });
+    if (m_writing == key)
+        m_writingCancelled = true;
+    insertLocked(key, frame);
+}
+
+void FrameCache::insertLocked(const FrameCacheKey &key, const FrameRef &frame)
+{
+    if (auto it = m_ram.find(key); it != m_ram.end())
+        eraseRamLocked(it);
+    const std::size_t bytes = FramePool::bufferBytes(frame->format());
+    m_probation.push_front({key, frame, bytes, Segment::Probation});
+    m_probationBytes += bytes;
+    m_ram.emplace(key, m_probation.begin());
+    balanceLocked();
+}
+
+void FrameCache::eraseRamLocked(std::map<FrameCacheKey, RamList::iterator>::iterator it)
+{
+    RamList::iterator entry = it->second;
+    if (entry->segment == Segment::Probation) {
+        m_probationBytes -= entry->bytes;
+        m_probation.erase(entry);
+    } else {
+        m_protectedBytes -= entry->bytes;
+        m_protected.erase(entry);
+    }
+    m_ram.erase(it);
+}
+
+void FrameCache::balanceLocked()
+{
+    // Overflowing protected frames get a second chance in probation.
+    const auto protectedLimit = static_cast<std::size_t>(m_config.ramBudget
+                                                         * m_config.protectedShare);
+    while (m_protectedBytes > protectedLimit && m_protected.size() > 1) {
+        RamList::iterator entry = std::prev(m_protected.end());
+        entry->segment = Segment::Probation;
+        m_protectedBytes -= entry->bytes;
+        m_probationBytes += entry->bytes;
+        m_probation.splice(m_probation.begin(), m_protected, entry);
+    }
+
+    while (m_probationBytes + m_protectedBytes > m_config.ramBudget && m_ram.size() > 1) {
+        RamList &victims = m_probation.empty() ? m_protected : m_probation;
+        RamEntry &victim = victims.back();
+        if (diskEnabled() && !m_disk.count(victim.key) && m_spillQueue.size() < kMaxPendingSpills
+            && m_writing != victim.key) {
+            m_spillQueue.emplace_back(victim.key, victim.frame);
+            m_spillWake.notify_one();
+        }
+        eraseRamLocked(m_ram.find(victim.key));
+    }
+}
+
+void FrameCache::invalidate(std::int64_t firstFrame, std::int64_t lastFrame)
+{
+    if (lastFrame <= firstFrame)
+        return;
+    std::lock_guard lock(m_mutex);
+    const FrameCacheKey begin{firstFrame, 0};
+    for (auto it = m_ram.lower_bound(begin); it != m_ram.end() && it->first.frame < lastFrame;) {
+        eraseRamLocked(it++);
+        ++m_stats.invalidated;
+    }
+    for (auto it = m_disk.lower_bound(begin); it != m_disk.end() && it->first.frame < lastFrame;) {
+        eraseDiskLocked(it++);
+        ++m_stats.invalidated;
+    }
+    std::erase_if(m_spillQueue, [&](const auto &item) {
+        return item.first.frame >= firstFrame && item.first.frame < lastFrame;
+    });
+    if (m_writing && m_writing->frame >= firstFrame && m_writing->frame < lastFrame)
+        m_writingCancelled = true;
+}
+
+void FrameCache::clear()
+{
+    invalidate(INT64_MIN, INT64_MAX);
+}
+
+FrameCacheStats FrameCache::stats() const
+{
+    std::lock_guard lock(m_mutex);
+    FrameCacheStats stats = m_stats;
+    stats.ramEntries = m_ram.size();
+    stats.ramBytes = m_probationBytes + m_protectedBytes;
+    stats.diskEntries = m_disk.size();
+    stats.diskBytes = m_diskBytes;
+    return stats;
+}
+
+void FrameCache::evictDiskLocked()
+{
+    while (m_diskBytes > m_config.diskBudget && !m_diskLru.empty())
+        eraseDiskLocked(m_disk.find(m_diskLru.back()));
+}
+
+void FrameCache::eraseDiskLocked(std::map<FrameCacheKey, DiskEntry>::iterator it)
+{
+    std::error_code error;
+    std::filesystem::remove(it->second.path, error);
+    m_diskBytes -= it->second.bytes;
+    m_diskLru.erase(it->second.lru);
+    m_disk.erase(it);
+}
+
+bool FrameCache::writeDisk(const std::string &path, const FrameBuffer &frame) const
+{
+    const std::size_t rawBytes = packedBytes(frame.format());
+    std::vector<std::uint8_t> packed(rawBytes);
+    packFiltered(frame, packed.data());
+    uLongf compressedBytes = compressBound(static_cast<uLong>(rawBytes));
+    std::vector<std::uint8_t> compressed(compressedBytes);
+    if (compress2(compressed.data(), &compressedBytes, packed.data(),
+                  static_cast<uLong>(rawBytes), m_config.compressionLevel)
+        != Z_OK)
+        return false;
+
+    DiskHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.width = frame.width();
+    header.height = frame.height();
+    header.pixelFormat = static_cast<std::uint32_t>(frame.pixelFormat());
+    header.colorMatrix = static_cast<std::uint8_t>(frame.colorSpec().matrix);
+    header.colorRange = static_cast<std::uint8_t>(frame.colorSpec().range);
+    header.pts = frame.pts();
+    header.rawBytes = rawBytes;
+    header.compressedBytes = compressedBytes;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(compressed.data()), std::streamsize(compressedBytes));
+    return static_cast<bool>(out.flush());
+}
+
+FrameRef FrameCache::readDisk(const std::string &path) const
+{
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    const std::streamoff fileBytes = in.tellg();
+    DiskHeader header;
+    if (fileBytes < std::streamoff(sizeof(header)) || !in.seekg(0)
+        || !in.read(reinterpret_cast<char *>(&header), sizeof(header))
+        || std::memcmp(header.magic, kMagic, sizeof(kMagic)) || header.version != kVersion)
+        return {};
+    // Sizes come from the file; check them against it before allocating.
+    if (header.compressedBytes != std::uint64_t(fileBytes) - sizeof(header)
+        || header.rawBytes / kMaxCompressionRatio > header.compressedBytes)
+        return {};
+    const FrameFormat format{header.width, header.height,
+                             static_cast<PixelFormat>(header.pixelFormat)};
+    if (!format.isValid() || header.rawBytes != packedBytes(format))
+        return {};
+    std::vector<std::uint8_t> compressed(header.compressedBytes);
+    if (!in.read(reinterpret_cast<char *>(compressed.data()), std::streamsize(compressed.size())))
+        return {};
+    std::vector<std::uint8_t> packed(header.rawBytes);
+    uLongf rawBytes = static_cast<uLongf>(packed.size());
+    if (uncompress(packed.data(), &rawBytes, compressed.data(), static_cast<uLong>(compressed.size()))
+            != Z_OK
+        || rawBytes != packed.size())
+        return {};
+    FrameRef frame = m_pool.acquire(format);
+    if (!frame)
+        return {};
+    unpackFiltered(packed.data(), *frame);
+    frame->setPts(header.pts);
+    frame->setColorSpec({static_cast<ColorMatrix>(header.colorMatrix),
+                         static_cast<ColorRange>(header.colorRange)});
+    return frame;
+}
+
+void FrameCache::runWriter(std::stop_token stop)
+{
+    for (;;) {
+        FrameCacheKey key;
+        FrameRef frame;
+        {
+            std::unique_lock lock(m_mutex);
+            if (!m_spillWake.wait(lock, stop, [this] { return !m_spillQueue.empty(); }))
+                return;
+            key = m_spillQueue.front().first;
+            frame = std::move(m_spillQueue.front().second);
+            m_spillQueue.pop_front();
+            m_writing = key;
+            m_writingCancelled = false;
+        }
+
+        const std::string path = diskPath(key);
+        const std::string temporary = path + ".tmp";
+        bool ok = writeDisk(temporary, *frame);
+        std::error_code error;
+        if (ok) {
+            std::filesystem::rename(temporary, path, error);
+            ok = !error;
+        }
+        const std::size_t bytes = ok ? std::filesystem::file_size(path, error) : 0;
+        frame.reset();
+
+        std::lock_guard lock(m_mutex);
+        m_writing.reset();
+        if (!ok || error || m_writingCancelled || m_disk.count(key)) {
+            std::filesystem::remove(temporary, error);
+            if (!m_disk.count(key))
+                std::filesystem::remove(path, error);
+            continue;
+        }
+        m_diskLru.push_front(key);
+        m_disk.emplace(key, DiskEntry{path, bytes, m_diskLru.begin()});
+        m_diskBytes += bytes;
+        ++m_stats.spills;
+        evictDiskLocked();
+    }
+}
+
+} // namespace scp
@@ -0,0 +1,147 @@
+#pragma once
+
+// Two-tier cache of rendered timeline frames for playback and scrubbing.
+//
+// The RAM tier is a segmented LRU under a byte budget: new frames enter a
+// probation segment and move to the protected segment when they are hit
+// again, so a single linear playback pass cannot flush the region the user
+// keeps scrubbing over. Frames evicted from RAM spill to an optional disk
+// tier, compressed on a background thread (row delta filter + zlib), and are
+// promoted back into RAM when hit. Timeline edits invalidate exactly the
+// affected frame range in both tiers.
+//
+// Cached frames are shared, so they must not be modified after insert().
+
+#include "core/frame_buffer.h"
+
+#include <compare>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace scp {
+
+class FramePool;
+
+struct FrameCacheKey
+{
+    std::int64_t frame = 0;
+    // Distinguishes renders of the same frame (preview scale, proxy mode,
+    // scopes overlay...).
+    std::uint64_t variant = 0;
+
+    auto operator<=>(const FrameCacheKey &) const = default;
+};
+
+struct FrameCacheConfig
+{
+    std::size_t ramBudget = std::size_t(2) << 30;
+    // Share of the RAM budget reserved for frames that were hit at least twice.
+    double protectedShare = 0.8;
+    // Disk tier is disabled when the directory is empty or the budget is 0.
+    // The cache writes only below a subdirectory of its own, removed when the
+    // cache is destroyed; those left by processes that no longer run are
+    // removed at start.
+    std::string diskDirectory;
+    std::size_t diskBudget = 0;
+    int compressionLevel = 1;
+};
+
+struct FrameCacheStats
+{
+    std::uint64_t ramHits = 0;
+    std::uint64_t diskHits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t spills = 0;
+    std::uint64_t invalidated = 0;
+    std::size_t ramEntries = 0;
+    std::size_t ramBytes = 0;
+    std::size_t diskEntries = 0;
+    std::size_t diskBytes = 0;
+};
+
+class FrameCache
+{
+public:
+    FrameCache(FramePool &pool, FrameCacheConfig config = {});
+    ~FrameCache();
+
+    FrameCache(const FrameCache &) = delete;
+    FrameCache &operator=(const FrameCache &) = delete;
+
+    // Looks in RAM, then on disk; a disk hit is promoted back into RAM.
+    FrameRef find(const FrameCacheKey &key);
+    // True if either tier holds key. Does not count as a use.
+    bool contains(const FrameCacheKey &key) const;
+
+    // Replaces any frame cached under key, in either tier.
+    void insert(const FrameCacheKey &key, const FrameRef &frame);
+
+    // Drops every variant of frames in [firstFrame, lastFrame) from both tiers.
+    void invalidate(std::int64_t firstFrame, std::int64_t lastFrame);
+    void clear();
+
+    FrameCacheStats stats() const;
+
+private:
+    enum class Segment { Probation, Protected };
+
+    struct RamEntry
+    {
+        FrameCacheKey key;
+        FrameRef frame;
+        std::size_t bytes;
+        Segment segment;
+    };
+    using RamList = std::list<RamEntry>;
+
+    struct DiskEntry
+    {
+        std::string path;
+        std::size_t bytes;
+        std::list<FrameCacheKey>::iterator lru;
+    };
+
+    bool diskEnabled() const;
+    void insertLocked(const FrameCacheKey &key, const FrameRef &frame);
+    void eraseRamLocked(std::map<FrameCacheKey, RamList::iterator>::iterator it);
+    void balanceLocked();
+    void evictDiskLocked();
+    void eraseDiskLocked(std::map<FrameCacheKey, DiskEntry>::iterator it);
+    std::string diskPath(const FrameCacheKey &key) const;
+    FrameRef readDisk(const std::string &path) const;
+    bool writeDisk(const std::string &path, const FrameBuffer &frame) const;
+    void runWriter(std::stop_token stop);
+
+    FramePool &m_pool;
+    const FrameCacheConfig m_config;
+    std::string m_diskDirectory; // empty: disk tier disabled
+
+    mutable std::mutex m_mutex;
+    RamList m_probation; // most recent first
+    RamList m_protected;
+    std::map<FrameCacheKey, RamList::iterator> m_ram;
+    std::size_t m_probationBytes = 0;
+    std::size_t m_protectedBytes = 0;
+
+    std::map<FrameCacheKey, DiskEntry> m_disk;
+    std::list<FrameCacheKey> m_diskLru; // most recent first
+    std::size_t m_diskBytes = 0;
+
+    std::deque<std::pair<FrameCacheKey, FrameRef>> m_spillQueue;
+    std::optional<FrameCacheKey> m_writing;
+    bool m_writingCancelled = false;
+    std::condition_variable_any m_spillWake;
+
+    FrameCacheStats m_stats;
+    std::jthread m_writer;
+};
+
+} // namespace scp
@@ -0,0 +1,223 @@
+#include "playback/prefetcher.h"
+
+#include "core/thread_pool.h"
+#include "playback/frame_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <thread>
+
+namespace scp {
+
+namespace {
+
+// A scrub event this long after the previous one starts a new gesture.
+constexpr double kScrubGestureGap = 0.25;
+
+} // namespace
+
+Prefetcher::Prefetcher(FrameCache &cache, ThreadPool &pool, FrameRenderer renderer,
+                       PrefetchConfig config)
+    : m_cache(cache)
+    , m_pool(pool)
+    , m_renderer(std::move(renderer))
+    , m_config(config)
+    , m_maxInFlight(std::max(1u, config.maxInFlight ? config.maxInFlight : pool.size()))
+{
+    m_motion.interval = 1.0 / m_config.frameRate;
+}
+
+Prefetcher::~Prefetcher()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        ++m_epoch;
+        m_plan.clear();
+        for (auto &[frame, render] : m_inFlight)
+            render.stop.request_stop();
+    }
+    for (;;) {
+        {
+            std::lock_guard lock(m_mutex);
+            if (m_inFlight.empty())
+                return;
+        }
+        if (!m_pool.runPendingTask())
+            std::this_thread::yield();
+    }
+}
+
+void Prefetcher::setRange(std::int64_t firstFrame, std::int64_t lastFrame)
+{
+    std::lock_guard lock(m_mutex);
+    m_firstFrame = firstFrame;
+    m_lastFrame = lastFrame;
+    replanLocked();
+}
+
+void Prefetcher::play(std::int64_t frame, double speed)
+{
+    std::lock_guard lock(m_mutex);
+    m_motion.frame = frame;
+    m_motion.velocity = speed * m_config.frameRate;
+    m_motion.interval = 1.0 / m_config.frameRate;
+    m_motion.scrubbing = false;
+    replanLocked();
+}
+
+void Prefetcher::seek(std::int64_t frame, Clock::time_point now)
+{
+    std::lock_guard lock(m_mutex);
+    const double elapsed = std::chrono::duration<double>(now - m_lastSeek).count();
+    if (!m_motion.scrubbing || elapsed > kScrubGestureGap) {
+        m_motion.velocity = 0.0;
+        m_motion.interval = 1.0 / m_config.frameRate;
+    } else {
+        // Smooth over pointer jitter; half-weight keeps direction changes
+        // visible within two events.
+        const double dt = std::max(elapsed, 1e-3);
+        const double velocity = double(frame - m_motion.frame) / dt;
+        m_motion.velocity = 0.5 * m_motion.velocity + 0.5 * velocity;
+        m_motion.interval = 0.5 * m_motion.interval + 0.5 * dt;
+    }
+    m_motion.frame = frame;
+    m_motion.scrubbing = true;
+    m_lastSeek = now;
+    replanLocked();
+}
+
+void Prefetcher::invalidate()
+{
+    std::lock_guard lock(m_mutex);
+    ++m_epoch;
+    for (auto &[frame, render] : m_inFlight)
+        render.stop.request_stop();
+    replanLocked();
+}
+
+void Prefetcher::invalidate(std::int64_t firstFrame, std::int64_t lastFrame)
+{
+    std::lock_guard lock(m_mutex);
+    for (auto it = m_inFlight.lower_bound(firstFrame);
+         it != m_inFlight.end() && it->first < lastFrame; ++it) {
+        it->second.stale = true;
+        it->second.stop.request_stop();
+    }
+    // A render that completed after the caller cleared the range put an
+    // old frame back; completions insert under m_mutex, so none can now.
+    m_cache.invalidate(firstFrame, lastFrame);
+    replanLocked();
+}
+
+PlayheadMotion Prefetcher::motion() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_motion;
+}
+
+PrefetchStats Prefetcher::stats() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_stats;
+}
+
+std::vector<std::int64_t> Prefetcher::predict(const PlayheadMotion &motion,
+                                              const PrefetchConfig &config,
+                                              std::int64_t firstFrame, std::int64_t lastFrame)
+{
+    std::vector<std::int64_t> frames;
+    auto add = [&](std::int64_t frame) {
+        if (frame >= firstFrame && frame < lastFrame
+            && std::find(frames.begin(), frames.end(), frame) == frames.end())
+            frames.push_back(frame);
+    };
+
+    const double interval = std::clamp(motion.interval, 1.0 / 240.0, 1.0);
+    // Timeline frames advanced per displayed frame. Above 1 (fast shuttle)
+    // the player skips frames, so only every step-th one is worth rendering.
+    const double step = motion.velocity * interval;
+    add(motion.frame);
+    if (std::abs(step) >= 0.5) {
+        const double horizon = motion.scrubbing ? config.scrubLookaheadSeconds
+                                                : config.lookaheadSeconds;
+        const int count = std::min(config.maxLookaheadFrames,
+                                   static_cast<int>(std::ceil(horizon / interval)));
+        for (int k = 1; k < count; ++k)
+            add(motion.frame + std::llround(step * k));
+        if (!motion.scrubbing)
+            return frames;
+    }
+
+    // Paused, or a scrub that may stop or turn around at any point: keep the
+    // neighbourhood warm, leaning in the direction of travel.
+    const int lean = step < 0 ? -1 : 1;
+    for (int r = 1; r <= config.scrubRadius; ++r) {
+        add(motion.frame + lean * r);
+        add(motion.frame - lean * r);
+    }
+    return frames;
+}
+
+void Prefetcher::replanLocked()
+{
+    m_plan = predict(m_motion, m_config, m_firstFrame, m_lastFrame);
+    for (auto &[frame, render] : m_inFlight) {
+        if (std::find(m_plan.begin(), m_plan.end(), frame) == m_plan.end())
+            render.stop.request_stop();
+    }
+    dispatchLocked();
+}
+
+void Prefetcher::dispatchLocked()
+{
+    // Frames whose cancelled render is still winding down stay in the plan
+    // and are picked up again when it returns.
+    auto it = m_plan.begin();
+    while (it != m_plan.end() && m_inFlight.size() < m_maxInFlight) {
+        const std::int64_t frame = *it;
+        if (m_inFlight.count(frame)) {
+            ++it;
+            continue;
+        }
+        it = m_plan.erase(it);
+        if (m_cache.contains({frame, m_config.variant}))
+            continue;
+        Render &render = m_inFlight[frame];
+        ++m_stats.scheduled;
+        m_pool.submit([this, frame, stop = render.stop.get_token(), epoch = m_epoch] {
+            renderTask(frame, stop, epoch);
+        });
+    }
+}
+
+void Prefetcher::renderTask(std::int64_t frame, std::stop_token stop, std::uint64_t epoch)
+{
+    FrameRef result;
+    bool failed = false;
+    if (!stop.stop_requested()) {
+        try {
+            result = m_renderer(frame, stop);
+        } catch (...) {
+            // Anything escaping here would skip the bookkeeping below and
+            // leave the frame in flight forever.
+            failed = true;
+        }
+    }
+
+    std::lock_guard lock(m_mutex);
+    const bool stale = m_inFlight.at(frame).stale;
+    if (result && epoch == m_epoch && !stale) {
+        // Even if it fell out of the plan, a finished frame is worth keeping.
+        m_cache.insert({frame, m_config.variant}, result);
+        ++m_stats.rendered;
+    } else if (failed) {
+        ++m_stats.failed;
+    } else {
+        ++m_stats.cancelled;
+    }
+    m_inFlight.erase(frame);
+    dispatchLocked();
+}
+
+} // namespace scp
@@ -0,0 +1,134 @@
+#pragma once
+
+// Lookahead renderer for the preview player.
+//
+// The player reports playhead movement: play() for normal playback and J/K/L
+// shuttle, where the speed is known exactly, and seek() for scrubbing, where
+// velocity is estimated from the timing of successive positions. From that
+// the prefetcher predicts the frames that will be displayed next, in the
+// order they will be needed, and renders the missing ones on the thread pool
+// into the FrameCache. Every movement replaces the plan; renders of frames
+// that dropped out of it are cancelled through their stop token.
+
+#include "core/frame_buffer.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stop_token>
+#include <vector>
+
+namespace scp {
+
+class FrameCache;
+class ThreadPool;
+
+// Renders one timeline frame. Should return early (with an empty ref) when
+// stop is requested. Exceptions count as a failed prefetch.
+using FrameRenderer = std::function<FrameRef(std::int64_t frame, std::stop_token stop)>;
+
+struct PrefetchConfig
+{
+    double frameRate = 25.0;
+    // Wall-clock time ahead of the playhead to keep rendered.
+    double lookaheadSeconds = 1.0;
+    int maxLookaheadFrames = 64;
+    // Frames kept warm on both sides of a paused or slowly scrubbed playhead.
+    int scrubRadius = 6;
+    // Scrub direction changes often, so predictions reach less far.
+    double scrubLookaheadSeconds = 0.25;
+    // Concurrent renders; 0 means one per pool worker.
+    unsigned maxInFlight = 0;
+    // FrameCacheKey::variant the player looks up.
+    std::uint64_t variant = 0;
+};
+
+struct PrefetchStats
+{
+    std::uint64_t scheduled = 0;
+    std::uint64_t rendered = 0;
+    std::uint64_t cancelled = 0;
+    std::uint64_t failed = 0;
+};
+
+// Playhead motion as seen by the prefetcher. velocity is in timeline frames
+// per second (negative when moving backwards); interval is the time between
+// displayed frames, which for scrubbing is the period of seek events.
+struct PlayheadMotion
+{
+    std::int64_t frame = 0;
+    double velocity = 0.0;
+    double interval = 0.04;
+    bool scrubbing = false;
+};
+
+class Prefetcher
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Prefetcher(FrameCache &cache, ThreadPool &pool, FrameRenderer renderer,
+               PrefetchConfig config = {});
+    // Cancels outstanding renders and waits for them.
+    ~Prefetcher();
+
+    Prefetcher(const Prefetcher &) = delete;
+    Prefetcher &operator=(const Prefetcher &) = delete;
+
+    // Clamps predictions to [firstFrame, lastFrame). Defaults to [0, max).
+    void setRange(std::int64_t firstFrame, std::int64_t lastFrame);
+
+    // Playback at speed times real time; 0 pauses (K), negative plays
+    // backwards (J).
+    void play(std::int64_t frame, double speed);
+    // The user moved the playhead directly (scrub drag, click, arrow keys).
+    void seek(std::int64_t frame, Clock::time_point now = Clock::now());
+
+    // Call after the timeline changed: renders in flight may show the old
+    // edit, so they are discarded and the plan is rebuilt.
+    void invalidate();
+    // Same, for an edit that only changed frames in [firstFrame, lastFrame):
+    // renders of other frames carry on. Also drops the range from the frame
+    // cache, after the caller has, to catch renders that completed since.
+    void invalidate(std::int64_t firstFrame, std::int64_t lastFrame);
+
+    PlayheadMotion motion() const;
+    PrefetchStats stats() const;
+
+    // Frames to have ready for the given motion, most urgent first.
+    static std::vector<std::int64_t> predict(const PlayheadMotion &motion,
+                                             const PrefetchConfig &config,
+                                             std::int64_t firstFrame, std::int64_t lastFrame);
+
+private:
+    struct Render
+    {
+        std::stop_source stop;
+        // An edit changed the frame after the render started.
+        bool stale = false;
+    };
+
+    void replanLocked();
+    void dispatchLocked();
+    void renderTask(std::int64_t frame, std::stop_token stop, std::uint64_t epoch);
+
+    FrameCache &m_cache;
+    ThreadPool &m_pool;
+    const FrameRenderer m_renderer;
+    const PrefetchConfig m_config;
+    const unsigned m_maxInFlight;
+
+    mutable std::mutex m_mutex;
+    std::int64_t m_firstFrame = 0;
+    std::int64_t m_lastFrame = INT64_MAX;
+    PlayheadMotion m_motion;
+    Clock::time_point m_lastSeek;
+    std::vector<std::int64_t> m_plan;
+    std::map<std::int64_t, Render> m_inFlight;
+    std::uint64_t m_epoch = 0;
+    PrefetchStats m_stats;
+};
+
+} // namespace scp
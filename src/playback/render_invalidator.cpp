@@ -0,0 +1,67 @@
+#include "playback/render_invalidator.h"
+
+#include "playback/frame_cache.h"
+#include "playback/prefetcher.h"
+#include "render/node_cache.h"
+
+#include <utility>
+
+namespace scp {
+
+RenderInvalidator::RenderInvalidator(FrameCache *frames, Prefetcher *prefetcher,
+                                     NodeCache *nodes, const RenderGraph *graph)
+    : m_frames(frames)
+    , m_prefetcher(prefetcher)
+    , m_nodes(nodes)
+    , m_graph(graph)
+{}
+
+void RenderInvalidator::addListener(Listener listener)
+{
+    std::lock_guard lock(m_mutex);
+    m_listeners.push_back(std::move(listener));
+}
+
+void RenderInvalidator::apply(const TimelineChange &change, std::span<const NodeId> changedNodes)
+{
+    std::uint64_t frames = 0;
+    for (const FrameRange &range : change.frames) {
+        // The frame cache first: the prefetcher replans while invalidating
+        // and skips frames it still finds cached, so the old renders have
+        // to be gone by then.
+        if (m_frames)
+            m_frames->invalidate(range.start, range.end);
+        if (m_prefetcher)
+            m_prefetcher->invalidate(range.start, range.end);
+        frames += std::uint64_t(range.duration());
+    }
+
+    std::size_t demoted = 0;
+    if (m_nodes && !changedNodes.empty()) {
+        if (m_graph) {
+            const std::vector<NodeId> affected = m_graph->downstream(changedNodes);
+            demoted = m_nodes->demote(affected);
+        } else {
+            demoted = m_nodes->demote(changedNodes);
+        }
+    }
+
+    std::vector<Listener> listeners;
+    {
+        std::lock_guard lock(m_mutex);
+        ++m_stats.changes;
+        m_stats.framesInvalidated += frames;
+        m_stats.nodesDemoted += demoted;
+        listeners = m_listeners;
+    }
+    for (const Listener &listener : listeners)
+        listener(change);
+}
+
+InvalidationStats RenderInvalidator::stats() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_stats;
+}
+
+} // namespace scp
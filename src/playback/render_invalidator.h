@@ -0,0 +1,64 @@
+#pragma once
+
+// Applies timeline edits to everything that caches rendered output.
+//
+// A TimelineChange names the frames that may now look different; only
+// those are dropped from the frame cache and only renders of those frames
+// are abandoned by the prefetcher. The render graph nodes behind the edited
+// items, and everything downstream of them, have their node cache entries
+// demoted rather than dropped: they are not wrong, and undo may ask for
+// them again. Caches outside playback (thumbnails, waveforms, background
+// pre-render) subscribe as listeners and get the same change.
+
+#include "render/render_graph.h"
+#include "timeline/timeline.h"
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace scp {
+
+class FrameCache;
+class NodeCache;
+class Prefetcher;
+
+struct InvalidationStats
+{
+    std::uint64_t changes = 0;
+    std::uint64_t framesInvalidated = 0; // summed over the dirty ranges
+    std::uint64_t nodesDemoted = 0;      // node cache entries moved to the cold end
+};
+
+class RenderInvalidator
+{
+public:
+    // Called with each applied change, on the editing thread.
+    using Listener = std::function<void(const TimelineChange &)>;
+
+    // Every target may be null.
+    RenderInvalidator(FrameCache *frames, Prefetcher *prefetcher = nullptr,
+                      NodeCache *nodes = nullptr, const RenderGraph *graph = nullptr);
+
+    void addListener(Listener listener);
+
+    // changedNodes are the render graph nodes of change.items; finding them
+    // is up to the owner of the graph.
+    void apply(const TimelineChange &change, std::span<const NodeId> changedNodes = {});
+
+    InvalidationStats stats() const;
+
+private:
+    FrameCache *m_frames;
+    Prefetcher *m_prefetcher;
+    NodeCache *m_nodes;
+    const RenderGraph *m_graph;
+
+    mutable std::mutex m_mutex;
+    std::vector<Listener> m_listeners;
+    InvalidationStats m_stats;
+};
+
+} // namespace scp
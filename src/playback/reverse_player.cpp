@@ -0,0 +1,259 @@
+#include "playback/reverse_player.h"
+
+#include "media/media_error.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace scp {
+
+namespace {
+
+std::int64_t timestampOf(const AVFrame *frame)
+{
+    return frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp
+                                                          : frame->pts;
+}
+
+} // namespace
+
+ReversePlayer::ReversePlayer(const std::string &path, int streamIndex, ReversePlayerConfig config,
+                             DecoderOptions options)
+    : m_config(config)
+{
+    // Every chunk starts with a seek, and reverse reads jump backwards.
+    options.lowLatency = true;
+    const int decoders = std::max(1, m_config.decoders);
+    for (int i = 0; i < decoders; ++i) {
+        m_decoders.push_back(std::make_unique<VideoDecoder>(path, streamIndex, options));
+        m_decoders.back()->setAccessPattern(AccessPattern::Reverse);
+    }
+    m_timeBase = m_decoders.front()->stream()->time_base;
+    m_streamStart = m_decoders.front()->startPts();
+    m_seekBackoff = std::max<std::int64_t>(1, av_rescale_q(1, AVRational{1, 1}, m_timeBase));
+    for (const auto &decoder : m_decoders)
+        m_workers.emplace_back([this, &decoder = *decoder](std::stop_token stop) {
+            run(decoder, stop);
+        });
+}
+
+ReversePlayer::~ReversePlayer()
+{
+    for (std::jthread &worker : m_workers)
+        worker.request_stop();
+}
+
+void ReversePlayer::start(std::int64_t pts)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        ++m_generation;
+        m_chunks.clear();
+        m_discovered.clear();
+        m_cursor = pts + 1;
+        m_started = true;
+        m_finished = false;
+        m_skip = 0;
+        m_error = nullptr;
+        m_chunks.emplace(m_cursor, Chunk{});
+    }
+    m_work.notify_all();
+}
+
+void ReversePlayer::setStep(int step)
+{
+    std::lock_guard lock(m_mutex);
+    m_step = std::max(1, step);
+    m_skip = std::min(m_skip, m_step - 1);
+}
+
+AVFramePtr ReversePlayer::next(std::chrono::milliseconds timeout)
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    auto cursorReady = [this] {
+        auto it = m_chunks.find(m_cursor);
+        return it != m_chunks.end() && it->second.state == Chunk::State::Ready;
+    };
+    bool waited = false;
+
+    std::unique_lock lock(m_mutex);
+    for (;;) {
+        if (m_error)
+            std::rethrow_exception(std::exchange(m_error, nullptr));
+        if (!m_started || m_finished)
+            return {};
+        if (!cursorReady()) {
+            if (!waited) {
+                ++m_stats.underruns;
+                waited = true;
+            }
+            if (!m_ready.wait_until(lock, deadline, [&] { return m_error || cursorReady(); }))
+                return {};
+            continue;
+        }
+
+        auto it = m_chunks.find(m_cursor);
+        Chunk &chunk = it->second;
+        AVFramePtr frame;
+        while (!chunk.frames.empty() && !frame) {
+            AVFramePtr candidate = std::move(chunk.frames.back());
+            chunk.frames.pop_back();
+            if (m_skip > 0) {
+                --m_skip;
+                continue;
+            }
+            m_skip = m_step - 1;
+            frame = std::move(candidate);
+        }
+        if (chunk.frames.empty()) {
+            if (chunk.atStart)
+                m_finished = true;
+            else
+                m_cursor = chunk.start;
+            m_chunks.erase(it);
+            fillLocked();
+            m_work.notify_all();
+        }
+        if (frame) {
+            ++m_stats.framesEmitted;
+            return frame;
+        }
+    }
+}
+
+bool ReversePlayer::finished() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_finished;
+}
+
+ReversePlayerStats ReversePlayer::stats() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_stats;
+}
+
+void ReversePlayer::discoverLocked(std::int64_t end)
+{
+    if (!m_chunks.contains(end))
+        m_discovered.insert(end);
+    fillLocked();
+}
+
+void ReversePlayer::fillLocked()
+{
+    // The nearest boundary first: it is the one playback reaches next.
+    while (!m_discovered.empty() && m_chunks.size() < std::size_t(std::max(1, m_config.chunks))) {
+        const std::int64_t end = *m_discovered.begin();
+        m_discovered.erase(m_discovered.begin());
+        m_chunks.try_emplace(end);
+    }
+}
+
+void ReversePlayer::run(VideoDecoder &decoder, std::stop_token stop)
+{
+    auto queued = [this] {
+        return std::find_if(m_chunks.begin(), m_chunks.end(), [](const auto &entry) {
+            return entry.second.state == Chunk::State::Queued;
+        });
+    };
+    for (;;) {
+        std::int64_t end;
+        std::uint64_t generation;
+        {
+            std::unique_lock lock(m_mutex);
+            if (!m_work.wait(lock, stop, [&] { return queued() != m_chunks.end(); }))
+                return;
+            auto it = queued();
+            it->second.state = Chunk::State::Decoding;
+            end = it->first;
+            generation = m_generation;
+        }
+        try {
+            decodeChunk(decoder, end, generation, stop);
+        } catch (...) {
+            {
+                std::lock_guard lock(m_mutex);
+                if (generation == m_generation)
+                    m_error = std::current_exception();
+            }
+            m_ready.notify_all();
+        }
+    }
+}
+
+void ReversePlayer::decodeChunk(VideoDecoder &decoder, std::int64_t end, std::uint64_t generation,
+                                std::stop_token stop)
+{
+    std::deque<AVFramePtr> frames;
+    std::uint64_t decoded = 0;
+    bool split = false;
+
+    // Find a keyframe before end. Seeks through a coarse container index
+    // can land on or after it; step back further, twice as far each time,
+    // until one does not or the stream start is reached.
+    const AVFrame *frame = nullptr;
+    std::int64_t target = end - 1;
+    for (std::int64_t back = m_seekBackoff;; back *= 2) {
+        decoder.seek(target);
+        frame = decoder.decodeNext();
+        if (stop.stop_requested() || generation != m_generation)
+            return;
+        if (frame && decoder.position() < end)
+            break;
+        if (target <= m_streamStart) {
+            frame = nullptr; // nothing decodable precedes end
+            break;
+        }
+        target = target - m_streamStart > back ? target - back : m_streamStart;
+    }
+
+    for (; frame; frame = decoder.decodeNext()) {
+        if (stop.stop_requested() || generation != m_generation)
+            return;
+        const std::int64_t pts = decoder.position();
+        if (pts >= end)
+            break;
+        if (decoded++ == 0 && pts > m_streamStart) {
+            // The keyframe: the previous chunk ends here, and another
+            // decoder can start on it now.
+            {
+                std::lock_guard lock(m_mutex);
+                if (generation != m_generation)
+                    return;
+                discoverLocked(pts);
+            }
+            m_work.notify_all();
+        }
+        AVFramePtr copy(av_frame_clone(frame));
+        if (!copy)
+            throw MediaError("cannot reference decoded frame of " + decoder.path());
+        frames.push_back(std::move(copy));
+        if (frames.size() > std::size_t(std::max(1, m_config.chunkFrames))) {
+            frames.pop_front();
+            split = true;
+        }
+    }
+
+    {
+        std::lock_guard lock(m_mutex);
+        auto it = m_chunks.find(end);
+        if (generation != m_generation || it == m_chunks.end())
+            return;
+        Chunk &chunk = it->second;
+        chunk.start = frames.empty() ? end : timestampOf(frames.front().get());
+        chunk.atStart = frames.empty() || chunk.start <= m_streamStart;
+        chunk.frames = std::move(frames);
+        chunk.state = Chunk::State::Ready;
+        ++m_stats.chunksDecoded;
+        m_stats.chunksSplit += split ? 1 : 0;
+        m_stats.framesDecoded += decoded;
+        // Where a split chunk resumes; the keyframe was queued above.
+        if (!chunk.atStart)
+            discoverLocked(chunk.start);
+    }
+    m_ready.notify_all();
+    m_work.notify_all();
+}
+
+} // namespace scp
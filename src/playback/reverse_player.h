@@ -0,0 +1,139 @@
+#pragma once
+
+// Reverse playback and J-key shuttling for long-GOP media.
+//
+// Seeking back for every frame costs a keyframe plus up to a GOP of decoding
+// per displayed frame. Instead, each GOP is decoded forward once into a
+// bounded chunk and played out backwards. Chunk boundaries come from the
+// decoders themselves: a chunk ending at end starts at the keyframe a seek to
+// end - 1 lands on, and that keyframe is where the next chunk ends. A seek
+// that lands at or after end (inexact container indexes) is retried further
+// back. Playback ends at the chunk starting at the stream's start. The next
+// chunk is queued as soon as the keyframe is decoded, so several decoder
+// sessions work on consecutive GOPs in parallel while the current one plays.
+//
+// GOPs longer than a chunk are decoded in passes: each pass keeps only the
+// last chunkFrames frames before its end, and the next pass seeks to the
+// same keyframe again and stops where the previous one began. Memory stays
+// bounded by chunks * chunkFrames decoded frames whatever the GOP length.
+
+#include "media/video_decoder.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace scp {
+
+struct ReversePlayerConfig
+{
+    // Decoded frames held per chunk.
+    int chunkFrames = 60;
+    // Chunks held at once: the one playing and those decoded ahead of it.
+    int chunks = 3;
+    // Decoder sessions working on chunks concurrently.
+    int decoders = 2;
+};
+
+struct ReversePlayerStats
+{
+    std::uint64_t chunksDecoded = 0;
+    // Chunks that had to drop frames because their GOP was too long.
+    std::uint64_t chunksSplit = 0;
+    std::uint64_t framesDecoded = 0;
+    std::uint64_t framesEmitted = 0;
+    // next() calls that found the next frame still being decoded.
+    std::uint64_t underruns = 0;
+};
+
+class ReversePlayer
+{
+public:
+    // Opens config.decoders low-latency sessions on streamIndex of path
+    // (-1: best video stream). Throws MediaError.
+    explicit ReversePlayer(const std::string &path, int streamIndex = -1,
+                           ReversePlayerConfig config = {}, DecoderOptions options = {});
+    ~ReversePlayer();
+
+    ReversePlayer(const ReversePlayer &) = delete;
+    ReversePlayer &operator=(const ReversePlayer &) = delete;
+
+    AVRational timeBase() const { return m_timeBase; }
+
+    // Starts playing backwards from the frame displayed at pts (stream time
+    // base), which is the first frame next() returns. Drops everything
+    // decoded for an earlier start.
+    void start(std::int64_t pts);
+
+    // Returns every step-th frame, for shuttling at a multiple of the
+    // normal speed.
+    void setStep(int step);
+
+    // The next frame backwards, waiting up to timeout for it to be decoded.
+    // Null if it is not ready in time or playback reached the first frame
+    // (see finished()). Rethrows whatever a decoder thread threw, usually
+    // MediaError.
+    AVFramePtr next(std::chrono::milliseconds timeout = {});
+
+    // True once every frame back to the start of the stream was returned.
+    bool finished() const;
+
+    ReversePlayerStats stats() const;
+
+private:
+    struct Chunk
+    {
+        enum class State { Queued, Decoding, Ready };
+        State state = State::Queued;
+        std::deque<AVFramePtr> frames; // ascending
+        std::int64_t start = 0;
+        // The chunk precedes the first frame of the stream.
+        bool atStart = false;
+    };
+    // Chunks by end, the next to play first.
+    using ChunkMap = std::map<std::int64_t, Chunk, std::greater<>>;
+
+    void run(VideoDecoder &decoder, std::stop_token stop);
+    void decodeChunk(VideoDecoder &decoder, std::int64_t end, std::uint64_t generation,
+                     std::stop_token stop);
+    void discoverLocked(std::int64_t end);
+    void fillLocked();
+
+    const ReversePlayerConfig m_config;
+    AVRational m_timeBase{0, 1};
+    std::int64_t m_streamStart = 0;
+    // How far the first retry steps back from a seek that overshot.
+    std::int64_t m_seekBackoff = 1;
+    std::vector<std::unique_ptr<VideoDecoder>> m_decoders;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable_any m_work;
+    std::condition_variable_any m_ready;
+    ChunkMap m_chunks;
+    // Chunk ends found while every chunk slot was taken.
+    std::set<std::int64_t, std::greater<>> m_discovered;
+    std::int64_t m_cursor = 0; // end of the chunk that plays next
+    bool m_started = false;
+    bool m_finished = false;
+    int m_step = 1;
+    int m_skip = 0;
+    // Bumped by start(); decoding for an older value is abandoned.
+    std::atomic<std::uint64_t> m_generation{0};
+    std::exception_ptr m_error;
+    ReversePlayerStats m_stats;
+
+    std::vector<std::jthread> m_workers;
+};
+
+} // namespace scp
@@ -0,0 +1,503 @@
+#include "project/mlt_importer.h"
+
+#include "project/xml_reader.h"
+
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace scp {
+
+namespace {
+
+// A producer, chain or transition tractor, reduced to what placing an entry
+// that uses it needs.
+struct Producer
+{
+    std::string resource;
+    std::int64_t in = 0;
+    std::int64_t out = -1; // inclusive, -1 if unknown
+    std::vector<std::string> filters;
+
+    // Transition tractors: the producers they mix and the transitions.
+    struct Input
+    {
+        std::string producer;
+        std::int64_t in = 0;
+    };
+    std::vector<Input> inputs;
+    std::vector<std::string> transitions;
+};
+
+struct TractorTrack
+{
+    std::string producer;
+    std::int64_t in = 0;
+    bool hideVideo = false;
+};
+
+// An open element and what was collected from it so far.
+struct Element
+{
+    enum class Kind { Producer, Playlist, Entry, Blank, Tractor, Track, Filter, Transition, Other };
+
+    Kind kind = Kind::Other;
+    std::string id;
+    std::string producer; // entries and tractor tracks
+    std::optional<std::int64_t> in;
+    std::optional<std::int64_t> out;
+    std::optional<std::int64_t> length;
+    bool hideVideo = false;
+
+    // Properties.
+    std::string resource;
+    std::string service;
+    bool internal = false;
+    bool audio = false;
+
+    std::vector<std::string> filters;
+    std::vector<std::string> transitions;
+    std::vector<TractorTrack> tracks;
+
+    // Playlists.
+    Track track{TrackKind::Video};
+    std::int64_t cursor = 0;
+};
+
+struct Playlist
+{
+    Track track;
+    bool audio = false;
+};
+
+class MltImporter
+{
+public:
+    explicit MltImporter(std::istream &in)
+        : m_reader(in)
+    {}
+
+    MltImportResult run();
+
+private:
+    void start();
+    void end();
+    void endProperty();
+    void endEntry(Element &entry);
+    void endTractor(Element &tractor);
+    void place(Element &playlist, const Producer &producer, std::int64_t in, std::int64_t out,
+               const std::vector<std::string> &entryFilters);
+    void addItem(Element &playlist, ItemKind kind, std::string resource, std::int64_t sourceIn,
+                 FrameRange range);
+    Element *parent();
+    std::optional<std::int64_t> timeAttribute(std::string_view name);
+    bool parseTime(std::string_view text, std::int64_t &frames) const;
+    Timeline buildTimeline();
+
+    XmlReader m_reader;
+    int m_rateNum = 25;
+    int m_rateDen = 1;
+    std::vector<Element> m_stack;
+    std::unordered_map<std::string, Producer> m_producers;
+    std::unordered_map<std::string, Playlist> m_playlists;
+    std::vector<std::string> m_playlistOrder;
+    std::optional<std::vector<TractorTrack>> m_main;
+
+    // Elements open inside the current <property>: 1 in the property
+    // itself, more inside the <properties> lists Shotcut nests in some
+    // (markers). Those belong to the property, not the service.
+    int m_propertyDepth = 0;
+    std::string m_propertyName;
+    std::string m_propertyValue;
+
+    std::string m_error;
+    MltImportStats m_stats;
+};
+
+MltImportResult MltImporter::run()
+{
+    const auto started = std::chrono::steady_clock::now();
+    MltImportResult result;
+    for (bool done = false; !done && m_error.empty();) {
+        switch (m_reader.next()) {
+        case XmlReader::Token::StartElement:
+            start();
+            break;
+        case XmlReader::Token::EndElement:
+            end();
+            break;
+        case XmlReader::Token::Text:
+            if (m_propertyDepth == 1)
+                m_propertyValue += m_reader.text();
+            break;
+        case XmlReader::Token::EndDocument:
+            done = true;
+            break;
+        case XmlReader::Token::Error:
+            m_error = m_reader.error();
+            break;
+        }
+    }
+    if (m_error.empty())
+        result.timeline = buildTimeline();
+    result.error = std::move(m_error);
+    m_stats.bytes = m_reader.bytesRead();
+    m_stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started)
+                          .count();
+    result.stats = m_stats;
+    return result;
+}
+
+void MltImporter::start()
+{
+    const std::string_view name = m_reader.name();
+    if (m_propertyDepth > 0) {
+        ++m_propertyDepth;
+        return;
+    }
+    if (name == "property") {
+        m_propertyDepth = 1;
+        m_propertyName = m_reader.attribute("name").value_or("");
+        m_propertyValue.clear();
+        return;
+    }
+    if (name == "profile") {
+        int num = 0;
+        int den = 0;
+        const std::string_view numText = m_reader.attribute("frame_rate_num").value_or("");
+        const std::string_view denText = m_reader.attribute("frame_rate_den").value_or("");
+        std::from_chars(numText.data(), numText.data() + numText.size(), num);
+        std::from_chars(denText.data(), denText.data() + denText.size(), den);
+        if (num > 0 && den > 0) {
+            m_rateNum = num;
+            m_rateDen = den;
+        }
+    }
+
+    Element element;
+    if (name == "producer" || name == "chain")
+        element.kind = Element::Kind::Producer;
+    else if (name == "playlist")
+        element.kind = Element::Kind::Playlist;
+    else if (name == "entry")
+        element.kind = Element::Kind::Entry;
+    else if (name == "blank")
+        element.kind = Element::Kind::Blank;
+    else if (name == "tractor")
+        element.kind = Element::Kind::Tractor;
+    else if (name == "track")
+        element.kind = Element::Kind::Track;
+    else if (name == "filter")
+        element.kind = Element::Kind::Filter;
+    else if (name == "transition")
+        element.kind = Element::Kind::Transition;
+    element.id = m_reader.attribute("id").value_or("");
+    element.producer = m_reader.attribute("producer").value_or("");
+    element.hideVideo = m_reader.attribute("hide").value_or("") == "video"
+                        || m_reader.attribute("hide").value_or("") == "both";
+    if (element.kind != Element::Kind::Other) {
+        element.in = timeAttribute("in");
+        element.out = timeAttribute("out");
+        element.length = timeAttribute("length");
+    }
+    m_stack.push_back(std::move(element));
+}
+
+void MltImporter::end()
+{
+    if (m_propertyDepth > 0) {
+        if (--m_propertyDepth == 0)
+            endProperty();
+        return;
+    }
+    if (m_stack.empty())
+        return;
+    Element element = std::move(m_stack.back());
+    m_stack.pop_back();
+    Element *owner = parent();
+    if (element.kind != Element::Kind::Other)
+        ++m_stats.objects;
+
+    switch (element.kind) {
+    case Element::Kind::Producer: {
+        Producer &producer = m_producers[element.id];
+        producer = Producer{};
+        producer.resource = std::move(element.resource);
+        producer.in = element.in.value_or(0);
+        if (element.out)
+            producer.out = *element.out;
+        else if (element.length)
+            producer.out = producer.in + *element.length - 1;
+        producer.filters = std::move(element.filters);
+        break;
+    }
+    case Element::Kind::Playlist: {
+        for (std::string &filter : element.filters)
+            addItem(element, ItemKind::Filter, std::move(filter), 0, {0, element.cursor});
+        if (!m_playlists.contains(element.id))
+            m_playlistOrder.push_back(element.id);
+        m_playlists.insert_or_assign(element.id, Playlist{std::move(element.track), element.audio});
+        break;
+    }
+    case Element::Kind::Entry:
+        if (owner && owner->kind == Element::Kind::Playlist)
+            endEntry(element);
+        else
+            ++m_stats.skipped;
+        break;
+    case Element::Kind::Blank:
+        if (owner && owner->kind == Element::Kind::Playlist)
+            owner->cursor += element.length.value_or(0);
+        break;
+    case Element::Kind::Tractor:
+        endTractor(element);
+        break;
+    case Element::Kind::Track:
+        m_stats.skipped += element.filters.size();
+        if (owner && owner->kind == Element::Kind::Tractor)
+            owner->tracks.push_back({element.producer, element.in.value_or(0), element.hideVideo});
+        break;
+    case Element::Kind::Filter:
+        if (element.internal || element.service.empty() || !owner
+            || owner->kind == Element::Kind::Other)
+            ++m_stats.skipped;
+        else
+            owner->filters.push_back(std::move(element.service));
+        break;
+    case Element::Kind::Transition:
+        if (owner && owner->kind == Element::Kind::Tractor && !element.service.empty())
+            owner->transitions.push_back(std::move(element.service));
+        else
+            ++m_stats.skipped;
+        break;
+    case Element::Kind::Other:
+        break;
+    }
+}
+
+void MltImporter::endProperty()
+{
+    if (m_stack.empty())
+        return;
+    Element &element = m_stack.back();
+    if (m_propertyName == "resource") {
+        element.resource = std::move(m_propertyValue);
+    } else if (m_propertyName == "mlt_service") {
+        element.service = std::move(m_propertyValue);
+    } else if (m_propertyName == "length") {
+        std::int64_t frames;
+        if (parseTime(m_propertyValue, frames))
+            element.length = frames;
+    } else if (m_propertyName == "_loader") {
+        element.internal = m_propertyValue == "1";
+    } else if (m_propertyName == "shotcut:audio") {
+        element.audio = m_propertyValue == "1";
+    }
+}
+
+void MltImporter::endEntry(Element &entry)
+{
+    Element &playlist = *parent();
+    const auto it = m_producers.find(entry.producer);
+    if (it == m_producers.end()) {
+        ++m_stats.unresolved;
+        // Keep what follows in place if the entry says how long it is.
+        if (entry.in && entry.out)
+            playlist.cursor += *entry.out - *entry.in + 1;
+        return;
+    }
+    const Producer &producer = it->second;
+    const std::int64_t in = entry.in.value_or(producer.in);
+    const std::int64_t out = entry.out.value_or(producer.out);
+    if (out < in) {
+        ++m_stats.skipped;
+        return;
+    }
+    place(playlist, producer, in, out, entry.filters);
+}
+
+void MltImporter::endTractor(Element &tractor)
+{
+    bool multitrack = false;
+    for (const TractorTrack &track : tractor.tracks)
+        multitrack = multitrack || m_playlists.contains(track.producer);
+    if (multitrack) {
+        // Track compositing has no counterpart; the last multitrack wins.
+        m_stats.skipped += tractor.transitions.size() + tractor.filters.size();
+        m_main = std::move(tractor.tracks);
+        return;
+    }
+    Producer &producer = m_producers[tractor.id];
+    producer = Producer{};
+    producer.in = tractor.in.value_or(0);
+    producer.out = tractor.out.value_or(-1);
+    producer.filters = std::move(tractor.filters);
+    producer.transitions = std::move(tractor.transitions);
+    for (TractorTrack &track : tractor.tracks)
+        producer.inputs.push_back({std::move(track.producer), track.in});
+}
+
+void MltImporter::place(Element &playlist, const Producer &producer, std::int64_t in,
+                        std::int64_t out, const std::vector<std::string> &entryFilters)
+{
+    const FrameRange range{playlist.cursor, playlist.cursor + out - in + 1};
+    if (producer.inputs.empty()) {
+        addItem(playlist, ItemKind::Clip, producer.resource, in, range);
+    } else {
+        for (const Producer::Input &input : producer.inputs) {
+            const auto it = m_producers.find(input.producer);
+            if (it == m_producers.end()) {
+                ++m_stats.unresolved;
+                continue;
+            }
+            addItem(playlist, ItemKind::Clip, it->second.resource, input.in + in - producer.in,
+                    range);
+            for (const std::string &filter : it->second.filters)
+                addItem(playlist, ItemKind::Filter, filter, 0, range);
+        }
+        for (const std::string &transition : producer.transitions)
+            addItem(playlist, ItemKind::Transition, transition, 0, range);
+    }
+    for (const std::string &filter : producer.filters)
+        addItem(playlist, ItemKind::Filter, filter, 0, range);
+    for (const std::string &filter : entryFilters)
+        addItem(playlist, ItemKind::Filter, filter, 0, range);
+    playlist.cursor = range.end;
+}
+
+void MltImporter::addItem(Element &playlist, ItemKind kind, std::string resource,
+                          std::int64_t sourceIn, FrameRange range)
+{
+    if (range.isEmpty())
+        return;
+    playlist.track.add({kind, std::move(resource), sourceIn}, range);
+}
+
+Element *MltImporter::parent()
+{
+    return m_stack.empty() ? nullptr : &m_stack.back();
+}
+
+std::optional<std::int64_t> MltImporter::timeAttribute(std::string_view name)
+{
+    const std::optional<std::string_view> text = m_reader.attribute(name);
+    if (!text || text->empty())
+        return std::nullopt;
+    std::int64_t frames;
+    if (!parseTime(*text, frames)) {
+        m_error = "bad time \"" + std::string(*text) + "\" in <" + std::string(m_reader.name())
+                  + ">";
+        return std::nullopt;
+    }
+    return frames;
+}
+
+// MLT times are frames ("125"), clock values ("00:00:05.000") or SMPTE
+// timecodes ("00:00:05:00", ';' for drop frame, treated as non-drop).
+bool MltImporter::parseTime(std::string_view text, std::int64_t &frames) const
+{
+    if (text.find_first_of(":;") == std::string_view::npos) {
+        const char *last = text.data() + text.size();
+        const auto [end, error] = std::from_chars(text.data(), last, frames);
+        return error == std::errc() && end == last;
+    }
+
+    // Split into hours, minutes, seconds and, for timecodes, frames.
+    std::string_view fields[4];
+    std::size_t count = 0;
+    for (std::string_view rest = text;;) {
+        const std::size_t split = rest.find_first_of(":;");
+        if (count == 4)
+            return false;
+        fields[count++] = rest.substr(0, split);
+        if (split == std::string_view::npos)
+            break;
+        rest.remove_prefix(split + 1);
+    }
+    if (count < 3)
+        return false;
+
+    std::int64_t whole[4] = {};
+    for (std::size_t i = 0; i < count; ++i) {
+        if (i == 2 && count == 3)
+            continue;
+        const char *begin = fields[i].data();
+        const char *end = begin + fields[i].size();
+        const auto [stop, error] = std::from_chars(begin, end, whole[i]);
+        if (error != std::errc() || stop != end || whole[i] < 0)
+            return false;
+    }
+    const double rate = double(m_rateNum) / double(m_rateDen);
+    const std::int64_t minutes = whole[0] * 60 + whole[1];
+    if (count == 4) {
+        frames = (minutes * 60 + whole[2]) * std::llround(rate) + whole[3];
+        return true;
+    }
+    double seconds = 0.0;
+    const char *begin = fields[2].data();
+    const char *end = begin + fields[2].size();
+    const auto [stop, error] = std::from_chars(begin, end, seconds);
+    if (error != std::errc() || stop != end || seconds < 0.0)
+        return false;
+    frames = std::llround((double(minutes) * 60.0 + seconds) * rate);
+    return true;
+}
+
+Timeline MltImporter::buildTimeline()
+{
+    Timeline timeline(m_rateNum, m_rateDen);
+    std::vector<TractorTrack> order;
+    if (m_main) {
+        order = std::move(*m_main);
+    } else {
+        // No multitrack: every playlist, in document order.
+        for (const std::string &id : m_playlistOrder)
+            order.push_back({id, 0, false});
+    }
+    for (const TractorTrack &entry : order) {
+        // Shotcut's media bin and the black background under track 1 are
+        // not part of the edit.
+        if (entry.producer == "main_bin" || entry.producer == "background") {
+            ++m_stats.skipped;
+            continue;
+        }
+        const auto it = m_playlists.find(entry.producer);
+        if (it == m_playlists.end()) {
+            ++m_stats.skipped;
+            continue;
+        }
+        Playlist playlist = std::move(it->second);
+        m_playlists.erase(it);
+        const TrackKind kind = playlist.audio || entry.hideVideo ? TrackKind::Audio
+                                                                 : TrackKind::Video;
+        const int index = timeline.addTrack(kind);
+        timeline.track(index) = std::move(playlist.track);
+        timeline.track(index).setKind(kind);
+        m_stats.items += timeline.track(index).size();
+    }
+    return timeline;
+}
+
+} // namespace
+
+MltImportResult importMlt(std::istream &in)
+{
+    return MltImporter(in).run();
+}
+
+MltImportResult importMltFile(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        MltImportResult result;
+        result.error = "cannot open " + path;
+        return result;
+    }
+    return importMlt(in);
+}
+
+} // namespace scp
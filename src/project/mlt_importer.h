@@ -0,0 +1,57 @@
+#pragma once
+
+// Imports Shotcut / MLT XML projects into a Timeline.
+//
+// The document is read once, token by token (XmlReader); no tree is built.
+// Producers and chains are reduced to what a timeline item needs (resource,
+// service, filters) as they close, playlist entries are placed on their
+// track as they are read, and the multitrack tractor at the end picks the
+// track order. Memory is the output timeline plus one small record per
+// producer, whatever the size of the document, so a server can batch
+// convert an archive of projects.
+//
+// Mapping: each playlist the main tractor uses becomes a track (audio if
+// Shotcut marked it so or the tractor hides its video), except Shotcut's
+// black "background" playlist and its "main_bin". Entries become clips,
+// blanks advance the track, filters on a producer or entry become filter
+// items over the entry, and filters on a playlist span the track. A
+// transition in Shotcut is a nested tractor used as a playlist entry; it
+// becomes the two overlapping clips plus a transition item per MLT
+// transition service. Track compositing transitions of the main tractor
+// and internal (loader) filters have no counterpart and are counted as
+// skipped. Nested property lists (markers) are ignored.
+
+#include "timeline/timeline.h"
+
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <string>
+
+namespace scp {
+
+struct MltImportStats
+{
+    std::uint64_t bytes = 0;
+    // Producers, chains, playlists, tractors, entries, blanks, tracks,
+    // filters and transitions read.
+    std::uint64_t objects = 0;
+    std::uint64_t items = 0;      // timeline items created
+    std::uint64_t skipped = 0;    // objects the timeline model cannot represent
+    std::uint64_t unresolved = 0; // entries naming a producer not defined before
+    double seconds = 0.0;
+
+    double objectsPerSecond() const { return seconds > 0.0 ? double(objects) / seconds : 0.0; }
+};
+
+struct MltImportResult
+{
+    std::optional<Timeline> timeline; // empty when the import failed
+    std::string error;
+    MltImportStats stats;
+};
+
+MltImportResult importMlt(std::istream &in);
+MltImportResult importMltFile(const std::string &path);
+
+} // namespace scp
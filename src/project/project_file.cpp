@@ -0,0 +1,337 @@
+#include "project/project_file.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+#include <utility>
+
+namespace scp {
+
+namespace {
+
+static_assert(std::endian::native == std::endian::little,
+              "project files are read in place and are little-endian");
+
+constexpr char kMagic[8] = {'S', 'C', 'P', 'P', 'R', 'O', 'J', '\0'};
+constexpr std::uint32_t kVersion = 1;
+
+enum SectionType : std::uint32_t {
+    StringSection = 1,
+    TrackSectionType = 2,
+};
+
+struct Header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t sectionCount;
+    std::int32_t rateNum;
+    std::int32_t rateDen;
+    std::uint32_t trackCount;
+    std::uint32_t reserved;
+};
+
+struct Section
+{
+    std::uint32_t type;
+    std::uint32_t index; // track number for track sections
+    std::uint64_t offset;
+    std::uint64_t size; // bytes
+};
+
+// Followed by count + 1 offsets into the string bytes, then the bytes.
+struct StringHeader
+{
+    std::uint64_t count;
+    std::uint64_t bytes;
+};
+
+// Followed by count item records.
+struct TrackHeader
+{
+    std::uint32_t kind;
+    std::uint32_t nextId;
+    std::uint64_t count;
+};
+
+constexpr std::uint64_t kAlignment = 8;
+
+std::uint64_t aligned(std::uint64_t offset)
+{
+    return (offset + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+class StringTable
+{
+public:
+    std::uint32_t add(const std::string &value)
+    {
+        auto [it, added] = m_indices.try_emplace(value, std::uint32_t(m_offsets.size() - 1));
+        if (added) {
+            m_bytes += value;
+            m_offsets.push_back(m_bytes.size());
+        }
+        return it->second;
+    }
+
+    StringHeader header() const { return {m_offsets.size() - 1, m_bytes.size()}; }
+    const std::vector<std::uint64_t> &offsets() const { return m_offsets; }
+    const std::string &bytes() const { return m_bytes; }
+
+    std::uint64_t sectionSize() const
+    {
+        return sizeof(StringHeader) + m_offsets.size() * sizeof(std::uint64_t) + m_bytes.size();
+    }
+
+private:
+    std::unordered_map<std::string, std::uint32_t> m_indices;
+    std::vector<std::uint64_t> m_offsets{0};
+    std::string m_bytes;
+};
+
+// Flushes path to the device. Syncing the file before the rename keeps a
+// crash from leaving the new name on a file whose data never landed;
+// syncing the directory after it makes the rename itself durable.
+bool syncPath(const std::string &path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    const bool synced = ::fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+}
+
+void pad(std::ofstream &out, std::uint64_t written)
+{
+    static constexpr char zeros[kAlignment] = {};
+    out.write(zeros, std::streamsize(aligned(written) - written));
+}
+
+} // namespace
+
+bool ProjectFile::write(const std::string &path, const Timeline &timeline)
+{
+    StringTable strings;
+    std::vector<TrackHeader> trackHeaders;
+    std::vector<std::vector<ProjectItemRecord>> records;
+    std::vector<ItemId> ids;
+    for (int i = 0; i < timeline.trackCount(); ++i) {
+        const Track &track = timeline.track(i);
+        ids.clear();
+        track.items(ids);
+        std::vector<ProjectItemRecord> &out = records.emplace_back();
+        out.reserve(ids.size());
+        for (const ItemId id : ids) {
+            const TimelineItem &item = *track.item(id);
+            const FrameRange range = *track.range(id);
+            ProjectItemRecord record;
+            record.start = range.start;
+            record.end = range.end;
+            record.sourceIn = item.sourceIn;
+            record.kind = static_cast<std::uint32_t>(item.kind);
+            record.resource = strings.add(item.resource);
+            record.id = id;
+            out.push_back(record);
+        }
+        trackHeaders.push_back({static_cast<std::uint32_t>(track.kind()), track.nextId(),
+                                out.size()});
+    }
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.sectionCount = static_cast<std::uint32_t>(1 + records.size());
+    header.rateNum = timeline.rateNum();
+    header.rateDen = timeline.rateDen();
+    header.trackCount = static_cast<std::uint32_t>(records.size());
+
+    std::vector<Section> sections;
+    std::uint64_t offset = sizeof(Header) + header.sectionCount * sizeof(Section);
+    sections.push_back({StringSection, 0, offset, strings.sectionSize()});
+    offset = aligned(offset + strings.sectionSize());
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        const std::uint64_t size = sizeof(TrackHeader)
+                                   + records[i].size() * sizeof(ProjectItemRecord);
+        sections.push_back({TrackSectionType, std::uint32_t(i), offset, size});
+        offset = aligned(offset + size);
+    }
+
+    const std::string temporary = path + ".tmp";
+    bool written = false;
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char *>(sections.data()),
+                  std::streamsize(sections.size() * sizeof(Section)));
+
+        const StringHeader stringHeader = strings.header();
+        out.write(reinterpret_cast<const char *>(&stringHeader), sizeof(stringHeader));
+        out.write(reinterpret_cast<const char *>(strings.offsets().data()),
+                  std::streamsize(strings.offsets().size() * sizeof(std::uint64_t)));
+        out.write(strings.bytes().data(), std::streamsize(strings.bytes().size()));
+        pad(out, sections[0].offset + sections[0].size);
+
+        for (std::size_t i = 0; i < records.size(); ++i) {
+            out.write(reinterpret_cast<const char *>(&trackHeaders[i]), sizeof(TrackHeader));
+            out.write(reinterpret_cast<const char *>(records[i].data()),
+                      std::streamsize(records[i].size() * sizeof(ProjectItemRecord)));
+            pad(out, sections[i + 1].offset + sections[i + 1].size);
+        }
+        out.close();
+        written = !out.fail();
+    }
+    std::error_code error;
+    if (written && syncPath(temporary))
+        std::filesystem::rename(temporary, path, error);
+    else
+        error = std::make_error_code(std::errc::io_error);
+    if (error) {
+        // Never leave a partial file behind; path itself is untouched.
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    const std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    syncPath(directory.empty() ? "." : directory.string());
+    return true;
+}
+
+std::optional<ProjectFile> ProjectFile::open(const std::string &path)
+{
+    ProjectFile project;
+    if (!project.m_file.open(path) || project.m_file.size() < sizeof(Header))
+        return std::nullopt;
+    const std::uint8_t *base = project.m_file.data();
+    const std::size_t size = project.m_file.size();
+
+    Header header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) || header.version == 0
+        || header.version > kVersion || header.rateNum <= 0 || header.rateDen <= 0)
+        return std::nullopt;
+    if (sizeof(Header) + std::uint64_t(header.sectionCount) * sizeof(Section) > size)
+        return std::nullopt;
+    // Every track needs a section; the count bounds the allocation below.
+    if (header.trackCount > header.sectionCount)
+        return std::nullopt;
+    project.m_version = header.version;
+    project.m_rateNum = header.rateNum;
+    project.m_rateDen = header.rateDen;
+    project.m_tracks.resize(header.trackCount);
+
+    std::vector<bool> seen(header.trackCount);
+    bool hasStrings = false;
+    for (std::uint32_t i = 0; i < header.sectionCount; ++i) {
+        Section section;
+        std::memcpy(&section, base + sizeof(Header) + i * sizeof(Section), sizeof(section));
+        if (section.offset % kAlignment || section.offset > size
+            || section.size > size - section.offset)
+            return std::nullopt;
+        if (section.type == StringSection) {
+            if (hasStrings || !project.readStrings(section.offset, section.size))
+                return std::nullopt;
+            hasStrings = true;
+        } else if (section.type == TrackSectionType) {
+            if (section.index >= header.trackCount || seen[section.index]
+                || !project.readTrack(section.index, section.offset, section.size))
+                return std::nullopt;
+            seen[section.index] = true;
+        }
+    }
+    if (!hasStrings || std::find(seen.begin(), seen.end(), false) != seen.end())
+        return std::nullopt;
+    return project;
+}
+
+bool ProjectFile::readStrings(std::uint64_t offset, std::uint64_t size)
+{
+    if (size < sizeof(StringHeader))
+        return false;
+    StringHeader header;
+    std::memcpy(&header, m_file.data() + offset, sizeof(header));
+    const std::uint64_t available = size - sizeof(StringHeader);
+    if (header.count >= available / sizeof(std::uint64_t))
+        return false;
+    const std::uint64_t offsetBytes = (header.count + 1) * sizeof(std::uint64_t);
+    if (header.bytes > available - offsetBytes)
+        return false;
+    const std::uint8_t *data = m_file.data() + offset + sizeof(StringHeader);
+    m_stringOffsets = {reinterpret_cast<const std::uint64_t *>(data),
+                       static_cast<std::size_t>(header.count + 1)};
+    m_stringData = reinterpret_cast<const char *>(data + offsetBytes);
+    m_stringBytes = header.bytes;
+    return true;
+}
+
+bool ProjectFile::readTrack(std::uint32_t index, std::uint64_t offset, std::uint64_t size)
+{
+    if (size < sizeof(TrackHeader))
+        return false;
+    TrackHeader header;
+    std::memcpy(&header, m_file.data() + offset, sizeof(header));
+    if (header.kind > static_cast<std::uint32_t>(TrackKind::Audio)
+        || header.count > (size - sizeof(TrackHeader)) / sizeof(ProjectItemRecord))
+        return false;
+    TrackSection &track = m_tracks[index];
+    track.kind = static_cast<TrackKind>(header.kind);
+    track.nextId = header.nextId;
+    track.offset = offset + sizeof(TrackHeader);
+    track.items = {reinterpret_cast<const ProjectItemRecord *>(m_file.data() + track.offset),
+                   static_cast<std::size_t>(header.count)};
+    return true;
+}
+
+std::string_view ProjectFile::string(std::uint32_t index) const
+{
+    if (std::size_t(index) + 1 >= m_stringOffsets.size())
+        return {};
+    const std::uint64_t begin = m_stringOffsets[index];
+    const std::uint64_t end = m_stringOffsets[index + 1];
+    if (begin > end || end > m_stringBytes)
+        return {};
+    return {m_stringData + begin, static_cast<std::size_t>(end - begin)};
+}
+
+std::optional<Track> ProjectFile::loadTrack(int index) const
+{
+    const TrackSection &section = m_tracks[index];
+    m_file.advise(static_cast<std::size_t>(section.offset), section.items.size_bytes(),
+                  MappedFile::Advice::WillNeed);
+    Track track(section.kind);
+    for (const ProjectItemRecord &record : section.items) {
+        if (record.kind > static_cast<std::uint32_t>(ItemKind::Filter)
+            || record.end <= record.start
+            || std::size_t(record.resource) + 1 >= m_stringOffsets.size())
+            return std::nullopt;
+        TimelineItem item;
+        item.kind = static_cast<ItemKind>(record.kind);
+        item.resource = std::string(string(record.resource));
+        item.sourceIn = record.sourceIn;
+        if (!track.restore(record.id, std::move(item), {record.start, record.end}))
+            return std::nullopt;
+    }
+    // Ids of items deleted before saving stay retired.
+    track.reserveIds(section.nextId);
+    return track;
+}
+
+std::optional<Timeline> ProjectFile::load() const
+{
+    Timeline timeline(m_rateNum, m_rateDen);
+    for (int i = 0; i < trackCount(); ++i) {
+        std::optional<Track> track = loadTrack(i);
+        if (!track)
+            return std::nullopt;
+        timeline.addTrack(track->kind());
+        timeline.track(i) = std::move(*track);
+    }
+    return timeline;
+}
+
+} // namespace scp
@@ -0,0 +1,98 @@
+#pragma once
+
+// Binary project files.
+//
+// Parsing a large XML project builds a DOM of every track and item before
+// the first frame can be shown. A binary project is instead opened by
+// mapping it and reading a fixed header and an offset table; each track is
+// a separate section that is validated and materialized only when it is
+// first needed (drawn, played, edited). Until then its items cost nothing
+// but address space, and the untouched pages are never read.
+//
+// Layout: header, section table, then 8-byte aligned sections. One string
+// section holds resource names, referenced by index from item records; one
+// section per track holds a small header and the track's item records in
+// start order. Readers skip section types they do not know, so later
+// versions can add sections (parameters, keyframes, bins) without breaking
+// older readers. Files are little-endian.
+
+#include "core/mapped_file.h"
+#include "timeline/timeline.h"
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace scp {
+
+// A saved item, as stored in the file.
+struct ProjectItemRecord
+{
+    std::int64_t start = 0;
+    std::int64_t end = 0;
+    std::int64_t sourceIn = 0;
+    std::uint32_t kind = 0;     // ItemKind
+    std::uint32_t resource = 0; // string index
+    std::uint32_t id = 0;
+    std::uint32_t reserved = 0;
+};
+static_assert(sizeof(ProjectItemRecord) == 40);
+
+class ProjectFile
+{
+public:
+    // Writes timeline atomically: a temporary file, synced, then renamed
+    // over path. On failure path is untouched and no temporary is left.
+    static bool write(const std::string &path, const Timeline &timeline);
+
+    // Maps path and checks the header and section table; sections are
+    // checked as they are read. Returns nullopt for missing or malformed
+    // files and for versions newer than this reader.
+    static std::optional<ProjectFile> open(const std::string &path);
+
+    std::uint32_t version() const { return m_version; }
+    int rateNum() const { return m_rateNum; }
+    int rateDen() const { return m_rateDen; }
+    int trackCount() const { return static_cast<int>(m_tracks.size()); }
+    TrackKind trackKind(int track) const { return m_tracks[track].kind; }
+    std::size_t itemCount(int track) const { return m_tracks[track].items.size(); }
+
+    // The records of track in the mapping, for views that only draw. Their
+    // fields are unchecked until loadTrack().
+    std::span<const ProjectItemRecord> items(int track) const { return m_tracks[track].items; }
+    // Empty for an out of range index.
+    std::string_view string(std::uint32_t index) const;
+
+    // Materializes one track. nullopt if its section is malformed.
+    std::optional<Track> loadTrack(int track) const;
+    // Materializes every track.
+    std::optional<Timeline> load() const;
+
+private:
+    struct TrackSection
+    {
+        TrackKind kind = TrackKind::Video;
+        ItemId nextId = 0;
+        std::uint64_t offset = 0; // of the records
+        std::span<const ProjectItemRecord> items;
+    };
+
+    ProjectFile() = default;
+
+    bool readStrings(std::uint64_t offset, std::uint64_t size);
+    bool readTrack(std::uint32_t index, std::uint64_t offset, std::uint64_t size);
+
+    MappedFile m_file;
+    std::uint32_t m_version = 0;
+    int m_rateNum = 25;
+    int m_rateDen = 1;
+    std::vector<TrackSection> m_tracks;
+    std::span<const std::uint64_t> m_stringOffsets; // count + 1 entries
+    const char *m_stringData = nullptr;
+    std::uint64_t m_stringBytes = 0;
+};
+
+} // namespace scp
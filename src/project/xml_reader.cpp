@@ -0,0 +1,355 @@
+#include "project/xml_reader.h"
+
+#include <charconv>
+
+namespace scp {
+
+namespace {
+
+constexpr std::size_t kChunkBytes = 64 * 1024;
+
+bool isSpace(int c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool isNameChar(int c)
+{
+    return c >= 0 && !isSpace(c) && c != '/' && c != '>' && c != '=' && c != '<' && c != '"'
+           && c != '\'';
+}
+
+void appendUtf8(std::string &out, std::uint32_t code)
+{
+    if (code < 0x80) {
+        out += char(code);
+    } else if (code < 0x800) {
+        out += char(0xc0 | (code >> 6));
+        out += char(0x80 | (code & 0x3f));
+    } else if (code < 0x10000) {
+        out += char(0xe0 | (code >> 12));
+        out += char(0x80 | ((code >> 6) & 0x3f));
+        out += char(0x80 | (code & 0x3f));
+    } else {
+        out += char(0xf0 | (code >> 18));
+        out += char(0x80 | ((code >> 12) & 0x3f));
+        out += char(0x80 | ((code >> 6) & 0x3f));
+        out += char(0x80 | (code & 0x3f));
+    }
+}
+
+} // namespace
+
+XmlReader::XmlReader(std::istream &in, std::size_t maxTokenBytes)
+    : m_in(in)
+    , m_maxTokenBytes(maxTokenBytes)
+    , m_buffer(kChunkBytes)
+{}
+
+std::optional<std::string_view> XmlReader::attribute(std::string_view name) const
+{
+    for (std::size_t i = 0; i < m_attributeCount; ++i) {
+        if (m_attributes[i].first == name)
+            return m_attributes[i].second;
+    }
+    return std::nullopt;
+}
+
+XmlReader::Token XmlReader::next()
+{
+    if (m_failed)
+        return Token::Error;
+    if (m_pendingEnd) {
+        m_pendingEnd = false;
+        m_open.pop_back();
+        return Token::EndElement;
+    }
+    m_attributeCount = 0;
+    for (;;) {
+        const int c = peek();
+        if (c == kEnd) {
+            if (m_in.bad())
+                return fail("read error");
+            if (!m_open.empty())
+                return fail("document ends inside <" + m_open.back() + ">");
+            return Token::EndDocument;
+        }
+        if (c == '<') {
+            get();
+            if (const std::optional<Token> token = readMarkup())
+                return *token;
+            continue;
+        }
+
+        m_text.clear();
+        bool content = false;
+        for (int t = peek(); t != kEnd && t != '<'; t = peek()) {
+            get();
+            if (t == '&') {
+                if (!readReference(m_text))
+                    return Token::Error;
+                content = true;
+                continue;
+            }
+            if (!append(m_text, t))
+                return Token::Error;
+            content = content || !isSpace(t);
+        }
+        if (content)
+            return Token::Text;
+    }
+}
+
+int XmlReader::peek()
+{
+    if (m_position == m_end && !refill())
+        return kEnd;
+    return static_cast<unsigned char>(m_buffer[m_position]);
+}
+
+int XmlReader::get()
+{
+    const int c = peek();
+    if (c != kEnd)
+        ++m_position;
+    return c;
+}
+
+bool XmlReader::refill()
+{
+    if (!m_in)
+        return false;
+    m_in.read(m_buffer.data(), std::streamsize(m_buffer.size()));
+    m_position = 0;
+    m_end = static_cast<std::size_t>(m_in.gcount());
+    m_bytesRead += m_end;
+    return m_end > 0;
+}
+
+XmlReader::Token XmlReader::fail(std::string message)
+{
+    if (!m_failed) {
+        m_failed = true;
+        m_error = std::move(message) + " at byte "
+                  + std::to_string(m_bytesRead - (m_end - m_position));
+    }
+    return Token::Error;
+}
+
+std::optional<XmlReader::Token> XmlReader::readMarkup()
+{
+    const int c = peek();
+    if (c == '?') {
+        if (!skipUntil("?>"))
+            return Token::Error;
+        return std::nullopt;
+    }
+    if (c == '/') {
+        get();
+        return readEndTag();
+    }
+    if (c != '!')
+        return readTag();
+
+    get();
+    if (peek() == '-') {
+        if (!consume("--") || !skipUntil("-->"))
+            return Token::Error;
+        return std::nullopt;
+    }
+    if (peek() == '[') {
+        m_text.clear();
+        if (!consume("[CDATA[") || !skipUntil("]]>", &m_text))
+            return Token::Error;
+        if (m_text.empty())
+            return std::nullopt;
+        return Token::Text;
+    }
+    // <!DOCTYPE ...>, possibly with an internal subset in brackets.
+    int depth = 0;
+    for (int d = get(); d != '>' || depth > 0; d = get()) {
+        if (d == kEnd)
+            return fail("unterminated declaration");
+        depth += d == '[' ? 1 : d == ']' ? -1 : 0;
+    }
+    return std::nullopt;
+}
+
+XmlReader::Token XmlReader::readTag()
+{
+    m_name.clear();
+    if (!readName(m_name))
+        return Token::Error;
+    for (;;) {
+        skipSpace();
+        const int c = peek();
+        if (c == '>' || c == '/') {
+            get();
+            if (c == '/') {
+                if (get() != '>')
+                    return fail("expected '>' after '/' in <" + m_name + ">");
+                m_pendingEnd = true;
+            }
+            m_open.push_back(m_name);
+            return Token::StartElement;
+        }
+        if (c == kEnd)
+            return fail("unterminated tag <" + m_name + ">");
+        if (m_attributeCount == m_attributes.size())
+            m_attributes.emplace_back();
+        auto &[key, value] = m_attributes[m_attributeCount];
+        key.clear();
+        value.clear();
+        if (!readName(key))
+            return Token::Error;
+        skipSpace();
+        if (get() != '=')
+            return fail("expected '=' after attribute " + key);
+        skipSpace();
+        if (!readAttributeValue(value))
+            return Token::Error;
+        ++m_attributeCount;
+    }
+}
+
+XmlReader::Token XmlReader::readEndTag()
+{
+    m_name.clear();
+    if (!readName(m_name))
+        return Token::Error;
+    skipSpace();
+    if (get() != '>')
+        return fail("expected '>' in </" + m_name + ">");
+    if (m_open.empty() || m_open.back() != m_name)
+        return fail("unexpected </" + m_name + ">");
+    m_open.pop_back();
+    return Token::EndElement;
+}
+
+bool XmlReader::consume(std::string_view literal)
+{
+    for (const char expected : literal) {
+        if (get() != static_cast<unsigned char>(expected)) {
+            fail("expected \"" + std::string(literal) + "\"");
+            return false;
+        }
+    }
+    return true;
+}
+
+bool XmlReader::skipUntil(std::string_view terminator, std::string *out)
+{
+    std::string window;
+    for (;;) {
+        const int c = get();
+        if (c == kEnd) {
+            fail("expected \"" + std::string(terminator) + "\"");
+            return false;
+        }
+        if (out && !append(*out, c))
+            return false;
+        window += char(c);
+        if (window.size() > terminator.size())
+            window.erase(window.begin());
+        if (window == terminator) {
+            if (out)
+                out->resize(out->size() - terminator.size());
+            return true;
+        }
+    }
+}
+
+bool XmlReader::readName(std::string &out)
+{
+    while (isNameChar(peek())) {
+        if (!append(out, get()))
+            return false;
+    }
+    if (out.empty()) {
+        fail("expected a name");
+        return false;
+    }
+    return true;
+}
+
+bool XmlReader::readAttributeValue(std::string &out)
+{
+    const int quote = get();
+    if (quote != '"' && quote != '\'') {
+        fail("expected a quoted attribute value");
+        return false;
+    }
+    for (;;) {
+        const int c = get();
+        if (c == quote)
+            return true;
+        if (c == kEnd || c == '<') {
+            fail("unterminated attribute value");
+            return false;
+        }
+        if (c == '&' ? !readReference(out) : !append(out, c))
+            return false;
+    }
+}
+
+bool XmlReader::readReference(std::string &out)
+{
+    char name[12];
+    std::size_t length = 0;
+    for (int c = get(); c != ';'; c = get()) {
+        if (c == kEnd || length == sizeof(name)) {
+            fail("malformed character reference");
+            return false;
+        }
+        name[length++] = char(c);
+    }
+    const std::string_view reference(name, length);
+    if (reference == "amp")
+        out += '&';
+    else if (reference == "lt")
+        out += '<';
+    else if (reference == "gt")
+        out += '>';
+    else if (reference == "quot")
+        out += '"';
+    else if (reference == "apos")
+        out += '\'';
+    else if (reference.size() > 1 && reference[0] == '#') {
+        const bool hex = reference[1] == 'x';
+        const char *first = reference.data() + (hex ? 2 : 1);
+        const char *last = reference.data() + reference.size();
+        std::uint32_t code = 0;
+        const auto [end, error] = std::from_chars(first, last, code, hex ? 16 : 10);
+        if (error != std::errc() || end != last || first == last || code > 0x10ffff) {
+            fail("malformed character reference");
+            return false;
+        }
+        appendUtf8(out, code);
+    } else {
+        fail("unknown entity &" + std::string(reference) + ";");
+        return false;
+    }
+    if (out.size() > m_maxTokenBytes) {
+        fail("token too long");
+        return false;
+    }
+    return true;
+}
+
+bool XmlReader::append(std::string &out, int c)
+{
+    if (out.size() >= m_maxTokenBytes) {
+        fail("token too long");
+        return false;
+    }
+    out += char(c);
+    return true;
+}
+
+void XmlReader::skipSpace()
+{
+    while (isSpace(peek()))
+        get();
+}
+
+} // namespace scp
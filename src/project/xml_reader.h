@@ -0,0 +1,89 @@
+#pragma once
+
+// Streaming XML tokenizer.
+//
+// Reads a stream in fixed-size chunks and returns one token at a time:
+// start tag (with its attributes), end tag or text. Nothing is kept once
+// the next token is read, so memory is bounded by the largest single
+// token, not the document. Enough of XML for MLT and similar machine
+// written files: comments, processing instructions, CDATA, a DOCTYPE
+// without entity definitions, the predefined and numeric character
+// references. Namespaces are left in names ("shotcut:name").
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace scp {
+
+class XmlReader
+{
+public:
+    enum class Token {
+        StartElement,
+        EndElement,
+        Text, // not whitespace only
+        EndDocument,
+        Error,
+    };
+
+    // Tokens longer than maxTokenBytes are an error.
+    explicit XmlReader(std::istream &in, std::size_t maxTokenBytes = std::size_t(16) << 20);
+
+    Token next();
+
+    // Element name of StartElement and EndElement; valid until next().
+    std::string_view name() const { return m_name; }
+    // Decoded text of Text; valid until next().
+    std::string_view text() const { return m_text; }
+    // Attribute of the current StartElement, decoded.
+    std::optional<std::string_view> attribute(std::string_view name) const;
+
+    const std::string &error() const { return m_error; }
+    std::uint64_t bytesRead() const { return m_bytesRead; }
+
+private:
+    static constexpr int kEnd = -1;
+
+    int peek();
+    int get();
+    bool refill();
+
+    Token fail(std::string message);
+    // After '<'. nullopt for markup that is not a token (comments...).
+    std::optional<Token> readMarkup();
+    Token readTag();
+    Token readEndTag();
+    bool consume(std::string_view literal);
+    bool skipUntil(std::string_view terminator, std::string *out = nullptr);
+    bool readName(std::string &out);
+    bool readAttributeValue(std::string &out);
+    bool readReference(std::string &out);
+    bool append(std::string &out, int c);
+    void skipSpace();
+
+    std::istream &m_in;
+    const std::size_t m_maxTokenBytes;
+    std::vector<char> m_buffer;
+    std::size_t m_position = 0;
+    std::size_t m_end = 0;
+    std::uint64_t m_bytesRead = 0;
+
+    std::string m_name;
+    std::string m_text;
+    // Strings are reused across tags to keep their capacity.
+    std::vector<std::pair<std::string, std::string>> m_attributes;
+    std::size_t m_attributeCount = 0;
+    // Names of the open elements, to check end tags against.
+    std::vector<std::string> m_open;
+    bool m_pendingEnd = false; // <tag/>: EndElement comes next
+    bool m_failed = false;
+    std::string m_error;
+};
+
+} // namespace scp
@@ -0,0 +1,28 @@
+#include "render/compositor.h"
+
+namespace scp {
+
+const char *blendModeName(BlendMode mode)
+{
+    switch (mode) {
+    case BlendMode::Normal:
+        return "normal";
+    case BlendMode::Add:
+        return "add";
+    case BlendMode::Multiply:
+        return "multiply";
+    case BlendMode::Screen:
+        return "screen";
+    case BlendMode::Overlay:
+        return "overlay";
+    case BlendMode::Darken:
+        return "darken";
+    case BlendMode::Lighten:
+        return "lighten";
+    case BlendMode::Difference:
+        return "difference";
+    }
+    return "unknown";
+}
+
+} // namespace scp
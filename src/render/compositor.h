@@ -0,0 +1,66 @@
+#pragma once
+
+// Track composition interface shared by the rendering backends.
+//
+// A composition is a stack of layers, bottom first. Each layer places one
+// frame at an integer offset in the output, optionally mixed with a second
+// frame by a transition, and blends it onto everything beneath it. All
+// frames are treated as premultiplied alpha. Backends must produce the same
+// result for the same layer stack; CpuCompositor is the reference.
+
+#include "core/frame_buffer.h"
+
+#include <span>
+
+namespace scp {
+
+enum class BlendMode {
+    Normal,
+    Add,
+    Multiply,
+    Screen,
+    Overlay,
+    Darken,
+    Lighten,
+    Difference,
+};
+
+const char *blendModeName(BlendMode mode);
+
+enum class TransitionKind {
+    None,
+    Dissolve,  // crossfade by progress
+    WipeRight, // target revealed from the left edge
+    WipeDown,  // target revealed from the top edge
+};
+
+struct Transition
+{
+    TransitionKind kind = TransitionKind::None;
+    FrameRef target;       // same size as the layer frame
+    float progress = 0.f;  // 0 = all source, 1 = all target
+    float softness = 0.f;  // wipe edge width as a fraction of the frame
+};
+
+struct CompositeLayer
+{
+    FrameRef frame;
+    int x = 0;
+    int y = 0;
+    float opacity = 1.f;
+    BlendMode blend = BlendMode::Normal;
+    Transition transition;
+};
+
+class Compositor
+{
+public:
+    virtual ~Compositor() = default;
+
+    // Renders layers into output (RGBA8 or RGBA16F) over a transparent
+    // background. Layer frames must be RGBA8 or RGBA16F. Returns false for
+    // unsupported formats.
+    virtual bool composite(std::span<const CompositeLayer> layers, FrameBuffer &output) = 0;
+};
+
+} // namespace scp
@@ -0,0 +1,221 @@
+#include "render/cpu_compositor.h"
+
+#include "core/half_float.h"
+#include "core/thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace scp {
+
+namespace {
+
+bool isRgba(PixelFormat format)
+{
+    return format == PixelFormat::RGBA8 || format == PixelFormat::RGBA16F;
+}
+
+// Reads count pixels of row y starting at column x as float RGBA.
+void loadRow(const FrameBuffer &frame, int x, int y, int count, float *out)
+{
+    const std::uint8_t *row = frame.data(0) + std::ptrdiff_t(y) * frame.stride(0);
+    if (frame.pixelFormat() == PixelFormat::RGBA8) {
+        const std::uint8_t *p = row + 4 * x;
+        for (int i = 0; i < 4 * count; ++i)
+            out[i] = p[i] * (1.f / 255.f);
+    } else {
+        const auto *p = reinterpret_cast<const std::uint16_t *>(row) + 4 * x;
+        for (int i = 0; i < 4 * count; ++i)
+            out[i] = halfToFloat(p[i]);
+    }
+}
+
+void storeRow(FrameBuffer &frame, int x, int y, int count, const float *in)
+{
+    std::uint8_t *row = frame.data(0) + std::ptrdiff_t(y) * frame.stride(0);
+    if (frame.pixelFormat() == PixelFormat::RGBA8) {
+        std::uint8_t *p = row + 4 * x;
+        for (int i = 0; i < 4 * count; ++i)
+            p[i] = static_cast<std::uint8_t>(std::clamp(in[i], 0.f, 1.f) * 255.f + 0.5f);
+    } else {
+        auto *p = reinterpret_cast<std::uint16_t *>(row) + 4 * x;
+        for (int i = 0; i < 4 * count; ++i)
+            p[i] = floatToHalf(in[i]);
+    }
+}
+
+// Mix weight of the transition target at column x / row y of the layer.
+float transitionWeight(const Transition &t, int x, int y, int width, int height)
+{
+    const float progress = std::clamp(t.progress, 0.f, 1.f);
+    float position = 0.f;
+    switch (t.kind) {
+    case TransitionKind::None:
+        return 0.f;
+    case TransitionKind::Dissolve:
+        return progress;
+    case TransitionKind::WipeRight:
+        position = (x + 0.5f) / width;
+        break;
+    case TransitionKind::WipeDown:
+        position = (y + 0.5f) / height;
+        break;
+    }
+    // The target's leading edge travels from 0 to 1 + softness, so the soft
+    // band has fully entered at progress 0 and fully left at progress 1.
+    const float reach = progress * (1.f + t.softness);
+    if (t.softness <= 0.f)
+        return position < reach ? 1.f : 0.f;
+    return std::clamp((reach - position) / t.softness, 0.f, 1.f);
+}
+
+// Separable blend function on unpremultiplied colour.
+template<BlendMode Mode>
+float blendColor(float s, float d)
+{
+    if constexpr (Mode == BlendMode::Multiply)
+        return s * d;
+    else if constexpr (Mode == BlendMode::Screen)
+        return s + d - s * d;
+    else if constexpr (Mode == BlendMode::Overlay)
+        return d <= 0.5f ? 2.f * s * d : 1.f - 2.f * (1.f - s) * (1.f - d);
+    else if constexpr (Mode == BlendMode::Darken)
+        return std::min(s, d);
+    else if constexpr (Mode == BlendMode::Lighten)
+        return std::max(s, d);
+    else if constexpr (Mode == BlendMode::Difference)
+        return std::abs(s - d);
+    else
+        return s;
+}
+
+// Blends premultiplied src over premultiplied dst in place.
+template<BlendMode Mode>
+void blendRow(float *dst, const float *src, int count)
+{
+    for (int i = 0; i < count; ++i, dst += 4, src += 4) {
+        const float sa = src[3];
+        const float da = dst[3];
+        if constexpr (Mode == BlendMode::Normal) {
+            for (int c = 0; c < 4; ++c)
+                dst[c] = src[c] + dst[c] * (1.f - sa);
+        } else if constexpr (Mode == BlendMode::Add) {
+            for (int c = 0; c < 3; ++c)
+                dst[c] = src[c] + dst[c];
+            dst[3] = std::min(1.f, sa + da);
+        } else {
+            // W3C separable blending with premultiplied operands.
+            for (int c = 0; c < 3; ++c) {
+                const float s = sa > 0.f ? src[c] / sa : 0.f;
+                const float d = da > 0.f ? dst[c] / da : 0.f;
+                dst[c] = src[c] * (1.f - da) + dst[c] * (1.f - sa)
+                         + sa * da * blendColor<Mode>(s, d);
+            }
+            dst[3] = sa + da - sa * da;
+        }
+    }
+}
+
+using BlendRowFn = void (*)(float *, const float *, int);
+
+BlendRowFn blendRowFor(BlendMode mode)
+{
+    switch (mode) {
+    case BlendMode::Normal:
+        return blendRow<BlendMode::Normal>;
+    case BlendMode::Add:
+        return blendRow<BlendMode::Add>;
+    case BlendMode::Multiply:
+        return blendRow<BlendMode::Multiply>;
+    case BlendMode::Screen:
+        return blendRow<BlendMode::Screen>;
+    case BlendMode::Overlay:
+        return blendRow<BlendMode::Overlay>;
+    case BlendMode::Darken:
+        return blendRow<BlendMode::Darken>;
+    case BlendMode::Lighten:
+        return blendRow<BlendMode::Lighten>;
+    case BlendMode::Difference:
+        return blendRow<BlendMode::Difference>;
+    }
+    return blendRow<BlendMode::Normal>;
+}
+
+} // namespace
+
+CpuCompositor::CpuCompositor(ThreadPool &pool, int tileWidth, int tileHeight)
+    : m_pool(pool)
+    , m_tileWidth(std::max(8, tileWidth))
+    , m_tileHeight(std::max(1, tileHeight))
+{}
+
+bool CpuCompositor::composite(std::span<const CompositeLayer> layers, FrameBuffer &output)
+{
+    if (!isRgba(output.pixelFormat()))
+        return false;
+    for (const CompositeLayer &layer : layers) {
+        if (!layer.frame || !isRgba(layer.frame->pixelFormat()))
+            return false;
+        const FrameRef &target = layer.transition.target;
+        if (layer.transition.kind != TransitionKind::None
+            && (!target || !isRgba(target->pixelFormat())
+                || target->width() != layer.frame->width()
+                || target->height() != layer.frame->height()))
+            return false;
+    }
+
+    const int columns = (output.width() + m_tileWidth - 1) / m_tileWidth;
+    const int rows = (output.height() + m_tileHeight - 1) / m_tileHeight;
+    m_pool.parallelFor(std::size_t(columns) * rows, [&](std::size_t tile) {
+        const int x0 = static_cast<int>(tile % columns) * m_tileWidth;
+        const int y0 = static_cast<int>(tile / columns) * m_tileHeight;
+        compositeTile(layers, output, x0, y0, std::min(x0 + m_tileWidth, output.width()),
+                      std::min(y0 + m_tileHeight, output.height()));
+    });
+    return true;
+}
+
+void CpuCompositor::compositeTile(std::span<const CompositeLayer> layers, FrameBuffer &output,
+                                  int x0, int y0, int x1, int y1) const
+{
+    const int width = x1 - x0;
+    thread_local std::vector<float> accumulator, source, target;
+    accumulator.resize(std::size_t(width) * 4);
+    source.resize(accumulator.size());
+    target.resize(accumulator.size());
+
+    for (int y = y0; y < y1; ++y) {
+        std::fill(accumulator.begin(), accumulator.end(), 0.f);
+        for (const CompositeLayer &layer : layers) {
+            const FrameBuffer &frame = *layer.frame;
+            const int layerY = y - layer.y;
+            const int begin = std::max(x0, layer.x);
+            const int end = std::min(x1, layer.x + frame.width());
+            if (layerY < 0 || layerY >= frame.height() || begin >= end || layer.opacity <= 0.f)
+                continue;
+            const int count = end - begin;
+            const int layerX = begin - layer.x;
+            loadRow(frame, layerX, layerY, count, source.data());
+
+            const Transition &transition = layer.transition;
+            if (transition.kind != TransitionKind::None) {
+                loadRow(*transition.target, layerX, layerY, count, target.data());
+                for (int i = 0; i < count; ++i) {
+                    const float w = transitionWeight(transition, layerX + i, layerY,
+                                                     frame.width(), frame.height());
+                    for (int c = 0; c < 4; ++c)
+                        source[4 * i + c] += (target[4 * i + c] - source[4 * i + c]) * w;
+                }
+            }
+            if (layer.opacity < 1.f) {
+                for (int i = 0; i < 4 * count; ++i)
+                    source[i] *= layer.opacity;
+            }
+            blendRowFor(layer.blend)(accumulator.data() + 4 * (begin - x0), source.data(), count);
+        }
+        storeRow(output, x0, y, width, accumulator.data());
+    }
+}
+
+} // namespace scp
@@ -0,0 +1,36 @@
+#pragma once
+
+// Reference compositor for machines without a GPU.
+//
+// The output is cut into tiles small enough that a tile's accumulator and
+// source rows stay in L2; tiles are composited independently on the shared
+// work-stealing pool, each running the whole layer stack. Accumulation is
+// float RGBA regardless of input and output formats.
+
+#include "render/compositor.h"
+
+namespace scp {
+
+class ThreadPool;
+
+class CpuCompositor final : public Compositor
+{
+public:
+    static constexpr int kDefaultTileWidth = 256;
+    static constexpr int kDefaultTileHeight = 32;
+
+    explicit CpuCompositor(ThreadPool &pool, int tileWidth = kDefaultTileWidth,
+                           int tileHeight = kDefaultTileHeight);
+
+    bool composite(std::span<const CompositeLayer> layers, FrameBuffer &output) override;
+
+private:
+    void compositeTile(std::span<const CompositeLayer> layers, FrameBuffer &output, int x0,
+                       int y0, int x1, int y1) const;
+
+    ThreadPool &m_pool;
+    int m_tileWidth;
+    int m_tileHeight;
+};
+
+} // namespace scp
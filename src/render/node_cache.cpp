@@ -0,0 +1,106 @@
+#include "render/node_cache.h"
+
+#include "core/frame_pool.h"
+
+#include <unordered_set>
+
+namespace scp {
+
+NodeCache::NodeCache(std::size_t byteBudget)
+    : m_budget(byteBudget)
+{}
+
+FrameRef NodeCache::find(std::uint64_t hash)
+{
+    std::lock_guard lock(m_mutex);
+    auto it = m_index.find(hash);
+    if (it == m_index.end()) {
+        ++m_stats.misses;
+        return {};
+    }
+    ++m_stats.hits;
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    return it->second->frame;
+}
+
+void NodeCache::insert(std::uint64_t hash, const FrameRef &frame, std::uint32_t node)
+{
+    if (!frame)
+        return;
+    const std::size_t bytes = FramePool::bufferBytes(frame->format());
+    std::lock_guard lock(m_mutex);
+    if (auto it = m_index.find(hash); it != m_index.end()) {
+        m_stats.bytes -= it->second->bytes;
+        m_lru.erase(it->second);
+        m_index.erase(it);
+    }
+    m_lru.push_front({hash, frame, bytes, node});
+    m_index.emplace(hash, m_lru.begin());
+    m_stats.bytes += bytes;
+    evictLocked();
+}
+
+void NodeCache::evictLocked()
+{
+    // Never evict the entry that was just inserted.
+    while (m_stats.bytes > m_budget && m_lru.size() > 1) {
+        const Entry &victim = m_lru.back();
+        m_stats.bytes -= victim.bytes;
+        m_index.erase(victim.hash);
+        m_lru.pop_back();
+        ++m_stats.evictions;
+    }
+}
+
+void NodeCache::clear()
+{
+    std::lock_guard lock(m_mutex);
+    m_lru.clear();
+    m_index.clear();
+    m_stats.bytes = 0;
+}
+
+std::size_t NodeCache::demote(std::span<const std::uint32_t> nodes)
+{
+    if (nodes.empty())
+        return 0;
+    const std::unordered_set<std::uint32_t> wanted(nodes.begin(), nodes.end());
+    std::size_t moved = 0;
+    std::lock_guard lock(m_mutex);
+    // The budget holds a few hundred frames at most; a scan is cheap next
+    // to rendering any of them.
+    const std::size_t count = m_lru.size();
+    auto it = m_lru.begin();
+    for (std::size_t i = 0; i < count; ++i) {
+        auto entry = it++;
+        if (wanted.contains(entry->node)) {
+            m_lru.splice(m_lru.end(), m_lru, entry);
+            ++moved;
+        }
+    }
+    m_stats.demoted += moved;
+    return moved;
+}
+
+std::size_t NodeCache::byteBudget() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_budget;
+}
+
+void NodeCache::setByteBudget(std::size_t bytes)
+{
+    std::lock_guard lock(m_mutex);
+    m_budget = bytes;
+    evictLocked();
+}
+
+NodeCacheStats NodeCache::stats() const
+{
+    std::lock_guard lock(m_mutex);
+    NodeCacheStats stats = m_stats;
+    stats.entries = m_lru.size();
+    return stats;
+}
+
+} // namespace scp
@@ -0,0 +1,74 @@
+#pragma once
+
+// Content-addressed cache of render graph node outputs.
+//
+// Keys are node content hashes, so an entry stays valid for as long as the
+// node's inputs and parameters hash the same. Entries are evicted least
+// recently used first once the byte budget is exceeded.
+//
+// Entries also remember the node that produced them. An edit cannot make an
+// entry wrong, only unlikely to be asked for again (undo may bring the old
+// hash back), so after an edit the changed nodes' entries are demoted to be
+// evicted first rather than dropped.
+
+#include "core/frame_buffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+
+namespace scp {
+
+struct NodeCacheStats
+{
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0;
+    std::uint64_t demoted = 0;
+    std::size_t entries = 0;
+    std::size_t bytes = 0;
+};
+
+class NodeCache
+{
+public:
+    static constexpr std::size_t kDefaultBudget = std::size_t(1) << 30;
+    static constexpr std::uint32_t kNoNode = UINT32_MAX;
+
+    explicit NodeCache(std::size_t byteBudget = kDefaultBudget);
+
+    FrameRef find(std::uint64_t hash);
+    // node is the render graph node that produced frame.
+    void insert(std::uint64_t hash, const FrameRef &frame, std::uint32_t node = kNoNode);
+    void clear();
+
+    // Moves the entries of nodes to the cold end of the LRU. Returns how
+    // many were moved.
+    std::size_t demote(std::span<const std::uint32_t> nodes);
+
+    std::size_t byteBudget() const;
+    void setByteBudget(std::size_t bytes);
+    NodeCacheStats stats() const;
+
+private:
+    struct Entry
+    {
+        std::uint64_t hash;
+        FrameRef frame;
+        std::size_t bytes;
+        std::uint32_t node;
+    };
+
+    void evictLocked();
+
+    mutable std::mutex m_mutex;
+    std::list<Entry> m_lru; // most recent first
+    std::unordered_map<std::uint64_t, std::list<Entry>::iterator> m_index;
+    std::size_t m_budget;
+    NodeCacheStats m_stats;
+};
+
+} // namespace scp
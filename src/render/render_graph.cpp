@@ -0,0 +1,252 @@
+#include "render/render_graph.h"
+
+#include "core/frame_pool.h"
+#include "core/hash.h"
+#include "core/thread_pool.h"
+#include "render/node_cache.h"
+
+#include <atomic>
+#include <cassert>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace scp {
+
+RenderGraph::RenderGraph(ThreadPool &pool, NodeCache &cache)
+    : m_pool(pool)
+    , m_cache(cache)
+{}
+
+RenderGraph::~RenderGraph() = default;
+
+NodeId RenderGraph::addNode(std::unique_ptr<RenderNode> node)
+{
+    m_nodes.push_back({std::move(node), {}});
+    return static_cast<NodeId>(m_nodes.size() - 1);
+}
+
+bool RenderGraph::reaches(NodeId from, NodeId to) const
+{
+    // True if to is from or one of from's (transitive) inputs.
+    std::vector<NodeId> stack{from};
+    std::vector<bool> seen(m_nodes.size());
+    while (!stack.empty()) {
+        const NodeId id = stack.back();
+        stack.pop_back();
+        if (id == to)
+            return true;
+        if (seen[id])
+            continue;
+        seen[id] = true;
+        stack.insert(stack.end(), m_nodes[id].inputs.begin(), m_nodes[id].inputs.end());
+    }
+    return false;
+}
+
+bool RenderGraph::connect(NodeId from, NodeId to)
+{
+    if (reaches(from, to))
+        return false;
+    m_nodes[to].inputs.push_back(from);
+    return true;
+}
+
+void RenderGraph::setInputs(NodeId id, std::vector<NodeId> inputs)
+{
+    m_nodes[id].inputs = std::move(inputs);
+    assert(!reaches(id, id) || m_nodes[id].inputs.empty());
+}
+
+std::uint64_t RenderGraph::hashNode(NodeId id, const RenderContext &context,
+                                   std::unordered_map<NodeId, std::uint64_t> &memo) const
+{
+    if (auto it = memo.find(id); it != memo.end())
+        return it->second;
+    const Slot &slot = m_nodes[id];
+    std::uint64_t h = hashString(slot.node->name());
+    h = hashValue(h, context.format.width);
+    h = hashValue(h, context.format.height);
+    h = hashValue(h, context.format.pixelFormat);
+    h = hashCombine(h, slot.node->parameterHash(context));
+    for (NodeId input : slot.inputs)
+        h = hashCombine(h, hashNode(input, context, memo));
+    memo.emplace(id, h);
+    return h;
+}
+
+std::uint64_t RenderGraph::contentHash(NodeId id, const RenderContext &context) const
+{
+    std::unordered_map<NodeId, std::uint64_t> memo;
+    return hashNode(id, context, memo);
+}
+
+std::vector<NodeId> RenderGraph::downstream(std::span<const NodeId> nodes) const
+{
+    std::vector<std::vector<NodeId>> consumers(m_nodes.size());
+    for (NodeId id = 0; id < m_nodes.size(); ++id) {
+        for (NodeId input : m_nodes[id].inputs)
+            consumers[input].push_back(id);
+    }
+    std::vector<bool> seen(m_nodes.size());
+    std::vector<NodeId> result;
+    for (NodeId id : nodes) {
+        if (id < m_nodes.size() && !seen[id]) {
+            seen[id] = true;
+            result.push_back(id);
+        }
+    }
+    for (std::size_t i = 0; i < result.size(); ++i) {
+        for (NodeId consumer : consumers[result[i]]) {
+            if (!seen[consumer]) {
+                seen[consumer] = true;
+                result.push_back(consumer);
+            }
+        }
+    }
+    return result;
+}
+
+FrameRef RenderGraph::evaluate(NodeId output, const RenderContext &context,
+                               RenderGraphStats *stats)
+{
+    struct Work
+    {
+        std::uint64_t hash = 0;
+        FrameRef result;
+        bool needed = false;
+        std::atomic<std::uint32_t> pendingInputs{0};
+        std::vector<NodeId> dependents;
+    };
+    std::unordered_map<NodeId, Work> work;
+    RenderGraphStats local;
+
+    // Hash every reachable node bottom-up.
+    std::unordered_map<NodeId, std::uint64_t> hashes;
+    hashNode(output, context, hashes);
+    for (const auto &[id, hash] : hashes)
+        work[id].hash = hash;
+    local.nodesVisited = static_cast<std::uint32_t>(hashes.size());
+
+    // Walk down from the output; a cache hit cuts off the whole subtree.
+    std::vector<NodeId> ready;
+    auto markNeeded = [&](auto &self, NodeId id) -> void {
+        Work &w = work[id];
+        if (w.needed || w.result)
+            return;
+        if ((w.result = m_cache.find(w.hash))) {
+            ++local.cacheHits;
+            return;
+        }
+        w.needed = true;
+        std::uint32_t pending = 0;
+        for (NodeId input : m_nodes[id].inputs) {
+            self(self, input);
+            if (work[input].needed) {
+                work[input].dependents.push_back(id);
+                ++pending;
+            }
+        }
+        w.pendingInputs.store(pending, std::memory_order_relaxed);
+        if (pending == 0)
+            ready.push_back(id);
+    };
+    markNeeded(markNeeded, output);
+
+    std::uint32_t toRender = 0;
+    for (auto &[id, w] : work)
+        toRender += w.needed;
+    local.nodesRendered = toRender;
+
+    std::atomic<std::uint32_t> remaining{toRender};
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+    // Runs one node, then releases dependents whose inputs are all done.
+    // All state lives on this stack frame, which outlives every task because
+    // we wait for remaining to reach zero below.
+    auto runNode = [&](auto &self, NodeId id) -> void {
+        Work &w = work.at(id);
+        const Slot &slot = m_nodes[id];
+        std::vector<FrameRef> inputs;
+        inputs.reserve(slot.inputs.size());
+        for (NodeId input : slot.inputs)
+            inputs.push_back(work.at(input).result);
+        try {
+            w.result = slot.node->render(context, inputs);
+            m_cache.insert(w.hash, w.result, id);
+        } catch (...) {
+            std::lock_guard lock(errorMutex);
+            if (!error)
+                error = std::current_exception();
+        }
+        // Inputs are still held by their own Work entries; drop this copy
+        // before signalling. Once remaining reaches zero evaluate() returns,
+        // and the pool these frames recycle into may go away with its caller.
+        inputs.clear();
+        for (NodeId dependent : w.dependents) {
+            if (work.at(dependent).pendingInputs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                m_pool.submit([&self, dependent] { self(self, dependent); });
+        }
+        remaining.fetch_sub(1, std::memory_order_acq_rel);
+    };
+    for (NodeId id : ready)
+        m_pool.submit([&runNode, id] { runNode(runNode, id); });
+    while (remaining.load(std::memory_order_acquire) > 0) {
+        if (!m_pool.runPendingTask())
+            std::this_thread::yield();
+    }
+
+    if (stats)
+        *stats = local;
+    if (error)
+        std::rethrow_exception(error);
+    return work[output].result;
+}
+
+CompositeNode::CompositeNode(Compositor &compositor, std::vector<CompositeLayer> layers)
+    : m_compositor(compositor)
+    , m_layers(std::move(layers))
+{}
+
+std::uint64_t CompositeNode::parameterHash(const RenderContext &) const
+{
+    std::uint64_t h = m_layers.size();
+    for (const CompositeLayer &layer : m_layers) {
+        h = hashValue(h, layer.x);
+        h = hashValue(h, layer.y);
+        h = hashValue(h, layer.opacity);
+        h = hashValue(h, layer.blend);
+        h = hashValue(h, layer.transition.kind);
+        h = hashValue(h, layer.transition.progress);
+        h = hashValue(h, layer.transition.softness);
+    }
+    return h;
+}
+
+std::size_t CompositeNode::inputCount() const
+{
+    std::size_t count = m_layers.size();
+    for (const CompositeLayer &layer : m_layers)
+        count += layer.transition.kind != TransitionKind::None;
+    return count;
+}
+
+FrameRef CompositeNode::render(const RenderContext &context, std::span<const FrameRef> inputs)
+{
+    if (!context.pool || inputs.size() != inputCount())
+        return {};
+    std::vector<CompositeLayer> layers = m_layers;
+    std::size_t next = 0;
+    for (CompositeLayer &layer : layers) {
+        layer.frame = inputs[next++];
+        if (layer.transition.kind != TransitionKind::None)
+            layer.transition.target = inputs[next++];
+    }
+    FrameRef output = context.pool->acquire(context.format);
+    if (!output || !m_compositor.composite(layers, *output))
+        return {};
+    return output;
+}
+
+} // namespace scp
@@ -0,0 +1,135 @@
+#pragma once
+
+// Rendering graph: a DAG of sources, filters, transitions and compositors.
+//
+// Every node has a content hash derived from its kind, its parameters at
+// the requested time and the hashes of its inputs. Evaluating an output walks
+// back from it and stops at any node whose hash is already in the NodeCache,
+// so changing one parameter only re-renders that node and what depends on
+// it. Nodes that are needed run on the thread pool as soon as all of their
+// inputs are available; independent branches run in parallel.
+//
+// The graph's structure must not change while evaluate() runs. Nodes must
+// be safe to render concurrently for different contexts.
+
+#include "core/frame_buffer.h"
+#include "render/compositor.h"
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace scp {
+
+class FramePool;
+class NodeCache;
+class ThreadPool;
+
+using NodeId = std::uint32_t;
+
+struct RenderContext
+{
+    std::int64_t frame = 0;   // timeline frame being rendered
+    FrameFormat format;       // format of the final output
+    FramePool *pool = nullptr;
+};
+
+class RenderNode
+{
+public:
+    enum class Kind {
+        Source,
+        Filter,
+        Transition,
+        Compositor,
+    };
+
+    virtual ~RenderNode() = default;
+
+    virtual Kind kind() const = 0;
+    virtual std::string name() const = 0;
+
+    // Hash of everything besides the inputs that affects the output at
+    // context.frame: parameters (animated values sampled at that frame),
+    // and for sources the media identity and source frame.
+    virtual std::uint64_t parameterHash(const RenderContext &context) const = 0;
+
+    // Produces the node's output from its inputs, in connection order.
+    // Returns a null ref on failure.
+    virtual FrameRef render(const RenderContext &context, std::span<const FrameRef> inputs) = 0;
+};
+
+struct RenderGraphStats
+{
+    std::uint32_t nodesVisited = 0;
+    std::uint32_t nodesRendered = 0;
+    std::uint32_t cacheHits = 0;
+};
+
+class RenderGraph
+{
+public:
+    RenderGraph(ThreadPool &pool, NodeCache &cache);
+    ~RenderGraph();
+
+    NodeId addNode(std::unique_ptr<RenderNode> node);
+    RenderNode &node(NodeId id) const { return *m_nodes[id].node; }
+    std::size_t nodeCount() const { return m_nodes.size(); }
+
+    // Appends from to to's inputs. Returns false if that would create a cycle.
+    bool connect(NodeId from, NodeId to);
+    void setInputs(NodeId id, std::vector<NodeId> inputs);
+    const std::vector<NodeId> &inputs(NodeId id) const { return m_nodes[id].inputs; }
+
+    std::uint64_t contentHash(NodeId id, const RenderContext &context) const;
+
+    // nodes and every node that consumes their output, directly or not:
+    // what an edit to nodes changes.
+    std::vector<NodeId> downstream(std::span<const NodeId> nodes) const;
+
+    // Renders output for context, reusing cached node results. Rethrows the
+    // first exception a node throws.
+    FrameRef evaluate(NodeId output, const RenderContext &context,
+                      RenderGraphStats *stats = nullptr);
+
+private:
+    struct Slot
+    {
+        std::unique_ptr<RenderNode> node;
+        std::vector<NodeId> inputs;
+    };
+
+    bool reaches(NodeId from, NodeId to) const;
+    std::uint64_t hashNode(NodeId id, const RenderContext &context,
+                           std::unordered_map<NodeId, std::uint64_t> &memo) const;
+
+    ThreadPool &m_pool;
+    NodeCache &m_cache;
+    std::vector<Slot> m_nodes;
+};
+
+// Compositor adapter. Inputs are consumed in layer order: each layer's
+// frame, followed by its transition target if it has a transition. The
+// frames stored in the layers themselves are ignored.
+class CompositeNode final : public RenderNode
+{
+public:
+    CompositeNode(Compositor &compositor, std::vector<CompositeLayer> layers);
+
+    Kind kind() const override { return Kind::Compositor; }
+    std::string name() const override { return "composite"; }
+    std::uint64_t parameterHash(const RenderContext &context) const override;
+    FrameRef render(const RenderContext &context, std::span<const FrameRef> inputs) override;
+
+    std::vector<CompositeLayer> &layers() { return m_layers; }
+    std::size_t inputCount() const;
+
+private:
+    Compositor &m_compositor;
+    std::vector<CompositeLayer> m_layers;
+};
+
+} // namespace scp
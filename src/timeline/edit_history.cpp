@@ -0,0 +1,83 @@
+#include "timeline/edit_history.h"
+
+#include <utility>
+
+namespace scp {
+
+EditHistory::EditHistory(Timeline timeline, std::size_t limit)
+    : m_limit(limit)
+{
+    m_versions.push_back({std::make_shared<const Timeline>(std::move(timeline)), {}, {}});
+    publish();
+}
+
+TimelineChange EditHistory::edit(const std::function<TimelineChange(Timeline &)> &edit,
+                                 std::string text)
+{
+    Timeline timeline = *m_versions[m_index].timeline;
+    TimelineChange change = edit(timeline);
+    if (!change.isEmpty())
+        push(std::move(timeline), change, std::move(text));
+    return change;
+}
+
+void EditHistory::push(Timeline timeline, TimelineChange change, std::string text)
+{
+    m_versions.erase(m_versions.begin() + std::ptrdiff_t(m_index + 1), m_versions.end());
+    m_versions.push_back({std::make_shared<const Timeline>(std::move(timeline)),
+                          std::move(change), std::move(text)});
+    ++m_index;
+    while (m_index > m_limit) {
+        m_versions.pop_front();
+        --m_index;
+    }
+    publish();
+}
+
+const std::string &EditHistory::undoText() const
+{
+    static const std::string none;
+    return canUndo() ? m_versions[m_index].text : none;
+}
+
+const std::string &EditHistory::redoText() const
+{
+    static const std::string none;
+    return canRedo() ? m_versions[m_index + 1].text : none;
+}
+
+TimelineChange EditHistory::undo()
+{
+    if (!canUndo())
+        return {};
+    TimelineChange change = m_versions[m_index].change;
+    --m_index;
+    publish();
+    return change;
+}
+
+TimelineChange EditHistory::redo()
+{
+    if (!canRedo())
+        return {};
+    ++m_index;
+    publish();
+    return m_versions[m_index].change;
+}
+
+void EditHistory::clear()
+{
+    Version version = std::move(m_versions[m_index]);
+    version.change = {};
+    version.text.clear();
+    m_versions.clear();
+    m_versions.push_back(std::move(version));
+    m_index = 0;
+}
+
+void EditHistory::publish()
+{
+    m_current.store(m_versions[m_index].timeline);
+}
+
+} // namespace scp
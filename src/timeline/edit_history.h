@@ -0,0 +1,77 @@
+#pragma once
+
+// Undo and redo as a list of timeline versions.
+//
+// Instead of commands that know how to reverse themselves, every edit
+// records the whole timeline it produced. Copying a Timeline is cheap and
+// its tracks share all unchanged nodes with the previous version, so a
+// version costs the O(log n) nodes the edit copied; undo and redo just
+// pick another version, whatever the edit was, and cost nothing to
+// replay in a session with thousands of edits.
+//
+// Versions are immutable once recorded. current() may be called from any
+// thread, so autosave and the renderer read the edit without stopping the
+// editor; everything else belongs to the editing thread.
+
+#include "timeline/timeline.h"
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace scp {
+
+class EditHistory
+{
+public:
+    // Keeps at most limit undo steps; the oldest are dropped first.
+    explicit EditHistory(Timeline timeline = Timeline(), std::size_t limit = 10000);
+
+    // The current version. Any thread.
+    std::shared_ptr<const Timeline> current() const { return m_current.load(); }
+
+    // Runs edit on a copy of the current version and, if it changed
+    // anything, records the result under text. Redo steps are dropped.
+    TimelineChange edit(const std::function<TimelineChange(Timeline &)> &edit,
+                        std::string text = {});
+    // Records timeline, an edited copy of current(), as the next version.
+    void push(Timeline timeline, TimelineChange change, std::string text = {});
+
+    bool canUndo() const { return m_index > 0; }
+    bool canRedo() const { return m_index + 1 < m_versions.size(); }
+    const std::string &undoText() const;
+    const std::string &redoText() const;
+
+    // Step back or forward. Each returns what the step changed, for
+    // RenderInvalidator; empty when there is nothing to undo or redo.
+    TimelineChange undo();
+    TimelineChange redo();
+
+    // Versions held, including the current one, and the current one's index.
+    std::size_t size() const { return m_versions.size(); }
+    std::size_t index() const { return m_index; }
+    // Drops every version but the current one.
+    void clear();
+
+private:
+    struct Version
+    {
+        std::shared_ptr<const Timeline> timeline;
+        // What the edit leading here changed, relative to the version
+        // before; undoing it changes the same frames back.
+        TimelineChange change;
+        std::string text;
+    };
+
+    void publish();
+
+    const std::size_t m_limit;
+    std::deque<Version> m_versions;
+    std::size_t m_index = 0;
+    std::atomic<std::shared_ptr<const Timeline>> m_current;
+};
+
+} // namespace scp
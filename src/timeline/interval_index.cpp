@@ -0,0 +1,349 @@
+#include "timeline/interval_index.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace scp {
+
+namespace {
+
+// Gap left between labels when appending or prepending, so that building a
+// track front to back never runs out of room between neighbours.
+constexpr std::uint64_t kLabelStep = std::uint64_t(1) << 32;
+// Density threshold of the order-maintenance relabelling: an aligned range
+// of 2^i labels may hold up to (2 / kDensityBase)^i nodes before a
+// relabel must widen past it. Between 1 and 2; with 64-bit labels, 1.4
+// still fits every id a track can hold in the full range.
+constexpr double kDensityBase = 1.4;
+
+} // namespace
+
+void IntervalIndex::clear()
+{
+    m_root.reset();
+    m_labels.clear();
+}
+
+void IntervalIndex::insert(ItemId id, FrameRange range)
+{
+    erase(id);
+    Node node;
+    node.start = range.start;
+    node.end = range.end;
+    node.maxEnd = range.end;
+    node.id = id;
+    insertNode(std::move(node));
+}
+
+bool IntervalIndex::erase(ItemId id)
+{
+    const std::optional<FrameRange> range = find(id);
+    if (!range)
+        return false;
+    // The key right after (start, id).
+    const Key next = id == UINT32_MAX ? Key{range->start + 1, 0} : Key{range->start, id + 1};
+
+    NodePtr left, rest, middle, right;
+    split(m_root, {range->start, id}, left, rest);
+    split(rest, next, middle, right); // middle is id's node
+    m_root = merge(left, right);
+    m_labels.erase(id);
+    return true;
+}
+
+std::optional<FrameRange> IntervalIndex::find(ItemId id) const
+{
+    const std::uint64_t *label = m_labels.find(id);
+    if (!label)
+        return std::nullopt;
+    std::int64_t shift = 0;
+    for (const Node *node = m_root.get(); node;) {
+        if (node->label == *label)
+            return FrameRange{node->start + shift, node->end + shift};
+        shift += node->shift;
+        node = *label < node->label ? node->left.get() : node->right.get();
+    }
+    return std::nullopt;
+}
+
+void IntervalIndex::shift(std::int64_t from, std::int64_t delta)
+{
+    if (delta == 0 || !m_root)
+        return;
+    NodePtr before, after;
+    split(m_root, {from, 0}, before, after);
+    after = shifted(after, delta);
+    if (delta > 0) {
+        m_root = merge(before, after);
+        return;
+    }
+    // Moving left, the shifted items may pass items that start in the
+    // frames they move over. Those are few (usually none): reinsert them.
+    NodePtr kept, passed;
+    split(before, {from + delta, 0}, kept, passed);
+    m_root = merge(kept, after);
+    std::vector<Node> nodes;
+    collect(passed.get(), 0, nodes);
+    for (Node &node : nodes)
+        insertNode(std::move(node));
+}
+
+void IntervalIndex::stab(std::int64_t frame, std::vector<ItemId> &out) const
+{
+    stab(m_root.get(), 0, frame, out);
+}
+
+void IntervalIndex::overlapping(FrameRange range, std::vector<ItemId> &out) const
+{
+    if (!range.isEmpty())
+        overlapping(m_root.get(), 0, range, out);
+}
+
+void IntervalIndex::all(std::vector<ItemId> &out) const
+{
+    out.reserve(out.size() + size());
+    all(m_root.get(), out);
+}
+
+IntervalIndex::NodePtr IntervalIndex::shifted(const NodePtr &node, std::int64_t delta)
+{
+    if (!node || delta == 0)
+        return node;
+    auto copy = std::make_shared<Node>(*node);
+    copy->start += delta;
+    copy->end += delta;
+    copy->maxEnd += delta;
+    copy->shift += delta;
+    return copy;
+}
+
+std::shared_ptr<IntervalIndex::Node> IntervalIndex::pushed(const NodePtr &node)
+{
+    auto copy = std::make_shared<Node>(*node);
+    if (copy->shift != 0) {
+        copy->left = shifted(copy->left, copy->shift);
+        copy->right = shifted(copy->right, copy->shift);
+        copy->shift = 0;
+    }
+    return copy;
+}
+
+void IntervalIndex::pull(Node &node)
+{
+    node.maxEnd = node.end;
+    node.size = 1;
+    for (const NodePtr &child : {node.left, node.right}) {
+        if (child) {
+            node.maxEnd = std::max(node.maxEnd, child->maxEnd + node.shift);
+            node.size += child->size;
+        }
+    }
+}
+
+void IntervalIndex::split(NodePtr node, Key key, NodePtr &left, NodePtr &right)
+{
+    if (!node) {
+        left = right = nullptr;
+        return;
+    }
+    const std::shared_ptr<Node> copy = pushed(node);
+    if (Key{copy->start, copy->id} < key) {
+        split(copy->right, key, copy->right, right);
+        pull(*copy);
+        left = copy;
+    } else {
+        split(copy->left, key, left, copy->left);
+        pull(*copy);
+        right = copy;
+    }
+}
+
+IntervalIndex::NodePtr IntervalIndex::merge(NodePtr left, NodePtr right)
+{
+    if (!left)
+        return right;
+    if (!right)
+        return left;
+    if (left->priority > right->priority) {
+        const std::shared_ptr<Node> copy = pushed(left);
+        copy->right = merge(copy->right, std::move(right));
+        pull(*copy);
+        return copy;
+    }
+    const std::shared_ptr<Node> copy = pushed(right);
+    copy->left = merge(std::move(left), copy->left);
+    pull(*copy);
+    return copy;
+}
+
+void IntervalIndex::splitLabel(NodePtr node, std::uint64_t label, NodePtr &left, NodePtr &right)
+{
+    if (!node) {
+        left = right = nullptr;
+        return;
+    }
+    const std::shared_ptr<Node> copy = pushed(node);
+    if (copy->label <= label) {
+        splitLabel(copy->right, label, copy->right, right);
+        pull(*copy);
+        left = copy;
+    } else {
+        splitLabel(copy->left, label, left, copy->left);
+        pull(*copy);
+        right = copy;
+    }
+}
+
+std::uint64_t IntervalIndex::countLabels(const Node *node, std::uint64_t label)
+{
+    std::uint64_t count = 0;
+    while (node) {
+        if (node->label <= label) {
+            count += 1 + (node->left ? node->left->size : 0);
+            node = node->right.get();
+        } else {
+            node = node->left.get();
+        }
+    }
+    return count;
+}
+
+void IntervalIndex::insertNode(Node node)
+{
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+    node.priority = m_seed;
+    node.size = 1;
+
+    NodePtr left, right;
+    // Labels of the neighbours, exclusive bounds for the new one.
+    std::uint64_t low = 0;
+    std::uint64_t high = std::numeric_limits<std::uint64_t>::max();
+    for (;;) {
+        split(m_root, {node.start, node.id}, left, right);
+        low = 0;
+        high = std::numeric_limits<std::uint64_t>::max();
+        for (const Node *n = left.get(); n; n = n->right.get())
+            low = n->label;
+        for (const Node *n = right.get(); n; n = n->left.get())
+            high = n->label;
+        if (high - low >= 2)
+            break;
+        m_root = merge(left, right);
+        makeRoom(low);
+    }
+    if (!right && high - low > kLabelStep)
+        node.label = low + kLabelStep;
+    else if (!left && high - low > kLabelStep)
+        node.label = high - kLabelStep;
+    else
+        node.label = low + (high - low) / 2;
+
+    m_labels.set(node.id, node.label);
+    m_root = merge(merge(left, std::make_shared<const Node>(std::move(node))), right);
+}
+
+void IntervalIndex::makeRoom(std::uint64_t label)
+{
+    // The smallest aligned range of 2^bits labels around label that is
+    // sparse enough, relabelled evenly with a gap at either end. Repeated
+    // inserts at one point halve the gap each time, so without the
+    // widening threshold they would rewrite the whole track every few
+    // dozen inserts.
+    double limit = 1;
+    for (int bits = 1; bits < 64; ++bits) {
+        limit *= 2 / kDensityBase;
+        const std::uint64_t span = std::uint64_t(1) << bits;
+        const std::uint64_t first = label & ~(span - 1);
+        const std::uint64_t last = first + (span - 1);
+        const std::uint64_t count = countLabels(m_root.get(), last)
+                                    - (first ? countLabels(m_root.get(), first - 1) : 0);
+        if (double(count) > limit || count + 1 > span / 2)
+            continue;
+
+        NodePtr before, range, after;
+        if (first)
+            splitLabel(m_root, first - 1, before, range);
+        else
+            range = m_root;
+        splitLabel(range, last, range, after);
+        const std::uint64_t step = span / (count + 1);
+        std::uint64_t next = first + step;
+        if (range)
+            range = relabel(*range, step, next);
+        m_root = merge(merge(before, range), after);
+        return;
+    }
+    // Nothing short of the whole label space is sparse enough.
+    const std::uint64_t step = std::min(kLabelStep,
+                                        std::numeric_limits<std::uint64_t>::max()
+                                            / (size() + 1));
+    std::uint64_t next = step;
+    if (m_root)
+        m_root = relabel(*m_root, step, next);
+}
+
+IntervalIndex::NodePtr IntervalIndex::relabel(const Node &node, std::uint64_t step,
+                                              std::uint64_t &next)
+{
+    auto copy = std::make_shared<Node>(node);
+    if (node.left)
+        copy->left = relabel(*node.left, step, next);
+    copy->label = next;
+    next += step;
+    m_labels.set(copy->id, copy->label);
+    if (node.right)
+        copy->right = relabel(*node.right, step, next);
+    return copy;
+}
+
+void IntervalIndex::collect(const Node *node, std::int64_t shift, std::vector<Node> &out)
+{
+    if (!node)
+        return;
+    collect(node->left.get(), shift + node->shift, out);
+    Node &copy = out.emplace_back();
+    copy.start = node->start + shift;
+    copy.end = node->end + shift;
+    copy.maxEnd = copy.end;
+    copy.id = node->id;
+    collect(node->right.get(), shift + node->shift, out);
+}
+
+void IntervalIndex::stab(const Node *node, std::int64_t shift, std::int64_t frame,
+                         std::vector<ItemId> &out)
+{
+    if (!node || node->maxEnd + shift <= frame)
+        return;
+    stab(node->left.get(), shift + node->shift, frame, out);
+    if (node->start + shift > frame)
+        return; // and so does everything to its right
+    if (node->end + shift > frame)
+        out.push_back(node->id);
+    stab(node->right.get(), shift + node->shift, frame, out);
+}
+
+void IntervalIndex::overlapping(const Node *node, std::int64_t shift, FrameRange range,
+                                std::vector<ItemId> &out)
+{
+    if (!node || node->maxEnd + shift <= range.start)
+        return;
+    overlapping(node->left.get(), shift + node->shift, range, out);
+    if (node->start + shift >= range.end)
+        return;
+    if (node->end + shift > range.start)
+        out.push_back(node->id);
+    overlapping(node->right.get(), shift + node->shift, range, out);
+}
+
+void IntervalIndex::all(const Node *node, std::vector<ItemId> &out)
+{
+    if (!node)
+        return;
+    all(node->left.get(), out);
+    out.push_back(node->id);
+    all(node->right.get(), out);
+}
+
+} // namespace scp
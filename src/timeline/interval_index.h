@@ -0,0 +1,133 @@
+#pragma once
+
+// Ordered index of the items on one track, by frame interval.
+//
+// A treap ordered by start frame, with two augmentations: every node
+// records the largest end in its subtree, so "what covers frame t" skips
+// whole subtrees that end before t; and every node carries a pending shift
+// for its subtree, so moving every item after a point (a ripple edit) is a
+// split, one tag and a merge rather than an update per item. Lookup,
+// insert, erase and shift are O(log n) expected; stabbing queries add the
+// number of items returned.
+//
+// The index is persistent: nodes are immutable and shared, every edit
+// copies only the O(log n) nodes on its path, and copying an index is
+// O(1). That is what makes an undo snapshot cheap (see EditHistory).
+// Without parent pointers, an id is found through an order label: each
+// node carries a 64-bit label that increases with its position, and a
+// PersistentMap maps ids to labels, so find() descends by label. When an
+// insert finds no free label between its neighbours, only the smallest
+// aligned label range around them that is sparse enough gets relabelled,
+// which keeps the relabelling cost O(log n) amortised per insert.
+//
+// Items may overlap (transitions, filters).
+
+#include "timeline/persistent_map.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace scp {
+
+using ItemId = std::uint32_t;
+
+// Half-open range of timeline frames.
+struct FrameRange
+{
+    std::int64_t start = 0;
+    std::int64_t end = 0;
+
+    std::int64_t duration() const { return end - start; }
+    bool isEmpty() const { return end <= start; }
+    bool contains(std::int64_t frame) const { return frame >= start && frame < end; }
+    bool operator==(const FrameRange &) const = default;
+};
+
+class IntervalIndex
+{
+public:
+    std::size_t size() const { return m_labels.size(); }
+    bool contains(ItemId id) const { return m_labels.contains(id); }
+    void clear();
+
+    // Adds id over range; an id already present is replaced.
+    void insert(ItemId id, FrameRange range);
+    bool erase(ItemId id);
+
+    // Current range of id, with every shift applied.
+    std::optional<FrameRange> find(ItemId id) const;
+
+    // Moves every item starting at or after from by delta frames.
+    void shift(std::int64_t from, std::int64_t delta);
+
+    // Items covering frame, in start order.
+    void stab(std::int64_t frame, std::vector<ItemId> &out) const;
+    // Items intersecting range, in start order.
+    void overlapping(FrameRange range, std::vector<ItemId> &out) const;
+    // Every item, in start order.
+    void all(std::vector<ItemId> &out) const;
+
+    // The largest end of any item, 0 when empty.
+    std::int64_t end() const { return m_root ? m_root->maxEnd : 0; }
+
+private:
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    struct Node
+    {
+        // Ranges and maxEnd lack the shifts pending in ancestors.
+        std::int64_t start = 0;
+        std::int64_t end = 0;
+        std::int64_t maxEnd = 0;
+        std::int64_t shift = 0; // pending for both subtrees
+        std::uint64_t label = 0;
+        ItemId id = 0;
+        std::uint32_t priority = 0;
+        std::uint32_t size = 1; // nodes in the subtree
+        NodePtr left;
+        NodePtr right;
+    };
+
+    struct Key
+    {
+        std::int64_t start;
+        ItemId id;
+        auto operator<=>(const Key &) const = default;
+    };
+
+    static NodePtr shifted(const NodePtr &node, std::int64_t delta);
+    // A copy of node with its pending shift handed to its children.
+    static std::shared_ptr<Node> pushed(const NodePtr &node);
+    static void pull(Node &node);
+    // Splits into keys < key and keys >= key.
+    static void split(NodePtr node, Key key, NodePtr &left, NodePtr &right);
+    // Every key of left precedes every key of right.
+    static NodePtr merge(NodePtr left, NodePtr right);
+    // Splits into labels <= label and labels > label.
+    static void splitLabel(NodePtr node, std::uint64_t label, NodePtr &left, NodePtr &right);
+    // Nodes labelled at most label.
+    static std::uint64_t countLabels(const Node *node, std::uint64_t label);
+    // Adds a node with no children to the tree and labels it.
+    void insertNode(Node node);
+    // Spreads out the labels around label, when an insert after it finds
+    // no gap.
+    void makeRoom(std::uint64_t label);
+    NodePtr relabel(const Node &node, std::uint64_t step, std::uint64_t &next);
+    // Childless copies of the subtree's nodes with every shift applied.
+    static void collect(const Node *node, std::int64_t shift, std::vector<Node> &out);
+
+    static void stab(const Node *node, std::int64_t shift, std::int64_t frame,
+                     std::vector<ItemId> &out);
+    static void overlapping(const Node *node, std::int64_t shift, FrameRange range,
+                            std::vector<ItemId> &out);
+    static void all(const Node *node, std::vector<ItemId> &out);
+
+    NodePtr m_root;
+    PersistentMap<std::uint64_t> m_labels;
+    std::uint32_t m_seed = 0x9e3779b9u;
+};
+
+} // namespace scp
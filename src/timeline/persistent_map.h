@@ -0,0 +1,195 @@
+#pragma once
+
+// Persistent map from 32-bit ids to values.
+//
+// A hash array mapped trie in the compressed (CHAMP) layout: each node
+// covers five bits of the key and keeps a bitmap of which of its 32 slots
+// hold an entry and which a child, with both packed in slot order. Ids
+// are their own hash, so there are no collisions and the trie is at most
+// seven levels deep.
+//
+// Nodes are never modified once built. set() and erase() copy the path to
+// the key and share everything else, so copying a map is O(1) and two
+// versions that differ by one edit share all but a handful of nodes. A
+// map may be read from any number of threads while another thread edits
+// its own copy.
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace scp {
+
+template <typename Value>
+class PersistentMap
+{
+public:
+    std::size_t size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+    bool contains(std::uint32_t key) const { return find(key) != nullptr; }
+
+    // The value of key, or null. Valid while any copy of this version of the
+    // map exists.
+    const Value *find(std::uint32_t key) const
+    {
+        const Node *node = m_root.get();
+        for (int shift = 0; node; shift += kBits) {
+            const std::uint32_t bit = bitOf(key, shift);
+            if (node->entryMap & bit) {
+                const Entry &entry = node->entries[indexOf(node->entryMap, bit)];
+                return entry.key == key ? &entry.value : nullptr;
+            }
+            if (!(node->nodeMap & bit))
+                return nullptr;
+            node = node->children[indexOf(node->nodeMap, bit)].get();
+        }
+        return nullptr;
+    }
+
+    // Adds key or replaces its value.
+    void set(std::uint32_t key, Value value)
+    {
+        bool added = false;
+        m_root = set(m_root.get(), 0, key, std::move(value), added);
+        m_size += added ? 1 : 0;
+    }
+
+    bool erase(std::uint32_t key)
+    {
+        if (!contains(key))
+            return false;
+        m_root = erase(*m_root, 0, key);
+        --m_size;
+        return true;
+    }
+
+    void clear()
+    {
+        m_root.reset();
+        m_size = 0;
+    }
+
+private:
+    static constexpr int kBits = 5;
+
+    struct Entry
+    {
+        std::uint32_t key;
+        Value value;
+    };
+
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    struct Node
+    {
+        std::uint32_t entryMap = 0;
+        std::uint32_t nodeMap = 0;
+        std::vector<Entry> entries;   // slot order
+        std::vector<NodePtr> children; // slot order
+    };
+
+    static std::uint32_t bitOf(std::uint32_t key, int shift)
+    {
+        return std::uint32_t(1) << ((key >> shift) & 31);
+    }
+
+    static std::size_t indexOf(std::uint32_t map, std::uint32_t bit)
+    {
+        return static_cast<std::size_t>(std::popcount(map & (bit - 1)));
+    }
+
+    static NodePtr set(const Node *node, int shift, std::uint32_t key, Value &&value,
+                       bool &added)
+    {
+        auto copy = node ? std::make_shared<Node>(*node) : std::make_shared<Node>();
+        const std::uint32_t bit = bitOf(key, shift);
+        if (copy->entryMap & bit) {
+            const std::size_t index = indexOf(copy->entryMap, bit);
+            if (copy->entries[index].key == key) {
+                copy->entries[index].value = std::move(value);
+                return copy;
+            }
+            // Two keys share this slot: push both a level down.
+            Entry existing = std::move(copy->entries[index]);
+            copy->entries.erase(copy->entries.begin() + std::ptrdiff_t(index));
+            copy->entryMap &= ~bit;
+            NodePtr child = pair(shift + kBits, std::move(existing), {key, std::move(value)});
+            copy->children.insert(copy->children.begin()
+                                      + std::ptrdiff_t(indexOf(copy->nodeMap, bit)),
+                                  std::move(child));
+            copy->nodeMap |= bit;
+            added = true;
+        } else if (copy->nodeMap & bit) {
+            NodePtr &child = copy->children[indexOf(copy->nodeMap, bit)];
+            child = set(child.get(), shift + kBits, key, std::move(value), added);
+        } else {
+            copy->entries.insert(copy->entries.begin()
+                                     + std::ptrdiff_t(indexOf(copy->entryMap, bit)),
+                                 Entry{key, std::move(value)});
+            copy->entryMap |= bit;
+            added = true;
+        }
+        return copy;
+    }
+
+    static NodePtr pair(int shift, Entry &&a, Entry &&b)
+    {
+        auto node = std::make_shared<Node>();
+        const std::uint32_t bitA = bitOf(a.key, shift);
+        const std::uint32_t bitB = bitOf(b.key, shift);
+        if (bitA == bitB) {
+            node->nodeMap = bitA;
+            node->children.push_back(pair(shift + kBits, std::move(a), std::move(b)));
+            return node;
+        }
+        node->entryMap = bitA | bitB;
+        if (bitA < bitB) {
+            node->entries.push_back(std::move(a));
+            node->entries.push_back(std::move(b));
+        } else {
+            node->entries.push_back(std::move(b));
+            node->entries.push_back(std::move(a));
+        }
+        return node;
+    }
+
+    // key must be present. Returns null when the node ends up empty.
+    static NodePtr erase(const Node &node, int shift, std::uint32_t key)
+    {
+        auto copy = std::make_shared<Node>(node);
+        const std::uint32_t bit = bitOf(key, shift);
+        if (copy->entryMap & bit) {
+            copy->entries.erase(copy->entries.begin()
+                                + std::ptrdiff_t(indexOf(copy->entryMap, bit)));
+            copy->entryMap &= ~bit;
+        } else {
+            const std::size_t index = indexOf(copy->nodeMap, bit);
+            NodePtr child = erase(*copy->children[index], shift + kBits, key);
+            if (child && (child->nodeMap || child->entries.size() > 1)) {
+                copy->children[index] = std::move(child);
+            } else {
+                // Keep the trie canonical: a lone entry moves up a level.
+                copy->children.erase(copy->children.begin() + std::ptrdiff_t(index));
+                copy->nodeMap &= ~bit;
+                if (child) {
+                    copy->entries.insert(copy->entries.begin()
+                                             + std::ptrdiff_t(indexOf(copy->entryMap, bit)),
+                                         child->entries.front());
+                    copy->entryMap |= bit;
+                }
+            }
+        }
+        if (!copy->entryMap && !copy->nodeMap)
+            return nullptr;
+        return copy;
+    }
+
+    NodePtr m_root;
+    std::size_t m_size = 0;
+};
+
+} // namespace scp
@@ -0,0 +1,196 @@
+#include "timeline/timeline.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace scp {
+
+void TimelineChange::addFrames(FrameRange range)
+{
+    if (range.isEmpty())
+        return;
+    // Absorb every range that overlaps or touches the new one.
+    auto first = std::lower_bound(frames.begin(), frames.end(), range.start,
+                                  [](const FrameRange &r, std::int64_t start) {
+                                      return r.end < start;
+                                  });
+    auto last = first;
+    while (last != frames.end() && last->start <= range.end) {
+        range.start = std::min(range.start, last->start);
+        range.end = std::max(range.end, last->end);
+        ++last;
+    }
+    frames.insert(frames.erase(first, last), range);
+}
+
+void TimelineChange::merge(const TimelineChange &other)
+{
+    for (const FrameRange &range : other.frames)
+        addFrames(range);
+    for (const ItemRef &item : other.items) {
+        if (std::find(items.begin(), items.end(), item) == items.end())
+            items.push_back(item);
+    }
+}
+
+int Timeline::addTrack(TrackKind kind)
+{
+    m_tracks.emplace_back(kind);
+    return trackCount() - 1;
+}
+
+std::int64_t Timeline::duration() const
+{
+    std::int64_t end = 0;
+    for (const Track &track : m_tracks)
+        end = std::max(end, track.end());
+    return end;
+}
+
+void Timeline::itemsAt(std::int64_t frame, std::vector<ItemRef> &out) const
+{
+    std::vector<ItemId> ids;
+    for (int i = 0; i < trackCount(); ++i) {
+        ids.clear();
+        m_tracks[i].itemsAt(frame, ids);
+        for (const ItemId id : ids)
+            out.push_back({i, id});
+    }
+}
+
+void Timeline::itemsIn(FrameRange range, std::vector<ItemRef> &out) const
+{
+    std::vector<ItemId> ids;
+    for (int i = 0; i < trackCount(); ++i) {
+        ids.clear();
+        m_tracks[i].itemsIn(range, ids);
+        for (const ItemId id : ids)
+            out.push_back({i, id});
+    }
+}
+
+bool Timeline::valid(ItemRef ref) const
+{
+    return ref.track >= 0 && ref.track < trackCount() && m_tracks[ref.track].item(ref.id);
+}
+
+TimelineChange Timeline::addItem(int track, TimelineItem item, FrameRange range, ItemRef *added)
+{
+    TimelineChange change;
+    if (track < 0 || track >= trackCount() || range.isEmpty())
+        return change;
+    const ItemRef ref{track, m_tracks[track].add(std::move(item), range)};
+    if (added)
+        *added = ref;
+    change.frames.push_back(range);
+    change.items.push_back(ref);
+    return change;
+}
+
+TimelineChange Timeline::removeItem(ItemRef ref)
+{
+    TimelineChange change;
+    if (!valid(ref))
+        return change;
+    change.addFrames(*m_tracks[ref.track].range(ref.id));
+    change.items.push_back(ref);
+    m_tracks[ref.track].remove(ref.id);
+    return change;
+}
+
+TimelineChange Timeline::setItem(ItemRef ref, TimelineItem item)
+{
+    TimelineChange change;
+    if (!valid(ref))
+        return change;
+    m_tracks[ref.track].setItem(ref.id, std::move(item));
+    change.addFrames(*m_tracks[ref.track].range(ref.id));
+    change.items.push_back(ref);
+    return change;
+}
+
+TimelineChange Timeline::moveItem(ItemRef ref, std::int64_t start)
+{
+    TimelineChange change;
+    if (!valid(ref))
+        return change;
+    Track &track = m_tracks[ref.track];
+    const FrameRange before = *track.range(ref.id);
+    if (before.start == start)
+        return change;
+    track.move(ref.id, start);
+    change.addFrames(before);
+    change.addFrames(*track.range(ref.id));
+    change.items.push_back(ref);
+    return change;
+}
+
+TimelineChange Timeline::trimItem(ItemRef ref, FrameRange range)
+{
+    TimelineChange change;
+    if (!valid(ref))
+        return change;
+    Track &track = m_tracks[ref.track];
+    const FrameRange before = *track.range(ref.id);
+    if (before == range || !track.trim(ref.id, range))
+        return change;
+    if (track.item(ref.id)->kind == ItemKind::Clip) {
+        // Track::trim moves the source in point with the head, so wherever
+        // the clip covers the timeline both before and after it shows the
+        // same frames. Only what the head and the tail uncovered or newly
+        // cover changes.
+        const std::int64_t firstEnd = std::min(before.end, range.end);
+        const std::int64_t lastStart = std::max(before.start, range.start);
+        change.addFrames({std::min(before.start, range.start), std::min(lastStart, firstEnd)});
+        change.addFrames({std::max(firstEnd, lastStart), std::max(before.end, range.end)});
+    } else {
+        // A transition or filter is evaluated relative to its whole range.
+        change.addFrames(before);
+        change.addFrames(range);
+    }
+    change.items.push_back(ref);
+    return change;
+}
+
+TimelineChange Timeline::rippleRemoveItem(ItemRef ref)
+{
+    TimelineChange change;
+    if (!valid(ref))
+        return change;
+    Track &track = m_tracks[ref.track];
+    const FrameRange range = *track.range(ref.id);
+    const std::int64_t end = track.end();
+    track.rippleRemove(ref.id);
+    change.addFrames({range.start, end});
+    change.items.push_back(ref);
+    return change;
+}
+
+TimelineChange Timeline::rippleTrimItemEnd(ItemRef ref, std::int64_t end)
+{
+    TimelineChange change;
+    if (!valid(ref))
+        return change;
+    Track &track = m_tracks[ref.track];
+    const FrameRange before = *track.range(ref.id);
+    const std::int64_t trackEnd = track.end();
+    if (before.end == end || !track.rippleTrimEnd(ref.id, end))
+        return change;
+    change.addFrames({std::min(before.end, end), std::max(trackEnd, track.end())});
+    change.items.push_back(ref);
+    return change;
+}
+
+TimelineChange Timeline::ripple(std::int64_t from, std::int64_t delta)
+{
+    TimelineChange change;
+    if (delta == 0)
+        return change;
+    const std::int64_t end = duration();
+    for (Track &track : m_tracks)
+        track.ripple(from, delta);
+    change.addFrames({std::min(from, from + delta), std::max(end, duration())});
+    return change;
+}
+
+} // namespace scp
@@ -0,0 +1,95 @@
+#pragma once
+
+// The edit: an ordered stack of tracks at one frame rate.
+//
+// Each track indexes its items by interval (see IntervalIndex), so finding
+// what plays at a frame and rippling everything after an edit point cost
+// O(log n) per track rather than a walk over a playlist, with 8,000+ clips
+// in a feature-length project.
+//
+// The edit operations report what they changed as a TimelineChange: the
+// exact frames whose picture or sound may now differ, and the items edited.
+// Caches drop only those (see RenderInvalidator) instead of everything
+// after every edit. Edits made directly through track() are not reported.
+//
+// Tracks are persistent structures: copying a timeline costs a few pointers
+// per track and the copy never sees later edits. EditHistory keeps one
+// copy per edit for undo.
+
+#include "timeline/track.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace scp {
+
+struct ItemRef
+{
+    int track = -1;
+    ItemId id = 0;
+
+    bool operator==(const ItemRef &) const = default;
+};
+
+struct TimelineChange
+{
+    // Frames that may render differently, sorted and disjoint.
+    std::vector<FrameRange> frames;
+    // Items added, removed, moved, trimmed or modified. Items that were
+    // only carried along by a ripple are not listed: what they show is
+    // unchanged, just later or earlier.
+    std::vector<ItemRef> items;
+
+    bool isEmpty() const { return frames.empty() && items.empty(); }
+    void addFrames(FrameRange range);
+    void merge(const TimelineChange &other);
+};
+
+class Timeline
+{
+public:
+    explicit Timeline(int rateNum = 25, int rateDen = 1)
+        : m_rateNum(rateNum)
+        , m_rateDen(rateDen)
+    {}
+
+    int rateNum() const { return m_rateNum; }
+    int rateDen() const { return m_rateDen; }
+
+    // Adds a track above the others and returns its index. Invalidates
+    // references to tracks.
+    int addTrack(TrackKind kind);
+    int trackCount() const { return static_cast<int>(m_tracks.size()); }
+    Track &track(int index) { return m_tracks[index]; }
+    const Track &track(int index) const { return m_tracks[index]; }
+
+    // End of the last item on any track.
+    std::int64_t duration() const;
+
+    // Items covering frame, bottom track first, each track in start order.
+    void itemsAt(std::int64_t frame, std::vector<ItemRef> &out) const;
+    void itemsIn(FrameRange range, std::vector<ItemRef> &out) const;
+
+    // Edits. Each returns an empty change when ref does not exist or the
+    // edit is rejected.
+    TimelineChange addItem(int track, TimelineItem item, FrameRange range,
+                           ItemRef *added = nullptr);
+    TimelineChange removeItem(ItemRef ref);
+    TimelineChange setItem(ItemRef ref, TimelineItem item);
+    TimelineChange moveItem(ItemRef ref, std::int64_t start);
+    TimelineChange trimItem(ItemRef ref, FrameRange range);
+    TimelineChange rippleRemoveItem(ItemRef ref);
+    TimelineChange rippleTrimItemEnd(ItemRef ref, std::int64_t end);
+
+    // Ripples every track: items starting at or after from move by delta.
+    TimelineChange ripple(std::int64_t from, std::int64_t delta);
+
+private:
+    bool valid(ItemRef ref) const;
+
+    int m_rateNum;
+    int m_rateDen;
+    std::vector<Track> m_tracks;
+};
+
+} // namespace scp
@@ -0,0 +1,94 @@
+#include "timeline/track.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+namespace scp {
+
+ItemId Track::add(TimelineItem item, FrameRange range)
+{
+    const ItemId id = m_nextId++;
+    m_items.set(id, std::make_shared<const TimelineItem>(std::move(item)));
+    m_index.insert(id, range);
+    return id;
+}
+
+bool Track::restore(ItemId id, TimelineItem item, FrameRange range)
+{
+    if (m_items.contains(id))
+        return false;
+    m_items.set(id, std::make_shared<const TimelineItem>(std::move(item)));
+    m_index.insert(id, range);
+    m_nextId = std::max(m_nextId, id + 1);
+    return true;
+}
+
+bool Track::remove(ItemId id)
+{
+    if (!m_items.erase(id))
+        return false;
+    m_index.erase(id);
+    return true;
+}
+
+const TimelineItem *Track::item(ItemId id) const
+{
+    const std::shared_ptr<const TimelineItem> *item = m_items.find(id);
+    return item ? item->get() : nullptr;
+}
+
+bool Track::setItem(ItemId id, TimelineItem item)
+{
+    if (!m_items.contains(id))
+        return false;
+    m_items.set(id, std::make_shared<const TimelineItem>(std::move(item)));
+    return true;
+}
+
+bool Track::move(ItemId id, std::int64_t start)
+{
+    const std::optional<FrameRange> current = m_index.find(id);
+    if (!current)
+        return false;
+    m_index.insert(id, {start, start + current->duration()});
+    return true;
+}
+
+bool Track::trim(ItemId id, FrameRange range)
+{
+    const std::optional<FrameRange> current = m_index.find(id);
+    if (!current || range.isEmpty())
+        return false;
+    const TimelineItem &before = *item(id);
+    if (before.kind == ItemKind::Clip && range.start != current->start) {
+        TimelineItem trimmed = before;
+        trimmed.sourceIn += range.start - current->start;
+        m_items.set(id, std::make_shared<const TimelineItem>(std::move(trimmed)));
+    }
+    m_index.insert(id, range);
+    return true;
+}
+
+bool Track::rippleRemove(ItemId id)
+{
+    const std::optional<FrameRange> range = m_index.find(id);
+    if (!range)
+        return false;
+    remove(id);
+    m_index.shift(range->end, -range->duration());
+    return true;
+}
+
+bool Track::rippleTrimEnd(ItemId id, std::int64_t end)
+{
+    const std::optional<FrameRange> current = m_index.find(id);
+    if (!current || end <= current->start)
+        return false;
+    // id starts before its old end, so the shift leaves it alone.
+    m_index.shift(current->end, end - current->end);
+    m_index.insert(id, {current->start, end});
+    return true;
+}
+
+} // namespace scp
@@ -0,0 +1,102 @@
+#pragma once
+
+// One timeline track: clips, and the transitions and filters placed on it.
+//
+// Placement lives only in the track's IntervalIndex, items hold none, so a
+// ripple edit that moves thousands of clips touches O(log n) nodes and no
+// items. Positions are timeline frames; ranges are half-open.
+//
+// Both the index and the items are persistent structures, so copying a
+// track is O(1) and the copy is unaffected by later edits to either one.
+
+#include "timeline/interval_index.h"
+#include "timeline/persistent_map.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace scp {
+
+enum class TrackKind {
+    Video,
+    Audio,
+};
+
+enum class ItemKind {
+    Clip,
+    Transition,
+    Filter,
+};
+
+struct TimelineItem
+{
+    ItemKind kind = ItemKind::Clip;
+    // Media path for clips, service name for transitions and filters.
+    std::string resource;
+    // Source frame shown at the item's first frame (clips).
+    std::int64_t sourceIn = 0;
+};
+
+class Track
+{
+public:
+    explicit Track(TrackKind kind)
+        : m_kind(kind)
+    {}
+
+    TrackKind kind() const { return m_kind; }
+    void setKind(TrackKind kind) { m_kind = kind; }
+    std::size_t size() const { return m_items.size(); }
+    // End of the last item, 0 for an empty track.
+    std::int64_t end() const { return m_index.end(); }
+
+    ItemId add(TimelineItem item, FrameRange range);
+    // Adds an item under an id it had before, when loading a saved edit.
+    // Returns false if id is taken.
+    bool restore(ItemId id, TimelineItem item, FrameRange range);
+    bool remove(ItemId id);
+
+    // Valid while any copy of this version of the track exists.
+    const TimelineItem *item(ItemId id) const;
+    // Replaces id's resource or parameters; its placement stays.
+    bool setItem(ItemId id, TimelineItem item);
+    std::optional<FrameRange> range(ItemId id) const { return m_index.find(id); }
+
+    // Moves id to start at frame. Nothing else moves.
+    bool move(ItemId id, std::int64_t start);
+    // Gives id a new range; a clip's source follows a trimmed head.
+    bool trim(ItemId id, FrameRange range);
+
+    // Moves every item starting at or after from by delta frames.
+    void ripple(std::int64_t from, std::int64_t delta) { m_index.shift(from, delta); }
+    // Removes id and closes the gap it leaves.
+    bool rippleRemove(ItemId id);
+    // Moves id's end to end, and the items after it along with it.
+    bool rippleTrimEnd(ItemId id, std::int64_t end);
+
+    // Items covering frame, in start order.
+    void itemsAt(std::int64_t frame, std::vector<ItemId> &out) const { m_index.stab(frame, out); }
+    // Items intersecting range, in start order.
+    void itemsIn(FrameRange range, std::vector<ItemId> &out) const
+    {
+        m_index.overlapping(range, out);
+    }
+    // Every item, in start order.
+    void items(std::vector<ItemId> &out) const { m_index.all(out); }
+    // The id the next add() returns.
+    ItemId nextId() const { return m_nextId; }
+    // Makes add() skip ids below next.
+    void reserveIds(ItemId next) { m_nextId = std::max(m_nextId, next); }
+
+private:
+    TrackKind m_kind;
+    IntervalIndex m_index;
+    PersistentMap<std::shared_ptr<const TimelineItem>> m_items;
+    ItemId m_nextId = 0;
+};
+
+} // namespace scp
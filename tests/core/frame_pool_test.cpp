@@ -0,0 +1,180 @@
+// FramePool: one size class per format, buffers recycled within the budget
+// and the free list bound, and no buffer handed to two owners at once under
+// concurrent acquire and release.
+
+#include "core/frame_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace scp {
+namespace {
+
+constexpr FrameFormat kRgba{64, 64, PixelFormat::RGBA8};
+constexpr FrameFormat kYuv{64, 48, PixelFormat::YUV420P};
+
+TEST(FramePoolTest, OneSizeClassPerFormat)
+{
+    FramePool pool;
+    EXPECT_FALSE(pool.acquire({0, 64, PixelFormat::RGBA8}));
+    EXPECT_FALSE(pool.acquire({64, 64, PixelFormat::None}));
+    EXPECT_EQ(pool.stats().sizeClasses, 0u);
+
+    const FrameRef a = pool.acquire(kRgba);
+    const FrameRef b = pool.acquire(kRgba);
+    const FrameRef c = pool.acquire(kYuv);
+    // Same byte size, different geometry: its own class.
+    const FrameRef d = pool.acquire({128, 32, PixelFormat::RGBA8});
+    ASSERT_TRUE(a && b && c && d);
+    EXPECT_EQ(pool.stats().sizeClasses, 3u);
+    EXPECT_EQ(c->format(), kYuv);
+    EXPECT_TRUE(a->isAligned());
+    EXPECT_TRUE(c->isAligned());
+    EXPECT_EQ(a->stride(0), 256);
+    EXPECT_EQ(c->stride(1), 64); // 32 bytes of chroma, padded to the alignment
+}
+
+TEST(FramePoolTest, BufferBytes)
+{
+    EXPECT_EQ(FramePool::bufferBytes(kRgba), 64u * 4 * 64);
+    EXPECT_EQ(FramePool::bufferBytes(kYuv), 64u * 48 + 2 * 64 * 24);
+    EXPECT_EQ(FramePool::bufferBytes({}), 0u);
+}
+
+TEST(FramePoolTest, ReleasedBuffersAreRecycled)
+{
+    FramePool pool;
+    const std::size_t bytes = FramePool::bufferBytes(kRgba);
+    FrameRef frame = pool.acquire(kRgba);
+    const FrameBuffer *first = frame.get();
+    FramePoolStats stats = pool.stats();
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.buffersInUse, 1u);
+    EXPECT_EQ(stats.bytesInUse, bytes);
+
+    frame = {};
+    stats = pool.stats();
+    EXPECT_EQ(stats.buffersInUse, 0u);
+    EXPECT_EQ(stats.bytesInUse, 0u);
+    EXPECT_EQ(stats.bytesPooled, bytes);
+
+    // Another format does not take it.
+    const FrameRef other = pool.acquire(kYuv);
+    EXPECT_EQ(pool.stats().hits, 0u);
+
+    frame = pool.acquire(kRgba);
+    EXPECT_EQ(frame.get(), first);
+    stats = pool.stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_EQ(stats.bytesPooled, 0u);
+    EXPECT_EQ(stats.highWaterBytes, bytes + FramePool::bufferBytes(kYuv));
+}
+
+TEST(FramePoolTest, BudgetAndTrim)
+{
+    const std::size_t bytes = FramePool::bufferBytes(kRgba);
+    FramePool pool(bytes);
+    {
+        const FrameRef a = pool.acquire(kRgba);
+        const FrameRef b = pool.acquire(kRgba);
+    }
+    // Only one fits the budget; the other was freed.
+    EXPECT_EQ(pool.stats().bytesPooled, bytes);
+
+    pool.trim();
+    EXPECT_EQ(pool.stats().bytesPooled, 0u);
+    pool.acquire(kRgba);
+    EXPECT_EQ(pool.stats().bytesPooled, bytes);
+    pool.setMaxPooledBytes(0);
+    EXPECT_EQ(pool.stats().bytesPooled, 0u);
+    pool.acquire(kRgba);
+    EXPECT_EQ(pool.stats().bytesPooled, 0u);
+}
+
+TEST(FramePoolTest, FreeListIsBounded)
+{
+    FramePool pool;
+    {
+        std::vector<FrameRef> frames;
+        for (std::size_t i = 0; i < FramePool::kBuffersPerClass + 4; ++i)
+            frames.push_back(pool.acquire(kRgba));
+    }
+    EXPECT_EQ(pool.stats().bytesPooled,
+              FramePool::kBuffersPerClass * FramePool::bufferBytes(kRgba));
+}
+
+TEST(FramePoolTest, FormatsPastTheClassTableAreUnpooled)
+{
+    FramePool pool;
+    std::vector<FrameRef> frames;
+    for (std::size_t i = 0; i <= FramePool::kMaxSizeClasses; ++i)
+        frames.push_back(pool.acquire({int(8 + i), 8, PixelFormat::RGBA8}));
+    for (const FrameRef &frame : frames)
+        ASSERT_TRUE(frame);
+    EXPECT_EQ(pool.stats().sizeClasses, FramePool::kMaxSizeClasses);
+
+    // The first formats took every class; only theirs are kept.
+    std::size_t pooled = 0;
+    for (std::size_t i = 0; i < FramePool::kMaxSizeClasses; ++i)
+        pooled += FramePool::bufferBytes(frames[i]->format());
+    frames.clear();
+    EXPECT_EQ(pool.stats().bytesPooled, pooled);
+}
+
+TEST(FramePoolTest, ConcurrentAcquireAndRelease)
+{
+    constexpr int kThreads = 8;
+    constexpr int kIterations = 20000;
+    constexpr FrameFormat kFormats[] = {kRgba, kYuv, {16, 16, PixelFormat::RGBA8}};
+    FramePool pool;
+    {
+        std::vector<std::jthread> threads;
+        for (int t = 0; t < kThreads; ++t) {
+            threads.emplace_back([&pool, &kFormats, t] {
+                // Hold a few buffers at a time so releases interleave with
+                // other threads' acquires.
+                std::vector<FrameRef> held(3);
+                for (int i = 0; i < kIterations; ++i) {
+                    FrameRef &slot = held[std::size_t(i) % held.size()];
+                    slot = pool.acquire(kFormats[(i + t) % 3]);
+                    ASSERT_TRUE(slot);
+                    const std::size_t bytes = FramePool::bufferBytes(slot->format());
+                    std::uint8_t *data = slot->data(0);
+                    data[0] = std::uint8_t(t);
+                    data[bytes - 1] = std::uint8_t(i);
+                    std::this_thread::yield();
+                    // A buffer given to two threads would be overwritten.
+                    ASSERT_EQ(data[0], std::uint8_t(t));
+                    ASSERT_EQ(data[bytes - 1], std::uint8_t(i));
+                }
+            });
+        }
+    }
+
+    const FramePoolStats stats = pool.stats();
+    EXPECT_EQ(stats.hits + stats.misses, std::uint64_t(kThreads) * kIterations);
+    EXPECT_EQ(stats.buffersInUse, 0u);
+    EXPECT_EQ(stats.bytesInUse, 0u);
+    EXPECT_EQ(stats.sizeClasses, 3u);
+    // At most 4 live per thread (3 held plus the one replacing them), so
+    // nothing beyond that was ever allocated.
+    EXPECT_LE(stats.misses, std::uint64_t(kThreads) * 4 * 3);
+
+    // The free lists hold each buffer once.
+    std::set<const FrameBuffer *> drained;
+    std::vector<FrameRef> frames;
+    for (std::size_t i = 0; i < FramePool::kBuffersPerClass; ++i) {
+        frames.push_back(pool.acquire(kRgba));
+        drained.insert(frames.back().get());
+    }
+    EXPECT_EQ(drained.size(), FramePool::kBuffersPerClass);
+}
+
+} // namespace
+} // namespace scp
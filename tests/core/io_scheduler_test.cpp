@@ -0,0 +1,118 @@
+// IoScheduler reads against the file's bytes, through both backends.
+
+#include "core/io_scheduler.h"
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace scp {
+namespace {
+
+class IoSchedulerTest : public ::testing::TestWithParam<bool>
+{
+protected:
+    void SetUp() override
+    {
+        char path[] = "/tmp/scp_io_scheduler_XXXXXX";
+        const int fd = ::mkstemp(path);
+        ASSERT_GE(fd, 0);
+        ::close(fd);
+        m_path = path;
+        std::mt19937 random(5);
+        m_bytes.resize(3 << 20);
+        for (std::uint8_t &byte : m_bytes)
+            byte = std::uint8_t(random());
+        std::ofstream(m_path, std::ios::binary)
+            .write(reinterpret_cast<const char *>(m_bytes.data()), std::streamsize(m_bytes.size()));
+
+        IoSchedulerConfig config;
+        config.ioUring = GetParam();
+        m_scheduler = std::make_unique<IoScheduler>(config);
+        if (GetParam() && !m_scheduler->usesIoUring())
+            GTEST_SKIP() << "io_uring is not available";
+    }
+
+    void TearDown() override
+    {
+        m_scheduler.reset();
+        if (!m_path.empty())
+            ::unlink(m_path.c_str());
+    }
+
+    std::string m_path;
+    std::vector<std::uint8_t> m_bytes;
+    std::unique_ptr<IoScheduler> m_scheduler;
+};
+
+TEST_P(IoSchedulerTest, ReadsMatchFile)
+{
+    const IoScheduler::FileHandle file = m_scheduler->open(m_path);
+    ASSERT_TRUE(file);
+
+    struct Read
+    {
+        std::uint64_t offset;
+        std::vector<std::uint8_t> buffer;
+        std::int64_t result = 0;
+    };
+    std::mt19937 random(9);
+    std::vector<Read> reads(2000);
+    std::atomic<int> left = int(reads.size());
+    std::uint64_t offset = 0;
+    for (std::size_t i = 0; i < reads.size(); ++i) {
+        // Runs of adjacent reads, to be merged, and jumps anywhere, some
+        // of them past the end.
+        offset = random() % 4 ? offset + 4096 : random() % (m_bytes.size() + 8192);
+        reads[i].offset = offset;
+        reads[i].buffer.resize(1 + random() % 16384);
+        m_scheduler->submit(file, offset, reads[i].buffer.size(), reads[i].buffer.data(),
+                            IoPriority(random() % 3), [&, i](std::int64_t result) {
+                                reads[i].result = result;
+                                left.fetch_sub(1);
+                                left.notify_all();
+                            });
+    }
+    for (int now = left.load(); now > 0; now = left.load())
+        left.wait(now);
+
+    for (const Read &read : reads) {
+        const std::uint64_t available = read.offset < m_bytes.size()
+                                            ? m_bytes.size() - read.offset
+                                            : 0;
+        const std::size_t expected = std::min<std::uint64_t>(available, read.buffer.size());
+        ASSERT_EQ(read.result, std::int64_t(expected)) << "offset " << read.offset;
+        EXPECT_EQ(std::memcmp(read.buffer.data(), m_bytes.data() + read.offset, expected), 0)
+            << "offset " << read.offset;
+    }
+    const IoSchedulerStats stats = m_scheduler->stats();
+    EXPECT_EQ(stats.requests, reads.size());
+    EXPECT_GT(stats.merged, 0u);
+}
+
+TEST_P(IoSchedulerTest, ReadWaits)
+{
+    const IoScheduler::FileHandle file = m_scheduler->open(m_path);
+    ASSERT_TRUE(file);
+    std::vector<std::uint8_t> buffer(100);
+    EXPECT_EQ(m_scheduler->read(file, m_bytes.size() - 40, buffer.size(), buffer.data(),
+                                IoPriority::Playhead),
+              40);
+    EXPECT_EQ(std::memcmp(buffer.data(), m_bytes.data() + m_bytes.size() - 40, 40), 0);
+    EXPECT_FALSE(m_scheduler->open(m_path + ".missing"));
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, IoSchedulerTest, ::testing::Bool(),
+                         [](const auto &info) { return info.param ? "IoUring" : "Pread"; });
+
+} // namespace
+} // namespace scp
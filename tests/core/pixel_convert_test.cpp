@@ -0,0 +1,146 @@
+// convertFrame() picks up the color spec a frame carries.
+
+#include "core/frame_pool.h"
+#include "core/half_float.h"
+#include "core/pixel_convert.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <utility>
+
+namespace scp {
+namespace {
+
+// A grey YUV420P frame with every sample set to luma and neutral chroma.
+FrameRef greyFrame(FramePool &pool, std::uint8_t luma, const ColorSpec &spec)
+{
+    FrameRef frame = pool.acquire({16, 16, PixelFormat::YUV420P});
+    std::memset(frame->data(0), luma, std::size_t(frame->stride(0)) * 16);
+    std::memset(frame->data(1), 128, std::size_t(frame->stride(1)) * 8);
+    std::memset(frame->data(2), 128, std::size_t(frame->stride(2)) * 8);
+    frame->setColorSpec(spec);
+    return frame;
+}
+
+std::uint8_t redAt(FramePool &pool, const FrameBuffer &source)
+{
+    FrameRef rgba = pool.acquire({16, 16, PixelFormat::RGBA8});
+    EXPECT_TRUE(convertFrame(source, *rgba));
+    return rgba->data(0)[0];
+}
+
+TEST(PixelConvertTest, UsesTheSourceRange)
+{
+    FramePool pool;
+    // Luma 235 is white in limited range, light grey in full range.
+    EXPECT_EQ(redAt(pool, *greyFrame(pool, 235, {ColorMatrix::BT709, ColorRange::Limited})), 255);
+    EXPECT_EQ(redAt(pool, *greyFrame(pool, 235, {ColorMatrix::BT709, ColorRange::Full})), 235);
+    EXPECT_EQ(redAt(pool, *greyFrame(pool, 16, {ColorMatrix::BT709, ColorRange::Limited})), 0);
+    EXPECT_EQ(redAt(pool, *greyFrame(pool, 16, {ColorMatrix::BT709, ColorRange::Full})), 16);
+}
+
+TEST(PixelConvertTest, DestinationRecordsTheSpec)
+{
+    FramePool pool;
+    const ColorSpec full{ColorMatrix::BT601, ColorRange::Full};
+    FrameRef rgba = pool.acquire({16, 16, PixelFormat::RGBA8});
+    std::memset(rgba->data(0), 255, std::size_t(rgba->stride(0)) * 16);
+    FrameRef yuv = pool.acquire({16, 16, PixelFormat::YUV420P});
+    ASSERT_TRUE(convertFrame(*rgba, *yuv, full));
+    EXPECT_EQ(yuv->colorSpec(), full);
+    EXPECT_EQ(yuv->data(0)[0], 255);
+}
+
+// Random samples in every plane; P010 keeps its 10 bits in the high end,
+// RGBA16F holds [0, 1] with some out-of-range values.
+FrameRef randomFrame(FramePool &pool, const FrameFormat &format, std::mt19937 &random)
+{
+    FrameRef frame = pool.acquire(format);
+    for (int plane = 0; plane < frame->planeCount(); ++plane) {
+        const PlaneGeometry geometry = planeGeometry(format.pixelFormat, format.width,
+                                                     format.height, plane);
+        for (int line = 0; line < geometry.rows; ++line) {
+            std::uint8_t *row = frame->data(plane) + std::ptrdiff_t(line) * frame->stride(plane);
+            auto *row16 = reinterpret_cast<std::uint16_t *>(row);
+            for (int i = 0; i < geometry.rowBytes / 2; ++i) {
+                if (format.pixelFormat == PixelFormat::P010)
+                    row16[i] = std::uint16_t((random() & 0x3ff) << 6);
+                else if (format.pixelFormat == PixelFormat::RGBA16F)
+                    row16[i] = floatToHalf(float(random() % 1200) / 1000.f - 0.1f);
+                else
+                    row16[i] = std::uint16_t(random());
+            }
+        }
+    }
+    return frame;
+}
+
+// Every byte of pixel data, not the padding.
+bool samePixels(const FrameBuffer &a, const FrameBuffer &b)
+{
+    for (int plane = 0; plane < a.planeCount(); ++plane) {
+        const PlaneGeometry geometry = planeGeometry(a.pixelFormat(), a.width(), a.height(),
+                                                     plane);
+        for (int line = 0; line < geometry.rows; ++line) {
+            if (std::memcmp(a.data(plane) + std::ptrdiff_t(line) * a.stride(plane),
+                            b.data(plane) + std::ptrdiff_t(line) * b.stride(plane),
+                            std::size_t(geometry.rowBytes))
+                != 0)
+                return false;
+        }
+    }
+    return true;
+}
+
+TEST(PixelConvertTest, EveryLevelMatchesScalar)
+{
+    const std::pair<PixelFormat, PixelFormat> conversions[] = {
+        {PixelFormat::YUV420P, PixelFormat::RGBA8}, {PixelFormat::NV12, PixelFormat::RGBA8},
+        {PixelFormat::P010, PixelFormat::RGBA8},    {PixelFormat::YUV420P, PixelFormat::RGBA16F},
+        {PixelFormat::NV12, PixelFormat::RGBA16F},  {PixelFormat::P010, PixelFormat::RGBA16F},
+        {PixelFormat::RGBA8, PixelFormat::YUV420P}, {PixelFormat::RGBA8, PixelFormat::NV12},
+        {PixelFormat::RGBA16F, PixelFormat::P010},
+    };
+    const ColorSpec specs[] = {
+        {ColorMatrix::BT709, ColorRange::Limited},
+        {ColorMatrix::BT601, ColorRange::Full},
+        {ColorMatrix::BT2020, ColorRange::Limited},
+    };
+    const SimdLevel levels[] = {SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::AVX512,
+                                SimdLevel::NEON};
+    // Wider than every vector, not a multiple of any lane count, and an odd
+    // size that ends on a half chroma sample.
+    const std::pair<int, int> sizes[] = {{70, 6}, {37, 5}};
+
+    FramePool pool;
+    std::mt19937 random(4);
+    int compared = 0;
+    for (const auto &[from, to] : conversions) {
+        for (const auto &[width, height] : sizes) {
+            const FrameRef source = randomFrame(pool, {width, height, from}, random);
+            for (const ColorSpec &spec : specs) {
+                const FrameRef expected = pool.acquire({width, height, to});
+                ASSERT_TRUE(convertFrame(*source, *expected, spec, SimdLevel::Scalar));
+                for (SimdLevel level : levels) {
+                    if (!isSimdLevelSupported(level))
+                        continue;
+                    SCOPED_TRACE(::testing::Message()
+                                 << pixelFormatName(from) << " -> " << pixelFormatName(to) << " "
+                                 << width << "x" << height << " at " << simdLevelName(level));
+                    const FrameRef actual = pool.acquire({width, height, to});
+                    ASSERT_TRUE(convertFrame(*source, *actual, spec, level));
+                    EXPECT_TRUE(samePixels(*expected, *actual));
+                    ++compared;
+                }
+            }
+        }
+    }
+    if (compared == 0)
+        GTEST_SKIP() << "no vector kernels on this machine";
+}
+
+} // namespace
+} // namespace scp
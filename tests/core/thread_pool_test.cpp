@@ -0,0 +1,108 @@
+// ThreadPool: every index runs exactly once, nesting does not deadlock, and
+// exceptions reach the caller instead of terminating the process.
+
+#include "core/thread_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace scp {
+namespace {
+
+TEST(ThreadPoolTest, ParallelForRunsEveryIndexOnce)
+{
+    ThreadPool pool(4);
+    std::vector<std::atomic<int>> runs(10000);
+    pool.parallelFor(runs.size(), [&](std::size_t i) { runs[i].fetch_add(1); });
+    for (std::size_t i = 0; i < runs.size(); ++i)
+        ASSERT_EQ(runs[i].load(), 1) << "index " << i;
+    pool.parallelFor(0, [](std::size_t) { FAIL(); });
+}
+
+TEST(ThreadPoolTest, NestedParallelFor)
+{
+    ThreadPool pool(3);
+    std::atomic<int> total{0};
+    pool.parallelFor(16, [&](std::size_t) {
+        pool.parallelFor(16, [&](std::size_t) { total.fetch_add(1); });
+    });
+    EXPECT_EQ(total.load(), 256);
+}
+
+TEST(ThreadPoolTest, SubmittedTasksRun)
+{
+    ThreadPool pool(2);
+    std::atomic<int> ran{0};
+    for (int i = 0; i < 100; ++i)
+        pool.submit([&] { ran.fetch_add(1); });
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (ran.load() < 100 && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::yield();
+    EXPECT_EQ(ran.load(), 100);
+}
+
+TEST(ThreadPoolTest, ThrowingTaskDoesNotStopTheWorker)
+{
+    ThreadPool pool(1);
+    pool.submit([] { throw std::runtime_error("dropped"); });
+    pool.submit([] { throw 42; });
+    std::atomic<bool> ran{false};
+    pool.submit([&] { ran = true; });
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!ran && std::chrono::steady_clock::now() < deadline)
+        std::this_thread::yield();
+    EXPECT_TRUE(ran);
+}
+
+TEST(ThreadPoolTest, ParallelForRethrowsAfterEveryBodyReturned)
+{
+    ThreadPool pool(4);
+    for (int round = 0; round < 50; ++round) {
+        std::atomic<int> running{0};
+        std::atomic<int> started{0};
+        bool finishedInside = true;
+        try {
+            pool.parallelFor(64, [&](std::size_t i) {
+                running.fetch_add(1);
+                started.fetch_add(1);
+                if (i == 3) {
+                    running.fetch_sub(1);
+                    throw std::runtime_error("index 3");
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                running.fetch_sub(1);
+            });
+            finishedInside = false;
+        } catch (const std::runtime_error &e) {
+            EXPECT_STREQ(e.what(), "index 3");
+        }
+        EXPECT_TRUE(finishedInside);
+        // Nothing may still be using the captures above.
+        EXPECT_EQ(running.load(), 0);
+        // Indices after the failure are skipped.
+        EXPECT_LT(started.load(), 64);
+    }
+}
+
+TEST(ThreadPoolTest, ParallelForRethrowsAnyException)
+{
+    ThreadPool pool(2);
+    EXPECT_THROW(pool.parallelFor(8, [](std::size_t i) {
+        if (i == 5)
+            throw 5;
+    }),
+                 int);
+    // The pool is still usable.
+    std::atomic<int> ran{0};
+    pool.parallelFor(8, [&](std::size_t) { ran.fetch_add(1); });
+    EXPECT_EQ(ran.load(), 8);
+}
+
+} // namespace
+} // namespace scp
@@ -0,0 +1,182 @@
+// Segment planning, and segments encoded by AVSegmentEncoder joined back
+// together by concatSegments().
+
+#include "jobs/av_segment_encoder.h"
+#include "jobs/export_segments.h"
+
+#include "core/frame_pool.h"
+#include "media/ffmpeg_ptr.h"
+#include "media/media_error.h"
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+namespace scp {
+namespace {
+
+TEST(PlanSegmentsTest, EmptyRange)
+{
+    EXPECT_TRUE(planSegments(10, 10, {}, "/out/a.mp4").empty());
+    EXPECT_TRUE(planSegments(10, 5, {}, "/out/a.mp4").empty());
+}
+
+TEST(PlanSegmentsTest, ShortRangeIsOneSegment)
+{
+    const std::vector<ExportSegment> segments = planSegments(0, 100, {60, 8, 600}, "/out/a.mp4");
+    ASSERT_EQ(segments.size(), 1u);
+    EXPECT_EQ(segments[0].startFrame, 0);
+    EXPECT_EQ(segments[0].endFrame, 100);
+    EXPECT_EQ(segments[0].path, "/out/a.seg000.mp4");
+}
+
+TEST(PlanSegmentsTest, SegmentsStartOnGopBoundaries)
+{
+    const std::vector<ExportSegment> segments = planSegments(100, 1310, {60, 4, 300},
+                                                             "/out/a.mkv");
+    ASSERT_EQ(segments.size(), 4u);
+    std::int64_t next = 100;
+    for (std::size_t i = 0; i < segments.size(); ++i) {
+        EXPECT_EQ(segments[i].index, int(i));
+        EXPECT_EQ(segments[i].startFrame, next);
+        EXPECT_EQ((segments[i].startFrame - 100) % 60, 0);
+        EXPECT_GT(segments[i].endFrame, segments[i].startFrame);
+        next = segments[i].endFrame;
+    }
+    EXPECT_EQ(next, 1310);
+    EXPECT_EQ(segments[3].path, "/out/a.seg003.mkv");
+}
+
+TEST(PlanSegmentsTest, SegmentCountIsBounded)
+{
+    // Long enough for 100 segments by size; capped by maxSegments.
+    const std::vector<ExportSegment> segments = planSegments(0, 10000, {10, 3, 100}, "a.mp4");
+    ASSERT_EQ(segments.size(), 3u);
+    EXPECT_EQ(segments.back().endFrame, 10000);
+}
+
+class ConcatSegmentsTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        char directory[] = "/tmp/scp_export_segments_XXXXXX";
+        ASSERT_NE(::mkdtemp(directory), nullptr);
+        m_directory = directory;
+    }
+
+    void TearDown() override { std::filesystem::remove_all(m_directory); }
+
+    // Built-in MPEG-4 Part 2 with B-frames, so closed GOPs matter.
+    AVSegmentEncoder encoder()
+    {
+        VideoEncoderSettings settings;
+        settings.codec = "mpeg4";
+        settings.width = 64;
+        settings.height = 48;
+        settings.frameRate = {25, 1};
+        settings.bitRate = 400000;
+        settings.codecOptions = {{"bf", "2"}};
+        return AVSegmentEncoder(settings, [this](std::int64_t n) {
+            FrameRef frame = m_pool.acquire({64, 48, PixelFormat::YUV420P});
+            for (int i = 0; i < 3; ++i) {
+                const int rows = i ? 24 : 48;
+                std::memset(frame->data(i), int(n * 3 + i * 50) & 0xff,
+                            std::size_t(frame->stride(i)) * rows);
+            }
+            return frame;
+        });
+    }
+
+    struct Packet
+    {
+        std::int64_t dts;
+        bool key;
+    };
+
+    static std::vector<Packet> packets(const std::string &path)
+    {
+        AVFormatContext *context = nullptr;
+        if (avformat_open_input(&context, path.c_str(), nullptr, nullptr) < 0)
+            return {};
+        AVFormatContextPtr input(context);
+        std::vector<Packet> out;
+        AVPacketPtr packet(av_packet_alloc());
+        while (av_read_frame(input.get(), packet.get()) >= 0) {
+            out.push_back({packet->dts, (packet->flags & AV_PKT_FLAG_KEY) != 0});
+            av_packet_unref(packet.get());
+        }
+        return out;
+    }
+
+    FramePool m_pool;
+    std::string m_directory;
+};
+
+TEST_F(ConcatSegmentsTest, EncodedSegmentsJoinByStreamCopy)
+{
+    ExportJob job;
+    job.outputPath = m_directory + "/out.mp4";
+    job.startFrame = 0;
+    job.endFrame = 90;
+    job.segments = {10, 3, 10};
+    const std::vector<ExportSegment> segments = planSegments(job.startFrame, job.endFrame,
+                                                             job.segments, job.outputPath);
+    ASSERT_EQ(segments.size(), 3u);
+
+    AVSegmentEncoder segmentEncoder = encoder();
+    std::vector<std::string> parts;
+    for (const ExportSegment &segment : segments) {
+        std::int64_t encoded = 0;
+        segmentEncoder.encode(job, segment, {}, [&](std::int64_t frames) { encoded += frames; });
+        EXPECT_EQ(encoded, segment.endFrame - segment.startFrame);
+        const std::vector<Packet> part = packets(segment.path);
+        ASSERT_EQ(part.size(), std::size_t(segment.endFrame - segment.startFrame));
+        EXPECT_TRUE(part.front().key) << segment.path;
+        parts.push_back(segment.path);
+    }
+
+    concatSegments(parts, job.outputPath);
+    const std::vector<Packet> joined = packets(job.outputPath);
+    ASSERT_EQ(joined.size(), 90u);
+    EXPECT_TRUE(joined.front().key);
+    for (std::size_t i = 1; i < joined.size(); ++i)
+        EXPECT_GT(joined[i].dts, joined[i - 1].dts) << "packet " << i;
+}
+
+TEST_F(ConcatSegmentsTest, StopEndsTheSegmentEarly)
+{
+    ExportJob job;
+    job.segments = {10, 1, 10};
+    const ExportSegment segment{0, 0, 50, m_directory + "/a.seg000.mp4"};
+    std::stop_source stop;
+    std::int64_t encoded = 0;
+    encoder().encode(job, segment, stop.get_token(), [&](std::int64_t frames) {
+        if ((encoded += frames) == 5)
+            stop.request_stop();
+    });
+    EXPECT_EQ(encoded, 5);
+}
+
+TEST_F(ConcatSegmentsTest, Errors)
+{
+    EXPECT_THROW(concatSegments({}, m_directory + "/out.mp4"), MediaError);
+    EXPECT_THROW(concatSegments({m_directory + "/missing.mp4"}, m_directory + "/out.mp4"),
+                 MediaError);
+
+    VideoEncoderSettings settings;
+    settings.codec = "no-such-encoder";
+    AVSegmentEncoder missing(settings, [](std::int64_t) { return FrameRef(); });
+    EXPECT_THROW(missing.encode({}, {0, 0, 1, m_directory + "/a.mp4"}, {}, [](std::int64_t) {}),
+                 MediaError);
+}
+
+} // namespace
+} // namespace scp
@@ -0,0 +1,128 @@
+// RenderQueue with a stand-in encoder: job states, what happens to the output
+// file, and how long finished jobs are remembered.
+
+#include "jobs/render_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+namespace scp {
+namespace {
+
+// Writes each segment's frame range as text, or throws what it is told to.
+class TextEncoder final : public SegmentEncoder
+{
+public:
+    void encode(const ExportJob &, const ExportSegment &segment, std::stop_token,
+                const std::function<void(std::int64_t frames)> &progress) override
+    {
+        if (throwInt)
+            throw 42;
+        if (throwError)
+            throw std::runtime_error("encoder failed");
+        std::ofstream(segment.path) << segment.startFrame << '-' << segment.endFrame;
+        progress(segment.endFrame - segment.startFrame);
+    }
+
+    bool throwInt = false;
+    bool throwError = false;
+};
+
+std::string contents(const std::string &path)
+{
+    std::ifstream in(path);
+    return std::string(std::istreambuf_iterator<char>(in), {});
+}
+
+class RenderQueueTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        char directory[] = "/tmp/scp_render_queue_XXXXXX";
+        ASSERT_NE(::mkdtemp(directory), nullptr);
+        m_directory = directory;
+    }
+
+    void TearDown() override { std::filesystem::remove_all(m_directory); }
+
+    // Short enough to be a single segment, so no remuxing is involved.
+    ExportJob job(const std::string &name) const
+    {
+        ExportJob job;
+        job.name = name;
+        job.outputPath = m_directory + "/" + name + ".mp4";
+        job.startFrame = 0;
+        job.endFrame = 100;
+        return job;
+    }
+
+    std::string m_directory;
+    TextEncoder m_encoder;
+};
+
+TEST_F(RenderQueueTest, FinishedJobWritesOutput)
+{
+    RenderQueue queue(m_encoder, 2);
+    const JobId id = queue.enqueue(job("a"));
+    queue.waitForIdle();
+    const JobStatus status = queue.status(id);
+    EXPECT_EQ(status.state, JobState::Finished);
+    EXPECT_EQ(status.progress, 1.0);
+    EXPECT_EQ(contents(m_directory + "/a.mp4"), "0-100");
+    EXPECT_FALSE(std::filesystem::exists(m_directory + "/a.seg000.mp4"));
+}
+
+TEST_F(RenderQueueTest, FailedJobKeepsExistingOutput)
+{
+    std::ofstream(m_directory + "/a.mp4") << "previous export";
+    RenderQueue queue(m_encoder, 2);
+
+    m_encoder.throwError = true;
+    const JobId failed = queue.enqueue(job("a"));
+    queue.waitForIdle();
+    EXPECT_EQ(queue.status(failed).state, JobState::Failed);
+    EXPECT_EQ(queue.status(failed).error, "segment 0: encoder failed");
+    EXPECT_EQ(contents(m_directory + "/a.mp4"), "previous export");
+
+    // Not a std::exception: still reported, not fatal.
+    m_encoder.throwError = false;
+    m_encoder.throwInt = true;
+    const JobId odd = queue.enqueue(job("a"));
+    queue.waitForIdle();
+    EXPECT_EQ(queue.status(odd).state, JobState::Failed);
+    EXPECT_EQ(queue.status(odd).error, "segment 0: unknown error");
+    EXPECT_EQ(contents(m_directory + "/a.mp4"), "previous export");
+}
+
+TEST_F(RenderQueueTest, CancelQueuedJob)
+{
+    RenderQueue queue(m_encoder, 1);
+    const JobId id = queue.enqueue(job("a"));
+    queue.cancel(id);
+    queue.waitForIdle();
+    EXPECT_EQ(queue.status(id).state, JobState::Cancelled);
+}
+
+TEST_F(RenderQueueTest, ForgetsOldFinishedJobs)
+{
+    RenderQueue queue(m_encoder, 1);
+    const JobId first = queue.enqueue(job("first"));
+    JobId last = first;
+    for (std::size_t i = 0; i < RenderQueue::kKeptJobs; ++i)
+        last = queue.enqueue(job("job" + std::to_string(i)));
+    queue.waitForIdle();
+    EXPECT_EQ(queue.status(first).error, "unknown job");
+    EXPECT_EQ(queue.status(first + 1).state, JobState::Finished);
+    EXPECT_EQ(queue.status(last).state, JobState::Finished);
+}
+
+} // namespace
+} // namespace scp
@@ -0,0 +1,178 @@
+// CpuDecodeBackend on a short generated clip: the submit queue stays within
+// its depth, frames held by the caller stall the decoder, and surfaces are
+// recycled once released.
+
+#include "media/cpu_decode_backend.h"
+
+#include "core/frame_pool.h"
+#include "jobs/av_segment_encoder.h"
+#include "media/ffmpeg_ptr.h"
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace scp {
+namespace {
+
+using namespace std::chrono_literals;
+
+constexpr int kFrames = 30;
+
+class CpuDecodeBackendTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        char directory[] = "/tmp/scp_cpu_decode_XXXXXX";
+        ASSERT_NE(::mkdtemp(directory), nullptr);
+        m_directory = directory;
+        const std::string path = m_directory + "/clip.mp4";
+
+        VideoEncoderSettings settings;
+        settings.codec = "mpeg4";
+        settings.width = 64;
+        settings.height = 48;
+        settings.frameRate = {25, 1};
+        FramePool pool;
+        AVSegmentEncoder encoder(settings, [&pool](std::int64_t n) {
+            FrameRef frame = pool.acquire({64, 48, PixelFormat::YUV420P});
+            for (int i = 0; i < 3; ++i)
+                std::memset(frame->data(i), int(n * 5 + i * 40) & 0xff,
+                            std::size_t(frame->stride(i)) * (i ? 24 : 48));
+            return frame;
+        });
+        ExportJob job;
+        job.segments.gopLength = 10;
+        encoder.encode(job, {0, 0, kFrames, path}, {}, [](std::int64_t) {});
+
+        AVFormatContext *context = nullptr;
+        ASSERT_GE(avformat_open_input(&context, path.c_str(), nullptr, nullptr), 0);
+        m_input.reset(context);
+        ASSERT_GE(avformat_find_stream_info(context, nullptr), 0);
+        ASSERT_EQ(context->nb_streams, 1u);
+        AVPacketPtr packet(av_packet_alloc());
+        while (av_read_frame(context, packet.get()) >= 0) {
+            m_packets.emplace_back(av_packet_alloc());
+            av_packet_move_ref(m_packets.back().get(), packet.get());
+        }
+        ASSERT_EQ(m_packets.size(), std::size_t(kFrames));
+    }
+
+    void TearDown() override { std::filesystem::remove_all(m_directory); }
+
+    const AVStream *stream() const { return m_input->streams[0]; }
+
+    // Frame threading would hold packets inside the codec.
+    static DecoderOptions singleThreaded()
+    {
+        DecoderOptions options;
+        options.budget = nullptr;
+        options.threads = 1;
+        return options;
+    }
+
+    // Submits every packet and the end of the stream, dropping each frame
+    // as soon as it is polled, starting at packet first. Returns the
+    // surfaces the frames came in.
+    std::set<const FrameBuffer *> decodeAll(DecodeBackend &backend, std::size_t first = 0)
+    {
+        std::set<const FrameBuffer *> surfaces;
+        auto pollOne = [&] {
+            if (const FrameRef frame = backend.poll(10ms))
+                surfaces.insert(frame.get());
+        };
+        for (std::size_t i = first; i < m_packets.size(); ++i) {
+            while (!backend.submit(m_packets[i].get()))
+                pollOne();
+        }
+        while (!backend.submit(nullptr))
+            pollOne();
+        while (!backend.finished())
+            pollOne();
+        return surfaces;
+    }
+
+    std::string m_directory;
+    AVFormatContextPtr m_input;
+    std::vector<AVPacketPtr> m_packets;
+};
+
+TEST_F(CpuDecodeBackendTest, DecodesEveryFrameThroughRecycledSurfaces)
+{
+    CpuDecodeBackend backend(stream(), {4, 3}, singleThreaded());
+    const std::set<const FrameBuffer *> surfaces = decodeAll(backend);
+    EXPECT_LE(surfaces.size(), 3u);
+
+    const DecodeBackendStats stats = backend.stats();
+    EXPECT_EQ(stats.packetsSubmitted, std::uint64_t(kFrames));
+    EXPECT_EQ(stats.framesDecoded, std::uint64_t(kFrames));
+    EXPECT_LE(stats.peakQueueDepth, 4);
+    EXPECT_EQ(stats.surfacesInUse, 0);
+}
+
+TEST_F(CpuDecodeBackendTest, HeldFramesStallTheDecoderAndFillTheQueue)
+{
+    CpuDecodeBackend backend(stream(), {2, 2}, singleThreaded());
+
+    // Never polling: the decoder fills both surfaces, then waits for one
+    // while the queue backs up behind it.
+    std::size_t accepted = 0;
+    const auto deadline = std::chrono::steady_clock::now() + 10s;
+    while (backend.stats().surfaceStalls == 0 && std::chrono::steady_clock::now() < deadline) {
+        if (accepted < m_packets.size() && backend.submit(m_packets[accepted].get()))
+            ++accepted;
+        else
+            std::this_thread::sleep_for(1ms);
+    }
+    while (accepted < m_packets.size() && backend.submit(m_packets[accepted].get()))
+        ++accepted;
+    ASSERT_LT(accepted, m_packets.size());
+
+    DecodeBackendStats stats = backend.stats();
+    EXPECT_GE(stats.surfaceStalls, 1u);
+    EXPECT_GE(stats.submitsRejected, 1u);
+    EXPECT_LE(stats.peakQueueDepth, 2);
+    EXPECT_EQ(stats.surfacesInUse, 2);
+
+    // Holding the polled frames keeps them out of the pool.
+    std::vector<FrameRef> held;
+    held.push_back(backend.poll(1s));
+    held.push_back(backend.poll(1s));
+    ASSERT_TRUE(held[0] && held[1]);
+    EXPECT_FALSE(backend.poll(50ms));
+    EXPECT_EQ(backend.stats().surfacesInUse, 2);
+
+    // Released, they come back for the rest of the stream.
+    held.clear();
+    decodeAll(backend, accepted);
+    stats = backend.stats();
+    EXPECT_EQ(stats.framesDecoded, std::uint64_t(kFrames));
+    EXPECT_EQ(stats.surfacesInUse, 0);
+}
+
+TEST_F(CpuDecodeBackendTest, FramesOutliveTheBackend)
+{
+    FrameRef frame;
+    {
+        CpuDecodeBackend backend(stream(), {2, 2}, singleThreaded());
+        ASSERT_TRUE(backend.submit(m_packets[0].get()));
+        ASSERT_TRUE(backend.submit(nullptr));
+        frame = backend.poll(10s);
+        ASSERT_TRUE(frame);
+    }
+    EXPECT_EQ(frame->format(), (FrameFormat{64, 48, PixelFormat::YUV420P}));
+    frame->data(0)[0] = 0;
+}
+
+} // namespace
+} // namespace scp
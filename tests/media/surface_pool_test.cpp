@@ -0,0 +1,80 @@
+// SurfacePool: a fixed set of surfaces, handed out until exhausted and
+// returned when the last reference goes.
+
+#include "media/surface_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <stop_token>
+#include <thread>
+
+namespace scp {
+namespace {
+
+constexpr FrameFormat kFormat{32, 16, PixelFormat::NV12};
+
+TEST(SurfacePoolTest, InvalidArguments)
+{
+    EXPECT_FALSE(SurfacePool::create({0, 16, PixelFormat::NV12}, 2));
+    EXPECT_FALSE(SurfacePool::create(kFormat, 0));
+}
+
+TEST(SurfacePoolTest, SurfacesAreRecycled)
+{
+    const std::shared_ptr<SurfacePool> pool = SurfacePool::create(kFormat, 2);
+    ASSERT_TRUE(pool);
+    EXPECT_EQ(pool->size(), 2);
+
+    FrameRef a = pool->tryAcquire();
+    FrameRef b = pool->tryAcquire();
+    ASSERT_TRUE(a && b);
+    EXPECT_NE(a.get(), b.get());
+    EXPECT_EQ(a->format(), kFormat);
+    EXPECT_EQ(pool->available(), 0);
+    EXPECT_FALSE(pool->tryAcquire());
+
+    const FrameBuffer *released = a.get();
+    FrameRef copy = a;
+    a = {};
+    EXPECT_EQ(pool->available(), 0); // copy still references it
+    copy = {};
+    EXPECT_EQ(pool->available(), 1);
+    EXPECT_EQ(pool->tryAcquire().get(), released);
+}
+
+TEST(SurfacePoolTest, AcquireWaitsForARelease)
+{
+    const std::shared_ptr<SurfacePool> pool = SurfacePool::create(kFormat, 1);
+    FrameRef held = pool->tryAcquire();
+    const FrameBuffer *surface = held.get();
+    std::jthread releaser([&held] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        held = {};
+    });
+    EXPECT_EQ(pool->acquire({}).get(), surface);
+}
+
+TEST(SurfacePoolTest, AcquireStopsOnRequest)
+{
+    const std::shared_ptr<SurfacePool> pool = SurfacePool::create(kFormat, 1);
+    const FrameRef held = pool->tryAcquire();
+    std::stop_source stop;
+    stop.request_stop();
+    EXPECT_FALSE(pool->acquire(stop.get_token()));
+}
+
+TEST(SurfacePoolTest, SurfacesKeepThePoolAlive)
+{
+    std::shared_ptr<SurfacePool> pool = SurfacePool::create(kFormat, 1);
+    const std::weak_ptr<SurfacePool> weak = pool;
+    FrameRef frame = pool->tryAcquire();
+    pool.reset();
+    EXPECT_FALSE(weak.expired());
+    frame->data(0)[0] = 1;
+    frame = {};
+    EXPECT_TRUE(weak.expired());
+}
+
+} // namespace
+} // namespace scp
@@ -0,0 +1,177 @@
+// FrameCache's disk tier: what comes back from disk is the latest frame
+// inserted under its key, damaged files are misses, and the cache cleans up
+// only after itself.
+
+#include "playback/frame_cache.h"
+
+#include "core/frame_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace scp {
+namespace {
+
+constexpr FrameFormat kFormat{64, 64, PixelFormat::RGBA8};
+
+class FrameCacheTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        char directory[] = "/tmp/scp_frame_cache_XXXXXX";
+        ASSERT_NE(::mkdtemp(directory), nullptr);
+        m_directory = directory;
+    }
+
+    void TearDown() override { std::filesystem::remove_all(m_directory); }
+
+    FrameCacheConfig config() const
+    {
+        // Room for one frame in RAM, so every insert spills the previous one.
+        FrameCacheConfig config;
+        config.ramBudget = FramePool::bufferBytes(kFormat);
+        config.diskDirectory = m_directory;
+        config.diskBudget = std::size_t(64) << 20;
+        return config;
+    }
+
+    FrameRef filled(std::uint8_t value)
+    {
+        FrameRef frame = m_pool.acquire(kFormat);
+        std::memset(frame->data(0), value, std::size_t(frame->stride(0)) * kFormat.height);
+        return frame;
+    }
+
+    static void waitForDiskEntries(const FrameCache &cache, std::size_t entries)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (cache.stats().diskEntries < entries && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        ASSERT_GE(cache.stats().diskEntries, entries);
+    }
+
+    // Every cache file below the test directory.
+    std::vector<std::filesystem::path> cacheFiles() const
+    {
+        std::vector<std::filesystem::path> files;
+        for (const auto &entry : std::filesystem::recursive_directory_iterator(m_directory)) {
+            if (entry.path().extension() == ".scf")
+                files.push_back(entry.path());
+        }
+        return files;
+    }
+
+    FramePool m_pool;
+    std::string m_directory;
+};
+
+TEST_F(FrameCacheTest, DiskHitIsPromoted)
+{
+    FrameCache cache(m_pool, config());
+    cache.insert({1}, filled(1));
+    cache.insert({2}, filled(2));
+    waitForDiskEntries(cache, 1);
+
+    const FrameRef frame = cache.find({1});
+    ASSERT_TRUE(frame);
+    EXPECT_EQ(frame->data(0)[0], 1);
+    EXPECT_EQ(cache.stats().diskHits, 1u);
+}
+
+TEST_F(FrameCacheTest, ReinsertReplacesDiskCopy)
+{
+    FrameCache cache(m_pool, config());
+    cache.insert({1}, filled(1));
+    cache.insert({2}, filled(2));
+    waitForDiskEntries(cache, 1);
+
+    // The new frame for key 1 spills in turn; the old copy must not win.
+    // Re-inserting key 2 drops whatever of it reached the disk meanwhile, so
+    // the next disk entry can only be key 1's new copy.
+    cache.insert({1}, filled(3));
+    cache.insert({2}, filled(4));
+    waitForDiskEntries(cache, 1);
+
+    const FrameRef frame = cache.find({1});
+    ASSERT_TRUE(frame);
+    EXPECT_EQ(frame->data(0)[0], 3);
+}
+
+TEST_F(FrameCacheTest, ReinsertDropsDiskCopyBeforeItSpills)
+{
+    FrameCache cache(m_pool, config());
+    cache.insert({1}, filled(1));
+    cache.insert({2}, filled(2));
+    waitForDiskEntries(cache, 1);
+
+    cache.insert({1}, filled(3));
+    // That evicted key 2, which may spill meanwhile; leave only key 1 to count.
+    cache.invalidate(2, 3);
+    EXPECT_EQ(cache.stats().diskEntries, 0u);
+    EXPECT_EQ(cache.find({1})->data(0)[0], 3);
+}
+
+TEST_F(FrameCacheTest, CorruptDiskFileIsAMiss)
+{
+    FrameCache cache(m_pool, config());
+    cache.insert({1}, filled(1));
+    cache.insert({2}, filled(2));
+    waitForDiskEntries(cache, 1);
+    const std::vector<std::filesystem::path> files = cacheFiles();
+    ASSERT_EQ(files.size(), 1u);
+
+    // A header claiming far more data than the file holds.
+    {
+        std::fstream file(files.front(), std::ios::binary | std::ios::in | std::ios::out);
+        const std::uint64_t huge = std::uint64_t(1) << 60;
+        file.seekp(40);
+        file.write(reinterpret_cast<const char *>(&huge), sizeof(huge));
+    }
+    EXPECT_FALSE(cache.find({1}));
+
+    // And a truncated one.
+    cache.insert({3}, filled(3));
+    cache.insert({4}, filled(4));
+    waitForDiskEntries(cache, 3);
+    for (const std::filesystem::path &file : cacheFiles())
+        std::filesystem::resize_file(file, 100);
+    EXPECT_FALSE(cache.find({3}));
+}
+
+TEST_F(FrameCacheTest, CleansUpOnlyItsOwnFiles)
+{
+    const std::string unrelated = m_directory + "/unrelated.scf";
+    std::ofstream(unrelated) << "not ours";
+    // Left by a process that is gone, and in use by one that is running.
+    const std::string abandoned = m_directory + "/scp-frame-cache-2147483646-0";
+    const std::string live = m_directory + "/scp-frame-cache-" + std::to_string(::getpid())
+                             + "-999999";
+    std::filesystem::create_directory(abandoned);
+    std::ofstream(abandoned + "/1_1.scf.tmp") << "interrupted";
+    std::filesystem::create_directory(live);
+    {
+        FrameCache cache(m_pool, config());
+        EXPECT_FALSE(std::filesystem::exists(abandoned));
+        cache.insert({1}, filled(1));
+        cache.insert({2}, filled(2));
+        waitForDiskEntries(cache, 1);
+        EXPECT_EQ(cacheFiles().size(), 2u); // unrelated.scf and the spilled frame
+    }
+    EXPECT_EQ(cacheFiles(), std::vector<std::filesystem::path>{unrelated});
+    EXPECT_TRUE(std::filesystem::exists(live));
+}
+
+} // namespace
+} // namespace scp
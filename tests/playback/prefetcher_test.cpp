@@ -0,0 +1,229 @@
+// Prefetcher: the frames predict() plans for each kind of playhead motion,
+// and how renders that fall out of the plan or are overtaken by an edit are
+// cancelled and kept out of the cache.
+
+#include "playback/prefetcher.h"
+
+#include "core/frame_pool.h"
+#include "core/thread_pool.h"
+#include "playback/frame_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace scp {
+namespace {
+
+using namespace std::chrono_literals;
+using Frames = std::vector<std::int64_t>;
+
+constexpr std::int64_t kEnd = INT64_MAX;
+
+PrefetchConfig config()
+{
+    PrefetchConfig config;
+    config.frameRate = 25.0;
+    config.maxLookaheadFrames = 5;
+    config.scrubRadius = 2;
+    return config;
+}
+
+TEST(PrefetcherPredictTest, PausedKeepsTheNeighbourhoodWarm)
+{
+    const PlayheadMotion paused{100, 0.0, 0.04, false};
+    EXPECT_EQ(Prefetcher::predict(paused, config(), 0, kEnd), (Frames{100, 101, 99, 102, 98}));
+}
+
+TEST(PrefetcherPredictTest, PlaybackLooksAheadInDisplayOrder)
+{
+    EXPECT_EQ(Prefetcher::predict({100, 25.0, 0.04, false}, config(), 0, kEnd),
+              (Frames{100, 101, 102, 103, 104}));
+    // J: backwards.
+    EXPECT_EQ(Prefetcher::predict({100, -25.0, 0.04, false}, config(), 0, kEnd),
+              (Frames{100, 99, 98, 97, 96}));
+    // Fast shuttle skips the frames the player will not show.
+    EXPECT_EQ(Prefetcher::predict({100, 100.0, 0.04, false}, config(), 0, kEnd),
+              (Frames{100, 104, 108, 112, 116}));
+}
+
+TEST(PrefetcherPredictTest, LookaheadFollowsTheConfiguredTime)
+{
+    PrefetchConfig shortLookahead = config();
+    shortLookahead.lookaheadSeconds = 0.1;
+    EXPECT_EQ(Prefetcher::predict({0, 25.0, 0.04, false}, shortLookahead, 0, kEnd),
+              (Frames{0, 1, 2}));
+}
+
+TEST(PrefetcherPredictTest, ScrubbingLooksAheadThenAroundThePlayhead)
+{
+    // Leaning forward: 101 comes before 99.
+    EXPECT_EQ(Prefetcher::predict({100, 50.0, 0.04, true}, config(), 0, kEnd),
+              (Frames{100, 102, 104, 106, 108, 101, 99, 98}));
+    // A slow scrub is treated like a pause, leaning the way it moves.
+    EXPECT_EQ(Prefetcher::predict({100, -5.0, 0.04, true}, config(), 0, kEnd),
+              (Frames{100, 99, 101, 98, 102}));
+}
+
+TEST(PrefetcherPredictTest, ClampsToTheRange)
+{
+    EXPECT_EQ(Prefetcher::predict({100, 25.0, 0.04, false}, config(), 0, 103),
+              (Frames{100, 101, 102}));
+    EXPECT_EQ(Prefetcher::predict({0, 0.0, 0.04, false}, config(), 0, kEnd), (Frames{0, 1, 2}));
+    EXPECT_TRUE(Prefetcher::predict({200, 0.0, 0.04, false}, config(), 0, 100).empty());
+}
+
+// Renders frames tagged with a render count. Frames listed in blocked wait
+// until released, or until stopped if honourStop is set.
+class PrefetcherTest : public ::testing::Test
+{
+protected:
+    ~PrefetcherTest() override { m_release = true; }
+
+    FrameRenderer renderer()
+    {
+        return [this](std::int64_t frame, std::stop_token stop) -> FrameRef {
+            const int count = m_renders.fetch_add(1) + 1;
+            if (frame == m_blocked) {
+                m_blockedStarted = true;
+                while (!m_release && !(m_honourStop && stop.stop_requested()))
+                    std::this_thread::sleep_for(1ms);
+                if (m_honourStop && stop.stop_requested())
+                    return {};
+            }
+            FrameRef result = m_pool.acquire({4, 4, PixelFormat::RGBA8});
+            result->data(0)[0] = std::uint8_t(count);
+            return result;
+        };
+    }
+
+    static bool waitFor(const std::function<bool()> &condition)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + 10s;
+        while (!condition()) {
+            if (std::chrono::steady_clock::now() > deadline)
+                return false;
+            std::this_thread::sleep_for(1ms);
+        }
+        return true;
+    }
+
+    FramePool m_pool;
+    FrameCache m_cache{m_pool};
+    ThreadPool m_threads{2};
+    std::atomic<int> m_renders{0};
+    std::atomic<std::int64_t> m_blocked{-1};
+    std::atomic<bool> m_blockedStarted{false};
+    std::atomic<bool> m_release{false};
+    std::atomic<bool> m_honourStop{true};
+};
+
+TEST_F(PrefetcherTest, RendersThePlanIntoTheCache)
+{
+    PrefetchConfig settings = config();
+    settings.variant = 3;
+    Prefetcher prefetcher(m_cache, m_threads, renderer(), settings);
+    prefetcher.play(10, 1.0);
+    ASSERT_TRUE(waitFor([&] { return prefetcher.stats().rendered == 5; }));
+    for (std::int64_t frame = 10; frame < 15; ++frame)
+        EXPECT_TRUE(m_cache.contains({frame, 3})) << frame;
+    EXPECT_EQ(prefetcher.stats().scheduled, 5u);
+
+    // Already cached frames are not scheduled again.
+    prefetcher.play(10, 1.0);
+    EXPECT_EQ(prefetcher.stats().scheduled, 5u);
+}
+
+TEST_F(PrefetcherTest, MovingAwayCancelsRendersOutsideThePlan)
+{
+    PrefetchConfig settings = config();
+    settings.scrubRadius = 0;
+    settings.maxInFlight = 1;
+    m_blocked = 0;
+    Prefetcher prefetcher(m_cache, m_threads, renderer(), settings);
+    prefetcher.play(0, 0.0);
+    ASSERT_TRUE(waitFor([&] { return m_blockedStarted.load(); }));
+
+    prefetcher.play(100, 0.0);
+    ASSERT_TRUE(waitFor([&] { return prefetcher.stats().rendered == 1; }));
+    const PrefetchStats stats = prefetcher.stats();
+    EXPECT_EQ(stats.scheduled, 2u);
+    EXPECT_EQ(stats.cancelled, 1u);
+    EXPECT_FALSE(m_cache.contains({0, 0}));
+    EXPECT_TRUE(m_cache.contains({100, 0}));
+}
+
+TEST_F(PrefetcherTest, StaleRenderIsDiscardedAndRedone)
+{
+    PrefetchConfig settings = config();
+    settings.scrubRadius = 0;
+    m_blocked = 5;
+    m_honourStop = false; // the render completes after the edit
+    Prefetcher prefetcher(m_cache, m_threads, renderer(), settings);
+    prefetcher.play(5, 0.0);
+    ASSERT_TRUE(waitFor([&] { return m_blockedStarted.load(); }));
+
+    m_cache.invalidate(0, 10);
+    prefetcher.invalidate(0, 10);
+    m_blocked = -1;
+    m_release = true;
+    ASSERT_TRUE(waitFor([&] { return prefetcher.stats().rendered == 1; }));
+    EXPECT_EQ(prefetcher.stats().cancelled, 1u);
+    const FrameRef frame = m_cache.find({5, 0});
+    ASSERT_TRUE(frame);
+    EXPECT_EQ(frame->data(0)[0], 2); // the second render, not the stale one
+}
+
+TEST_F(PrefetcherTest, EditElsewhereLeavesRendersAlone)
+{
+    PrefetchConfig settings = config();
+    settings.scrubRadius = 0;
+    m_blocked = 5;
+    Prefetcher prefetcher(m_cache, m_threads, renderer(), settings);
+    prefetcher.play(5, 0.0);
+    ASSERT_TRUE(waitFor([&] { return m_blockedStarted.load(); }));
+
+    prefetcher.invalidate(20, 30);
+    m_release = true;
+    ASSERT_TRUE(waitFor([&] { return prefetcher.stats().rendered == 1; }));
+    EXPECT_EQ(prefetcher.stats().cancelled, 0u);
+    EXPECT_EQ(m_renders.load(), 1);
+    EXPECT_TRUE(m_cache.contains({5, 0}));
+}
+
+TEST_F(PrefetcherTest, FullInvalidateDiscardsEveryRender)
+{
+    PrefetchConfig settings = config();
+    settings.scrubRadius = 0;
+    m_blocked = 5;
+    m_honourStop = false;
+    Prefetcher prefetcher(m_cache, m_threads, renderer(), settings);
+    prefetcher.play(5, 0.0);
+    ASSERT_TRUE(waitFor([&] { return m_blockedStarted.load(); }));
+
+    prefetcher.invalidate();
+    m_blocked = -1;
+    m_release = true;
+    ASSERT_TRUE(waitFor([&] { return prefetcher.stats().rendered == 1; }));
+    EXPECT_EQ(prefetcher.stats().cancelled, 1u);
+    EXPECT_EQ(m_cache.find({5, 0})->data(0)[0], 2);
+}
+
+TEST_F(PrefetcherTest, ThrowingRendererCountsAsFailed)
+{
+    PrefetchConfig settings = config();
+    settings.scrubRadius = 0;
+    Prefetcher prefetcher(m_cache, m_threads,
+                          [](std::int64_t, std::stop_token) -> FrameRef { throw 1; }, settings);
+    prefetcher.play(0, 0.0);
+    ASSERT_TRUE(waitFor([&] { return prefetcher.stats().failed == 1; }));
+    EXPECT_FALSE(m_cache.contains({0, 0}));
+}
+
+} // namespace
+} // namespace scp
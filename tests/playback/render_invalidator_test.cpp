@@ -0,0 +1,126 @@
+// RenderInvalidator: a change drops exactly its frames from the frame cache,
+// demotes the node cache entries of the edited nodes and what depends on
+// them, and reaches every listener.
+
+#include "playback/render_invalidator.h"
+
+#include "core/frame_pool.h"
+#include "core/thread_pool.h"
+#include "playback/frame_cache.h"
+#include "render/node_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace scp {
+namespace {
+
+constexpr FrameFormat kFormat{16, 16, PixelFormat::RGBA8};
+
+// Graph structure is all the invalidator looks at; nothing is rendered.
+class StubNode final : public RenderNode
+{
+public:
+    Kind kind() const override { return Kind::Filter; }
+    std::string name() const override { return "stub"; }
+    std::uint64_t parameterHash(const RenderContext &) const override { return 0; }
+    FrameRef render(const RenderContext &, std::span<const FrameRef>) override { return {}; }
+};
+
+TEST(RenderInvalidatorTest, DropsOnlyTheChangedFrames)
+{
+    FramePool pool;
+    FrameCache frames(pool);
+    for (std::int64_t frame = 0; frame < 100; ++frame) {
+        frames.insert({frame, 0}, pool.acquire(kFormat));
+        frames.insert({frame, 1}, pool.acquire(kFormat));
+    }
+
+    RenderInvalidator invalidator(&frames);
+    Timeline timeline;
+    timeline.addTrack(TrackKind::Video);
+    ItemRef clip;
+    timeline.addItem(0, {ItemKind::Clip, "a.mov", 0}, {10, 50}, &clip);
+    invalidator.apply(timeline.trimItem(clip, {20, 45}));
+
+    for (std::int64_t frame = 0; frame < 100; ++frame) {
+        const bool changed = (frame >= 10 && frame < 20) || (frame >= 45 && frame < 50);
+        EXPECT_EQ(frames.contains({frame, 0}), !changed) << frame;
+        EXPECT_EQ(frames.contains({frame, 1}), !changed) << frame;
+    }
+    const InvalidationStats stats = invalidator.stats();
+    EXPECT_EQ(stats.changes, 1u);
+    EXPECT_EQ(stats.framesInvalidated, 15u);
+    EXPECT_EQ(stats.nodesDemoted, 0u);
+}
+
+TEST(RenderInvalidatorTest, DemotesChangedNodesAndTheirConsumers)
+{
+    FramePool pool;
+    const std::size_t frameBytes = FramePool::bufferBytes(kFormat);
+    NodeCache nodes(4 * frameBytes);
+    ThreadPool threads(1);
+    RenderGraph graph(threads, nodes);
+    const NodeId source = graph.addNode(std::make_unique<StubNode>());
+    const NodeId filter = graph.addNode(std::make_unique<StubNode>());
+    const NodeId other = graph.addNode(std::make_unique<StubNode>());
+    const NodeId output = graph.addNode(std::make_unique<StubNode>());
+    graph.connect(source, filter);
+    graph.connect(filter, output);
+    graph.connect(other, output);
+    // Oldest first: without demotion, other would be evicted next.
+    nodes.insert(1, pool.acquire(kFormat), other);
+    nodes.insert(2, pool.acquire(kFormat), filter);
+    nodes.insert(3, pool.acquire(kFormat), output);
+    nodes.insert(4, pool.acquire(kFormat), source);
+
+    RenderInvalidator invalidator(nullptr, nullptr, &nodes, &graph);
+    TimelineChange change;
+    change.addFrames({0, 10});
+    const std::vector<NodeId> changed{filter};
+    invalidator.apply(change, changed);
+    EXPECT_EQ(invalidator.stats().nodesDemoted, 2u); // filter and output
+
+    nodes.insert(5, pool.acquire(kFormat));
+    nodes.insert(6, pool.acquire(kFormat));
+    EXPECT_FALSE(nodes.find(2));
+    EXPECT_FALSE(nodes.find(3));
+    EXPECT_TRUE(nodes.find(1));
+    EXPECT_TRUE(nodes.find(4));
+}
+
+TEST(RenderInvalidatorTest, WithoutAGraphDemotesOnlyTheGivenNodes)
+{
+    FramePool pool;
+    NodeCache nodes;
+    nodes.insert(1, pool.acquire(kFormat), 0);
+    nodes.insert(2, pool.acquire(kFormat), 1);
+    RenderInvalidator invalidator(nullptr, nullptr, &nodes);
+    const std::vector<NodeId> changed{0};
+    invalidator.apply({}, changed);
+    EXPECT_EQ(invalidator.stats().nodesDemoted, 1u);
+}
+
+TEST(RenderInvalidatorTest, ListenersGetEveryChange)
+{
+    RenderInvalidator invalidator(nullptr);
+    std::vector<TimelineChange> seen;
+    invalidator.addListener([&](const TimelineChange &change) { seen.push_back(change); });
+    TimelineChange change;
+    change.addFrames({5, 8});
+    change.items.push_back({0, 3});
+    invalidator.apply(change);
+    invalidator.apply({});
+    ASSERT_EQ(seen.size(), 2u);
+    EXPECT_EQ(seen[0].frames, change.frames);
+    EXPECT_EQ(seen[0].items, change.items);
+    EXPECT_TRUE(seen[1].isEmpty());
+    EXPECT_EQ(invalidator.stats().changes, 2u);
+    EXPECT_EQ(invalidator.stats().framesInvalidated, 3u);
+}
+
+} // namespace
+} // namespace scp
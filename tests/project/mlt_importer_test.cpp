@@ -0,0 +1,248 @@
+// importMlt on projects as Shotcut writes them.
+
+#include "project/mlt_importer.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace scp {
+namespace {
+
+// Saved by Shotcut 24.02 (29.97 fps): a clip with a filter, a dissolve
+// into a second clip, a gap, an audio track and a marker. Hashes and
+// properties that do not matter here are trimmed.
+constexpr const char *kShotcutProject = R"(<?xml version="1.0" standalone="no"?>
+<mlt LC_NUMERIC="C" version="7.22.0" title="Shotcut version 24.02.29" producer="main_bin">
+  <profile description="HD 1080p 29.97 fps" width="1920" height="1080" progressive="1" sample_aspect_num="1" sample_aspect_den="1" display_aspect_num="16" display_aspect_den="9" frame_rate_num="30000" frame_rate_den="1001" colorspace="709"/>
+  <playlist id="main_bin">
+    <property name="xml_retain">1</property>
+  </playlist>
+  <producer id="black" in="00:00:00.000" out="00:00:10.010">
+    <property name="length">00:00:10.043</property>
+    <property name="eof">pause</property>
+    <property name="resource">0</property>
+    <property name="aspect_ratio">1</property>
+    <property name="mlt_service">color</property>
+    <property name="mlt_image_format">rgba</property>
+    <property name="set.test_audio">0</property>
+  </producer>
+  <playlist id="background">
+    <entry producer="black" in="00:00:00.000" out="00:00:10.010"/>
+  </playlist>
+  <chain id="chain0" out="00:00:19.987">
+    <property name="length">00:00:20.020</property>
+    <property name="eof">pause</property>
+    <property name="resource">/home/user/Videos/clip1.mp4</property>
+    <property name="mlt_service">avformat-novalidate</property>
+    <property name="seekable">1</property>
+    <property name="audio_index">1</property>
+    <property name="video_index">0</property>
+    <property name="shotcut:caption">clip1.mp4</property>
+    <filter id="filter0" out="00:00:04.971">
+      <property name="start">1</property>
+      <property name="level">1</property>
+      <property name="mlt_service">brightness</property>
+      <property name="shotcut:filter">brightnessOpacity</property>
+      <property name="alpha">1</property>
+    </filter>
+  </chain>
+  <chain id="chain1" out="00:00:19.987">
+    <property name="length">00:00:20.020</property>
+    <property name="resource">/home/user/Videos/clip1.mp4</property>
+    <property name="mlt_service">avformat-novalidate</property>
+    <property name="shotcut:caption">clip1.mp4</property>
+  </chain>
+  <chain id="chain2" out="00:00:29.996">
+    <property name="length">00:00:30.030</property>
+    <property name="resource">/home/user/Videos/Caf&#xe9; &amp; bar.mov</property>
+    <property name="mlt_service">avformat-novalidate</property>
+    <property name="shotcut:caption">Caf&#xe9; &amp; bar.mov</property>
+  </chain>
+  <tractor id="tractor1" in="00:00:00.000" out="00:00:00.967">
+    <property name="shotcut:transition">lumaMix</property>
+    <track producer="chain1" in="00:00:05.005" out="00:00:05.972"/>
+    <track producer="chain2" in="00:00:00.000" out="00:00:00.967"/>
+    <transition id="transition0" out="00:00:00.967">
+      <property name="a_track">0</property>
+      <property name="b_track">1</property>
+      <property name="factory">loader</property>
+      <property name="mlt_service">luma</property>
+      <property name="alpha_over">1</property>
+      <property name="fix_background_alpha">1</property>
+    </transition>
+    <transition id="transition1" out="00:00:00.967">
+      <property name="a_track">0</property>
+      <property name="b_track">1</property>
+      <property name="start">-1</property>
+      <property name="accepts_blanks">1</property>
+      <property name="mlt_service">mix</property>
+    </transition>
+  </tractor>
+  <chain id="chain3" out="00:00:29.996">
+    <property name="length">00:00:30.030</property>
+    <property name="resource">/home/user/Videos/Caf&#xe9; &amp; bar.mov</property>
+    <property name="mlt_service">avformat-novalidate</property>
+  </chain>
+  <playlist id="playlist0">
+    <property name="shotcut:video">1</property>
+    <property name="shotcut:name">V1</property>
+    <entry producer="chain0" in="00:00:00.000" out="00:00:04.971"/>
+    <entry producer="tractor1" in="00:00:00.000" out="00:00:00.967"/>
+    <entry producer="chain3" in="00:00:01.001" out="00:00:05.005"/>
+    <blank length="00:00:01.001"/>
+  </playlist>
+  <chain id="chain4" out="00:00:59.993">
+    <property name="length">00:01:00.027</property>
+    <property name="resource">/home/user/Music/score.wav</property>
+    <property name="mlt_service">avformat-novalidate</property>
+    <property name="video_index">-1</property>
+  </chain>
+  <playlist id="playlist1">
+    <property name="shotcut:audio">1</property>
+    <property name="shotcut:name">A1</property>
+    <entry producer="chain4" in="00:00:00.000" out="00:00:09.976">
+      <filter id="filter1" out="00:00:09.976">
+        <property name="window">75</property>
+        <property name="max_gain">20dB</property>
+        <property name="level">-3</property>
+        <property name="mlt_service">volume</property>
+        <property name="shotcut:filter">audioGain</property>
+      </filter>
+    </entry>
+  </playlist>
+  <tractor id="tractor0" title="Shotcut version 24.02.29" in="00:00:00.000" out="00:00:10.010">
+    <property name="shotcut">1</property>
+    <property name="shotcut:projectAudioChannels">2</property>
+    <property name="shotcut:projectFolder">0</property>
+    <property name="shotcut:markers">
+      <properties name="0">
+        <property name="text">Marker 1</property>
+        <property name="start">00:00:02.002</property>
+        <property name="end">00:00:02.002</property>
+        <property name="color">#008000</property>
+      </properties>
+    </property>
+    <track producer="background"/>
+    <track producer="playlist0"/>
+    <track producer="playlist1" hide="video"/>
+    <transition id="transition2">
+      <property name="a_track">0</property>
+      <property name="b_track">1</property>
+      <property name="mlt_service">mix</property>
+      <property name="always_active">1</property>
+      <property name="sum">1</property>
+    </transition>
+    <transition id="transition3">
+      <property name="a_track">0</property>
+      <property name="b_track">1</property>
+      <property name="version">0.1</property>
+      <property name="mlt_service">frei0r.cairoblend</property>
+      <property name="threads">0</property>
+      <property name="disable">1</property>
+    </transition>
+  </tractor>
+</mlt>
+)";
+
+using Item = std::tuple<std::int64_t, std::int64_t, ItemKind, std::string, std::int64_t>;
+
+// A track's items as (start, end, kind, resource, sourceIn), sorted.
+std::vector<Item> itemsOf(const Track &track)
+{
+    std::vector<ItemId> ids;
+    track.items(ids);
+    std::vector<Item> items;
+    for (const ItemId id : ids) {
+        const TimelineItem &item = *track.item(id);
+        const FrameRange range = *track.range(id);
+        items.emplace_back(range.start, range.end, item.kind, item.resource, item.sourceIn);
+    }
+    std::sort(items.begin(), items.end());
+    return items;
+}
+
+MltImportResult import(const std::string &document)
+{
+    std::istringstream in(document);
+    return importMlt(in);
+}
+
+TEST(MltImporterTest, ShotcutProject)
+{
+    const MltImportResult result = import(kShotcutProject);
+    ASSERT_TRUE(result.timeline) << result.error;
+    const Timeline &timeline = *result.timeline;
+    EXPECT_EQ(timeline.rateNum(), 30000);
+    EXPECT_EQ(timeline.rateDen(), 1001);
+
+    // The background and media bin are not tracks.
+    ASSERT_EQ(timeline.trackCount(), 2);
+    EXPECT_EQ(timeline.track(0).kind(), TrackKind::Video);
+    EXPECT_EQ(timeline.track(1).kind(), TrackKind::Audio);
+
+    const std::string clip1 = "/home/user/Videos/clip1.mp4";
+    const std::string clip2 = "/home/user/Videos/Caf\xc3\xa9 & bar.mov";
+    EXPECT_EQ(itemsOf(timeline.track(0)), (std::vector<Item>{
+                                              {0, 150, ItemKind::Clip, clip1, 0},
+                                              {0, 150, ItemKind::Filter, "brightness", 0},
+                                              {150, 180, ItemKind::Clip, clip2, 0},
+                                              {150, 180, ItemKind::Clip, clip1, 150},
+                                              {150, 180, ItemKind::Transition, "luma", 0},
+                                              {150, 180, ItemKind::Transition, "mix", 0},
+                                              {180, 301, ItemKind::Clip, clip2, 30},
+                                          }));
+    EXPECT_EQ(itemsOf(timeline.track(1)), (std::vector<Item>{
+                                              {0, 300, ItemKind::Clip,
+                                               "/home/user/Music/score.wav", 0},
+                                              {0, 300, ItemKind::Filter, "volume", 0},
+                                          }));
+
+    EXPECT_EQ(result.stats.items, 9u);
+    EXPECT_EQ(result.stats.unresolved, 0u);
+    // The main tractor's two compositing transitions and the background.
+    EXPECT_EQ(result.stats.skipped, 3u);
+}
+
+TEST(MltImporterTest, NestedPropertiesBelongToTheProperty)
+{
+    // The tractor's track order and hide flags must survive the marker
+    // list; document order would put "b" second and as video.
+    const MltImportResult result = import(R"(<mlt>
+  <producer id="p" in="0" out="9"><property name="resource">a.mov</property></producer>
+  <playlist id="b"><entry producer="p"/></playlist>
+  <playlist id="a"><entry producer="p"/><entry producer="p"/></playlist>
+  <tractor id="main">
+    <property name="shotcut:markers">
+      <properties name="0"><property name="text">cut here</property></properties>
+      <properties name="1"><property name="text">and here</property></properties>
+    </property>
+    <track producer="a"/>
+    <track producer="b" hide="video"/>
+  </tractor>
+</mlt>)");
+    ASSERT_TRUE(result.timeline) << result.error;
+    ASSERT_EQ(result.timeline->trackCount(), 2);
+    EXPECT_EQ(result.timeline->track(0).kind(), TrackKind::Video);
+    EXPECT_EQ(result.timeline->track(0).end(), 20);
+    EXPECT_EQ(result.timeline->track(1).kind(), TrackKind::Audio);
+    EXPECT_EQ(result.timeline->track(1).end(), 10);
+}
+
+TEST(MltImporterTest, Errors)
+{
+    for (const char *document : {"<mlt><a></b></mlt>", "<mlt><producer in=\"x:1\"/></mlt>",
+                                 "<mlt>", "<mlt a=b/>", "<mlt>&foo;</mlt>"}) {
+        const MltImportResult result = import(document);
+        EXPECT_FALSE(result.timeline) << document;
+        EXPECT_FALSE(result.error.empty()) << document;
+    }
+}
+
+} // namespace
+} // namespace scp
@@ -0,0 +1,261 @@
+// ProjectFile: a written timeline opens and loads back unchanged, failed
+// writes leave nothing behind, and truncated or corrupt files are rejected.
+
+#include "project/project_file.h"
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace scp {
+namespace {
+
+// The on-disk offsets the corruption tests patch.
+constexpr std::size_t kHeaderBytes = 32;
+constexpr std::size_t kSectionBytes = 24;
+constexpr std::size_t kTrackHeaderBytes = 16;
+
+class ProjectFileTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        char directory[] = "/tmp/scp_project_file_XXXXXX";
+        ASSERT_NE(::mkdtemp(directory), nullptr);
+        m_directory = directory;
+        m_path = m_directory + "/edit.scp";
+
+        m_timeline.addTrack(TrackKind::Video);
+        m_timeline.addTrack(TrackKind::Audio);
+        ItemRef removed;
+        m_timeline.addItem(0, {ItemKind::Clip, "a.mov", 100}, {10, 50});
+        m_timeline.addItem(0, {ItemKind::Transition, "luma", 0}, {40, 50});
+        m_timeline.addItem(0, {ItemKind::Clip, "b.mov", 0}, {50, 80}, &removed);
+        m_timeline.addItem(0, {ItemKind::Clip, "a.mov", 7}, {90, 120});
+        m_timeline.addItem(1, {ItemKind::Clip, "a.mov", 100}, {10, 50});
+        m_timeline.removeItem(removed);
+    }
+
+    void TearDown() override { std::filesystem::remove_all(m_directory); }
+
+    std::string read() const
+    {
+        std::ifstream in(m_path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    }
+
+    void overwrite(const std::string &bytes) const
+    {
+        std::ofstream(m_path, std::ios::binary | std::ios::trunc) << bytes;
+    }
+
+    // Offset of record item of track in bytes, from the section table.
+    static std::size_t recordOffset(const std::string &bytes, int track, std::size_t item)
+    {
+        std::uint64_t offset = 0;
+        std::memcpy(&offset, bytes.data() + kHeaderBytes + (1 + track) * kSectionBytes + 8,
+                    sizeof(offset));
+        return std::size_t(offset) + kTrackHeaderBytes + item * sizeof(ProjectItemRecord);
+    }
+
+    static void patch(std::string &bytes, std::size_t offset, const auto &value)
+    {
+        std::memcpy(bytes.data() + offset, &value, sizeof(value));
+    }
+
+    std::string m_directory;
+    std::string m_path;
+    Timeline m_timeline{30000, 1001};
+};
+
+TEST_F(ProjectFileTest, RoundTrip)
+{
+    ASSERT_TRUE(ProjectFile::write(m_path, m_timeline));
+    EXPECT_FALSE(std::filesystem::exists(m_path + ".tmp"));
+
+    const std::optional<ProjectFile> file = ProjectFile::open(m_path);
+    ASSERT_TRUE(file);
+    EXPECT_EQ(file->version(), 1u);
+    EXPECT_EQ(file->rateNum(), 30000);
+    EXPECT_EQ(file->rateDen(), 1001);
+    ASSERT_EQ(file->trackCount(), 2);
+    EXPECT_EQ(file->trackKind(0), TrackKind::Video);
+    EXPECT_EQ(file->trackKind(1), TrackKind::Audio);
+    EXPECT_EQ(file->itemCount(0), 3u);
+    EXPECT_EQ(file->itemCount(1), 1u);
+    EXPECT_EQ(file->string(file->items(0)[0].resource), "a.mov");
+    EXPECT_TRUE(file->string(1000).empty());
+
+    const std::optional<Timeline> loaded = file->load();
+    ASSERT_TRUE(loaded);
+    EXPECT_EQ(loaded->rateNum(), 30000);
+    EXPECT_EQ(loaded->rateDen(), 1001);
+    ASSERT_EQ(loaded->trackCount(), 2);
+    for (int i = 0; i < 2; ++i) {
+        const Track &expected = m_timeline.track(i);
+        const Track &actual = loaded->track(i);
+        EXPECT_EQ(actual.kind(), expected.kind());
+        // The removed item's id stays retired.
+        EXPECT_EQ(actual.nextId(), expected.nextId());
+        std::vector<ItemId> expectedIds;
+        std::vector<ItemId> actualIds;
+        expected.items(expectedIds);
+        actual.items(actualIds);
+        ASSERT_EQ(actualIds, expectedIds);
+        for (const ItemId id : expectedIds) {
+            const TimelineItem *item = actual.item(id);
+            ASSERT_TRUE(item);
+            EXPECT_EQ(item->kind, expected.item(id)->kind);
+            EXPECT_EQ(item->resource, expected.item(id)->resource);
+            EXPECT_EQ(item->sourceIn, expected.item(id)->sourceIn);
+            EXPECT_EQ(actual.range(id), expected.range(id));
+        }
+    }
+}
+
+TEST_F(ProjectFileTest, EmptyTimeline)
+{
+    ASSERT_TRUE(ProjectFile::write(m_path, Timeline()));
+    const std::optional<ProjectFile> file = ProjectFile::open(m_path);
+    ASSERT_TRUE(file);
+    EXPECT_EQ(file->trackCount(), 0);
+    const std::optional<Timeline> loaded = file->load();
+    ASSERT_TRUE(loaded);
+    EXPECT_EQ(loaded->rateNum(), 25);
+}
+
+TEST_F(ProjectFileTest, FailedWriteLeavesNothingBehind)
+{
+    // Renaming a file over a directory fails after the temporary is written.
+    std::filesystem::create_directory(m_path);
+    EXPECT_FALSE(ProjectFile::write(m_path, m_timeline));
+    EXPECT_FALSE(std::filesystem::exists(m_path + ".tmp"));
+    EXPECT_TRUE(std::filesystem::is_directory(m_path));
+
+    EXPECT_FALSE(ProjectFile::write(m_directory + "/missing/edit.scp", m_timeline));
+    EXPECT_FALSE(std::filesystem::exists(m_directory + "/missing"));
+}
+
+TEST_F(ProjectFileTest, OverwriteReplacesTheFile)
+{
+    ASSERT_TRUE(ProjectFile::write(m_path, Timeline()));
+    ASSERT_TRUE(ProjectFile::write(m_path, m_timeline));
+    const std::optional<ProjectFile> file = ProjectFile::open(m_path);
+    ASSERT_TRUE(file);
+    EXPECT_EQ(file->trackCount(), 2);
+}
+
+TEST_F(ProjectFileTest, RejectsMissingAndForeignFiles)
+{
+    EXPECT_FALSE(ProjectFile::open(m_path));
+    overwrite("");
+    EXPECT_FALSE(ProjectFile::open(m_path));
+    overwrite(std::string(256, 'x'));
+    EXPECT_FALSE(ProjectFile::open(m_path));
+}
+
+TEST_F(ProjectFileTest, RejectsBadHeaders)
+{
+    ASSERT_TRUE(ProjectFile::write(m_path, m_timeline));
+    const std::string original = read();
+    ASSERT_TRUE(ProjectFile::open(m_path));
+
+    auto rejected = [&](std::size_t offset, std::uint32_t value) {
+        std::string bytes = original;
+        patch(bytes, offset, value);
+        overwrite(bytes);
+        return !ProjectFile::open(m_path);
+    };
+    EXPECT_TRUE(rejected(0, 0x4e4f4e));    // magic
+    EXPECT_TRUE(rejected(8, 0));           // version
+    EXPECT_TRUE(rejected(8, 2));           // newer version
+    EXPECT_TRUE(rejected(12, 1000));       // section count past the end
+    EXPECT_TRUE(rejected(16, 0));          // rate numerator
+    EXPECT_TRUE(rejected(20, 0xffffffff)); // negative rate denominator
+    EXPECT_TRUE(rejected(24, 3));          // a track without a section
+}
+
+TEST_F(ProjectFileTest, RejectsBadSections)
+{
+    ASSERT_TRUE(ProjectFile::write(m_path, m_timeline));
+    const std::string original = read();
+    const std::size_t track0 = kHeaderBytes + kSectionBytes;
+
+    auto rejected = [&](std::size_t offset, std::uint64_t value) {
+        std::string bytes = original;
+        patch(bytes, offset, value);
+        overwrite(bytes);
+        return !ProjectFile::open(m_path);
+    };
+    EXPECT_TRUE(rejected(track0 + 8, original.size() + 8));    // offset past the end
+    EXPECT_TRUE(rejected(track0 + 8, 4));                      // misaligned
+    EXPECT_TRUE(rejected(track0 + 16, original.size()));       // size past the end
+    EXPECT_TRUE(rejected(track0, std::uint64_t(1) << 32 | 2)); // track 1 twice
+    EXPECT_TRUE(rejected(track0, 0));                          // track 0 untyped, so missing
+}
+
+TEST_F(ProjectFileTest, RejectsEveryTruncation)
+{
+    ASSERT_TRUE(ProjectFile::write(m_path, m_timeline));
+    const std::string original = read();
+    // Only the last section's padding may go.
+    for (std::size_t size = 0; size + 8 <= original.size(); ++size) {
+        overwrite(original.substr(0, size));
+        EXPECT_FALSE(ProjectFile::open(m_path)) << size;
+    }
+}
+
+TEST_F(ProjectFileTest, LoadRejectsBadRecords)
+{
+    ASSERT_TRUE(ProjectFile::write(m_path, m_timeline));
+    const std::string original = read();
+    const std::size_t record = recordOffset(original, 0, 1);
+    {
+        const std::optional<ProjectFile> file = ProjectFile::open(m_path);
+        ASSERT_TRUE(file);
+        ASSERT_EQ(file->items(0)[1].start, 40);
+    }
+
+    // Records are checked by loadTrack(), not open(); other tracks still load.
+    auto rejected = [&](std::size_t offset, const auto &value) {
+        std::string bytes = original;
+        patch(bytes, record + offset, value);
+        overwrite(bytes);
+        const std::optional<ProjectFile> file = ProjectFile::open(m_path);
+        return file && !file->loadTrack(0) && file->loadTrack(1) && !file->load();
+    };
+    EXPECT_TRUE(rejected(8, std::int64_t(40)));   // end == start
+    EXPECT_TRUE(rejected(8, std::int64_t(30)));   // end before start
+    EXPECT_TRUE(rejected(24, std::uint32_t(99))); // kind
+    EXPECT_TRUE(rejected(28, std::uint32_t(99))); // resource
+    EXPECT_TRUE(rejected(32, std::uint32_t(0)));  // duplicate id
+}
+
+TEST_F(ProjectFileTest, CorruptBytesNeverCrash)
+{
+    ASSERT_TRUE(ProjectFile::write(m_path, m_timeline));
+    const std::string original = read();
+    for (std::size_t i = 0; i < original.size(); ++i) {
+        std::string bytes = original;
+        bytes[i] = char(~bytes[i]);
+        overwrite(bytes);
+        if (const std::optional<ProjectFile> file = ProjectFile::open(m_path)) {
+            for (int track = 0; track < file->trackCount(); ++track) {
+                for (const ProjectItemRecord &item : file->items(track))
+                    file->string(item.resource);
+            }
+            file->load();
+        }
+    }
+}
+
+} // namespace
+} // namespace scp
@@ -0,0 +1,235 @@
+// CpuCompositor against per-pixel expectations for placement, opacity,
+// blend modes and transitions, and against itself across tile sizes.
+
+#include "render/cpu_compositor.h"
+
+#include "core/frame_pool.h"
+#include "core/half_float.h"
+#include "core/thread_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace scp {
+namespace {
+
+using Pixel = std::array<int, 4>;
+
+class CpuCompositorTest : public ::testing::Test
+{
+protected:
+    FrameRef solid(int width, int height, Pixel color,
+                   PixelFormat format = PixelFormat::RGBA8)
+    {
+        FrameRef frame = m_pool.acquire({width, height, format});
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x)
+                set(*frame, x, y, color);
+        }
+        return frame;
+    }
+
+    static void set(FrameBuffer &frame, int x, int y, Pixel color)
+    {
+        std::uint8_t *row = frame.data(0) + std::ptrdiff_t(y) * frame.stride(0);
+        for (int c = 0; c < 4; ++c)
+            row[4 * x + c] = std::uint8_t(color[c]);
+    }
+
+    static Pixel at(const FrameBuffer &frame, int x, int y)
+    {
+        const std::uint8_t *row = frame.data(0) + std::ptrdiff_t(y) * frame.stride(0);
+        return {row[4 * x], row[4 * x + 1], row[4 * x + 2], row[4 * x + 3]};
+    }
+
+    FrameRef composite(std::vector<CompositeLayer> layers, int width = 16, int height = 16,
+                       PixelFormat format = PixelFormat::RGBA8)
+    {
+        FrameRef output = m_pool.acquire({width, height, format});
+        EXPECT_TRUE(m_compositor.composite(layers, *output));
+        return output;
+    }
+
+    static void expectNear(Pixel actual, Pixel expected)
+    {
+        for (int c = 0; c < 4; ++c)
+            EXPECT_NEAR(actual[c], expected[c], 1) << "channel " << c;
+    }
+
+    FramePool m_pool;
+    ThreadPool m_threads{3};
+    CpuCompositor m_compositor{m_threads, 8, 4};
+};
+
+TEST_F(CpuCompositorTest, EmptyStackIsTransparent)
+{
+    const FrameRef output = composite({});
+    EXPECT_EQ(at(*output, 0, 0), (Pixel{0, 0, 0, 0}));
+    EXPECT_EQ(at(*output, 15, 15), (Pixel{0, 0, 0, 0}));
+}
+
+TEST_F(CpuCompositorTest, LayerIsPlacedAndClipped)
+{
+    CompositeLayer layer;
+    layer.frame = solid(8, 8, {255, 0, 0, 255});
+    layer.x = -4;
+    layer.y = 4;
+    const FrameRef output = composite({layer});
+    for (int y = 0; y < 16; ++y) {
+        for (int x = 0; x < 16; ++x) {
+            const bool covered = x < 4 && y >= 4 && y < 12;
+            const Pixel expected = covered ? Pixel{255, 0, 0, 255} : Pixel{0, 0, 0, 0};
+            EXPECT_EQ(at(*output, x, y), expected)
+                << x << "," << y;
+        }
+    }
+}
+
+TEST_F(CpuCompositorTest, OpacityMixesOverTheLayerBelow)
+{
+    CompositeLayer below;
+    below.frame = solid(16, 16, {0, 0, 0, 255});
+    CompositeLayer above;
+    above.frame = solid(16, 16, {255, 255, 255, 255});
+    above.opacity = 0.5f;
+    expectNear(at(*composite({below, above}), 3, 3), {128, 128, 128, 255});
+}
+
+TEST_F(CpuCompositorTest, BlendModesOnOpaqueColors)
+{
+    const Pixel s{200, 100, 50, 255};
+    const Pixel d{128, 255, 0, 255};
+    auto expected = [&](auto &&f) {
+        Pixel out{0, 0, 0, 255};
+        for (int c = 0; c < 3; ++c)
+            out[c] = int(std::lround(std::clamp(f(s[c] / 255.f, d[c] / 255.f), 0.f, 1.f) * 255));
+        return out;
+    };
+    const std::vector<std::pair<BlendMode, Pixel>> cases = {
+        {BlendMode::Normal, s},
+        {BlendMode::Add, expected([](float a, float b) { return a + b; })},
+        {BlendMode::Multiply, expected([](float a, float b) { return a * b; })},
+        {BlendMode::Screen, expected([](float a, float b) { return a + b - a * b; })},
+        {BlendMode::Darken, expected([](float a, float b) { return std::min(a, b); })},
+        {BlendMode::Lighten, expected([](float a, float b) { return std::max(a, b); })},
+        {BlendMode::Difference, expected([](float a, float b) { return std::abs(a - b); })},
+        {BlendMode::Overlay, expected([](float a, float b) {
+             return b <= 0.5f ? 2 * a * b : 1 - 2 * (1 - a) * (1 - b);
+         })},
+    };
+    for (const auto &[mode, result] : cases) {
+        SCOPED_TRACE(blendModeName(mode));
+        CompositeLayer below;
+        below.frame = solid(16, 16, d);
+        CompositeLayer above;
+        above.frame = solid(16, 16, s);
+        above.blend = mode;
+        expectNear(at(*composite({below, above}), 5, 5), result);
+    }
+}
+
+TEST_F(CpuCompositorTest, Dissolve)
+{
+    CompositeLayer layer;
+    layer.frame = solid(16, 16, {0, 0, 0, 255});
+    layer.transition = {TransitionKind::Dissolve, solid(16, 16, {255, 255, 255, 255}), 0.25f};
+    expectNear(at(*composite({layer}), 0, 0), {64, 64, 64, 255});
+}
+
+TEST_F(CpuCompositorTest, HardWipes)
+{
+    CompositeLayer layer;
+    layer.frame = solid(16, 16, {0, 0, 0, 255});
+    layer.transition = {TransitionKind::WipeRight, solid(16, 16, {255, 255, 255, 255}), 0.5f};
+    const FrameRef right = composite({layer});
+    for (int x = 0; x < 16; ++x)
+        EXPECT_EQ(at(*right, x, 9)[0], x < 8 ? 255 : 0) << x;
+
+    layer.transition.kind = TransitionKind::WipeDown;
+    layer.transition.progress = 0.25f;
+    const FrameRef down = composite({layer});
+    for (int y = 0; y < 16; ++y)
+        EXPECT_EQ(at(*down, 9, y)[0], y < 4 ? 255 : 0) << y;
+}
+
+TEST_F(CpuCompositorTest, HalfFloatOutput)
+{
+    CompositeLayer layer;
+    layer.frame = solid(16, 16, {51, 102, 204, 255});
+    const FrameRef output = composite({layer}, 16, 16, PixelFormat::RGBA16F);
+    const auto *row = reinterpret_cast<const std::uint16_t *>(output->data(0));
+    EXPECT_FLOAT_EQ(halfToFloat(row[0]), halfToFloat(floatToHalf(51 / 255.f)));
+    EXPECT_FLOAT_EQ(halfToFloat(row[2]), halfToFloat(floatToHalf(204 / 255.f)));
+    EXPECT_EQ(halfToFloat(row[3]), 1.f);
+}
+
+TEST_F(CpuCompositorTest, ResultDoesNotDependOnTiling)
+{
+    std::mt19937 random(9);
+    std::vector<CompositeLayer> layers;
+    for (int i = 0; i < 6; ++i) {
+        const int width = 5 + int(random() % 60);
+        const int height = 5 + int(random() % 40);
+        CompositeLayer layer;
+        layer.frame = m_pool.acquire({width, height, PixelFormat::RGBA8});
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const int alpha = int(random() % 256);
+                set(*layer.frame, x, y,
+                    {int(random() % (alpha + 1)), int(random() % (alpha + 1)),
+                     int(random() % (alpha + 1)), alpha});
+            }
+        }
+        layer.x = int(random() % 80) - 20;
+        layer.y = int(random() % 50) - 10;
+        layer.opacity = (random() % 100) / 99.f;
+        layer.blend = BlendMode(random() % 8);
+        if (i % 2)
+            layer.transition = {TransitionKind(1 + random() % 3), solid(width, height,
+                                                                        {10, 200, 30, 255}),
+                                0.4f, 0.2f};
+        layers.push_back(layer);
+    }
+
+    CpuCompositor oneTile(m_threads, 4096, 4096);
+    CpuCompositor smallTiles(m_threads, 8, 1);
+    FrameRef a = m_pool.acquire({70, 45, PixelFormat::RGBA8});
+    FrameRef b = m_pool.acquire({70, 45, PixelFormat::RGBA8});
+    ASSERT_TRUE(oneTile.composite(layers, *a));
+    ASSERT_TRUE(smallTiles.composite(layers, *b));
+    for (int y = 0; y < 45; ++y)
+        ASSERT_EQ(std::memcmp(a->data(0) + std::ptrdiff_t(y) * a->stride(0),
+                              b->data(0) + std::ptrdiff_t(y) * b->stride(0), 70 * 4),
+                  0)
+            << "row " << y;
+}
+
+TEST_F(CpuCompositorTest, RejectsUnsupportedInput)
+{
+    FrameRef output = m_pool.acquire({16, 16, PixelFormat::RGBA8});
+    CompositeLayer yuv;
+    yuv.frame = m_pool.acquire({16, 16, PixelFormat::YUV420P});
+    EXPECT_FALSE(m_compositor.composite(std::vector{yuv}, *output));
+
+    CompositeLayer missingTarget;
+    missingTarget.frame = solid(16, 16, {0, 0, 0, 255});
+    missingTarget.transition.kind = TransitionKind::Dissolve;
+    EXPECT_FALSE(m_compositor.composite(std::vector{missingTarget}, *output));
+
+    CompositeLayer wrongSize = missingTarget;
+    wrongSize.transition.target = solid(8, 8, {0, 0, 0, 255});
+    EXPECT_FALSE(m_compositor.composite(std::vector{wrongSize}, *output));
+
+    FrameRef nv12 = m_pool.acquire({16, 16, PixelFormat::NV12});
+    EXPECT_FALSE(m_compositor.composite({}, *nv12));
+}
+
+} // namespace
+} // namespace scp
@@ -0,0 +1,105 @@
+// NodeCache hits, LRU eviction under the byte budget, and demotion of an
+// edited node's entries.
+
+#include "render/node_cache.h"
+
+#include "core/frame_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace scp {
+namespace {
+
+class NodeCacheTest : public ::testing::Test
+{
+protected:
+    FrameRef frame() { return m_pool.acquire(kFormat); }
+
+    static constexpr FrameFormat kFormat{16, 16, PixelFormat::RGBA8};
+    const std::size_t m_frameBytes = FramePool::bufferBytes(kFormat);
+    FramePool m_pool;
+};
+
+TEST_F(NodeCacheTest, HitsAndMisses)
+{
+    NodeCache cache;
+    const FrameRef a = frame();
+    cache.insert(1, a, 7);
+    EXPECT_EQ(cache.find(1).get(), a.get());
+    EXPECT_FALSE(cache.find(2));
+    cache.insert(3, FrameRef()); // null frames are not cached
+    EXPECT_FALSE(cache.find(3));
+
+    const NodeCacheStats stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_EQ(stats.entries, 1u);
+    EXPECT_EQ(stats.bytes, m_frameBytes);
+}
+
+TEST_F(NodeCacheTest, ReinsertReplaces)
+{
+    NodeCache cache;
+    cache.insert(1, frame());
+    const FrameRef b = frame();
+    cache.insert(1, b);
+    EXPECT_EQ(cache.find(1).get(), b.get());
+    EXPECT_EQ(cache.stats().entries, 1u);
+    EXPECT_EQ(cache.stats().bytes, m_frameBytes);
+}
+
+TEST_F(NodeCacheTest, EvictsLeastRecentlyUsed)
+{
+    NodeCache cache(3 * m_frameBytes);
+    cache.insert(1, frame());
+    cache.insert(2, frame());
+    cache.insert(3, frame());
+    cache.find(1);
+    cache.insert(4, frame());
+    EXPECT_TRUE(cache.find(1));
+    EXPECT_FALSE(cache.find(2));
+    EXPECT_TRUE(cache.find(3));
+    EXPECT_TRUE(cache.find(4));
+    EXPECT_EQ(cache.stats().evictions, 1u);
+
+    // The newest entry survives even a budget it does not fit.
+    cache.setByteBudget(1);
+    EXPECT_EQ(cache.stats().entries, 1u);
+    EXPECT_TRUE(cache.find(4));
+}
+
+TEST_F(NodeCacheTest, DemotedEntriesAreEvictedFirst)
+{
+    NodeCache cache(3 * m_frameBytes);
+    cache.insert(1, frame(), 10);
+    cache.insert(2, frame(), 20);
+    cache.insert(3, frame(), 30);
+    const std::vector<std::uint32_t> edited{30, 99};
+    EXPECT_EQ(cache.demote(edited), 1u);
+    // Demoted, not dropped: an undo can still find it.
+    EXPECT_TRUE(cache.find(3));
+
+    cache.demote(edited);
+    cache.insert(4, frame(), 40);
+    EXPECT_FALSE(cache.find(3));
+    EXPECT_TRUE(cache.find(1));
+    EXPECT_TRUE(cache.find(2));
+    EXPECT_EQ(cache.stats().demoted, 2u);
+}
+
+TEST_F(NodeCacheTest, ClearReleasesFrames)
+{
+    NodeCache cache;
+    cache.insert(1, frame());
+    cache.insert(2, frame());
+    EXPECT_EQ(m_pool.stats().buffersInUse, 2u);
+    cache.clear();
+    EXPECT_EQ(m_pool.stats().buffersInUse, 0u);
+    EXPECT_EQ(cache.stats().bytes, 0u);
+}
+
+} // namespace
+} // namespace scp
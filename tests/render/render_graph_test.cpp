@@ -0,0 +1,226 @@
+// RenderGraph evaluation with counting stand-in nodes: dependency order,
+// which nodes re-render after an edit, cycles, and failures.
+
+#include "render/render_graph.h"
+
+#include "core/frame_pool.h"
+#include "core/thread_pool.h"
+#include "render/cpu_compositor.h"
+#include "render/node_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace scp {
+namespace {
+
+// A frame filled with one byte value.
+class SolidNode final : public RenderNode
+{
+public:
+    explicit SolidNode(std::uint8_t value)
+        : value(value)
+    {}
+
+    Kind kind() const override { return Kind::Source; }
+    std::string name() const override { return "solid"; }
+    std::uint64_t parameterHash(const RenderContext &) const override { return value; }
+
+    FrameRef render(const RenderContext &context, std::span<const FrameRef>) override
+    {
+        renders.fetch_add(1);
+        if (fail)
+            throw std::runtime_error("source failed");
+        FrameRef frame = context.pool->acquire(context.format);
+        std::memset(frame->data(0), value,
+                    std::size_t(frame->stride(0)) * context.format.height);
+        return frame;
+    }
+
+    std::uint8_t value;
+    bool fail = false;
+    std::atomic<int> renders{0};
+};
+
+// Inverts every byte of its input into a new frame.
+class InvertNode final : public RenderNode
+{
+public:
+    Kind kind() const override { return Kind::Filter; }
+    std::string name() const override { return "invert"; }
+    std::uint64_t parameterHash(const RenderContext &) const override { return 0; }
+
+    FrameRef render(const RenderContext &context, std::span<const FrameRef> inputs) override
+    {
+        renders.fetch_add(1);
+        if (inputs.size() != 1 || !inputs[0])
+            return {};
+        FrameRef frame = context.pool->acquire(context.format);
+        const std::size_t bytes = std::size_t(frame->stride(0)) * context.format.height;
+        for (std::size_t i = 0; i < bytes; ++i)
+            frame->data(0)[i] = std::uint8_t(255 - inputs[0]->data(0)[i]);
+        return frame;
+    }
+
+    std::atomic<int> renders{0};
+};
+
+class RenderGraphTest : public ::testing::Test
+{
+protected:
+    template<typename Node, typename... Args>
+    std::pair<NodeId, Node *> add(Args &&...args)
+    {
+        auto node = std::make_unique<Node>(std::forward<Args>(args)...);
+        Node *raw = node.get();
+        return {m_graph.addNode(std::move(node)), raw};
+    }
+
+    RenderContext context(std::int64_t frame = 0)
+    {
+        return {frame, {8, 8, PixelFormat::RGBA8}, &m_pool};
+    }
+
+    FramePool m_pool;
+    ThreadPool m_threads{3};
+    NodeCache m_cache;
+    RenderGraph m_graph{m_threads, m_cache};
+};
+
+TEST_F(RenderGraphTest, RendersInputsBeforeConsumers)
+{
+    const auto [source, solid] = add<SolidNode>(std::uint8_t(10));
+    const auto [filter, invert] = add<InvertNode>();
+    ASSERT_TRUE(m_graph.connect(source, filter));
+
+    RenderGraphStats stats;
+    const FrameRef result = m_graph.evaluate(filter, context(), &stats);
+    ASSERT_TRUE(result);
+    EXPECT_EQ(result->data(0)[0], 245);
+    EXPECT_EQ(stats.nodesVisited, 2u);
+    EXPECT_EQ(stats.nodesRendered, 2u);
+    EXPECT_EQ(stats.cacheHits, 0u);
+}
+
+TEST_F(RenderGraphTest, UnchangedGraphIsOneCacheHit)
+{
+    const auto [source, solid] = add<SolidNode>(std::uint8_t(10));
+    const auto [filter, invert] = add<InvertNode>();
+    m_graph.connect(source, filter);
+    const FrameRef first = m_graph.evaluate(filter, context());
+
+    RenderGraphStats stats;
+    const FrameRef second = m_graph.evaluate(filter, context(), &stats);
+    EXPECT_EQ(second.get(), first.get());
+    EXPECT_EQ(stats.nodesRendered, 0u);
+    EXPECT_EQ(stats.cacheHits, 1u);
+    EXPECT_EQ(solid->renders.load(), 1);
+    EXPECT_EQ(invert->renders.load(), 1);
+}
+
+TEST_F(RenderGraphTest, EditRendersOnlyWhatDependsOnIt)
+{
+    CpuCompositor compositor(m_threads);
+    const auto [a, solidA] = add<SolidNode>(std::uint8_t(10));
+    const auto [b, solidB] = add<SolidNode>(std::uint8_t(20));
+    const auto [filter, invert] = add<InvertNode>();
+    std::vector<CompositeLayer> layers(2);
+    const auto [composite, node] = add<CompositeNode>(compositor, layers);
+    m_graph.connect(a, filter);
+    m_graph.connect(filter, composite);
+    m_graph.connect(b, composite);
+    m_graph.evaluate(composite, context());
+
+    solidB->value = 30;
+    RenderGraphStats stats;
+    ASSERT_TRUE(m_graph.evaluate(composite, context(), &stats));
+    EXPECT_EQ(stats.nodesRendered, 2u); // b and the composite
+    EXPECT_EQ(stats.cacheHits, 1u);     // the filter; a is never reached
+    EXPECT_EQ(solidA->renders.load(), 1);
+    EXPECT_EQ(invert->renders.load(), 1);
+    EXPECT_EQ(solidB->renders.load(), 2);
+
+    // Undo brings the old result back from the cache.
+    solidB->value = 20;
+    m_graph.evaluate(composite, context(), &stats);
+    EXPECT_EQ(stats.nodesRendered, 0u);
+}
+
+TEST_F(RenderGraphTest, ContextIsPartOfTheHash)
+{
+    const auto [source, solid] = add<SolidNode>(std::uint8_t(1));
+    RenderContext larger = context();
+    larger.format.width = 16;
+    EXPECT_NE(m_graph.contentHash(source, context()), m_graph.contentHash(source, larger));
+    EXPECT_EQ(m_graph.contentHash(source, context(0)), m_graph.contentHash(source, context(5)));
+}
+
+TEST_F(RenderGraphTest, ConnectRejectsCycles)
+{
+    const NodeId a = add<InvertNode>().first;
+    const NodeId b = add<InvertNode>().first;
+    const NodeId c = add<InvertNode>().first;
+    EXPECT_TRUE(m_graph.connect(a, b));
+    EXPECT_TRUE(m_graph.connect(b, c));
+    EXPECT_FALSE(m_graph.connect(c, a));
+    EXPECT_FALSE(m_graph.connect(a, a));
+    EXPECT_EQ(m_graph.inputs(a).size(), 0u);
+}
+
+TEST_F(RenderGraphTest, Downstream)
+{
+    const NodeId a = add<InvertNode>().first;
+    const NodeId b = add<InvertNode>().first;
+    const NodeId c = add<InvertNode>().first;
+    const NodeId d = add<InvertNode>().first;
+    m_graph.connect(a, b);
+    m_graph.connect(b, c);
+    m_graph.connect(d, c);
+    const std::vector<NodeId> changed{b};
+    std::vector<NodeId> result = m_graph.downstream(changed);
+    std::sort(result.begin(), result.end());
+    EXPECT_EQ(result, (std::vector<NodeId>{b, c}));
+}
+
+TEST_F(RenderGraphTest, ThrowingNodeIsRethrownAndNotCached)
+{
+    const auto [source, solid] = add<SolidNode>(std::uint8_t(10));
+    const auto [filter, invert] = add<InvertNode>();
+    m_graph.connect(source, filter);
+    solid->fail = true;
+    EXPECT_THROW(m_graph.evaluate(filter, context()), std::runtime_error);
+    // The consumer still ran, on a null input, before evaluate() returned.
+    EXPECT_EQ(invert->renders.load(), 1);
+
+    solid->fail = false;
+    const FrameRef result = m_graph.evaluate(filter, context());
+    ASSERT_TRUE(result);
+    EXPECT_EQ(result->data(0)[0], 245);
+}
+
+TEST_F(RenderGraphTest, ReleasesIntermediateFramesBeforeReturning)
+{
+    const auto [source, solid] = add<SolidNode>(std::uint8_t(10));
+    const auto [filter, invert] = add<InvertNode>();
+    m_graph.connect(source, filter);
+    for (int i = 0; i < 200; ++i) {
+        m_cache.clear();
+        solid->value = std::uint8_t(i);
+        const FrameRef result = m_graph.evaluate(filter, context());
+        ASSERT_TRUE(result);
+        m_cache.clear();
+        // Only the result is left; no task still holds the source frame.
+        ASSERT_EQ(m_pool.stats().buffersInUse, 1u) << "round " << i;
+    }
+}
+
+} // namespace
+} // namespace scp
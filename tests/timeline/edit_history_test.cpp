@@ -0,0 +1,197 @@
+// EditHistory against a list of independently built timelines: every
+// version it hands back must equal the timeline as it was after that edit.
+
+#include "timeline/edit_history.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace scp {
+namespace {
+
+// Everything observable about a timeline, in a comparable form.
+using Snapshot = std::vector<std::tuple<int, ItemId, int, std::string, std::int64_t,
+                                        std::int64_t, std::int64_t>>;
+
+Snapshot snapshot(const Timeline &timeline)
+{
+    Snapshot out;
+    std::vector<ItemId> ids;
+    for (int track = 0; track < timeline.trackCount(); ++track) {
+        ids.clear();
+        timeline.track(track).items(ids);
+        for (const ItemId id : ids) {
+            const TimelineItem &item = *timeline.track(track).item(id);
+            const FrameRange range = *timeline.track(track).range(id);
+            out.emplace_back(track, id, int(item.kind), item.resource, item.sourceIn,
+                             range.start, range.end);
+        }
+    }
+    return out;
+}
+
+Timeline twoTracks()
+{
+    Timeline timeline;
+    timeline.addTrack(TrackKind::Video);
+    timeline.addTrack(TrackKind::Audio);
+    return timeline;
+}
+
+TEST(EditHistoryTest, UndoRedo)
+{
+    EditHistory history(twoTracks());
+    EXPECT_FALSE(history.canUndo());
+    EXPECT_TRUE(history.undo().isEmpty());
+
+    ItemRef clip;
+    history.edit(
+        [&](Timeline &t) { return t.addItem(0, {ItemKind::Clip, "a.mov", 0}, {0, 100}, &clip); },
+        "Add clip");
+    history.edit([&](Timeline &t) { return t.trimItem(clip, {10, 100}); }, "Trim");
+    EXPECT_EQ(history.undoText(), "Trim");
+    EXPECT_EQ(history.current()->track(0).item(clip.id)->sourceIn, 10);
+
+    const TimelineChange undone = history.undo();
+    // The source follows the head, so only the trimmed-off head changes.
+    EXPECT_EQ(undone.frames, (std::vector<FrameRange>{{0, 10}}));
+    EXPECT_EQ(history.current()->track(0).range(clip.id), (FrameRange{0, 100}));
+    EXPECT_EQ(history.redoText(), "Trim");
+
+    history.redo();
+    EXPECT_EQ(history.current()->track(0).range(clip.id), (FrameRange{10, 100}));
+    EXPECT_FALSE(history.canRedo());
+}
+
+TEST(EditHistoryTest, RejectedEditIsNotRecorded)
+{
+    EditHistory history(twoTracks());
+    const TimelineChange change = history.edit([](Timeline &t) { return t.moveItem({0, 42}, 5); });
+    EXPECT_TRUE(change.isEmpty());
+    EXPECT_EQ(history.size(), 1u);
+}
+
+TEST(EditHistoryTest, NewEditDropsRedo)
+{
+    EditHistory history(twoTracks());
+    history.edit([](Timeline &t) { return t.addItem(0, {ItemKind::Clip, "a", 0}, {0, 10}); });
+    history.edit([](Timeline &t) { return t.addItem(0, {ItemKind::Clip, "b", 0}, {10, 20}); });
+    history.undo();
+    history.edit([](Timeline &t) { return t.ripple(0, 5); });
+    EXPECT_FALSE(history.canRedo());
+    EXPECT_EQ(history.size(), 3u);
+    EXPECT_EQ(history.current()->track(0).size(), 1u);
+}
+
+TEST(EditHistoryTest, LimitDropsOldest)
+{
+    EditHistory history(twoTracks(), 3);
+    for (int i = 0; i < 10; ++i) {
+        history.edit(
+            [&](Timeline &t) { return t.addItem(0, {ItemKind::Clip, "c", 0}, {i, i + 1}); });
+    }
+    EXPECT_EQ(history.size(), 4u);
+    while (history.canUndo())
+        history.undo();
+    EXPECT_EQ(history.current()->track(0).size(), 7u);
+}
+
+TEST(EditHistoryTest, RandomEditsMatchRecordedVersions)
+{
+    std::mt19937 random(11);
+    EditHistory history(twoTracks());
+    // expected[i] is version i as it was when recorded.
+    std::vector<Snapshot> expected{snapshot(*history.current())};
+    for (int step = 0; step < 3000; ++step) {
+        Timeline timeline = *history.current();
+        const int track = int(random() % 2);
+        std::vector<ItemId> ids;
+        timeline.track(track).items(ids);
+        const ItemRef ref{track, ids.empty() ? 0 : ids[random() % ids.size()]};
+        const std::int64_t frame = random() % 5000;
+        TimelineChange change;
+        switch (random() % 7) {
+        case 0:
+        case 1:
+            change = timeline.addItem(track, {ItemKind::Clip, "clip", 0},
+                                      {frame, frame + 1 + std::int64_t(random() % 200)});
+            break;
+        case 2:
+            change = timeline.removeItem(ref);
+            break;
+        case 3:
+            change = timeline.moveItem(ref, frame);
+            break;
+        case 4:
+            change = timeline.trimItem(ref, {frame, frame + 50});
+            break;
+        case 5:
+            change = timeline.rippleRemoveItem(ref);
+            break;
+        default:
+            change = timeline.ripple(frame, std::int64_t(random() % 100) - 50);
+            break;
+        }
+        if (change.isEmpty())
+            continue;
+        history.push(std::move(timeline), change);
+        expected.resize(history.index());
+        expected.push_back(snapshot(*history.current()));
+
+        // Now and then, wander back and forth through the history.
+        if (random() % 10 == 0) {
+            const std::size_t back = random() % (history.index() + 1);
+            for (std::size_t i = 0; i < back; ++i)
+                history.undo();
+            ASSERT_EQ(snapshot(*history.current()), expected[history.index()]);
+            const std::size_t forward = random() % (back + 1);
+            for (std::size_t i = 0; i < forward; ++i)
+                history.redo();
+            ASSERT_EQ(snapshot(*history.current()), expected[history.index()]);
+        }
+    }
+    while (history.canUndo()) {
+        history.undo();
+        ASSERT_EQ(snapshot(*history.current()), expected[history.index()]);
+    }
+}
+
+TEST(EditHistoryTest, ReadersSeeWholeVersions)
+{
+    Timeline timeline = twoTracks();
+    for (int i = 0; i < 1000; ++i)
+        timeline.addItem(0, {ItemKind::Clip, "c", 0}, {i * 10, i * 10 + 10});
+    EditHistory history(std::move(timeline));
+
+    std::atomic<bool> stop = false;
+    std::atomic<bool> torn = false;
+    std::thread reader([&] {
+        std::vector<ItemId> ids;
+        while (!stop) {
+            const std::shared_ptr<const Timeline> version = history.current();
+            ids.clear();
+            version->track(0).items(ids);
+            if (ids.size() != 1000 || version->track(0).end() != version->duration())
+                torn = true;
+        }
+    });
+    for (int i = 0; i < 2000; ++i) {
+        history.edit([&](Timeline &t) { return t.ripple(i % 10000, i % 2 ? 3 : -3); });
+        if (i % 7 == 0)
+            history.undo();
+    }
+    stop = true;
+    reader.join();
+    EXPECT_FALSE(torn);
+}
+
+} // namespace
+} // namespace scp
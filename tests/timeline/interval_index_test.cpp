@@ -0,0 +1,204 @@
+// IntervalIndex against a plain map of ranges, including old copies of the
+// index kept across later edits.
+
+#include "timeline/interval_index.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace scp {
+namespace {
+
+using Model = std::map<ItemId, FrameRange>;
+
+void shiftModel(Model &model, std::int64_t from, std::int64_t delta)
+{
+    for (auto &[id, range] : model) {
+        if (range.start >= from) {
+            range.start += delta;
+            range.end += delta;
+        }
+    }
+}
+
+// Ids in start order, ties by id, as the index returns them.
+std::vector<ItemId> ordered(const Model &model, auto &&keep)
+{
+    std::vector<std::pair<FrameRange, ItemId>> items;
+    for (const auto &[id, range] : model) {
+        if (keep(range))
+            items.push_back({range, id});
+    }
+    std::sort(items.begin(), items.end(), [](const auto &a, const auto &b) {
+        return std::pair(a.first.start, a.second) < std::pair(b.first.start, b.second);
+    });
+    std::vector<ItemId> ids;
+    for (const auto &item : items)
+        ids.push_back(item.second);
+    return ids;
+}
+
+void expectMatches(const IntervalIndex &index, const Model &model, std::mt19937 &random)
+{
+    ASSERT_EQ(index.size(), model.size());
+    std::int64_t end = 0;
+    for (const auto &[id, range] : model) {
+        const std::optional<FrameRange> found = index.find(id);
+        ASSERT_TRUE(found) << "id " << id;
+        EXPECT_EQ(*found, range) << "id " << id;
+        end = std::max(end, range.end);
+    }
+    EXPECT_EQ(index.end(), end);
+
+    std::vector<ItemId> all;
+    index.all(all);
+    EXPECT_EQ(all, ordered(model, [](const FrameRange &) { return true; }));
+
+    std::uniform_int_distribution<std::int64_t> frames(-200, 3000);
+    for (int i = 0; i < 8; ++i) {
+        const std::int64_t frame = frames(random);
+        std::vector<ItemId> stabbed;
+        index.stab(frame, stabbed);
+        EXPECT_EQ(stabbed, ordered(model, [&](const FrameRange &r) { return r.contains(frame); }));
+
+        const FrameRange query{frame, frame + 1 + std::int64_t(random() % 300)};
+        std::vector<ItemId> overlapping;
+        index.overlapping(query, overlapping);
+        EXPECT_EQ(overlapping, ordered(model, [&](const FrameRange &r) {
+                      return r.start < query.end && r.end > query.start;
+                  }));
+    }
+}
+
+TEST(IntervalIndexTest, Empty)
+{
+    IntervalIndex index;
+    EXPECT_EQ(index.size(), 0u);
+    EXPECT_EQ(index.end(), 0);
+    EXPECT_FALSE(index.find(0));
+    EXPECT_FALSE(index.erase(0));
+    index.shift(0, 10);
+    std::vector<ItemId> out;
+    index.stab(0, out);
+    EXPECT_TRUE(out.empty());
+}
+
+TEST(IntervalIndexTest, InsertReplacesExistingId)
+{
+    IntervalIndex index;
+    index.insert(7, {0, 10});
+    index.insert(7, {20, 30});
+    EXPECT_EQ(index.size(), 1u);
+    EXPECT_EQ(index.find(7), (FrameRange{20, 30}));
+}
+
+TEST(IntervalIndexTest, NegativeShiftPassesItems)
+{
+    IntervalIndex index;
+    index.insert(1, {0, 10});
+    index.insert(2, {15, 20});
+    index.insert(3, {30, 40});
+    index.shift(30, -20);
+    std::vector<ItemId> all;
+    index.all(all);
+    EXPECT_EQ(all, (std::vector<ItemId>{1, 3, 2}));
+    EXPECT_EQ(index.find(3), (FrameRange{10, 20}));
+    EXPECT_EQ(index.find(2), (FrameRange{15, 20}));
+}
+
+TEST(IntervalIndexTest, CopiesAreUnaffectedByLaterEdits)
+{
+    IntervalIndex index;
+    for (ItemId id = 0; id < 100; ++id)
+        index.insert(id, {id * 10, id * 10 + 10});
+    const IntervalIndex copy = index;
+    index.shift(500, 7);
+    index.erase(3);
+    index.insert(200, {5, 6});
+    EXPECT_EQ(copy.size(), 100u);
+    EXPECT_EQ(copy.find(60), (FrameRange{600, 610}));
+    EXPECT_EQ(copy.find(3), (FrameRange{30, 40}));
+    EXPECT_FALSE(copy.find(200));
+    EXPECT_EQ(index.find(60), (FrameRange{607, 617}));
+}
+
+TEST(IntervalIndexTest, RepeatedInsertsAtOnePoint)
+{
+    // Each insert lands just before the previous one, in the same gap.
+    IntervalIndex index;
+    Model model;
+    index.insert(0, {0, 10});
+    model[0] = {0, 10};
+    index.insert(UINT32_MAX, {1000, 1010});
+    model[UINT32_MAX] = {1000, 1010};
+    std::mt19937 random(1);
+    std::vector<std::pair<IntervalIndex, Model>> versions;
+    for (ItemId id = 5000; id > 1000; --id) {
+        index.insert(id, {500, 510});
+        model[id] = {500, 510};
+        if (id % 500 == 0)
+            versions.push_back({index, model});
+    }
+    // And each just after the previous one.
+    for (ItemId id = 6000; id < 10000; ++id) {
+        index.insert(id, {700, 710});
+        model[id] = {700, 710};
+        if (id % 500 == 0)
+            versions.push_back({index, model});
+    }
+    expectMatches(index, model, random);
+    for (const auto &[version, versionModel] : versions)
+        expectMatches(version, versionModel, random);
+}
+
+TEST(IntervalIndexTest, RandomEditsMatchModel)
+{
+    std::mt19937 random(7);
+    IntervalIndex index;
+    Model model;
+    std::vector<std::pair<IntervalIndex, Model>> versions;
+    for (int step = 0; step < 20000; ++step) {
+        const ItemId id = step % 50 == 0 ? UINT32_MAX - random() % 3 : random() % 400;
+        switch (random() % 8) {
+        case 0:
+        case 1:
+        case 2: {
+            const std::int64_t start = random() % 2000;
+            const FrameRange range{start, start + 1 + std::int64_t(random() % 100)};
+            index.insert(id, range);
+            model[id] = range;
+            break;
+        }
+        case 3:
+        case 4:
+            EXPECT_EQ(index.erase(id), model.erase(id) > 0);
+            break;
+        case 5:
+        case 6: {
+            const std::int64_t from = random() % 2000;
+            const std::int64_t delta = std::int64_t(random() % 200) - 100;
+            index.shift(from, delta);
+            shiftModel(model, from, delta);
+            break;
+        }
+        default:
+            expectMatches(index, model, random);
+            break;
+        }
+        if (step % 1000 == 0)
+            versions.push_back({index, model});
+        if (HasFatalFailure())
+            return;
+    }
+    for (const auto &[version, versionModel] : versions)
+        expectMatches(version, versionModel, random);
+}
+
+} // namespace
+} // namespace scp
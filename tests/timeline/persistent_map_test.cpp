@@ -0,0 +1,107 @@
+// PersistentMap against std::map, including old versions kept across edits.
+
+#include "timeline/persistent_map.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace scp {
+namespace {
+
+using Model = std::map<std::uint32_t, int>;
+
+void expectMatches(const PersistentMap<int> &map, const Model &model)
+{
+    ASSERT_EQ(map.size(), model.size());
+    for (const auto &[key, value] : model) {
+        const int *found = map.find(key);
+        ASSERT_NE(found, nullptr) << "key " << key;
+        EXPECT_EQ(*found, value) << "key " << key;
+    }
+}
+
+TEST(PersistentMapTest, Empty)
+{
+    PersistentMap<int> map;
+    EXPECT_TRUE(map.isEmpty());
+    EXPECT_EQ(map.find(0), nullptr);
+    EXPECT_FALSE(map.erase(0));
+}
+
+TEST(PersistentMapTest, SetReplaces)
+{
+    PersistentMap<std::string> map;
+    map.set(1, "a");
+    map.set(1, "b");
+    EXPECT_EQ(map.size(), 1u);
+    EXPECT_EQ(*map.find(1), "b");
+}
+
+TEST(PersistentMapTest, KeysSharingLowBits)
+{
+    // Differ only in the top bits, so they split at the deepest level.
+    PersistentMap<int> map;
+    map.set(0x00000001, 1);
+    map.set(0x40000001, 2);
+    map.set(0x80000001, 3);
+    map.set(0xc0000001, 4);
+    EXPECT_EQ(*map.find(0x80000001), 3);
+    EXPECT_TRUE(map.erase(0x40000001));
+    EXPECT_FALSE(map.contains(0x40000001));
+    EXPECT_EQ(*map.find(0xc0000001), 4);
+    EXPECT_EQ(map.size(), 3u);
+}
+
+TEST(PersistentMapTest, CopiesAreUnaffectedByLaterEdits)
+{
+    PersistentMap<int> map;
+    for (std::uint32_t key = 0; key < 1000; ++key)
+        map.set(key, int(key));
+    const PersistentMap<int> copy = map;
+    map.set(5, -1);
+    map.erase(6);
+    map.set(5000, 1);
+    EXPECT_EQ(*copy.find(5), 5);
+    EXPECT_EQ(*copy.find(6), 6);
+    EXPECT_FALSE(copy.contains(5000));
+    EXPECT_EQ(copy.size(), 1000u);
+    EXPECT_EQ(*map.find(5), -1);
+}
+
+TEST(PersistentMapTest, RandomEditsMatchModel)
+{
+    std::mt19937 random(3);
+    PersistentMap<int> map;
+    Model model;
+    std::vector<std::pair<PersistentMap<int>, Model>> versions;
+    for (int step = 0; step < 100000; ++step) {
+        // Mostly a dense range like item ids, sometimes anywhere.
+        const std::uint32_t key = step % 3 == 0 ? std::uint32_t(random()) : random() % 2000;
+        if (random() % 3 == 0) {
+            EXPECT_EQ(map.erase(key), model.erase(key) > 0);
+        } else {
+            map.set(key, step);
+            model[key] = step;
+        }
+        if (step % 10000 == 0)
+            versions.push_back({map, model});
+    }
+    expectMatches(map, model);
+    for (const auto &[version, versionModel] : versions) {
+        expectMatches(version, versionModel);
+        for (std::uint32_t key = 0; key < 2000; ++key)
+            EXPECT_EQ(version.contains(key), versionModel.contains(key));
+    }
+    for (const auto &[key, value] : model)
+        EXPECT_TRUE(map.erase(key));
+    EXPECT_TRUE(map.isEmpty());
+}
+
+} // namespace
+} // namespace scp
@@ -0,0 +1,128 @@
+// The frames each Timeline edit reports as changed: every frame that can
+// render differently, and no more where the edit leaves frames as they were.
+
+#include "timeline/timeline.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace scp {
+namespace {
+
+using Ranges = std::vector<FrameRange>;
+
+TEST(TimelineChangeTest, AddFramesKeepsRangesSortedAndDisjoint)
+{
+    TimelineChange change;
+    change.addFrames({30, 40});
+    change.addFrames({10, 20});
+    change.addFrames({25, 25}); // empty
+    EXPECT_EQ(change.frames, (Ranges{{10, 20}, {30, 40}}));
+    change.addFrames({20, 25}); // touches
+    EXPECT_EQ(change.frames, (Ranges{{10, 25}, {30, 40}}));
+    change.addFrames({0, 5});
+    change.addFrames({50, 60});
+    EXPECT_EQ(change.frames, (Ranges{{0, 5}, {10, 25}, {30, 40}, {50, 60}}));
+    change.addFrames({3, 35}); // spans several
+    EXPECT_EQ(change.frames, (Ranges{{0, 40}, {50, 60}}));
+}
+
+TEST(TimelineChangeTest, MergeKeepsItemsOnce)
+{
+    TimelineChange a;
+    a.addFrames({0, 10});
+    a.items = {{0, 1}};
+    TimelineChange b;
+    b.addFrames({5, 20});
+    b.items = {{0, 1}, {1, 1}};
+    a.merge(b);
+    EXPECT_EQ(a.frames, (Ranges{{0, 20}}));
+    EXPECT_EQ(a.items, (std::vector<ItemRef>{{0, 1}, {1, 1}}));
+}
+
+class TimelineEditTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        m_timeline.addTrack(TrackKind::Video);
+        m_timeline.addItem(0, {ItemKind::Clip, "a.mov", 100}, {10, 50}, &m_clip);
+        m_timeline.addItem(0, {ItemKind::Transition, "luma", 0}, {40, 50}, &m_transition);
+        m_timeline.addItem(0, {ItemKind::Clip, "b.mov", 0}, {60, 80}, &m_next);
+    }
+
+    std::int64_t sourceIn(ItemRef ref) const
+    {
+        return m_timeline.track(ref.track).item(ref.id)->sourceIn;
+    }
+
+    Timeline m_timeline;
+    ItemRef m_clip;
+    ItemRef m_transition;
+    ItemRef m_next;
+};
+
+TEST_F(TimelineEditTest, AddRemoveAndMove)
+{
+    ItemRef added;
+    EXPECT_EQ(m_timeline.addItem(0, {}, {90, 95}, &added).frames, (Ranges{{90, 95}}));
+    const TimelineChange moved = m_timeline.moveItem(m_next, 70);
+    EXPECT_EQ(moved.frames, (Ranges{{60, 90}}));
+    EXPECT_EQ(moved.items, (std::vector<ItemRef>{m_next}));
+    EXPECT_EQ(m_timeline.removeItem(added).frames, (Ranges{{90, 95}}));
+}
+
+TEST_F(TimelineEditTest, TailTrimCoversTheDifference)
+{
+    EXPECT_EQ(m_timeline.trimItem(m_clip, {10, 40}).frames, (Ranges{{40, 50}}));
+    EXPECT_EQ(m_timeline.trimItem(m_clip, {10, 45}).frames, (Ranges{{40, 45}}));
+    EXPECT_EQ(sourceIn(m_clip), 100);
+}
+
+TEST_F(TimelineEditTest, HeadTrimCoversTheDifference)
+{
+    // The source follows the head, so [20, 50) still shows what it did.
+    const TimelineChange shortened = m_timeline.trimItem(m_clip, {20, 50});
+    EXPECT_EQ(shortened.frames, (Ranges{{10, 20}}));
+    EXPECT_EQ(shortened.items, (std::vector<ItemRef>{m_clip}));
+    EXPECT_EQ(sourceIn(m_clip), 110);
+
+    EXPECT_EQ(m_timeline.trimItem(m_clip, {5, 50}).frames, (Ranges{{5, 20}}));
+    EXPECT_EQ(sourceIn(m_clip), 95);
+}
+
+TEST_F(TimelineEditTest, TrimmingBothEnds)
+{
+    EXPECT_EQ(m_timeline.trimItem(m_clip, {15, 55}).frames, (Ranges{{10, 15}, {50, 55}}));
+    // Nothing in common with the old range: both are covered, not the gap.
+    EXPECT_EQ(m_timeline.trimItem(m_clip, {100, 110}).frames, (Ranges{{15, 55}, {100, 110}}));
+}
+
+TEST_F(TimelineEditTest, TransitionTrimCoversBothRanges)
+{
+    // A transition's progress at each frame depends on its whole range.
+    EXPECT_EQ(m_timeline.trimItem(m_transition, {45, 50}).frames, (Ranges{{40, 50}}));
+    EXPECT_EQ(m_timeline.trimItem(m_transition, {45, 55}).frames, (Ranges{{45, 55}}));
+}
+
+TEST_F(TimelineEditTest, RippleEditsCoverEverythingThatMoved)
+{
+    EXPECT_EQ(m_timeline.rippleTrimItemEnd(m_clip, 30).frames, (Ranges{{30, 80}}));
+    EXPECT_EQ(m_timeline.track(0).range(m_next.id), (FrameRange{40, 60}));
+    EXPECT_EQ(m_timeline.rippleRemoveItem(m_clip).frames, (Ranges{{10, 60}}));
+    EXPECT_EQ(m_timeline.ripple(0, 5).frames, (Ranges{{0, 45}}));
+}
+
+TEST_F(TimelineEditTest, RejectedEditsAreEmpty)
+{
+    EXPECT_TRUE(m_timeline.trimItem(m_clip, {10, 50}).isEmpty());
+    EXPECT_TRUE(m_timeline.trimItem(m_clip, {30, 30}).isEmpty());
+    EXPECT_TRUE(m_timeline.trimItem({0, 999}, {0, 10}).isEmpty());
+    EXPECT_TRUE(m_timeline.moveItem(m_clip, 10).isEmpty());
+    EXPECT_TRUE(m_timeline.removeItem({3, m_clip.id}).isEmpty());
+    EXPECT_TRUE(m_timeline.ripple(20, 0).isEmpty());
+}
+
+} // namespace
+} // namespace scp